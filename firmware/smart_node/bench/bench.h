@@ -0,0 +1,71 @@
+/**
+ * @file bench.h
+ *
+ * @brief Markers between the benchmark firmware and the simulator
+ *
+ * @details The firmware writes the benchmark identifier in GPIOR1, then a
+ *          marker in GPIOR0, which the simulator watches: the cycles between
+ *          BENCH_BEGIN and BENCH_END, minus the interrupts taken meanwhile,
+ *          are one call of the benchmark. GPIOR0 and GPIOR1 are not used by
+ *          the firmware, and the marker costs the same on both sides, so it
+ *          is measured once with BENCH_EMPTY and subtracted.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+// Data space addresses, as seen by the simulator
+#define BENCH_MARKER_ADDRESS    0x3E    // GPIOR0
+#define BENCH_ID_ADDRESS        0x4A    // GPIOR1
+
+#define BENCH_MARKER_BEGIN      1
+#define BENCH_MARKER_END        2
+#define BENCH_MARKER_DONE       3       // all run, the simulator stops
+
+typedef enum {
+    BENCH_EMPTY = 0,            // calibration of the markers
+    BENCH_TEMP_SENSOR_1MS,      // TempSensor__1msTask, a whole conversion
+    BENCH_RELAYS_1MS,           // Relays__1msTask, pulses on both relays
+    BENCH_USART_FAST,           // Usart__FastTask, while transmitting
+    BENCH_RADIO_1MS,            // Radio__1msTask, power up and bursts
+    BENCH_RADIO_PAYLOAD,        // Radio__Transmit, then the 1ms task loading it
+    BENCH_NUMBER,
+} BENCH_ID_T;
+
+// Names in the report, in the order of BENCH_ID_T
+#define BENCH_NAMES \
+    "empty", \
+    "temp_sensor_1ms_task", \
+    "relays_1ms_task", \
+    "usart_fast_task", \
+    "radio_1ms_task", \
+    "radio_payload"
+
+#ifdef __AVR__
+
+#include <avr/io.h>
+
+#define BENCH_BEGIN(id) \
+    do \
+    { \
+        GPIOR1 = (id); \
+        GPIOR0 = BENCH_MARKER_BEGIN; \
+    } while (0)
+
+#define BENCH_END()     do { GPIOR0 = BENCH_MARKER_END; } while (0)
+#define BENCH_DONE()    do { GPIOR0 = BENCH_MARKER_DONE; } while (0)
+
+#define BENCH_CALL(id, call) \
+    do \
+    { \
+        BENCH_BEGIN(id); \
+        call; \
+        BENCH_END(); \
+    } while (0)
+
+#endif /* __AVR__ */
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,229 @@
+/**
+ * @file bench_main.c
+ *
+ * @brief Benchmark firmware, run by simbench under simavr
+ *
+ * @details Takes the place of main.c: the drivers are linked as they are,
+ *          and each benchmark calls one task between the markers of
+ *          bench.h. The 1ms tasks are called from the main loop, once per
+ *          tick of the timer 0 ISR, which only runs the clock here; their
+ *          cost is the same as in the 1ms ISR of the application, which
+ *          leaves the interrupts enabled too.
+ *
+ *          The radio payload goes through the radio driver, from
+ *          Radio__Transmit to the end of the burst, with the relays idle.
+ *          The simulator answers as an nRF24L01+ on the bus and acknowledges
+ *          the bursts, and loops the USART transmitter back to the receiver.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "timer.h"
+#include "trace.h"
+#include "critical.h"
+#include "usart.h"
+#include "event.h"
+#include "spi.h"
+#include "relays.h"
+#include "radio.h"
+#include "temp_sensor.h"
+#include "bench.h"
+
+#define BENCH_CALIBRATION_RUNS      16
+#define BENCH_CONVERSIONS           2
+#define BENCH_CONVERSION_TIMEOUT_MS 2000
+#define BENCH_RELAY_TIMEOUT_MS      100
+#define BENCH_USART_BYTES           32
+#define BENCH_USART_TIMEOUT_MS      100
+#define BENCH_RADIO_RUNS            4
+#define BENCH_RADIO_TIMEOUT_MS      100
+
+static uint8_t Radio_Payload[RADIO_PAYLOAD_SIZE];
+static BOOL_T Conversion_Over;
+
+static void WaitTick(void)
+{
+    uint32_t ms = Timer__GetMs();
+
+    while (Timer__GetMs() == ms)
+    {
+    }
+}
+
+static void OnConversionOver(const EVENT_RECORD_T *event)
+{
+    (void)event;
+    Conversion_Over = TRUE;
+}
+
+static void BenchTempSensor(void)
+{
+    uint16_t elapsed_ms;
+    uint8_t i;
+
+    for (i = 0; i < BENCH_CONVERSIONS; i++)
+    {
+        // Configured first, on the first run
+        Conversion_Over = FALSE;
+        TempSensor__StartAcquisition();
+        for (elapsed_ms = 0; elapsed_ms < BENCH_CONVERSION_TIMEOUT_MS; elapsed_ms++)
+        {
+            WaitTick();
+            BENCH_CALL(BENCH_TEMP_SENSOR_1MS, TempSensor__1msTask());
+            Event__FastTask();
+            if (Conversion_Over)
+            {
+                break;
+            }
+        }
+    }
+}
+
+static void WaitRelay(RELAY_T relay)
+{
+    uint8_t elapsed_ms;
+
+    for (elapsed_ms = 0; elapsed_ms < BENCH_RELAY_TIMEOUT_MS; elapsed_ms++)
+    {
+        WaitTick();
+        BENCH_CALL(BENCH_RELAYS_1MS, Relays__1msTask());
+        if (Relays__IsBusy(relay) == 0)
+        {
+            break;
+        }
+    }
+}
+
+static void BenchRelays(void)
+{
+    uint8_t relay;
+
+    for (relay = 0; relay < RELAYS_NUMBER; relay++)
+    {
+        Relays__Set((RELAY_T)relay);
+        WaitRelay((RELAY_T)relay);
+        Relays__Reset((RELAY_T)relay);
+        WaitRelay((RELAY_T)relay);
+    }
+    // Both at once, the second one waits for the current budget
+    Relays__SetGroup(RELAYS_ALL_MASK);
+    WaitRelay(RELAY_0);
+    WaitRelay(RELAY_1);
+}
+
+static void BenchUsart(void)
+{
+    uint8_t received = 0;
+    uint8_t elapsed_ms;
+    uint8_t i;
+
+    for (i = 0; i < BENCH_USART_BYTES; i++)
+    {
+        Usart__PutChar(i);
+    }
+    while (Usart__IsTxBufferEmpty() == FALSE)
+    {
+        BENCH_CALL(BENCH_USART_FAST, Usart__FastTask());
+    }
+
+    // Looped back by the simulator, through the RX ISR
+    for (elapsed_ms = 0; elapsed_ms < BENCH_USART_TIMEOUT_MS && received < BENCH_USART_BYTES; elapsed_ms++)
+    {
+        WaitTick();
+        while (Usart__IsRxBufferEmpty() == FALSE)
+        {
+            (void)Usart__GetChar();
+            received++;
+        }
+    }
+}
+
+/**
+ * @brief   Run the radio 1ms task until it is idle, or for a while
+ */
+static void WaitRadio(void)
+{
+    uint8_t elapsed_ms;
+
+    for (elapsed_ms = 0; elapsed_ms < BENCH_RADIO_TIMEOUT_MS; elapsed_ms++)
+    {
+        WaitTick();
+        BENCH_CALL(BENCH_RADIO_1MS, Radio__1msTask());
+        if (Radio__IsBusy() == FALSE)
+        {
+            break;
+        }
+    }
+}
+
+static void BenchRadio(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < RADIO_PAYLOAD_SIZE; i++)
+    {
+        Radio_Payload[i] = i;
+    }
+
+    // Listening after the start-up delay
+    Radio__TurnOn();
+    for (i = 0; i < BENCH_RADIO_TIMEOUT_MS; i++)
+    {
+        WaitTick();
+        BENCH_CALL(BENCH_RADIO_1MS, Radio__1msTask());
+    }
+
+    for (i = 0; i < BENCH_RADIO_RUNS; i++)
+    {
+        WaitTick();
+        BENCH_BEGIN(BENCH_RADIO_PAYLOAD);
+        (void)Radio__Transmit(Radio_Payload);
+        Radio__1msTask();
+        BENCH_END();
+        WaitRadio();
+    }
+}
+
+int main(void)
+{
+    uint8_t i;
+
+    Timer__Initialize();
+    Trace__Initialize();
+    Critical__Initialize();
+    Usart__Initialize();
+    Event__Initialize();
+    Spi__Initialize();
+    Relays__Initialize();
+    Radio__Initialize();
+    TempSensor__Initialize();
+    Event__Subscribe(EVENT_TEMPERATURE_READY, OnConversionOver);
+    Event__Subscribe(EVENT_TEMPERATURE_ERROR, OnConversionOver);
+    Micro__EnableInterrupts();
+
+    for (i = 0; i < BENCH_CALIBRATION_RUNS; i++)
+    {
+        BENCH_BEGIN(BENCH_EMPTY);
+        BENCH_END();
+    }
+
+    BenchTempSensor();
+    BenchRelays();
+    BenchUsart();
+    BenchRadio();
+
+    BENCH_DONE();
+    while (1)
+    {
+    }
+}
+
+/**
+ * Timer 0 compare match ISR, the clock only
+ */
+ISR(TIMER0_COMPA_vect, ISR_NOBLOCK)
+{
+    Timer__1msTask();
+}
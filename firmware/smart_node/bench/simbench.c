@@ -0,0 +1,689 @@
+/**
+ * @file simbench.c
+ *
+ * @brief Cycle counts of the drivers, on the benchmark firmware under simavr
+ *
+ * @details Runs bench.elf on the simavr ATmega328P one instruction at a time
+ *          and writes a JSON report on stdout, or in the file given after
+ *          the firmware:
+ *
+ *          benchmarks      cycles per call between the markers of bench.h,
+ *                          without the interrupts taken meanwhile and the
+ *                          cost of the markers
+ *          isr             per vector: calls, latency from the flag to the
+ *                          first instruction of the vector, and cycles, not
+ *                          counting the interrupts nested in it
+ *          interrupts_off  spans with the I bit clear, by the function that
+ *                          cleared it, or the vector for a blocking ISR
+ *          models          what the peripherals saw
+ *
+ *          The bus models: the DS18B20 of the host build on PD7, driven at
+ *          each instruction, with the reading of SMART_NODE_TEMPERATURE; an
+ *          nRF24L01+ on the SPI, CSN on PB2, answering STATUS and its
+ *          registers, whose bursts on CE (PB1) are acknowledged on IRQ
+ *          (PD2) after NRF24_BURST_CYCLES; the USART transmitter looped
+ *          back to the receiver.
+ *          The cycle counts are deterministic, so two reports of the same
+ *          firmware are equal, and tools/bench_compare.py tells the
+ *          differences between two commits.
+ *
+ *          Build, from bench/:
+ *
+ *              avr-gcc -mmcu=atmega328p -std=gnu99 -Os -g -I../src \
+ *                  -I../src/drivers -o bench.elf bench_main.c \
+ *                  $(find ../src -name '*.c' ! -name main.c ! -path '*host*')
+ *              gcc -std=gnu99 -O2 -I/usr/include/simavr \
+ *                  -I../src/host/include -I../src/host -o simbench \
+ *                  simbench.c ../src/host/host_onewire.c -lsimavr -lelf
+ *              ./simbench bench.elf > report.json
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <fcntl.h>
+#include <gelf.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "sim_irq.h"
+#include "sim_interrupts.h"
+#include "avr_ioport.h"
+#include "avr_spi.h"
+#include "avr_uart.h"
+
+#include "host.h"
+#include "bench.h"
+
+#define SIMBENCH_MCU            "atmega328p"
+#define SIMBENCH_F_CPU          16000000UL
+#define SIMBENCH_MAX_CYCLES     (60ULL * SIMBENCH_F_CPU)    // a minute, then the firmware is stuck
+
+#define SIMBENCH_VECTORS        26
+#define SIMBENCH_NESTING        8
+#define SIMBENCH_SITES          64
+
+// Data space addresses
+#define SIMBENCH_DDRD           0x2A
+#define SIMBENCH_PORTD          0x2B
+#define SIMBENCH_ONEWIRE_PIN    7
+
+#define SIMBENCH_RESET_CYCLES   (450 * (SIMBENCH_F_CPU / 1000000))
+
+// nRF24L01+ commands and registers
+#define NRF24_R_REGISTER        0x00
+#define NRF24_W_REGISTER        0x20
+#define NRF24_REGISTER_MASK     0x1F
+#define NRF24_R_RX_PAYLOAD      0x61
+#define NRF24_W_TX_PAYLOAD      0xA0
+#define NRF24_FLUSH_TX          0xE1
+#define NRF24_NOP               0xFF
+#define NRF24_STATUS            0x07
+#define NRF24_STATUS_TX_DS      0x20
+#define NRF24_STATUS_IRQ        0x70
+#define NRF24_REGISTERS         0x20
+#define NRF24_CE_PIN            1
+#define NRF24_IRQ_PIN           2
+
+// Settling, 32 bytes at 1Mbps and the acknowledgement
+#define NRF24_BURST_CYCLES      (700 * (SIMBENCH_F_CPU / 1000000))
+
+typedef struct {
+    uint32_t calls;
+    uint64_t min;
+    uint64_t max;
+    uint64_t total;
+} STATS_T;
+
+typedef struct {
+    uint8_t vector;
+    uint64_t entry;
+    uint64_t nested;    // cycles of the ISRs nested in this one
+} FRAME_T;
+
+typedef struct {
+    STATS_T cycles;
+    STATS_T latency;
+    uint64_t pending_since;
+    uint8_t pending;
+} VECTOR_T;
+
+typedef struct {
+    const char *name;
+    STATS_T cycles;
+} SITE_T;
+
+typedef struct {
+    uint64_t address;
+    uint64_t size;
+    char *name;
+} SYMBOL_T;
+
+static const char *const Bench_Names[BENCH_NUMBER] = {BENCH_NAMES};
+
+static const char *const Vector_Names[SIMBENCH_VECTORS] = {
+    "RESET", "INT0_vect", "INT1_vect", "PCINT0_vect", "PCINT1_vect",
+    "PCINT2_vect", "WDT_vect", "TIMER2_COMPA_vect", "TIMER2_COMPB_vect",
+    "TIMER2_OVF_vect", "TIMER1_CAPT_vect", "TIMER1_COMPA_vect",
+    "TIMER1_COMPB_vect", "TIMER1_OVF_vect", "TIMER0_COMPA_vect",
+    "TIMER0_COMPB_vect", "TIMER0_OVF_vect", "SPI_STC_vect", "USART_RX_vect",
+    "USART_UDRE_vect", "USART_TX_vect", "ADC_vect", "EE_READY_vect",
+    "ANALOG_COMP_vect", "TWI_vect", "SPM_READY_vect",
+};
+
+static avr_t *Avr;
+static uint8_t Done;
+
+// Benchmarks
+static STATS_T Benchmarks[BENCH_NUMBER];
+static uint8_t Bench_Id;
+static uint64_t Bench_Begin;
+static uint64_t Bench_Begin_Isr;
+
+// Interrupts
+static VECTOR_T Vectors[SIMBENCH_VECTORS];
+static FRAME_T Frames[SIMBENCH_NESTING];
+static uint8_t Depth;
+static uint8_t Entered;         // a vector was entered in this step
+static uint64_t Isr_Cycles;     // outermost ISRs, since the start
+
+// Interrupts off
+static SITE_T Sites[SIMBENCH_SITES];
+static uint8_t Sites_Number;
+static const char *Off_Site;
+static uint64_t Off_Since;
+
+static SYMBOL_T *Symbols;
+static uint32_t Symbols_Number;
+
+// Models
+static avr_irq_t *Onewire_Irq;
+static uint8_t Onewire_Master_Low;
+static uint8_t Onewire_Level;
+static uint64_t Onewire_Low_Since;
+static uint32_t Onewire_Resets;
+
+static avr_irq_t *Spi_Input_Irq;
+static uint8_t Nrf24_Registers[NRF24_REGISTERS];
+static uint8_t Nrf24_Command;
+static uint8_t Nrf24_Index;
+static uint32_t Nrf24_Transactions;
+static uint32_t Nrf24_Bytes;
+static uint32_t Nrf24_Payload_Bytes;
+static uint8_t Nrf24_Tx_Full;
+static uint64_t Nrf24_Burst_End;    // 0: none
+static uint32_t Nrf24_Bursts;
+static avr_irq_t *Nrf24_Irq;
+
+static avr_irq_t *Uart_Input_Irq;
+static uint32_t Uart_Bytes;
+
+static void Record(STATS_T *stats, uint64_t value)
+{
+    if (stats->calls == 0 || value < stats->min)
+    {
+        stats->min = value;
+    }
+    if (value > stats->max)
+    {
+        stats->max = value;
+    }
+    stats->total += value;
+    stats->calls++;
+}
+
+static void ReadSymbols(const char *path)
+{
+    Elf *elf;
+    Elf_Scn *section = NULL;
+    Elf_Data *data;
+    GElf_Shdr header;
+    GElf_Sym symbol;
+    size_t i;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || elf_version(EV_CURRENT) == EV_NONE ||
+        (elf = elf_begin(fd, ELF_C_READ, NULL)) == NULL)
+    {
+        return;
+    }
+    while ((section = elf_nextscn(elf, section)) != NULL)
+    {
+        if (gelf_getshdr(section, &header) == NULL || header.sh_type != SHT_SYMTAB)
+        {
+            continue;
+        }
+        data = elf_getdata(section, NULL);
+        Symbols = calloc(header.sh_size / header.sh_entsize, sizeof(SYMBOL_T));
+        for (i = 0; i < header.sh_size / header.sh_entsize; i++)
+        {
+            if (gelf_getsym(data, (int)i, &symbol) != NULL &&
+                GELF_ST_TYPE(symbol.st_info) == STT_FUNC && symbol.st_size != 0)
+            {
+                Symbols[Symbols_Number].address = symbol.st_value;
+                Symbols[Symbols_Number].size = symbol.st_size;
+                Symbols[Symbols_Number].name = strdup(elf_strptr(elf, header.sh_link, symbol.st_name));
+                Symbols_Number++;
+            }
+        }
+    }
+    elf_end(elf);
+    close(fd);
+}
+
+static const char *FunctionAt(uint32_t pc)
+{
+    uint32_t i;
+
+    for (i = 0; i < Symbols_Number; i++)
+    {
+        if (pc >= Symbols[i].address && pc < Symbols[i].address + Symbols[i].size)
+        {
+            return Symbols[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static void OnMarker(struct avr_t *avr, avr_io_addr_t address, uint8_t value, void *param)
+{
+    uint64_t cycles;
+
+    (void)param;
+    avr->data[address] = value;
+    switch (value)
+    {
+        case BENCH_MARKER_BEGIN:
+        {
+            Bench_Id = avr->data[BENCH_ID_ADDRESS];
+            Bench_Begin = avr->cycle;
+            Bench_Begin_Isr = Isr_Cycles;
+            break;
+        }
+        case BENCH_MARKER_END:
+        {
+            if (Bench_Id < BENCH_NUMBER)
+            {
+                cycles = (avr->cycle - Bench_Begin) - (Isr_Cycles - Bench_Begin_Isr);
+                Record(&Benchmarks[Bench_Id], cycles);
+            }
+            break;
+        }
+        case BENCH_MARKER_DONE:
+        {
+            Done = 1;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+static void OnPending(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    VECTOR_T *vector = &Vectors[(uintptr_t)param];
+
+    (void)irq;
+    if (value && vector->pending == 0)
+    {
+        vector->pending_since = Avr->cycle;
+    }
+    vector->pending = value ? 1 : 0;
+}
+
+static void OnRunning(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    uint8_t number = (uint8_t)(uintptr_t)param;
+    VECTOR_T *vector = &Vectors[number];
+    FRAME_T *frame;
+    uint64_t cycles;
+
+    (void)irq;
+    if (value)
+    {
+        Record(&vector->latency, Avr->cycle - vector->pending_since);
+        vector->pending = 0;
+        if (Depth < SIMBENCH_NESTING)
+        {
+            Frames[Depth].vector = number;
+            Frames[Depth].entry = Avr->cycle;
+            Frames[Depth].nested = 0;
+        }
+        Depth++;
+        Entered = 1;
+    }
+    else if (Depth != 0)
+    {
+        Depth--;
+        if (Depth < SIMBENCH_NESTING)
+        {
+            frame = &Frames[Depth];
+            cycles = Avr->cycle - frame->entry;
+            Record(&Vectors[frame->vector].cycles, cycles - frame->nested);
+            if (Depth == 0)
+            {
+                Isr_Cycles += cycles;
+            }
+            else if (Depth - 1 < SIMBENCH_NESTING)
+            {
+                Frames[Depth - 1].nested += cycles;
+            }
+        }
+    }
+}
+
+static SITE_T *Site(const char *name)
+{
+    uint8_t i;
+
+    for (i = 0; i < Sites_Number; i++)
+    {
+        if (strcmp(Sites[i].name, name) == 0)
+        {
+            return &Sites[i];
+        }
+    }
+    if (Sites_Number == SIMBENCH_SITES)
+    {
+        return NULL;
+    }
+    Sites[Sites_Number].name = name;
+    return &Sites[Sites_Number++];
+}
+
+/**
+ * @brief   Follow the I bit, after each step
+ *
+ * @param   pc          instruction of the step
+ * @param   enabled     I bit before the step
+ */
+static void FollowInterrupts(uint32_t pc, uint8_t enabled)
+{
+    SITE_T *site;
+
+    if (enabled && Avr->sreg[S_I] == 0)
+    {
+        Off_Since = Avr->cycle;
+        Off_Site = Entered ? Vector_Names[Frames[(Depth - 1) % SIMBENCH_NESTING].vector] :
+                             FunctionAt(pc);
+    }
+    else if (enabled == 0 && Avr->sreg[S_I] && Off_Site != NULL)
+    {
+        site = Site(Off_Site);
+        if (site != NULL)
+        {
+            Record(&site->cycles, Avr->cycle - Off_Since);
+        }
+        Off_Site = NULL;
+    }
+    Entered = 0;
+}
+
+/**
+ * @brief   DS18B20: the master edges in, the bus level out, at each step
+ *
+ * @details The master drives the bus low with the pin as an output low,
+ *          and releases it to the pull-up as an input.
+ */
+static void FollowOnewire(void)
+{
+    uint8_t mask = 1 << SIMBENCH_ONEWIRE_PIN;
+    uint8_t master_low = (Avr->data[SIMBENCH_DDRD] & mask) && (Avr->data[SIMBENCH_PORTD] & mask) == 0;
+    uint8_t level;
+
+    if (master_low && Onewire_Master_Low == 0)
+    {
+        Onewire_Low_Since = Avr->cycle;
+    }
+    else if (master_low == 0 && Onewire_Master_Low &&
+             Avr->cycle - Onewire_Low_Since >= SIMBENCH_RESET_CYCLES)
+    {
+        Onewire_Resets++;
+    }
+    Onewire_Master_Low = master_low;
+
+    HostOnewire__Update(Avr->cycle, master_low);
+    level = (master_low || HostOnewire__IsLow(Avr->cycle)) ? 0 : 1;
+    if (level != Onewire_Level)
+    {
+        Onewire_Level = level;
+        avr_raise_irq(Onewire_Irq, level);
+    }
+}
+
+/**
+ * @brief   nRF24L01+: the end of a burst, acknowledged by the receiver
+ */
+static void FollowNrf24(void)
+{
+    if (Nrf24_Burst_End != 0 && Avr->cycle >= Nrf24_Burst_End)
+    {
+        Nrf24_Burst_End = 0;
+        Nrf24_Tx_Full = 0;
+        Nrf24_Bursts++;
+        Nrf24_Registers[NRF24_STATUS] |= NRF24_STATUS_TX_DS;
+        avr_raise_irq(Nrf24_Irq, 0);
+    }
+}
+
+static void OnCe(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    if (value != 0 && Nrf24_Tx_Full && Nrf24_Burst_End == 0)
+    {
+        Nrf24_Burst_End = Avr->cycle + NRF24_BURST_CYCLES;
+    }
+}
+
+static void OnCsn(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    if (value == 0)
+    {
+        Nrf24_Index = 0;
+        Nrf24_Transactions++;
+    }
+}
+
+/**
+ * @brief   nRF24L01+: the byte shifted in for the one from the master
+ *
+ * @details STATUS while the command comes in, then the registers, one byte
+ *          each, the addresses too.
+ */
+static uint8_t Nrf24Exchange(uint8_t data)
+{
+    uint8_t reply = 0;
+    uint8_t reg = Nrf24_Command & NRF24_REGISTER_MASK;
+
+    Nrf24_Bytes++;
+    if (Nrf24_Index == 0)
+    {
+        Nrf24_Command = data;
+        reply = Nrf24_Registers[NRF24_STATUS];
+        if (data == NRF24_FLUSH_TX)
+        {
+            Nrf24_Tx_Full = 0;
+        }
+    }
+    else if (Nrf24_Command == NRF24_W_TX_PAYLOAD)
+    {
+        Nrf24_Payload_Bytes++;
+        Nrf24_Tx_Full = 1;
+    }
+    else if (Nrf24_Command == (NRF24_W_REGISTER | NRF24_STATUS))
+    {
+        // The interrupt flags clear when written with one
+        Nrf24_Registers[NRF24_STATUS] &= ~(data & NRF24_STATUS_IRQ);
+        if ((Nrf24_Registers[NRF24_STATUS] & NRF24_STATUS_IRQ) == 0)
+        {
+            avr_raise_irq(Nrf24_Irq, 1);
+        }
+    }
+    else if (Nrf24_Command == NRF24_R_RX_PAYLOAD || Nrf24_Command == NRF24_NOP)
+    {
+        reply = 0;
+    }
+    else if ((Nrf24_Command & ~NRF24_REGISTER_MASK) == NRF24_W_REGISTER)
+    {
+        Nrf24_Registers[reg] = data;
+    }
+    else if ((Nrf24_Command & ~NRF24_REGISTER_MASK) == NRF24_R_REGISTER)
+    {
+        reply = Nrf24_Registers[reg];
+    }
+    Nrf24_Index++;
+    return reply;
+}
+
+static void OnSpiOutput(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    avr_raise_irq(Spi_Input_Irq, Nrf24Exchange((uint8_t)value));
+}
+
+static void OnUartOutput(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    Uart_Bytes++;
+    avr_raise_irq(Uart_Input_Irq, value);
+}
+
+static void AttachModels(void)
+{
+    static const uint8_t nrf24_reset[] = {0x08, 0x3F, 0x03, 0x03, 0x03, 0x02, 0x0E, 0x0E};
+    uint32_t flags = 0;
+    uint8_t i;
+
+    HostOnewire__Initialize();
+    Onewire_Irq = avr_io_getirq(Avr, AVR_IOCTL_IOPORT_GETIRQ('D'), SIMBENCH_ONEWIRE_PIN);
+    Onewire_Level = 1;
+    avr_raise_irq(Onewire_Irq, 1);
+
+    memcpy(Nrf24_Registers, nrf24_reset, sizeof(nrf24_reset));
+    Nrf24_Registers[0x17] = 0x11;   // FIFO_STATUS, both empty
+    Spi_Input_Irq = avr_io_getirq(Avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(Avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), OnSpiOutput, NULL);
+    avr_irq_register_notify(avr_io_getirq(Avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2), OnCsn, NULL);
+    avr_irq_register_notify(avr_io_getirq(Avr, AVR_IOCTL_IOPORT_GETIRQ('B'), NRF24_CE_PIN), OnCe, NULL);
+    Nrf24_Irq = avr_io_getirq(Avr, AVR_IOCTL_IOPORT_GETIRQ('D'), NRF24_IRQ_PIN);
+    avr_raise_irq(Nrf24_Irq, 1);
+
+    // Not on the console, the report goes to stdout
+    avr_ioctl(Avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(Avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    Uart_Input_Irq = avr_io_getirq(Avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(Avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), OnUartOutput, NULL);
+
+    for (i = 0; i < Avr->interrupts.vector_count; i++)
+    {
+        avr_int_vector_t *vector = Avr->interrupts.vector[i];
+
+        if (vector->vector < SIMBENCH_VECTORS)
+        {
+            avr_irq_register_notify(vector->irq + AVR_INT_IRQ_PENDING, OnPending, (void *)(uintptr_t)vector->vector);
+            avr_irq_register_notify(vector->irq + AVR_INT_IRQ_RUNNING, OnRunning, (void *)(uintptr_t)vector->vector);
+        }
+    }
+    avr_register_io_write(Avr, BENCH_MARKER_ADDRESS, OnMarker, NULL);
+}
+
+static void PrintStats(FILE *out, const STATS_T *stats, uint64_t offset)
+{
+    uint64_t min = (stats->min > offset) ? stats->min - offset : 0;
+    uint64_t max = (stats->max > offset) ? stats->max - offset : 0;
+    double mean = stats->calls ? (double)stats->total / stats->calls - (double)offset : 0;
+
+    fprintf(out, "\"calls\": %" PRIu32 ", \"min\": %" PRIu64 ", \"mean\": %.1f, \"max\": %" PRIu64,
+            stats->calls, min, (mean > 0) ? mean : 0, max);
+}
+
+static void Report(FILE *out, const char *firmware)
+{
+    uint64_t marker = Benchmarks[BENCH_EMPTY].min;
+    const SITE_T *worst = NULL;
+    uint64_t total = 0;
+    const char *separator = "";
+    uint8_t i;
+
+    fprintf(out, "{\n  \"firmware\": \"%s\",\n  \"mcu\": \"%s\",\n  \"f_cpu\": %lu,\n",
+            firmware, SIMBENCH_MCU, SIMBENCH_F_CPU);
+    fprintf(out, "  \"cycles\": %" PRIu64 ",\n  \"marker_cycles\": %" PRIu64 ",\n", Avr->cycle, marker);
+
+    fprintf(out, "  \"benchmarks\": {");
+    for (i = BENCH_EMPTY + 1; i < BENCH_NUMBER; i++)
+    {
+        fprintf(out, "%s\n    \"%s\": {", separator, Bench_Names[i]);
+        PrintStats(out, &Benchmarks[i], marker);
+        fprintf(out, "}");
+        separator = ",";
+    }
+
+    fprintf(out, "\n  },\n  \"isr\": {");
+    separator = "";
+    for (i = 0; i < SIMBENCH_VECTORS; i++)
+    {
+        if (Vectors[i].cycles.calls == 0)
+        {
+            continue;
+        }
+        fprintf(out, "%s\n    \"%s\": {", separator, Vector_Names[i]);
+        PrintStats(out, &Vectors[i].cycles, 0);
+        fprintf(out, ", \"latency_max\": %" PRIu64 ", \"latency_mean\": %.1f}",
+                Vectors[i].latency.max, (double)Vectors[i].latency.total / Vectors[i].latency.calls);
+        separator = ",";
+    }
+
+    fprintf(out, "\n  },\n  \"interrupts_off\": {\n    \"sites\": {");
+    separator = "";
+    for (i = 0; i < Sites_Number; i++)
+    {
+        if (worst == NULL || Sites[i].cycles.max > worst->cycles.max)
+        {
+            worst = &Sites[i];
+        }
+        total += Sites[i].cycles.total;
+        fprintf(out, "%s\n      \"%s\": {", separator, Sites[i].name);
+        PrintStats(out, &Sites[i].cycles, 0);
+        fprintf(out, "}");
+        separator = ",";
+    }
+    fprintf(out, "\n    },\n    \"max\": %" PRIu64 ",\n    \"max_site\": \"%s\",\n    \"total\": %" PRIu64 "\n  },\n",
+            worst ? worst->cycles.max : 0, worst ? worst->name : "", total);
+
+    fprintf(out, "  \"models\": {\n    \"onewire_resets\": %" PRIu32 ",\n    \"nrf24_transactions\": %" PRIu32
+            ",\n    \"nrf24_bytes\": %" PRIu32 ",\n    \"nrf24_payload_bytes\": %" PRIu32
+            ",\n    \"nrf24_bursts\": %" PRIu32 ",\n    \"usart_bytes\": %" PRIu32 "\n  }\n}\n",
+            Onewire_Resets, Nrf24_Transactions, Nrf24_Bytes, Nrf24_Payload_Bytes, Nrf24_Bursts, Uart_Bytes);
+}
+
+int main(int argc, char *argv[])
+{
+    elf_firmware_t firmware;
+    FILE *out = stdout;
+    uint32_t pc;
+    uint8_t enabled;
+    int state = cpu_Running;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s bench.elf [report.json]\n", argv[0]);
+        return 2;
+    }
+
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(argv[1], &firmware) != 0)
+    {
+        fprintf(stderr, "simbench: cannot read %s\n", argv[1]);
+        return 2;
+    }
+    firmware.frequency = SIMBENCH_F_CPU;
+    Avr = avr_make_mcu_by_name(SIMBENCH_MCU);
+    if (Avr == NULL)
+    {
+        fprintf(stderr, "simbench: no %s in simavr\n", SIMBENCH_MCU);
+        return 2;
+    }
+    avr_init(Avr);
+    Avr->log = LOG_ERROR;
+    avr_load_firmware(Avr, &firmware);
+    ReadSymbols(argv[1]);
+    AttachModels();
+
+    while (Done == 0 && state != cpu_Done && state != cpu_Crashed && Avr->cycle < SIMBENCH_MAX_CYCLES)
+    {
+        pc = Avr->pc;
+        enabled = Avr->sreg[S_I];
+        state = avr_run(Avr);
+        FollowInterrupts(pc, enabled);
+        FollowOnewire();
+        FollowNrf24();
+    }
+    if (Done == 0)
+    {
+        fprintf(stderr, "simbench: firmware %s at cycle %" PRIu64 "\n",
+                (state == cpu_Crashed) ? "crashed" : "did not finish", Avr->cycle);
+        return 1;
+    }
+
+    if (argc > 2 && (out = fopen(argv[2], "w")) == NULL)
+    {
+        fprintf(stderr, "simbench: cannot write %s\n", argv[2]);
+        return 2;
+    }
+    Report(out, argv[1]);
+    return 0;
+}
@@ -0,0 +1,565 @@
+/**
+ * @file simlatency.c
+ *
+ * @brief End-to-end latency of the firmware under simavr, with a gateway
+ *
+ * @details Runs the firmware built with PROBE_ENABLED on the simavr
+ *          ATmega328P, paced to the wall clock, with its USART on a pty.
+ *          The gateway runs as a child process on the other side of the pty
+ *          and timestamps its own stages on the same clock, CLOCK_MONOTONIC,
+ *          in the same events file. tools/latency_report.py makes the
+ *          histograms.
+ *
+ *          One line per stage of a reading or a command: microseconds,
+ *          stage, sequence number of the report or of the request.
+ *
+ *          convert         the DS18B20 model finished CONVERT_T
+ *          ready           the driver has the scratchpad, PROBE_SENSOR_READY
+ *          decision        the thermostat ran its control on the sample
+ *          queued          the report frame is in the USART buffer
+ *          wire            the last byte of the frame left the USART
+ *          command_wire    the last byte of a request went to the USART
+ *          command_parsed  the request passed the CRC
+ *          command_decision the thermostat ran its control on the change
+ *          pulse           a relay coil started moving, first pin up
+ *
+ *          The DS18B20 of the host build is on PD7, reading a triangle
+ *          between 18 and 22 Celsius. The USART runs at the firmware baud
+ *          rate both ways, one byte per character time. Without the pacing
+ *          the host stages would not be comparable; the worst lag of the
+ *          simulation behind the wall clock is printed at the end.
+ *
+ *          Build, from bench/:
+ *
+ *              avr-gcc -mmcu=atmega328p -std=gnu99 -Os -g -DPROBE_ENABLED \
+ *                  -I../src -I../src/drivers -o latency.elf \
+ *                  $(find ../src -name '*.c' ! -path '*host*')
+ *              gcc -std=gnu99 -O2 -I/usr/include/simavr \
+ *                  -I../src/host/include -I../src/host -I../src/drivers \
+ *                  -o simlatency simlatency.c ../src/host/host_onewire.c \
+ *                  -lsimavr -lelf
+ *              ./simlatency latency.elf 600 events.log \
+ *                  ../tools/latency_gateway.py --events events.log
+ *              ../tools/latency_report.py events.log
+ *
+ *          The path of the pty is appended to the gateway command.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "sim_irq.h"
+#include "avr_ioport.h"
+#include "avr_uart.h"
+
+#include "host.h"
+#include "probe.h"
+
+#define SIMLATENCY_MCU              "atmega328p"
+#define SIMLATENCY_F_CPU            16000000UL
+#define SIMLATENCY_CYCLES_PER_US    (SIMLATENCY_F_CPU / 1000000)
+#define SIMLATENCY_BAUDRATE         9600    // USART_BAUDRATE
+#define SIMLATENCY_CHAR_CYCLES      (SIMLATENCY_F_CPU * 10 / SIMLATENCY_BAUDRATE)  // 8N1
+#define SIMLATENCY_PACE_STEPS       1024    // instructions between two looks at the clock
+#define SIMLATENCY_QUEUE_SIZE       256
+
+// Injected temperature, 1/16 Celsius
+#define SIMLATENCY_LOW              (18 * 16)
+#define SIMLATENCY_HIGH             (22 * 16)
+#define SIMLATENCY_PERIOD_S         120
+
+// Data space addresses
+#define SIMLATENCY_DDRD             0x2A
+#define SIMLATENCY_PORTD            0x2B
+#define SIMLATENCY_ONEWIRE_PIN      7
+#define SIMLATENCY_COIL_FIRST_PIN   3       // PD3 to PD6, set and reset of both relays
+#define SIMLATENCY_COIL_LAST_PIN    6
+
+// Frame tags of command.h and trace.h
+#define SIMLATENCY_REQUEST_TAG      'C'
+#define SIMLATENCY_RESPONSE_TAG     'R'
+#define SIMLATENCY_REPORT_TAG       'S'
+#define SIMLATENCY_TRACE_TAG        'T'
+#define SIMLATENCY_TRACE_RECORD     4
+
+typedef enum {
+    PARSER_TAG = 0,
+    PARSER_LENGTH,
+    PARSER_BODY,
+} PARSER_STATE_T;
+
+/**
+ * Frames on one direction of the USART, to find the sequence numbers
+ */
+typedef struct {
+    PARSER_STATE_T state;
+    uint8_t tag;
+    uint16_t left;      // bytes of the frame still to come
+    uint16_t index;
+    uint8_t sequence;   // first byte of the payload
+} PARSER_T;
+
+typedef struct {
+    uint64_t due;       // cycle
+    uint8_t data;
+} QUEUED_BYTE_T;
+
+typedef struct {
+    QUEUED_BYTE_T bytes[SIMLATENCY_QUEUE_SIZE];
+    uint16_t head;
+    uint16_t count;
+} BYTE_QUEUE_T;
+
+static avr_t *Avr;
+static FILE *Events;
+static uint64_t Start_Us;       // CLOCK_MONOTONIC at cycle 0
+static uint64_t Worst_Lag_Us;
+static int Pty;
+static pid_t Gateway;
+static volatile sig_atomic_t Stop;
+
+// Sensor path, the sample being followed
+static uint64_t Convert_Us;
+static uint64_t Ready_Us;
+static uint64_t Decision_Us;
+
+// Command path, the request being followed
+static uint8_t Command_Pending;
+static uint8_t Command_Sequence;
+static uint64_t Command_Decision_Us;
+
+static avr_irq_t *Onewire_Irq;
+static uint8_t Onewire_Level;
+
+static avr_irq_t *Uart_Input_Irq;
+static BYTE_QUEUE_T Tx_Queue;   // firmware to pty
+static BYTE_QUEUE_T Rx_Queue;   // pty to firmware
+static uint64_t Rx_Next;        // cycle the USART receiver takes the next byte
+static PARSER_T Tx_Parser;
+static PARSER_T Rx_Parser;
+
+static uint64_t Monotonic(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+static uint64_t CycleToUs(uint64_t cycle)
+{
+    return Start_Us + cycle / SIMLATENCY_CYCLES_PER_US;
+}
+
+static void Emit(uint64_t us, const char *stage, uint8_t sequence)
+{
+    fprintf(Events, "%" PRIu64 " %s %u\n", us, stage, sequence);
+    fflush(Events);
+}
+
+static uint8_t Push(BYTE_QUEUE_T *queue, uint64_t due, uint8_t data)
+{
+    QUEUED_BYTE_T *entry;
+
+    if (queue->count == SIMLATENCY_QUEUE_SIZE)
+    {
+        return 0;
+    }
+    entry = &queue->bytes[(queue->head + queue->count) % SIMLATENCY_QUEUE_SIZE];
+    entry->due = due;
+    entry->data = data;
+    queue->count++;
+    return 1;
+}
+
+static const QUEUED_BYTE_T *Peek(const BYTE_QUEUE_T *queue)
+{
+    return (queue->count != 0) ? &queue->bytes[queue->head] : NULL;
+}
+
+static void Pop(BYTE_QUEUE_T *queue)
+{
+    queue->head = (queue->head + 1) % SIMLATENCY_QUEUE_SIZE;
+    queue->count--;
+}
+
+/**
+ * @brief   Follow the frames, one byte at a time
+ *
+ * @return  Tag of the frame the byte completed, 0 if none
+ */
+static uint8_t Parse(PARSER_T *parser, uint8_t data)
+{
+    switch (parser->state)
+    {
+        case PARSER_TAG:
+        {
+            if (data == SIMLATENCY_REQUEST_TAG || data == SIMLATENCY_RESPONSE_TAG ||
+                data == SIMLATENCY_REPORT_TAG || data == SIMLATENCY_TRACE_TAG)
+            {
+                parser->tag = data;
+                parser->state = PARSER_LENGTH;
+            }
+            break;
+        }
+        case PARSER_LENGTH:
+        {
+            // Payload and CRC, or the trace records
+            parser->left = (parser->tag == SIMLATENCY_TRACE_TAG) ?
+                           (uint16_t)(data * SIMLATENCY_TRACE_RECORD) : (uint16_t)(data + 1);
+            parser->index = 0;
+            parser->state = (parser->left != 0) ? PARSER_BODY : PARSER_TAG;
+            break;
+        }
+        case PARSER_BODY:
+        {
+            if (parser->index++ == 0)
+            {
+                parser->sequence = data;
+            }
+            if (--parser->left == 0)
+            {
+                parser->state = PARSER_TAG;
+                return parser->tag;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief   DS18B20 reading, at the end of each conversion
+ *
+ * @details Overrides the one of the host build.
+ */
+int16_t Host__GetTemperature(void)
+{
+    uint64_t period = (uint64_t)SIMLATENCY_PERIOD_S * SIMLATENCY_F_CPU;
+    uint64_t phase = Avr->cycle % period;
+    uint64_t half = period / 2;
+    uint64_t rise = (phase < half) ? phase : period - phase;
+
+    Convert_Us = CycleToUs(Avr->cycle);
+    Ready_Us = 0;
+    Decision_Us = 0;
+    return (int16_t)(SIMLATENCY_LOW + (SIMLATENCY_HIGH - SIMLATENCY_LOW) * rise / half);
+}
+
+static void OnProbe(struct avr_t *avr, avr_io_addr_t address, uint8_t value, void *param)
+{
+    uint8_t arg = avr->data[PROBE_ARG_ADDRESS];
+    uint64_t now = CycleToUs(avr->cycle);
+
+    (void)param;
+    avr->data[address] = value;
+    switch (value)
+    {
+        case PROBE_SENSOR_READY:
+        {
+            if (Convert_Us != 0 && Ready_Us == 0)
+            {
+                Ready_Us = now;
+            }
+            break;
+        }
+        case PROBE_DECISION:
+        {
+            if ((arg & PROBE_DECISION_CHANGE) == 0 && Ready_Us != 0 && Decision_Us == 0)
+            {
+                Decision_Us = now;
+            }
+            else if ((arg & PROBE_DECISION_CHANGE) && Command_Pending && Command_Decision_Us == 0)
+            {
+                Command_Decision_Us = now;
+                Emit(now, "command_decision", Command_Sequence);
+            }
+            break;
+        }
+        case PROBE_FRAME_QUEUED:
+        {
+            if (Decision_Us != 0)
+            {
+                Emit(Convert_Us, "convert", arg);
+                Emit(Ready_Us, "ready", arg);
+                Emit(Decision_Us, "decision", arg);
+            }
+            Emit(now, "queued", arg);
+            Convert_Us = 0;
+            Ready_Us = 0;
+            Decision_Us = 0;
+            break;
+        }
+        case PROBE_COMMAND_PARSED:
+        {
+            Command_Pending = 1;
+            Command_Sequence = arg;
+            Command_Decision_Us = 0;
+            Emit(now, "command_parsed", arg);
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+static void OnCoil(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    if (value && Command_Pending && Command_Decision_Us != 0)
+    {
+        Emit(CycleToUs(Avr->cycle), "pulse", Command_Sequence);
+        Command_Pending = 0;
+    }
+}
+
+/**
+ * @brief   A byte written in UDR, on the pty once shifted out
+ */
+static void OnUartOutput(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    if (Push(&Tx_Queue, Avr->cycle + SIMLATENCY_CHAR_CYCLES, (uint8_t)value) == 0)
+    {
+        fprintf(stderr, "simlatency: transmit queue full\n");
+    }
+}
+
+static void FollowOnewire(void)
+{
+    uint8_t mask = 1 << SIMLATENCY_ONEWIRE_PIN;
+    uint8_t master_low = (Avr->data[SIMLATENCY_DDRD] & mask) && (Avr->data[SIMLATENCY_PORTD] & mask) == 0;
+    uint8_t level;
+
+    HostOnewire__Update(Avr->cycle, master_low);
+    level = (master_low || HostOnewire__IsLow(Avr->cycle)) ? 0 : 1;
+    if (level != Onewire_Level)
+    {
+        Onewire_Level = level;
+        avr_raise_irq(Onewire_Irq, level);
+    }
+}
+
+/**
+ * @brief   Move the USART bytes that are due, both ways
+ */
+static void FollowUart(void)
+{
+    const QUEUED_BYTE_T *entry;
+    uint8_t buffer[SIMLATENCY_QUEUE_SIZE];
+    ssize_t size;
+    ssize_t i;
+
+    while ((entry = Peek(&Tx_Queue)) != NULL && entry->due <= Avr->cycle)
+    {
+        if (write(Pty, &entry->data, 1) != 1)
+        {
+            fprintf(stderr, "simlatency: byte lost, the gateway does not read\n");
+        }
+        if (Parse(&Tx_Parser, entry->data) == SIMLATENCY_REPORT_TAG)
+        {
+            Emit(CycleToUs(entry->due), "wire", Tx_Parser.sequence);
+        }
+        Pop(&Tx_Queue);
+    }
+
+    size = read(Pty, buffer, SIMLATENCY_QUEUE_SIZE - Rx_Queue.count);
+    for (i = 0; i < size; i++)
+    {
+        Rx_Next = (Rx_Next > Avr->cycle) ? Rx_Next : Avr->cycle;
+        Rx_Next += SIMLATENCY_CHAR_CYCLES;
+        (void)Push(&Rx_Queue, Rx_Next, buffer[i]);
+    }
+    while ((entry = Peek(&Rx_Queue)) != NULL && entry->due <= Avr->cycle)
+    {
+        avr_raise_irq(Uart_Input_Irq, entry->data);
+        if (Parse(&Rx_Parser, entry->data) == SIMLATENCY_REQUEST_TAG)
+        {
+            Emit(CycleToUs(entry->due), "command_wire", Rx_Parser.sequence);
+        }
+        Pop(&Rx_Queue);
+    }
+}
+
+/**
+ * @brief   Wait for the wall clock when ahead, note the lag when behind
+ */
+static void Pace(void)
+{
+    uint64_t simulated = CycleToUs(Avr->cycle);
+    uint64_t now = Monotonic();
+    struct timespec wait;
+
+    if (simulated > now)
+    {
+        wait.tv_sec = (time_t)((simulated - now) / 1000000);
+        wait.tv_nsec = (long)((simulated - now) % 1000000) * 1000;
+        nanosleep(&wait, NULL);
+    }
+    else if (now - simulated > Worst_Lag_Us)
+    {
+        Worst_Lag_Us = now - simulated;
+    }
+}
+
+static int OpenPty(void)
+{
+    struct termios termios;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0 || tcgetattr(fd, &termios) != 0)
+    {
+        return -1;
+    }
+    cfmakeraw(&termios);
+    tcsetattr(fd, TCSANOW, &termios);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static pid_t StartGateway(char *command[], int words)
+{
+    char **argv = calloc((size_t)words + 2, sizeof(char *));
+    pid_t pid;
+
+    memcpy(argv, command, (size_t)words * sizeof(char *));
+    argv[words] = ptsname(Pty);
+    pid = fork();
+    if (pid == 0)
+    {
+        execvp(argv[0], argv);
+        fprintf(stderr, "simlatency: cannot run %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    free(argv);
+    return pid;
+}
+
+static void AttachModels(void)
+{
+    uint32_t flags = 0;
+    int pin;
+
+    HostOnewire__Initialize();
+    Onewire_Irq = avr_io_getirq(Avr, AVR_IOCTL_IOPORT_GETIRQ('D'), SIMLATENCY_ONEWIRE_PIN);
+    Onewire_Level = 1;
+    avr_raise_irq(Onewire_Irq, 1);
+
+    for (pin = SIMLATENCY_COIL_FIRST_PIN; pin <= SIMLATENCY_COIL_LAST_PIN; pin++)
+    {
+        avr_irq_register_notify(avr_io_getirq(Avr, AVR_IOCTL_IOPORT_GETIRQ('D'), pin), OnCoil, NULL);
+    }
+
+    avr_ioctl(Avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(Avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    Uart_Input_Irq = avr_io_getirq(Avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(Avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), OnUartOutput, NULL);
+
+    avr_register_io_write(Avr, PROBE_STAGE_ADDRESS, OnProbe, NULL);
+}
+
+static void OnSignal(int signal)
+{
+    (void)signal;
+    Stop = 1;
+}
+
+int main(int argc, char *argv[])
+{
+    elf_firmware_t firmware;
+    uint64_t end;
+    uint32_t steps = 0;
+    int state = cpu_Running;
+    int status = 0;
+
+    if (argc < 4)
+    {
+        fprintf(stderr, "usage: %s latency.elf seconds events.log [gateway command...]\n", argv[0]);
+        return 2;
+    }
+
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(argv[1], &firmware) != 0)
+    {
+        fprintf(stderr, "simlatency: cannot read %s\n", argv[1]);
+        return 2;
+    }
+    firmware.frequency = SIMLATENCY_F_CPU;
+    Avr = avr_make_mcu_by_name(SIMLATENCY_MCU);
+    if (Avr == NULL)
+    {
+        fprintf(stderr, "simlatency: no %s in simavr\n", SIMLATENCY_MCU);
+        return 2;
+    }
+    end = strtoull(argv[2], NULL, 0) * SIMLATENCY_F_CPU;
+    if ((Events = fopen(argv[3], "w")) == NULL || (Pty = OpenPty()) < 0)
+    {
+        fprintf(stderr, "simlatency: cannot open %s or a pty\n", argv[3]);
+        return 2;
+    }
+    avr_init(Avr);
+    Avr->log = LOG_ERROR;
+    avr_load_firmware(Avr, &firmware);
+    AttachModels();
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    if (argc > 4)
+    {
+        Gateway = StartGateway(&argv[4], argc - 4);
+    }
+    else
+    {
+        fprintf(stderr, "simlatency: USART on %s\n", ptsname(Pty));
+    }
+
+    Start_Us = Monotonic();
+    while (Stop == 0 && state != cpu_Done && state != cpu_Crashed && Avr->cycle < end)
+    {
+        state = avr_run(Avr);
+        FollowOnewire();
+        if (++steps == SIMLATENCY_PACE_STEPS)
+        {
+            steps = 0;
+            FollowUart();
+            Pace();
+        }
+    }
+
+    if (Gateway > 0)
+    {
+        kill(Gateway, SIGTERM);
+        waitpid(Gateway, &status, 0);
+    }
+    fclose(Events);
+    fprintf(stderr, "simlatency: %.1f s simulated, worst lag behind the wall clock %" PRIu64 " us\n",
+            (double)Avr->cycle / SIMLATENCY_F_CPU, Worst_Lag_Us);
+    if (state == cpu_Crashed)
+    {
+        fprintf(stderr, "simlatency: firmware crashed at cycle %" PRIu64 "\n", (uint64_t)Avr->cycle);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,435 @@
+/**
+ * @file esb.c
+ *
+ * @brief nRF24L01+ Enhanced ShockBurst and channel access, network simulator
+ *
+ * @details A node sends one packet at a time, to its parent. It powers up
+ *          if needed (1.5ms), waits for its turn on the channel, settles
+ *          the PLL (130us) and transmits, then listens for the acknowledge.
+ *          With none within ARD of the end of the packet it sends the same
+ *          packet again, up to ARC times, then gives up (MAX_RT) and the
+ *          reports in it are lost. The receiver acknowledges 130us after a
+ *          packet, and passes it up unless it has the same PID as the last
+ *          one from that sender, i.e. the acknowledge was lost.
+ *          The gateway, the routers and with listen=1 every node stay in RX
+ *          between two packets, the others power down.
+ *          A node that runs the firmware sends what its driver puts in the
+ *          TX FIFO of nrf24.c, at once on the CE pulse, with the ARC and
+ *          ARD of its registers, and its radio state is the one of the
+ *          chip between two packets. The gateway sends its requests like
+ *          a model node.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "netsim.h"
+
+#define ESB_POWER_UP_US         1500    // Tpd2stby
+#define ESB_SETTLING_US         130     // Tstby2a
+#define ESB_SUPPLY_V            3.3
+
+#define ESB_TAG(source, pid)    ((uint32_t)(source) | ((uint32_t)(pid) << 16))
+#define ESB_TAG_SOURCE(tag)     ((uint16_t)((tag) & 0xFFFF))
+#define ESB_TAG_PID(tag)        ((uint8_t)((tag) >> 16))
+
+// Supply current in mA, by state, RX by data rate and TX by output power
+static const double Off_Ma = 0.0009;
+static const double Standby_Ma = 0.026;
+static const double Rx_Ma[3] = {12.6, 13.1, 13.5};
+static const double Tx_Ma[4] = {11.3, 9.0, 7.5, 7.0};  // 0, -6, -12, -18 dBm
+
+static uint8_t *Last_Pid;       // receiver x sender, PID + 1 of the last packet
+
+static void SetState(NODE_T *node, RADIO_STATE_T state)
+{
+    SIM_TIME_T now = Events__Now();
+
+    node->time_in[node->state] += now - node->state_since;
+    node->state = state;
+    node->state_since = now;
+    if (state == RADIO_RX)
+    {
+        node->rx_since = now + ESB_SETTLING_US;
+    }
+}
+
+static uint8_t Listens(uint16_t id)
+{
+    return (id == NETSIM_GATEWAY) || Netsim__Nodes[id].router || Netsim__Config.listen;
+}
+
+static void Idle(uint16_t id)
+{
+    if (Firmware__Runs(id))
+    {
+        SetState(&Netsim__Nodes[id], Nrf24__GetState(id));
+    }
+    else
+    {
+        SetState(&Netsim__Nodes[id], Listens(id) ? RADIO_RX : RADIO_OFF);
+    }
+}
+
+static uint8_t Retransmits(uint16_t id)
+{
+    return Firmware__Runs(id) ? Nrf24__GetRetransmits(id) : Netsim__Config.retransmits;
+}
+
+static uint16_t RetransmitDelayUs(uint16_t id)
+{
+    return Firmware__Runs(id) ? Nrf24__GetRetransmitDelayUs(id) : Netsim__Config.retransmit_delay_us;
+}
+
+static SIM_TIME_T AccessDelay(uint16_t id)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    SIM_TIME_T now = Events__Now();
+    SIM_TIME_T frame;
+    SIM_TIME_T start;
+
+    if (config->mac == MAC_TDMA)
+    {
+        frame = (SIM_TIME_T)config->nodes * config->slot_us;
+        start = (SIM_TIME_T)Netsim__Nodes[id].slot * config->slot_us;
+        return (start + frame - now % frame) % frame;
+    }
+    return (SIM_TIME_T)(Netsim__Uniform() * config->jitter_ms * NETSIM_US_PER_MS);
+}
+
+static void Finish(uint16_t id, uint8_t acknowledged)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+
+    node->generation++;
+    node->busy = 0;
+    node->awaiting_ack = 0;
+    Idle(id);
+    if (Firmware__Runs(id))
+    {
+        Nrf24__Sent(id, acknowledged);
+    }
+    else
+    {
+        Node__Sent(id, acknowledged);
+    }
+}
+
+static void Start(const EVENT_T *event)
+{
+    NODE_T *node = &Netsim__Nodes[event->node];
+    SIM_TIME_T now = Events__Now();
+
+    if (node->acking)
+    {
+        Events__Schedule(now + ESB_SETTLING_US + Medium__Airtime(0), EVENT_TX_START, event->node, event->tag);
+    }
+    else if (Firmware__Runs(event->node))
+    {
+        // Powered up by the driver, no channel access
+        SetState(node, RADIO_TX);
+        Events__Schedule(now + ESB_SETTLING_US, EVENT_TX_AIR, event->node, event->tag);
+    }
+    else if (node->state == RADIO_OFF)
+    {
+        SetState(node, RADIO_STANDBY);
+        Events__Schedule(now + ESB_POWER_UP_US, EVENT_TX_START, event->node, event->tag);
+    }
+    else if (Netsim__Config.mac == MAC_CSMA && Medium__IsBusy(event->node))
+    {
+        node->cca_busy++;
+        Events__Schedule(now + Medium__Airtime(NETSIM_PAYLOAD_MAX) * (1 + Netsim__Random() % 8),
+                         EVENT_TX_START, event->node, event->tag);
+    }
+    else
+    {
+        SetState(node, RADIO_TX);
+        Events__Schedule(now + ESB_SETTLING_US, EVENT_TX_AIR, event->node, event->tag);
+    }
+}
+
+static void Air(const EVENT_T *event)
+{
+    NODE_T *node = &Netsim__Nodes[event->node];
+    TRANSMISSION_T packet = {0};
+    SIM_TIME_T now = Events__Now();
+    uint8_t size = NETSIM_PAYLOAD_MAX;
+
+    if (node->attempts == 0)
+    {
+        node->pid = (node->pid + 1) & 0x03;
+        node->packets++;
+    }
+    else
+    {
+        node->retransmissions++;
+    }
+    packet.destination = node->parent;
+    if (Firmware__Runs(event->node))
+    {
+        Nrf24__GetPayload(event->node, packet.payload);
+    }
+    else if (event->node == NETSIM_GATEWAY)
+    {
+        packet.destination = Node__TakeRequest(packet.payload);
+    }
+    else
+    {
+        node->in_flight = Node__TakeReports(event->node, packet.reports,
+                                            (node->attempts == 0) ? NETSIM_REPORTS_MAX : node->in_flight);
+        size = NETSIM_HEADER_SIZE + node->in_flight * NETSIM_REPORT_SIZE;
+    }
+    packet.kind = TRANSMISSION_DATA;
+    packet.source = event->node;
+    packet.pid = node->pid;
+    packet.reports_number = node->in_flight;
+    packet.start = now;
+    packet.end = now + Medium__Airtime(size);
+    node->transmissions++;
+    node->airtime += packet.end - packet.start;
+    Events__Schedule(packet.end, EVENT_TX_END, event->node, Medium__Begin(&packet));
+}
+
+static void DataEnd(const TRANSMISSION_T *packet, uint32_t index)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    NODE_T *sender = &Netsim__Nodes[packet->source];
+    NODE_T *receiver = &Netsim__Nodes[packet->destination];
+    uint8_t *last_pid = &Last_Pid[(uint32_t)packet->destination * config->nodes + packet->source];
+    SIM_TIME_T now = Events__Now();
+
+    // Retransmission settled ARD after the end of this packet
+    SetState(sender, RADIO_RX);
+    sender->awaiting_ack = 1;
+    Events__Schedule(now + RetransmitDelayUs(packet->source) - ESB_SETTLING_US, EVENT_ACK_TIMEOUT,
+                     packet->source, sender->generation);
+
+    if (Medium__Receive(index, packet->destination) == 0 ||
+        (Firmware__Runs(packet->destination) && Nrf24__IsRxFull(packet->destination)))
+    {
+        return;
+    }
+    receiver->acking = 1;
+    SetState(receiver, RADIO_TX);
+    Events__Schedule(now + ESB_SETTLING_US, EVENT_ACK_START, packet->destination,
+                     ESB_TAG(packet->source, packet->pid));
+    if (*last_pid == packet->pid + 1)
+    {
+        receiver->duplicates++;
+    }
+    else
+    {
+        *last_pid = packet->pid + 1;
+        Node__Receive(packet->destination, packet);
+    }
+}
+
+static void AckStart(const EVENT_T *event)
+{
+    NODE_T *node = &Netsim__Nodes[event->node];
+    TRANSMISSION_T ack = {0};
+    SIM_TIME_T now = Events__Now();
+
+    ack.kind = TRANSMISSION_ACK;
+    ack.source = event->node;
+    ack.destination = ESB_TAG_SOURCE(event->tag);
+    ack.pid = ESB_TAG_PID(event->tag);
+    ack.start = now;
+    ack.end = now + Medium__Airtime(0);
+    node->acks++;
+    node->airtime += ack.end - ack.start;
+    Events__Schedule(ack.end, EVENT_TX_END, event->node, Medium__Begin(&ack));
+}
+
+static void AckEnd(const TRANSMISSION_T *ack, uint32_t index)
+{
+    NODE_T *sender = &Netsim__Nodes[ack->destination];
+    NODE_T *receiver = &Netsim__Nodes[ack->source];
+
+    receiver->acking = 0;
+    Idle(ack->source);
+    if (sender->awaiting_ack && sender->pid == ack->pid && Medium__Receive(index, ack->destination))
+    {
+        sender->acknowledged++;
+        Node__DropReports(ack->destination, sender->in_flight);
+        Finish(ack->destination, 1);
+    }
+}
+
+static void AckTimeout(const EVENT_T *event)
+{
+    NODE_T *node = &Netsim__Nodes[event->node];
+
+    if (event->tag != node->generation || node->awaiting_ack == 0)
+    {
+        return;
+    }
+    node->awaiting_ack = 0;
+    node->attempts++;
+    if (node->attempts <= Retransmits(event->node))
+    {
+        SetState(node, RADIO_TX);
+        Events__Schedule(Events__Now() + ESB_SETTLING_US, EVENT_TX_AIR, event->node, node->generation);
+    }
+    else
+    {
+        node->max_rt++;
+        node->lost_reports += node->in_flight;
+        Node__DropReports(event->node, node->in_flight);
+        Finish(event->node, 0);
+    }
+}
+
+void Esb__Initialize(void)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    SIM_TIME_T shortest = 2 * ESB_SETTLING_US + Medium__Airtime(0);
+    uint16_t i;
+
+    if (config->retransmit_delay_us < shortest)
+    {
+        fprintf(stderr, "netsim: ARD %uus is shorter than the acknowledge, %lluus\n",
+                config->retransmit_delay_us, (unsigned long long)shortest);
+    }
+    Last_Pid = calloc((size_t)config->nodes * config->nodes, 1);
+    for (i = 0; i < config->nodes; i++)
+    {
+        Netsim__Nodes[i].state = RADIO_OFF;
+        if (Listens(i) && Firmware__Runs(i) == 0)
+        {
+            SetState(&Netsim__Nodes[i], RADIO_RX);
+            Netsim__Nodes[i].rx_since = ESB_POWER_UP_US + ESB_SETTLING_US;
+        }
+    }
+}
+
+/**
+ * @brief   Send the reports at the head of the queue, or the request of the
+ *          gateway, if not sending yet
+ */
+void Esb__Send(uint16_t id)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+    uint8_t payload[NETSIM_PAYLOAD_MAX];
+
+    if (node->busy || Firmware__Runs(id))
+    {
+        return;
+    }
+    if ((id == NETSIM_GATEWAY) ? (Node__TakeRequest(payload) == NETSIM_NOBODY) : (node->queue_count == 0))
+    {
+        return;
+    }
+    node->busy = 1;
+    node->attempts = 0;
+    node->generation++;
+    Events__Schedule(Events__Now() + AccessDelay(id), EVENT_TX_START, id, node->generation);
+}
+
+/**
+ * @brief   CE pulse of a node that runs the firmware, with a payload in the
+ *          TX FIFO
+ */
+void Esb__Burst(uint16_t id, SIM_TIME_T at)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+
+    if (node->busy)
+    {
+        return;
+    }
+    node->busy = 1;
+    node->attempts = 0;
+    node->generation++;
+    Events__Schedule(at, EVENT_TX_START, id, node->generation);
+}
+
+/**
+ * @brief   The driver changed the mode of the chip: follow it, between two
+ *          packets
+ */
+void Esb__Refresh(uint16_t id)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+
+    if (node->busy == 0 && node->acking == 0 && node->state != Nrf24__GetState(id))
+    {
+        Idle(id);
+    }
+}
+
+void Esb__Event(const EVENT_T *event)
+{
+    const TRANSMISSION_T *transmission;
+
+    switch (event->type)
+    {
+        case EVENT_TX_START:
+        {
+            Start(event);
+            break;
+        }
+        case EVENT_TX_AIR:
+        {
+            Air(event);
+            break;
+        }
+        case EVENT_TX_END:
+        {
+            transmission = Medium__Get(event->tag);
+            if (transmission->kind == TRANSMISSION_DATA)
+            {
+                DataEnd(transmission, event->tag);
+            }
+            else
+            {
+                AckEnd(transmission, event->tag);
+            }
+            break;
+        }
+        case EVENT_ACK_START:
+        {
+            AckStart(event);
+            break;
+        }
+        case EVENT_ACK_TIMEOUT:
+        {
+            AckTimeout(event);
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief   Close the time in the current states, at the end of the run
+ */
+void Esb__Finish(SIM_TIME_T now)
+{
+    uint16_t i;
+    NODE_T *node;
+
+    for (i = 0; i < Netsim__Config.nodes; i++)
+    {
+        node = &Netsim__Nodes[i];
+        node->time_in[node->state] += now - node->state_since;
+        node->state_since = now;
+    }
+}
+
+double Esb__EnergyMj(const NODE_T *node)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    uint8_t power = (uint8_t)((-config->power_dbm) / 6);
+    double ma_us = node->time_in[RADIO_OFF] * Off_Ma +
+                   node->time_in[RADIO_STANDBY] * Standby_Ma +
+                   node->time_in[RADIO_RX] * Rx_Ma[config->rate] +
+                   node->time_in[RADIO_TX] * Tx_Ma[(power < 4) ? power : 3];
+
+    return ma_us * ESB_SUPPLY_V / NETSIM_US_PER_S;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file events.c
+ *
+ * @brief Queue of the timed events of the network simulator
+ *
+ * @details A binary heap on the time, then on the order of scheduling, so
+ *          a run is the same for the same seed.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "netsim.h"
+
+#define EVENTS_INITIAL_SIZE     1024
+
+static EVENT_T *Heap;
+static uint32_t Heap_Size;
+static uint32_t Heap_Count;
+static uint64_t Order;
+static SIM_TIME_T Now;
+static uint64_t Processed;
+
+static uint8_t IsBefore(const EVENT_T *a, const EVENT_T *b)
+{
+    return (a->at < b->at) || (a->at == b->at && a->order < b->order);
+}
+
+static void Swap(uint32_t a, uint32_t b)
+{
+    EVENT_T event = Heap[a];
+
+    Heap[a] = Heap[b];
+    Heap[b] = event;
+}
+
+void Events__Initialize(void)
+{
+    Heap_Size = EVENTS_INITIAL_SIZE;
+    Heap = malloc(Heap_Size * sizeof(EVENT_T));
+    Heap_Count = 0;
+    Order = 0;
+    Now = 0;
+    Processed = 0;
+}
+
+void Events__Schedule(SIM_TIME_T at, EVENT_TYPE_T type, uint16_t node, uint32_t tag)
+{
+    uint32_t i = Heap_Count;
+
+    if (Heap_Count == Heap_Size)
+    {
+        Heap_Size *= 2;
+        Heap = realloc(Heap, Heap_Size * sizeof(EVENT_T));
+        if (Heap == NULL)
+        {
+            fprintf(stderr, "netsim: out of memory for the events\n");
+            exit(1);
+        }
+    }
+    Heap[i].at = (at < Now) ? Now : at;
+    Heap[i].order = Order++;
+    Heap[i].tag = tag;
+    Heap[i].node = node;
+    Heap[i].type = type;
+    Heap_Count++;
+
+    while (i != 0 && IsBefore(&Heap[i], &Heap[(i - 1) / 2]))
+    {
+        Swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/**
+ * @brief   Take the earliest event, the time moves to it
+ *
+ * @return  0 when there is none left
+ */
+uint8_t Events__Next(EVENT_T *event)
+{
+    uint32_t i = 0;
+    uint32_t child;
+
+    if (Heap_Count == 0)
+    {
+        return 0;
+    }
+    *event = Heap[0];
+    Now = event->at;
+    Processed++;
+
+    Heap_Count--;
+    Heap[0] = Heap[Heap_Count];
+    while ((child = 2 * i + 1) < Heap_Count)
+    {
+        if (child + 1 < Heap_Count && IsBefore(&Heap[child + 1], &Heap[child]))
+        {
+            child++;
+        }
+        if (IsBefore(&Heap[i], &Heap[child]))
+        {
+            break;
+        }
+        Swap(i, child);
+        i = child;
+    }
+    return 1;
+}
+
+SIM_TIME_T Events__Now(void)
+{
+    return Now;
+}
+
+uint64_t Events__GetProcessed(void)
+{
+    return Processed;
+}
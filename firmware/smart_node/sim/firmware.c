@@ -0,0 +1,282 @@
+/**
+ * @file firmware.c
+ *
+ * @brief The firmware of each node, in one process, network simulator
+ *
+ * @details The firmware and the host backend are linked once, as
+ *          firmware.o, with their variables moved to sections of their own
+ *          (see the build in netsim.h). Each node has a copy of them, and
+ *          a stack where main() runs as a coroutine: before a node runs,
+ *          the copy of the node that ran last is saved and its own is put
+ *          in place. A node runs until its main loop is idle, in
+ *          Host__Wait, then yields until the next event of its micro, or
+ *          until an input from the network comes first.
+ *          Virtual time: cycle 0 of a node is its power on, at a random
+ *          time in the first FIRMWARE_BOOT_SPREAD_US. In its delays and
+ *          busy waits a node runs ahead of the network, a few microseconds.
+ *          Its USART is not connected: stdin is /dev/null, the output is
+ *          dropped.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "host.h"
+#include "relays.h"
+#include "netsim.h"
+
+#define FIRMWARE_CYCLES_PER_US  16ULL
+#define FIRMWARE_STACK_SIZE     (64 * 1024)
+#define FIRMWARE_BOOT_SPREAD_US (5 * NETSIM_US_PER_S)
+
+typedef struct {
+    ucontext_t context;
+    uint8_t *image;             // while another node runs
+    SIM_TIME_T boot;            // at cycle 0
+    SIM_TIME_T wake;            // of the pending EVENT_FIRMWARE
+} FIRMWARE_T;
+
+// Sections of firmware.o, made by objcopy
+extern uint8_t __start_firmware_data[];
+extern uint8_t __stop_firmware_data[];
+extern uint8_t __start_firmware_bss[];
+extern uint8_t __stop_firmware_bss[];
+extern uint8_t __start_firmware_noinit[];
+extern uint8_t __stop_firmware_noinit[];
+
+// main() of main.c, renamed
+int Firmware__Main(void);
+
+static FIRMWARE_T *Firmwares;
+static uint8_t *Process_Image;  // of the process, before the first node
+static uint16_t Current = NETSIM_NOBODY;    // whose image is in place
+static ucontext_t Scheduler;
+
+static size_t DataSize(void)
+{
+    return (size_t)(__stop_firmware_data - __start_firmware_data);
+}
+
+static size_t BssSize(void)
+{
+    return (size_t)(__stop_firmware_bss - __start_firmware_bss);
+}
+
+static size_t NoinitSize(void)
+{
+    return (size_t)(__stop_firmware_noinit - __start_firmware_noinit);
+}
+
+static void Save(uint8_t *image)
+{
+    memcpy(image, __start_firmware_data, DataSize());
+    memcpy(image + DataSize(), __start_firmware_bss, BssSize());
+    memcpy(image + DataSize() + BssSize(), __start_firmware_noinit, NoinitSize());
+}
+
+static void Load(const uint8_t *image)
+{
+    memcpy(__start_firmware_data, image, DataSize());
+    memcpy(__start_firmware_bss, image + DataSize(), BssSize());
+    memcpy(__start_firmware_noinit, image + DataSize() + BssSize(), NoinitSize());
+}
+
+/**
+ * @brief   Put the image of a node in place
+ */
+static void Switch(uint16_t node)
+{
+    if (node == Current)
+    {
+        return;
+    }
+    if (Current != NETSIM_NOBODY)
+    {
+        Save(Firmwares[Current].image);
+    }
+    Load(Firmwares[node].image);
+    Current = node;
+}
+
+static void Schedule(uint16_t node, SIM_TIME_T at)
+{
+    FIRMWARE_T *firmware = &Firmwares[node];
+
+    if (at < Events__Now())
+    {
+        at = Events__Now();
+    }
+    if (at < firmware->wake)
+    {
+        firmware->wake = at;
+        Events__Schedule(at, EVENT_FIRMWARE, node, 0);
+    }
+}
+
+static void Run(void)
+{
+    (void)Firmware__Main();
+    fprintf(stderr, "netsim: the firmware of node %u returned\n", Current);
+    exit(1);
+}
+
+void Firmware__Initialize(void)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    size_t size = DataSize() + BssSize() + NoinitSize();
+    FIRMWARE_T *firmware;
+    uint16_t i;
+
+    if (config->stack != STACK_FIRMWARE)
+    {
+        return;
+    }
+    if (freopen("/dev/null", "r", stdin) == NULL)
+    {
+        fprintf(stderr, "netsim: cannot disconnect stdin\n");
+    }
+    unsetenv("SMART_NODE_RUN_MS");
+
+    Firmwares = calloc(config->nodes, sizeof(FIRMWARE_T));
+    Process_Image = malloc(size);
+    if (Firmwares == NULL || Process_Image == NULL)
+    {
+        fprintf(stderr, "netsim: out of memory for the firmware\n");
+        exit(1);
+    }
+    Save(Process_Image);
+    Current = NETSIM_NOBODY;
+
+    for (i = 1; i < config->nodes; i++)
+    {
+        firmware = &Firmwares[i];
+        firmware->image = malloc(size);
+        firmware->context.uc_stack.ss_sp = malloc(FIRMWARE_STACK_SIZE);
+        if (firmware->image == NULL || firmware->context.uc_stack.ss_sp == NULL)
+        {
+            fprintf(stderr, "netsim: out of memory for the firmware\n");
+            exit(1);
+        }
+        // Power on, with the EEPROMs of a new board
+        Load(Process_Image);
+        Host__Reset();
+        Save(firmware->image);
+
+        getcontext(&firmware->context);
+        firmware->context.uc_stack.ss_size = FIRMWARE_STACK_SIZE;
+        firmware->context.uc_link = NULL;
+        makecontext(&firmware->context, Run, 0);
+
+        Nrf24__Initialize(i);
+        firmware->boot = (SIM_TIME_T)(Netsim__Uniform() * FIRMWARE_BOOT_SPREAD_US);
+        firmware->wake = NETSIM_NEVER;
+        Schedule(i, firmware->boot);
+    }
+    Load(Process_Image);
+}
+
+uint8_t Firmware__Runs(uint16_t node)
+{
+    return Netsim__Config.stack == STACK_FIRMWARE && node != NETSIM_GATEWAY;
+}
+
+/**
+ * @brief   EVENT_FIRMWARE: run the node until it is idle
+ */
+void Firmware__Event(const EVENT_T *event)
+{
+    FIRMWARE_T *firmware = &Firmwares[event->node];
+
+    if (event->at != firmware->wake)
+    {
+        // Brought forward by an input
+        return;
+    }
+    firmware->wake = NETSIM_NEVER;
+    Switch(event->node);
+    swapcontext(&Scheduler, &firmware->context);
+}
+
+/**
+ * @brief   An input for a node: run it, if it is idle
+ */
+void Firmware__Wake(uint16_t node, SIM_TIME_T at)
+{
+    Schedule(node, at);
+}
+
+/**
+ * @return  The node that is running, NETSIM_NOBODY between two
+ */
+uint16_t Firmware__Current(void)
+{
+    return Current;
+}
+
+/**
+ * @return  Time of the node that is running, ahead of the network in its
+ *          busy waits
+ */
+SIM_TIME_T Firmware__Now(void)
+{
+    SIM_TIME_T now = Firmwares[Current].boot + Host__GetCycles() / FIRMWARE_CYCLES_PER_US;
+
+    return (now > Events__Now()) ? now : Events__Now();
+}
+
+/**
+ * @return  Relays set on the board of a node, for the heating of its room
+ */
+uint8_t Firmware__GetRelaysSet(uint16_t node)
+{
+    uint8_t set = 0;
+    uint8_t relay;
+
+    Switch(node);
+    for (relay = 0; relay < RELAYS_NUMBER; relay++)
+    {
+        set += Relays__IsSet((RELAY_T)relay) ? 1 : 0;
+    }
+    return set;
+}
+
+/**
+ * @brief   Put the image of the process back, for the exit of the host
+ */
+void Firmware__Finish(void)
+{
+    if (Firmwares == NULL)
+    {
+        return;
+    }
+    if (Current != NETSIM_NOBODY)
+    {
+        Save(Firmwares[Current].image);
+    }
+    Load(Process_Image);
+    Current = NETSIM_NOBODY;
+}
+
+/**
+ * @brief   Idle main loop of the running node: back to the network until
+ *          the cycle due, or an input
+ */
+uint64_t Host__Wait(uint64_t due)
+{
+    FIRMWARE_T *firmware = &Firmwares[Current];
+    uint16_t node = Current;
+
+    Schedule(node, firmware->boot + (due + FIRMWARE_CYCLES_PER_US - 1) / FIRMWARE_CYCLES_PER_US);
+    swapcontext(&firmware->context, &Scheduler);
+
+    return (Events__Now() - firmware->boot) * FIRMWARE_CYCLES_PER_US;
+}
+
+void Host__UsartTransmit(uint8_t data)
+{
+    (void)data;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file medium.c
+ *
+ * @brief 2.4GHz medium of the network simulator
+ *
+ * @details Log-distance path loss from 1m, a loss per floor crossed and a
+ *          log-normal shadowing drawn once per link, the same both ways.
+ *          A packet reaches the receiver when it is above the sensitivity
+ *          of the data rate, and above the co-channel rejection of the
+ *          nRF24L01+ over the noise floor plus everything else on the air
+ *          during any part of it; the receiver must be listening from the
+ *          start to the end. Interference comes in bursts of fixed power at
+ *          every node, e.g. a Wi-Fi network on the same channel.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "netsim.h"
+
+#define MEDIUM_LOSS_1M_DB       40.0    // free space at 2.4GHz
+#define MEDIUM_NOISE_DBM        -100.0
+#define MEDIUM_RPD_DBM          -64.0   // received power detector threshold
+#define MEDIUM_NOISE_BURST_US   1000    // mean length of an interference burst
+
+// Enhanced ShockBurst packet, besides the payload: preamble, address,
+// packet control field with dynamic payload length, CRC
+#define MEDIUM_PREAMBLE_BYTES   1
+#define MEDIUM_ADDRESS_BYTES    5
+#define MEDIUM_PCF_BITS         9
+#define MEDIUM_CRC_BYTES        2
+
+#define MEDIUM_INITIAL_SLOTS    64
+
+// By data rate: 250kbps, 1Mbps, 2Mbps
+static const double Sensitivity_Dbm[3] = {-94.0, -85.0, -82.0};
+static const double Rejection_Db[3] = {12.0, 9.0, 7.0};    // co-channel C/I
+static const double Bits_Per_Us[3] = {0.25, 1.0, 2.0};
+
+static float *Link_Dbm;         // nodes x nodes
+static TRANSMISSION_T *Slots;
+static uint8_t *Used;
+static uint32_t Slots_Number;
+static uint32_t *Live;          // slots on the air or that may still overlap
+static uint32_t Live_Count;
+static SIM_TIME_T Longest;      // transmission, how long to keep the ended ones
+static MEDIUM_STATS_T Stats;
+
+static double ToMw(double dbm)
+{
+    return pow(10.0, dbm / 10.0);
+}
+
+static void Place(void)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    uint16_t per_floor = (uint16_t)((config->nodes - 1 + config->floors - 1) / config->floors);
+    uint16_t side = (uint16_t)ceil(sqrt(per_floor));
+    double center = (side - 1) * config->spacing_m / 2.0;
+    NODE_T *node;
+    uint16_t index;
+    uint16_t i;
+
+    // The gateway in the middle of the building
+    node = &Netsim__Nodes[NETSIM_GATEWAY];
+    node->floor = config->floors / 2;
+    node->x = center;
+    node->y = center;
+    node->z = node->floor * config->floor_height_m;
+
+    for (i = 1; i < config->nodes; i++)
+    {
+        node = &Netsim__Nodes[i];
+        index = (uint16_t)((i - 1) % per_floor);
+        node->floor = (uint8_t)((i - 1) / per_floor);
+        node->x = (index % side) * config->spacing_m + (Netsim__Uniform() - 0.5) * config->spacing_m / 2;
+        node->y = (index / side) * config->spacing_m + (Netsim__Uniform() - 0.5) * config->spacing_m / 2;
+        node->z = node->floor * config->floor_height_m;
+    }
+}
+
+void Medium__Initialize(void)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    const NODE_T *a;
+    const NODE_T *b;
+    double distance;
+    double loss;
+    uint32_t n = config->nodes;
+    uint32_t i;
+    uint32_t j;
+
+    Place();
+    Link_Dbm = malloc((size_t)n * n * sizeof(float));
+    for (i = 0; i < n; i++)
+    {
+        Link_Dbm[i * n + i] = 0;
+        for (j = i + 1; j < n; j++)
+        {
+            a = &Netsim__Nodes[i];
+            b = &Netsim__Nodes[j];
+            distance = sqrt((a->x - b->x) * (a->x - b->x) + (a->y - b->y) * (a->y - b->y) +
+                            (a->z - b->z) * (a->z - b->z));
+            loss = MEDIUM_LOSS_1M_DB + 10.0 * config->path_exponent * log10((distance < 1.0) ? 1.0 : distance) +
+                   abs(a->floor - b->floor) * config->floor_db + Netsim__Gaussian() * config->shadow_db;
+            Link_Dbm[i * n + j] = (float)(config->power_dbm - loss);
+            Link_Dbm[j * n + i] = Link_Dbm[i * n + j];
+        }
+    }
+
+    Slots_Number = MEDIUM_INITIAL_SLOTS;
+    Slots = malloc(Slots_Number * sizeof(TRANSMISSION_T));
+    Used = calloc(Slots_Number, 1);
+    Live = malloc(Slots_Number * sizeof(uint32_t));
+    Live_Count = 0;
+    Longest = 0;
+
+    if (config->interference_duty > 0)
+    {
+        Events__Schedule(0, EVENT_NOISE, NETSIM_NOBODY, 0);
+    }
+}
+
+double Medium__RxDbm(uint16_t from, uint16_t to)
+{
+    return Link_Dbm[(uint32_t)from * Netsim__Config.nodes + to];
+}
+
+double Medium__Sensitivity(void)
+{
+    return Sensitivity_Dbm[Netsim__Config.rate];
+}
+
+SIM_TIME_T Medium__Airtime(uint8_t payload_size)
+{
+    uint32_t bits = 8 * (MEDIUM_PREAMBLE_BYTES + MEDIUM_ADDRESS_BYTES + payload_size + MEDIUM_CRC_BYTES) +
+                    MEDIUM_PCF_BITS;
+
+    return (SIM_TIME_T)ceil(bits / Bits_Per_Us[Netsim__Config.rate]);
+}
+
+static void Prune(SIM_TIME_T now)
+{
+    uint32_t i = 0;
+
+    while (i < Live_Count)
+    {
+        if (Slots[Live[i]].end + Longest < now)
+        {
+            Used[Live[i]] = 0;
+            Live[i] = Live[--Live_Count];
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+/**
+ * @brief   Put a transmission on the air
+ *
+ * @return  Index, valid at least until the end of the transmission
+ */
+uint32_t Medium__Begin(const TRANSMISSION_T *transmission)
+{
+    uint32_t index;
+
+    Prune(Events__Now());
+    for (index = 0; index < Slots_Number && Used[index]; index++)
+    {
+    }
+    if (index == Slots_Number)
+    {
+        Slots_Number *= 2;
+        Slots = realloc(Slots, Slots_Number * sizeof(TRANSMISSION_T));
+        Used = realloc(Used, Slots_Number);
+        Live = realloc(Live, Slots_Number * sizeof(uint32_t));
+        if (Slots == NULL || Used == NULL || Live == NULL)
+        {
+            fprintf(stderr, "netsim: out of memory for the transmissions\n");
+            exit(1);
+        }
+        for (uint32_t i = index; i < Slots_Number; i++)
+        {
+            Used[i] = 0;
+        }
+    }
+    Slots[index] = *transmission;
+    Used[index] = 1;
+    Live[Live_Count++] = index;
+    if (transmission->end - transmission->start > Longest)
+    {
+        Longest = transmission->end - transmission->start;
+    }
+    if (transmission->kind != TRANSMISSION_NOISE)
+    {
+        Stats.transmissions++;
+    }
+    return index;
+}
+
+const TRANSMISSION_T *Medium__Get(uint32_t index)
+{
+    return &Slots[index];
+}
+
+static double PowerAt(const TRANSMISSION_T *transmission, uint16_t node)
+{
+    return (transmission->kind == TRANSMISSION_NOISE) ? transmission->dbm :
+           Medium__RxDbm(transmission->source, node);
+}
+
+/**
+ * @brief   Whether a transmission, at its end, reached a node
+ */
+uint8_t Medium__Receive(uint32_t index, uint16_t node)
+{
+    const TRANSMISSION_T *transmission = &Slots[index];
+    const TRANSMISSION_T *other;
+    const NODE_T *receiver = &Netsim__Nodes[node];
+    double signal;
+    double interference = ToMw(MEDIUM_NOISE_DBM);
+    uint32_t i;
+
+    // While sending, a node only listens for its acknowledge
+    if (receiver->state != RADIO_RX || receiver->rx_since > transmission->start ||
+        (transmission->kind == TRANSMISSION_DATA && receiver->awaiting_ack))
+    {
+        Stats.deaf++;
+        return 0;
+    }
+    signal = PowerAt(transmission, node);
+    if (signal < Sensitivity_Dbm[Netsim__Config.rate])
+    {
+        Stats.weak++;
+        return 0;
+    }
+    for (i = 0; i < Live_Count; i++)
+    {
+        other = &Slots[Live[i]];
+        if (Live[i] != index && other->source != node &&
+            other->start < transmission->end && other->end > transmission->start)
+        {
+            interference += ToMw(PowerAt(other, node));
+        }
+    }
+    if (signal - 10.0 * log10(interference) < Rejection_Db[Netsim__Config.rate])
+    {
+        Stats.collisions++;
+        return 0;
+    }
+    Stats.received++;
+    return 1;
+}
+
+/**
+ * @brief   Received power detector of the node, for the carrier sense
+ */
+uint8_t Medium__IsBusy(uint16_t node)
+{
+    SIM_TIME_T now = Events__Now();
+    const TRANSMISSION_T *other;
+    uint32_t i;
+
+    for (i = 0; i < Live_Count; i++)
+    {
+        other = &Slots[Live[i]];
+        if (other->start <= now && other->end > now && other->source != node &&
+            PowerAt(other, node) >= MEDIUM_RPD_DBM)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief   A burst of interference, and the next one
+ *
+ * @details Exponential lengths and gaps, with the mean gap that gives the
+ *          configured duty.
+ */
+void Medium__Noise(void)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    TRANSMISSION_T burst = {0};
+    SIM_TIME_T now = Events__Now();
+    double duty = (config->interference_duty < 0.99) ? config->interference_duty : 0.99;
+    double gap = MEDIUM_NOISE_BURST_US * (1.0 - duty) / duty;
+
+    burst.kind = TRANSMISSION_NOISE;
+    burst.source = NETSIM_NOBODY;
+    burst.destination = NETSIM_NOBODY;
+    burst.dbm = config->interference_dbm;
+    burst.start = now;
+    burst.end = now + 1 + (SIM_TIME_T)(-log(1.0 - Netsim__Uniform()) * MEDIUM_NOISE_BURST_US);
+    Medium__Begin(&burst);
+    Stats.noise_bursts++;
+
+    Events__Schedule(burst.end + (SIM_TIME_T)(-log(1.0 - Netsim__Uniform()) * gap),
+                     EVENT_NOISE, NETSIM_NOBODY, 0);
+}
+
+const MEDIUM_STATS_T *Medium__GetStats(void)
+{
+    return &Stats;
+}
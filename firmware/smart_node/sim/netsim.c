@@ -0,0 +1,419 @@
+/**
+ * @file netsim.c
+ *
+ * @brief Options, main loop and report of the network simulator
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "netsim.h"
+
+// In the order of the enumerations
+#define STACK_NAMES     "firmware model"
+#define RATE_NAMES      "250k 1M 2M"
+#define MAC_NAMES       "aloha csma tdma"
+#define ROUTING_NAMES   "star tree"
+
+typedef enum {
+    OPTION_U8 = 0,
+    OPTION_I8,
+    OPTION_U16,
+    OPTION_U32,
+    OPTION_DOUBLE,
+    OPTION_CHOICE,
+} OPTION_TYPE_T;
+
+typedef struct {
+    const char *name;
+    OPTION_TYPE_T type;
+    void *value;
+    const char *choices;    // space separated, the index is the value
+    const char *help;
+} OPTION_T;
+
+NETSIM_CONFIG_T Netsim__Config = {
+    .stack = STACK_FIRMWARE,
+    .nodes = 100,
+    .floors = 4,
+    .spacing_m = 8.0,
+    .floor_height_m = 3.0,
+    .seed = 1,
+    .hours = 0.1,
+    .rate = RATE_1M,
+    .power_dbm = 0,
+    .retransmits = 3,
+    .retransmit_delay_us = 500,
+    .mac = MAC_ALOHA,
+    .jitter_ms = 100,
+    .slot_us = 2000,
+    .listen = 0,
+    .routing = ROUTING_STAR,
+    .link_margin_db = 6.0,
+    .batch = 1,
+    .batch_ms = 10000,
+    .report_s = 60,
+    .sample_s = 5,
+    .duty_step = 32,
+    .path_exponent = 3.0,
+    .floor_db = 15.0,
+    .shadow_db = 4.0,
+    .interference_duty = 0.0,
+    .interference_dbm = -75.0,
+};
+
+NODE_T *Netsim__Nodes;
+
+static const OPTION_T Options[] = {
+    {"stack",       OPTION_CHOICE,  &Netsim__Config.stack,               STACK_NAMES, "what runs on the nodes"},
+    {"nodes",       OPTION_U16,     &Netsim__Config.nodes,               NULL, "nodes, with the gateway"},
+    {"floors",      OPTION_U8,      &Netsim__Config.floors,              NULL, "floors of the building"},
+    {"spacing",     OPTION_DOUBLE,  &Netsim__Config.spacing_m,           NULL, "m between nodes on a floor"},
+    {"floor_height", OPTION_DOUBLE, &Netsim__Config.floor_height_m,      NULL, "m"},
+    {"seed",        OPTION_U32,     &Netsim__Config.seed,                NULL, "of the random numbers"},
+    {"hours",       OPTION_DOUBLE,  &Netsim__Config.hours,               NULL, "virtual time to run"},
+    {"rate",        OPTION_CHOICE,  &Netsim__Config.rate,                RATE_NAMES, "air data rate"},
+    {"power",       OPTION_I8,      &Netsim__Config.power_dbm,           NULL, "dBm, 0 -6 -12 -18"},
+    {"arc",         OPTION_U8,      &Netsim__Config.retransmits,         NULL, "retransmits, 0..15"},
+    {"ard",         OPTION_U16,     &Netsim__Config.retransmit_delay_us, NULL, "us, retransmit delay"},
+    {"mac",         OPTION_CHOICE,  &Netsim__Config.mac,                 MAC_NAMES, "channel access"},
+    {"jitter",      OPTION_U32,     &Netsim__Config.jitter_ms,           NULL, "ms, random delay of aloha and csma"},
+    {"slot",        OPTION_U32,     &Netsim__Config.slot_us,             NULL, "us, TDMA slot, one per node"},
+    {"listen",      OPTION_U8,      &Netsim__Config.listen,              NULL, "1: every node stays in RX"},
+    {"routing",     OPTION_CHOICE,  &Netsim__Config.routing,             ROUTING_NAMES, "route to the gateway"},
+    {"margin",      OPTION_DOUBLE,  &Netsim__Config.link_margin_db,      NULL, "dB over the sensitivity, tree links"},
+    {"batch",       OPTION_U8,      &Netsim__Config.batch,               NULL, "reports per packet, 1..5"},
+    {"batch_ms",    OPTION_U32,     &Netsim__Config.batch_ms,            NULL, "ms, longest wait for a batch"},
+    {"report",      OPTION_U32,     &Netsim__Config.report_s,            NULL, "s, report period"},
+    {"sample",      OPTION_U32,     &Netsim__Config.sample_s,            NULL, "s, thermostat sample period"},
+    {"duty_step",   OPTION_U8,      &Netsim__Config.duty_step,           NULL, "demand change reported at once"},
+    {"path_exponent", OPTION_DOUBLE, &Netsim__Config.path_exponent,      NULL, "of the path loss"},
+    {"floor_loss",  OPTION_DOUBLE,  &Netsim__Config.floor_db,            NULL, "dB per floor"},
+    {"shadowing",   OPTION_DOUBLE,  &Netsim__Config.shadow_db,           NULL, "dB, standard deviation"},
+    {"interference", OPTION_DOUBLE, &Netsim__Config.interference_duty,   NULL, "fraction of the time"},
+    {"interference_dbm", OPTION_DOUBLE, &Netsim__Config.interference_dbm, NULL, "at every node"},
+};
+
+#define OPTIONS_NUMBER (sizeof(Options) / sizeof(Options[0]))
+
+static uint64_t Random_State;
+
+/**
+ * @brief   xorshift64*, the same sequence for the same seed everywhere
+ */
+uint64_t Netsim__Random(void)
+{
+    Random_State ^= Random_State >> 12;
+    Random_State ^= Random_State << 25;
+    Random_State ^= Random_State >> 27;
+    return Random_State * 0x2545F4914F6CDD1DULL;
+}
+
+double Netsim__Uniform(void)
+{
+    return (Netsim__Random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double Netsim__Gaussian(void)
+{
+    double u = 1.0 - Netsim__Uniform();
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * Netsim__Uniform());
+}
+
+static void Usage(void)
+{
+    uint32_t i;
+
+    fprintf(stderr, "usage: netsim [option=value]...\n");
+    for (i = 0; i < OPTIONS_NUMBER; i++)
+    {
+        fprintf(stderr, "  %-18s %s%s%s\n", Options[i].name, Options[i].help,
+                Options[i].choices ? ": " : "", Options[i].choices ? Options[i].choices : "");
+    }
+}
+
+static uint8_t Choice(const char *choices, const char *value, uint32_t *index)
+{
+    size_t length = strlen(value);
+    const char *choice = choices;
+
+    for (*index = 0; choice != NULL && *choice != '\0'; (*index)++)
+    {
+        if (strncmp(choice, value, length) == 0 && (choice[length] == ' ' || choice[length] == '\0'))
+        {
+            return 1;
+        }
+        choice = strchr(choice, ' ');
+        choice = choice ? choice + 1 : NULL;
+    }
+    return 0;
+}
+
+static const char *ChoiceName(const char *choices, uint32_t index, char *name, size_t size)
+{
+    const char *end;
+
+    while (index-- != 0 && choices != NULL)
+    {
+        choices = strchr(choices, ' ');
+        choices = choices ? choices + 1 : NULL;
+    }
+    if (choices == NULL)
+    {
+        return "";
+    }
+    end = strchr(choices, ' ');
+    snprintf(name, size, "%.*s", (int)(end ? (size_t)(end - choices) : strlen(choices)), choices);
+    return name;
+}
+
+static uint8_t Parse(const char *argument)
+{
+    const char *equal = strchr(argument, '=');
+    const OPTION_T *option = NULL;
+    const char *value;
+    uint32_t index;
+    uint32_t i;
+
+    if (equal == NULL)
+    {
+        return 0;
+    }
+    for (i = 0; i < OPTIONS_NUMBER; i++)
+    {
+        if (strlen(Options[i].name) == (size_t)(equal - argument) &&
+            strncmp(Options[i].name, argument, equal - argument) == 0)
+        {
+            option = &Options[i];
+        }
+    }
+    if (option == NULL)
+    {
+        return 0;
+    }
+    value = equal + 1;
+    switch (option->type)
+    {
+        case OPTION_U8:     *(uint8_t *)option->value = (uint8_t)strtoul(value, NULL, 0);   break;
+        case OPTION_I8:     *(int8_t *)option->value = (int8_t)strtol(value, NULL, 0);      break;
+        case OPTION_U16:    *(uint16_t *)option->value = (uint16_t)strtoul(value, NULL, 0); break;
+        case OPTION_U32:    *(uint32_t *)option->value = (uint32_t)strtoul(value, NULL, 0); break;
+        case OPTION_DOUBLE: *(double *)option->value = strtod(value, NULL);                 break;
+        case OPTION_CHOICE:
+        {
+            if (Choice(option->choices, value, &index) == 0)
+            {
+                return 0;
+            }
+            *(int *)option->value = (int)index;
+            break;
+        }
+    }
+    return 1;
+}
+
+static uint8_t Check(void)
+{
+    NETSIM_CONFIG_T *config = &Netsim__Config;
+
+    if (config->batch > NETSIM_REPORTS_MAX)
+    {
+        fprintf(stderr, "netsim: batch of %u reports in a packet at most\n", NETSIM_REPORTS_MAX);
+        config->batch = NETSIM_REPORTS_MAX;
+    }
+    if (config->batch == 0)
+    {
+        config->batch = 1;
+    }
+    if (config->retransmits > 15)
+    {
+        config->retransmits = 15;
+    }
+    if (config->stack == STACK_FIRMWARE &&
+        (config->routing != ROUTING_STAR || config->batch != 1 || config->mac != MAC_ALOHA))
+    {
+        // Not in the firmware until mesh.c is written
+        fprintf(stderr, "netsim: routing, batch and mac are options of stack=model\n");
+        return 0;
+    }
+    return config->nodes >= 2 && config->floors >= 1 && config->sample_s >= 1 &&
+           config->report_s >= 1 && config->slot_us >= 1 && config->power_dbm <= 0;
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double Percentile(const double *sorted, uint32_t number, double fraction)
+{
+    return number ? sorted[(uint32_t)(fraction * (number - 1) + 0.5)] : 0;
+}
+
+static void Report(SIM_TIME_T end, double wall_s)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    const MEDIUM_STATS_T *medium = Medium__GetStats();
+    const NODE_T *node;
+    double *latencies;
+    uint32_t delivered = Node__GetLatencies(&latencies);
+    uint64_t generated = 0;
+    uint64_t lost = 0;
+    uint64_t drops = 0;
+    uint64_t duplicates = 0;
+    double seconds = (double)end / NETSIM_US_PER_S;
+    double energy;
+    double energy_max = 0;
+    double energy_total = 0;
+    char stack[12];
+    char rate[8];
+    char mac[8];
+    char routing[8];
+    uint16_t i;
+
+    qsort(latencies, delivered, sizeof(double), CompareDouble);
+    for (i = 0; i < config->nodes; i++)
+    {
+        node = &Netsim__Nodes[i];
+        generated += node->generated;
+        lost += node->lost_reports;
+        drops += node->queue_drops;
+        duplicates += node->duplicates;
+        if (i != NETSIM_GATEWAY)
+        {
+            energy = Esb__EnergyMj(node);
+            energy_total += energy;
+            energy_max = (energy > energy_max) ? energy : energy_max;
+        }
+    }
+
+    printf("{\n  \"config\": {\"stack\": \"%s\", \"nodes\": %u, \"floors\": %u, \"hours\": %g, \"seed\": %u, "
+           "\"rate\": \"%s\", \"power_dbm\": %d, \"arc\": %u, \"ard_us\": %u, \"mac\": \"%s\", "
+           "\"routing\": \"%s\", \"batch\": %u, \"report_s\": %u, \"interference\": %g},\n",
+           ChoiceName(STACK_NAMES, config->stack, stack, sizeof(stack)),
+           config->nodes, config->floors, config->hours, config->seed,
+           ChoiceName(RATE_NAMES, config->rate, rate, sizeof(rate)), config->power_dbm,
+           config->retransmits, config->retransmit_delay_us,
+           ChoiceName(MAC_NAMES, config->mac, mac, sizeof(mac)),
+           ChoiceName(ROUTING_NAMES, config->routing, routing, sizeof(routing)),
+           config->batch, config->report_s, config->interference_duty);
+    printf("  \"simulated_s\": %.0f,\n  \"wall_s\": %.3f,\n  \"speedup\": %.0f,\n  \"events\": %llu,\n",
+           seconds, wall_s, (wall_s > 0) ? seconds / wall_s : 0, (unsigned long long)Events__GetProcessed());
+    printf("  \"reports\": {\"generated\": %llu, \"delivered\": %u, \"delivery_ratio\": %.4f, "
+           "\"lost_max_rt\": %llu, \"queue_drops\": %llu, \"duplicates\": %llu},\n",
+           (unsigned long long)generated, delivered, generated ? (double)delivered / generated : 0,
+           (unsigned long long)lost, (unsigned long long)drops, (unsigned long long)duplicates);
+    printf("  \"throughput\": {\"reports_per_s\": %.3f, \"payload_bytes_per_s\": %.1f},\n",
+           delivered / seconds, delivered * (double)NETSIM_REPORT_SIZE / seconds);
+    printf("  \"latency_ms\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f},\n",
+           Percentile(latencies, delivered, 0.50), Percentile(latencies, delivered, 0.90),
+           Percentile(latencies, delivered, 0.99), delivered ? latencies[delivered - 1] : 0);
+    printf("  \"medium\": {\"transmissions\": %u, \"received\": %u, \"collisions\": %u, "
+           "\"weak\": %u, \"deaf\": %u, \"noise_bursts\": %u},\n",
+           medium->transmissions, medium->received, medium->collisions, medium->weak,
+           medium->deaf, medium->noise_bursts);
+    printf("  \"energy_mj\": {\"mean\": %.1f, \"max\": %.1f},\n",
+           energy_total / (config->nodes - 1), energy_max);
+
+    printf("  \"nodes\": [");
+    for (i = 0; i < config->nodes; i++)
+    {
+        node = &Netsim__Nodes[i];
+        energy = Esb__EnergyMj(node);
+        printf("%s\n    {\"id\": %u, \"floor\": %u, \"parent\": %u, \"hops\": %u, \"router\": %u, "
+               "\"enabled\": %u, \"generated\": %u, \"delivered\": %u, \"latency_ms\": %.1f, \"forwarded\": %u, "
+               "\"packets\": %u, \"transmissions\": %u, \"retransmissions\": %u, \"max_rt\": %u, "
+               "\"queue_drops\": %u, \"cca_busy\": %u, \"acks\": %u, \"airtime_ms\": %.1f, "
+               "\"airtime_percent\": %.4f, \"energy_mj\": %.1f, \"current_ua\": %.1f}",
+               (i == 0) ? "" : ",", i, node->floor, (i == NETSIM_GATEWAY) ? i : node->parent, node->hops,
+               node->router, node->enabled, node->generated, node->delivered,
+               node->delivered ? node->latency_total_ms / node->delivered : 0, node->forwarded,
+               node->packets, node->transmissions, node->retransmissions, node->max_rt,
+               node->queue_drops, node->cca_busy, node->acks, node->airtime / 1000.0,
+               node->airtime * 100.0 / end, energy, energy * 1000.0 / 3.3 / seconds);
+    }
+    printf("\n  ]\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct timespec start;
+    struct timespec stop;
+    EVENT_T event;
+    SIM_TIME_T end;
+    double wall_s;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (Parse(argv[i]) == 0)
+        {
+            fprintf(stderr, "netsim: bad option %s\n", argv[i]);
+            Usage();
+            return 2;
+        }
+    }
+    if (Check() == 0)
+    {
+        Usage();
+        return 2;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Random_State = 0x9E3779B97F4A7C15ULL ^ Netsim__Config.seed;
+    Netsim__Nodes = calloc(Netsim__Config.nodes, sizeof(NODE_T));
+    end = (SIM_TIME_T)(Netsim__Config.hours * 3600.0 * NETSIM_US_PER_S);
+
+    Events__Initialize();
+    Medium__Initialize();
+    Node__Initialize();
+    Esb__Initialize();
+    Firmware__Initialize();
+
+    while (Events__Next(&event) && event.at <= end)
+    {
+        switch (event.type)
+        {
+            case EVENT_SAMPLE:
+            case EVENT_REPORT:
+            case EVENT_BATCH:
+            case EVENT_REQUEST:
+            {
+                Node__Event(&event);
+                break;
+            }
+            case EVENT_NOISE:
+            {
+                Medium__Noise();
+                break;
+            }
+            case EVENT_FIRMWARE:
+            {
+                Firmware__Event(&event);
+                break;
+            }
+            default:
+            {
+                Esb__Event(&event);
+                break;
+            }
+        }
+    }
+    Esb__Finish(end);
+    Firmware__Finish();
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    wall_s = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    Report(end, wall_s);
+    fprintf(stderr, "netsim: %u nodes, %.1f h in %.2f s\n", Netsim__Config.nodes, Netsim__Config.hours, wall_s);
+    return 0;
+}
@@ -0,0 +1,357 @@
+/**
+ * @file netsim.h
+ *
+ * @brief Discrete event simulator of a network of smart nodes
+ *
+ * @details Hundreds of nodes on the floors of a building, with an nRF24L01+
+ *          each, share one 2.4GHz channel. Time is virtual, in microseconds,
+ *          and jumps from one event to the next, so a day of the network
+ *          takes seconds.
+ *
+ *          Two stacks run on the nodes, stack= of the options:
+ *
+ *          firmware    each node runs the firmware, main.c with radio.c,
+ *                      thermostat.c and the drivers as they are, on the
+ *                      host backend; its nRF24L01+ is a model on the SPI
+ *                      bus, its room is heated by its relays. The gateway
+ *                      asks each node for its reports and collects them
+ *          model       a model of what a node sends: the temperature chain
+ *                      of the firmware on its room, a report at each period
+ *                      and when the heating demand changes; the queue,
+ *                      batching and routes to the gateway. mesh.c is still
+ *                      empty: the routing, batching and TDMA here are the
+ *                      options to compare before it is written
+ *
+ *          node.c      the rooms, the gateway and the nodes of the model
+ *          firmware.c  the firmware of each node, a coroutine with its own
+ *                      copy of the variables
+ *          nrf24.c     the registers and FIFOs of the chip, for radio.c
+ *          esb.c       Enhanced ShockBurst: power up, settling, auto
+ *                      acknowledge and retransmit, duplicate detection;
+ *                      the channel access, aloha, carrier sense on the
+ *                      received power detector or TDMA slots; the time in
+ *                      each radio state, for the energy
+ *          medium.c    path loss with the distance, the floors and a
+ *                      shadowing per link; a packet is lost below the
+ *                      sensitivity, under the co-channel rejection of the
+ *                      other packets and of the interference, or when the
+ *                      receiver is not listening
+ *          events.c    the queue of timed events
+ *
+ *          Build, from sim/: the firmware is linked in one object, with
+ *          its main() renamed and its variables in sections of their own,
+ *          then with the simulator:
+ *
+ *              mkdir -p firmware && cd firmware
+ *              gcc -std=gnu99 -O2 -fno-pie -DMICRO_HOST \
+ *                  -I../../src/host/include -I../../src/host -I../../src \
+ *                  -I../../src/drivers -c $(find ../../src -name '*.c')
+ *              ld -r -o ../firmware.o *.o && cd ..
+ *              objcopy --redefine-sym main=Firmware__Main \
+ *                  --rename-section .data=firmware_data \
+ *                  --rename-section .bss=firmware_bss \
+ *                  --rename-section .noinit=firmware_noinit firmware.o
+ *              gcc -std=gnu99 -O2 -no-pie -DMICRO_HOST -I../src/host/include \
+ *                  -I../src/host -I../src -I../src/drivers -o netsim \
+ *                  *.c firmware.o -lm
+ *
+ *          Run with option=value arguments, see Usage() in netsim.c, the report
+ *          is written on stdout as JSON:
+ *
+ *              ./netsim nodes=20 floors=2 hours=0.1
+ *              ./netsim stack=model nodes=100 floors=4 hours=24 \
+ *                  routing=tree mac=tdma batch=4
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef NETSIM_H_
+#define NETSIM_H_
+
+#include <stdint.h>
+#include "temp_filter.h"
+#include "pi_controller.h"
+
+#define NETSIM_US_PER_MS        1000ULL
+#define NETSIM_US_PER_S         1000000ULL
+#define NETSIM_NEVER            UINT64_MAX
+
+#define NETSIM_GATEWAY          0
+#define NETSIM_NOBODY           0xFFFF
+
+#define NETSIM_QUEUE_SIZE       32      // reports, in the RAM of a node
+#define NETSIM_REPORT_SIZE      6       // origin, sequence, temperature, duty, flags
+#define NETSIM_HEADER_SIZE      2       // sender, reports
+#define NETSIM_PAYLOAD_MAX      32
+#define NETSIM_REPORTS_MAX      ((NETSIM_PAYLOAD_MAX - NETSIM_HEADER_SIZE) / NETSIM_REPORT_SIZE)
+#define NETSIM_RX_FIFO          3       // payloads, in the nRF24L01+
+#define NETSIM_REGISTERS        0x20
+
+typedef uint64_t SIM_TIME_T;    // microseconds
+
+typedef enum {
+    STACK_FIRMWARE = 0, // each node runs the firmware, on an nRF24L01+ model
+    STACK_MODEL,        // node.c and esb.c, for the options of mesh.c
+} STACK_T;
+
+typedef enum {
+    RATE_250K = 0,
+    RATE_1M,
+    RATE_2M,
+} RATE_T;
+
+typedef enum {
+    MAC_ALOHA = 0,  // send after a random jitter
+    MAC_CSMA,       // and only when the received power detector is low
+    MAC_TDMA,       // in the slot of the node
+} MAC_T;
+
+typedef enum {
+    ROUTING_STAR = 0,   // straight to the gateway
+    ROUTING_TREE,       // through the neighbour with the fewest hops
+} ROUTING_T;
+
+typedef enum {
+    RADIO_OFF = 0,      // power down
+    RADIO_STANDBY,
+    RADIO_RX,
+    RADIO_TX,
+    RADIO_STATES,
+} RADIO_STATE_T;
+
+typedef struct {
+    STACK_T stack;
+    uint16_t nodes;             // with the gateway
+    uint8_t floors;
+    double spacing_m;           // between two nodes on a floor
+    double floor_height_m;
+    uint32_t seed;
+    double hours;
+
+    RATE_T rate;
+    int8_t power_dbm;           // 0, -6, -12 or -18
+    uint8_t retransmits;        // ARC
+    uint16_t retransmit_delay_us;   // ARD
+    MAC_T mac;
+    uint32_t jitter_ms;
+    uint32_t slot_us;
+    uint8_t listen;             // every node listens, not just the routers
+
+    ROUTING_T routing;
+    double link_margin_db;      // over the sensitivity, for a tree link
+    uint8_t batch;              // reports per packet
+    uint32_t batch_ms;          // longest wait of a report for a full batch
+    uint32_t report_s;
+    uint32_t sample_s;
+    uint8_t duty_step;          // change of the demand that is reported at once
+
+    double path_exponent;
+    double floor_db;
+    double shadow_db;
+    double interference_duty;   // fraction of the time with interference
+    double interference_dbm;
+} NETSIM_CONFIG_T;
+
+typedef struct {
+    uint16_t origin;
+    uint8_t sequence;
+    int16_t temperature;        // Q12.4
+    uint8_t duty;
+    SIM_TIME_T created;         // not sent, for the latency
+} REPORT_T;
+
+typedef enum {
+    TRANSMISSION_DATA = 0,
+    TRANSMISSION_ACK,
+    TRANSMISSION_NOISE,
+} TRANSMISSION_KIND_T;
+
+typedef struct {
+    TRANSMISSION_KIND_T kind;
+    uint16_t source;            // NETSIM_NOBODY for the interference
+    uint16_t destination;
+    SIM_TIME_T start;
+    SIM_TIME_T end;
+    double dbm;                 // at every node, for the interference
+    uint8_t pid;
+    uint8_t reports_number;
+    REPORT_T reports[NETSIM_REPORTS_MAX];
+    uint8_t payload[NETSIM_PAYLOAD_MAX];    // firmware stack, and the gateway requests
+} TRANSMISSION_T;
+
+// nRF24L01+ of a node that runs the firmware
+typedef struct {
+    uint8_t registers[NETSIM_REGISTERS];    // the first byte of the addresses
+    uint8_t tx[NETSIM_PAYLOAD_MAX];
+    uint8_t tx_full;
+    uint8_t rx[NETSIM_RX_FIFO][NETSIM_PAYLOAD_MAX];
+    uint8_t rx_count;
+    uint8_t command;            // SPI transaction in progress
+    uint8_t index;              // bytes of it so far
+    uint8_t length;             // data bytes after the command
+    uint8_t ce;
+    uint8_t irq;                // the IRQ line is low
+    uint8_t edge;               // a falling edge, for INT0
+} NRF24_T;
+
+typedef struct {
+    // Placement and route
+    double x;
+    double y;
+    double z;
+    uint8_t floor;
+    uint16_t parent;
+    uint8_t hops;
+    uint8_t router;
+    uint16_t slot;
+
+    // Application
+    double room;                // Celsius
+    TEMP_FILTER_T filter;       // the firmware chain
+    PI_CONTROLLER_T controller;
+    uint8_t duty;
+    uint8_t reported_duty;
+    uint8_t sequence;
+    REPORT_T queue[NETSIM_QUEUE_SIZE];
+    uint8_t queue_head;
+    uint8_t queue_count;
+    uint32_t batch_generation;
+
+    // Firmware stack
+    NRF24_T chip;
+    SIM_TIME_T loaded;          // the last report payload, for the latency
+    uint8_t enabled;            // its reports, by a request of the gateway
+    uint8_t requested;          // in the queue of the gateway
+
+    // Radio
+    RADIO_STATE_T state;
+    SIM_TIME_T state_since;
+    SIM_TIME_T rx_since;        // listening since, after the settling
+    SIM_TIME_T time_in[RADIO_STATES];
+    uint8_t busy;               // a packet is being sent
+    uint8_t awaiting_ack;
+    uint8_t acking;             // sending an acknowledge, as a receiver
+    uint8_t in_flight;          // reports in the packet
+    uint8_t attempts;
+    uint8_t pid;
+    uint32_t generation;        // of the operation, the older events are stale
+
+    // Statistics
+    uint32_t generated;
+    uint32_t delivered;         // of its reports, at the gateway
+    uint32_t forwarded;
+    uint32_t packets;
+    uint32_t transmissions;
+    uint32_t retransmissions;
+    uint32_t acknowledged;
+    uint32_t max_rt;
+    uint32_t lost_reports;      // dropped after MAX_RT
+    uint32_t queue_drops;
+    uint32_t duplicates;
+    uint32_t cca_busy;
+    uint32_t acks;
+    SIM_TIME_T airtime;
+    double latency_total_ms;
+} NODE_T;
+
+typedef struct {
+    uint32_t transmissions;
+    uint32_t received;
+    uint32_t weak;              // below the sensitivity
+    uint32_t collisions;        // under the co-channel rejection
+    uint32_t deaf;              // receiver not listening
+    uint32_t noise_bursts;
+} MEDIUM_STATS_T;
+
+// Event types
+typedef enum {
+    EVENT_SAMPLE = 0,
+    EVENT_REPORT,
+    EVENT_BATCH,
+    EVENT_TX_START,
+    EVENT_TX_AIR,
+    EVENT_TX_END,
+    EVENT_ACK_START,
+    EVENT_ACK_TIMEOUT,
+    EVENT_NOISE,
+    EVENT_FIRMWARE,             // resume the firmware of a node
+    EVENT_REQUEST,              // of the gateway, to enable the reports
+} EVENT_TYPE_T;
+
+typedef struct {
+    SIM_TIME_T at;
+    uint64_t order;             // same time, first scheduled first
+    uint32_t tag;
+    uint16_t node;
+    EVENT_TYPE_T type;
+} EVENT_T;
+
+extern NETSIM_CONFIG_T Netsim__Config;
+extern NODE_T *Netsim__Nodes;
+
+// netsim.c
+uint64_t Netsim__Random(void);
+double Netsim__Uniform(void);
+double Netsim__Gaussian(void);
+
+// events.c
+void Events__Initialize(void);
+void Events__Schedule(SIM_TIME_T at, EVENT_TYPE_T type, uint16_t node, uint32_t tag);
+uint8_t Events__Next(EVENT_T *event);
+SIM_TIME_T Events__Now(void);
+uint64_t Events__GetProcessed(void);
+
+// medium.c
+void Medium__Initialize(void);
+double Medium__RxDbm(uint16_t from, uint16_t to);
+double Medium__Sensitivity(void);
+SIM_TIME_T Medium__Airtime(uint8_t payload_size);
+uint32_t Medium__Begin(const TRANSMISSION_T *transmission);
+const TRANSMISSION_T *Medium__Get(uint32_t index);
+uint8_t Medium__Receive(uint32_t index, uint16_t node);
+uint8_t Medium__IsBusy(uint16_t node);
+void Medium__Noise(void);
+const MEDIUM_STATS_T *Medium__GetStats(void);
+
+// esb.c
+void Esb__Initialize(void);
+void Esb__Send(uint16_t node);
+void Esb__Burst(uint16_t node, SIM_TIME_T at);
+void Esb__Refresh(uint16_t node);
+void Esb__Event(const EVENT_T *event);
+void Esb__Finish(SIM_TIME_T now);
+double Esb__EnergyMj(const NODE_T *node);
+
+// node.c
+void Node__Initialize(void);
+void Node__Event(const EVENT_T *event);
+void Node__Sent(uint16_t node, uint8_t acknowledged);
+void Node__Receive(uint16_t node, const TRANSMISSION_T *transmission);
+uint8_t Node__TakeReports(uint16_t node, REPORT_T *reports, uint8_t max);
+void Node__DropReports(uint16_t node, uint8_t number);
+uint16_t Node__TakeRequest(uint8_t *payload);
+void Node__Loaded(uint16_t node, const uint8_t *payload);
+uint32_t Node__GetLatencies(double **latencies_ms);
+
+// firmware.c
+void Firmware__Initialize(void);
+uint8_t Firmware__Runs(uint16_t node);
+void Firmware__Event(const EVENT_T *event);
+void Firmware__Wake(uint16_t node, SIM_TIME_T at);
+uint16_t Firmware__Current(void);
+SIM_TIME_T Firmware__Now(void);
+uint8_t Firmware__GetRelaysSet(uint16_t node);
+void Firmware__Finish(void);
+
+// nrf24.c
+void Nrf24__Initialize(uint16_t node);
+RADIO_STATE_T Nrf24__GetState(uint16_t node);
+uint8_t Nrf24__GetRetransmits(uint16_t node);
+uint16_t Nrf24__GetRetransmitDelayUs(uint16_t node);
+void Nrf24__GetPayload(uint16_t node, uint8_t *payload);
+uint8_t Nrf24__IsRxFull(uint16_t node);
+void Nrf24__Receive(uint16_t node, const uint8_t *payload);
+void Nrf24__Sent(uint16_t node, uint8_t acknowledged);
+
+#endif /* NETSIM_H_ */
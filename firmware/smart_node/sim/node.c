@@ -0,0 +1,522 @@
+/**
+ * @file node.c
+ *
+ * @brief Application and routing of a node, network simulator
+ *
+ * @details Each node heats a room, a first order model towards the outdoor
+ *          temperature.
+ *          With the firmware stack, the DS18B20 of the node reads its room
+ *          and the heating follows the relays set by thermostat.c. The
+ *          gateway enables the reports of each node with an OP_REPORT
+ *          request, again every NODE_REQUEST_RETRY_S until the response
+ *          comes; then the firmware sends an 'S' payload after each sample,
+ *          and the latency counts from the payload in the TX FIFO.
+ *          With the model stack, at the sample period of the thermostat the
+ *          reading goes through the temperature filter and the PI
+ *          controller of the firmware, with the firmware configuration, and
+ *          the controller output drives the heating: the demand of
+ *          thermostat.c before its time proportioning window. A node
+ *          reports its temperature and demand to the gateway every report
+ *          period, and at once when the demand moved by duty_step.
+ *          Reports wait in a queue until there are batch of them, or the
+ *          oldest has waited batch_ms, then go in one packet. A router
+ *          queues the reports it receives with its own.
+ *          With the tree routing, the parent of a node is the neighbour with
+ *          the fewest hops to the gateway, over a link with margin above the
+ *          sensitivity, the strongest one on a tie. TDMA slots go to the
+ *          deepest nodes first, so a report climbs the tree in one frame.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parameters.h"
+#include "thermostat.h"
+#include "relays.h"
+#include "command.h"
+#include "netsim.h"
+
+#define NODE_OUTDOOR_C          5.0
+#define NODE_ROOM_TAU_S         10800.0     // 3 hours
+#define NODE_HEATING_C          25.0        // above the outdoor, at full duty
+#define NODE_NO_HOPS            0xFF
+#define NODE_ROOM_STEP_S        5           // of the room model, firmware stack
+#define NODE_REQUEST_RETRY_S    10
+
+static const TEMP_FILTER_CONFIG_T Filter_Config = {
+    .min = THERMOSTAT_FILTER_MIN,
+    .max = THERMOSTAT_FILTER_MAX,
+    .max_step = THERMOSTAT_FILTER_MAX_STEP,
+    .ema_shift = THERMOSTAT_FILTER_EMA_SHIFT,
+};
+
+static const PI_CONTROLLER_CONFIG_T Controller_Config = {
+    .kp = THERMOSTAT_PI_KP,
+    .ki = THERMOSTAT_PI_KI,
+    .kd = 0,
+};
+
+static double *Latencies_Ms;
+static uint32_t Latencies_Number;
+static uint32_t Latencies_Size;
+
+// Nodes the gateway has a request for, firmware stack
+static uint16_t *Requests;
+static uint16_t Requests_Head;
+static uint16_t Requests_Count;
+
+static void Route(void)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    double threshold = Medium__Sensitivity() + config->link_margin_db;
+    NODE_T *node;
+    NODE_T *candidate;
+    double best;
+    double dbm;
+    uint8_t hops;
+    uint8_t changed = 1;
+    uint16_t i;
+    uint16_t j;
+
+    for (i = 0; i < config->nodes; i++)
+    {
+        node = &Netsim__Nodes[i];
+        node->parent = NETSIM_GATEWAY;
+        node->hops = (config->routing == ROUTING_STAR &&
+                      Medium__RxDbm(i, NETSIM_GATEWAY) >= threshold) ? 1 : NODE_NO_HOPS;
+    }
+    Netsim__Nodes[NETSIM_GATEWAY].hops = 0;
+
+    // One more hop at each pass, until no node gets closer
+    for (hops = 1; config->routing == ROUTING_TREE && changed && hops < NODE_NO_HOPS; hops++)
+    {
+        changed = 0;
+        for (i = 1; i < config->nodes; i++)
+        {
+            node = &Netsim__Nodes[i];
+            if (node->hops != NODE_NO_HOPS)
+            {
+                continue;
+            }
+            best = -INFINITY;
+            for (j = 0; j < config->nodes; j++)
+            {
+                candidate = &Netsim__Nodes[j];
+                dbm = Medium__RxDbm(i, j);
+                if (j != i && candidate->hops == hops - 1 && dbm >= threshold && dbm > best)
+                {
+                    best = dbm;
+                    node->parent = j;
+                }
+            }
+            if (best > -INFINITY)
+            {
+                node->hops = hops;
+                changed = 1;
+            }
+        }
+    }
+
+    // Out of reach: through the strongest link anyway
+    for (i = 1; i < config->nodes; i++)
+    {
+        node = &Netsim__Nodes[i];
+        if (node->hops != NODE_NO_HOPS || config->routing == ROUTING_STAR)
+        {
+            continue;
+        }
+        best = -INFINITY;
+        for (j = 0; j < config->nodes; j++)
+        {
+            if (j != i && Netsim__Nodes[j].hops != NODE_NO_HOPS && Medium__RxDbm(i, j) > best)
+            {
+                best = Medium__RxDbm(i, j);
+                node->parent = j;
+            }
+        }
+    }
+
+    for (i = 1; i < config->nodes; i++)
+    {
+        if (Netsim__Nodes[i].parent != NETSIM_GATEWAY)
+        {
+            Netsim__Nodes[Netsim__Nodes[i].parent].router = 1;
+        }
+    }
+}
+
+static void AssignSlots(void)
+{
+    uint16_t slot = 0;
+    int16_t hops;
+    uint16_t i;
+
+    for (hops = NODE_NO_HOPS; hops >= 1; hops--)
+    {
+        for (i = 1; i < Netsim__Config.nodes; i++)
+        {
+            if (Netsim__Nodes[i].hops == hops)
+            {
+                Netsim__Nodes[i].slot = slot++;
+            }
+        }
+    }
+}
+
+static void Deliver(const REPORT_T *report)
+{
+    NODE_T *origin = &Netsim__Nodes[report->origin];
+    double latency_ms = (double)(Events__Now() - report->created) / NETSIM_US_PER_MS;
+
+    if (Latencies_Number == Latencies_Size)
+    {
+        Latencies_Size = Latencies_Size ? 2 * Latencies_Size : 4096;
+        Latencies_Ms = realloc(Latencies_Ms, Latencies_Size * sizeof(double));
+        if (Latencies_Ms == NULL)
+        {
+            fprintf(stderr, "netsim: out of memory for the latencies\n");
+            exit(1);
+        }
+    }
+    Latencies_Ms[Latencies_Number++] = latency_ms;
+    origin->delivered++;
+    origin->latency_total_ms += latency_ms;
+}
+
+/**
+ * @brief   Send when a batch is ready, or arm the wait of the oldest report
+ */
+static void Ready(uint16_t id)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+    SIM_TIME_T due;
+
+    if (node->busy || node->queue_count == 0)
+    {
+        return;
+    }
+    due = node->queue[node->queue_head].created + Netsim__Config.batch_ms * NETSIM_US_PER_MS;
+    if (node->queue_count >= Netsim__Config.batch || Events__Now() >= due)
+    {
+        Esb__Send(id);
+    }
+    else
+    {
+        Events__Schedule(due, EVENT_BATCH, id, ++node->batch_generation);
+    }
+}
+
+static void Enqueue(uint16_t id, const REPORT_T *report)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+
+    if (node->queue_count == NETSIM_QUEUE_SIZE)
+    {
+        node->queue_drops++;
+        return;
+    }
+    node->queue[(node->queue_head + node->queue_count) % NETSIM_QUEUE_SIZE] = *report;
+    node->queue_count++;
+    Ready(id);
+}
+
+static void Report(uint16_t id)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+    REPORT_T report;
+
+    report.origin = id;
+    report.sequence = node->sequence++;
+    report.temperature = TempFilter__GetOutput(&node->filter);
+    report.duty = node->duty;
+    report.created = Events__Now();
+    node->reported_duty = node->duty;
+    node->generated++;
+    Enqueue(id, &report);
+}
+
+/**
+ * @brief   The room of a node that runs the firmware, heated by its relays
+ */
+static void Heat(uint16_t id)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+    double heating = NODE_HEATING_C * Firmware__GetRelaysSet(id) / RELAYS_NUMBER;
+
+    node->room += NODE_ROOM_STEP_S * (NODE_OUTDOOR_C + heating - node->room) / NODE_ROOM_TAU_S;
+}
+
+static void Sample(uint16_t id)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+    double period = Netsim__Config.sample_s;
+    int16_t raw;
+
+    node->room += period * ((NODE_OUTDOOR_C - node->room) / NODE_ROOM_TAU_S +
+                            NODE_HEATING_C * node->duty / (PI_CONTROLLER_OUTPUT_MAX * NODE_ROOM_TAU_S));
+    raw = (int16_t)lround(node->room * 16) + (int16_t)(Netsim__Random() % 3) - 1;
+    (void)TempFilter__Process(&node->filter, raw);
+    if (TempFilter__IsValid(&node->filter))
+    {
+        // The demand of thermostat.c before its time proportioning window
+        node->duty = PiController__Update(&node->controller, THERMOSTAT_TEMPERATURE_SET,
+                                          TempFilter__GetOutput(&node->filter));
+    }
+    if (abs(node->duty - node->reported_duty) >= Netsim__Config.duty_step)
+    {
+        Report(id);
+    }
+}
+
+/**
+ * @brief   Queue a request to a node, again later until it answers
+ */
+static void Request(uint16_t id)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+
+    if (node->enabled)
+    {
+        return;
+    }
+    if (node->requested == 0)
+    {
+        node->requested = 1;
+        Requests[(Requests_Head + Requests_Count) % Netsim__Config.nodes] = id;
+        Requests_Count++;
+        Esb__Send(NETSIM_GATEWAY);
+    }
+    Events__Schedule(Events__Now() + NODE_REQUEST_RETRY_S * NETSIM_US_PER_S, EVENT_REQUEST, id, 0);
+}
+
+/**
+ * @brief   A payload of a node at the gateway, firmware stack
+ */
+static void Gateway(const TRANSMISSION_T *transmission)
+{
+    NODE_T *source = &Netsim__Nodes[transmission->source];
+    const uint8_t *payload = transmission->payload;
+    REPORT_T report;
+
+    if (payload[0] == COMMAND_REPORT_TAG && payload[1] == COMMAND_REPORT_SIZE)
+    {
+        report.origin = transmission->source;
+        report.sequence = payload[2];
+        report.temperature = (int16_t)((payload[3] << 8) | payload[4]);
+        report.duty = payload[5];
+        report.created = source->loaded;
+        Deliver(&report);
+    }
+    else if (payload[0] == COMMAND_RESPONSE_TAG)
+    {
+        source->enabled = 1;
+    }
+}
+
+void Node__Initialize(void)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    NODE_T *node;
+    uint16_t i;
+
+    Route();
+    AssignSlots();
+    if (config->stack == STACK_FIRMWARE)
+    {
+        Requests = malloc(config->nodes * sizeof(uint16_t));
+        for (i = 1; i < config->nodes; i++)
+        {
+            Netsim__Nodes[i].room = 14.0 + 6.0 * Netsim__Uniform();
+            Events__Schedule((SIM_TIME_T)(Netsim__Uniform() * NODE_ROOM_STEP_S * NETSIM_US_PER_S),
+                             EVENT_SAMPLE, i, 0);
+            Events__Schedule((SIM_TIME_T)((0.5 + Netsim__Uniform()) * NODE_REQUEST_RETRY_S * NETSIM_US_PER_S),
+                             EVENT_REQUEST, i, 0);
+        }
+        return;
+    }
+    for (i = 1; i < config->nodes; i++)
+    {
+        node = &Netsim__Nodes[i];
+        node->room = 14.0 + 6.0 * Netsim__Uniform();
+        TempFilter__Initialize(&node->filter, &Filter_Config);
+        PiController__Initialize(&node->controller, &Controller_Config);
+        Events__Schedule((SIM_TIME_T)(Netsim__Uniform() * config->sample_s * NETSIM_US_PER_S),
+                         EVENT_SAMPLE, i, 0);
+        Events__Schedule((SIM_TIME_T)(Netsim__Uniform() * config->report_s * NETSIM_US_PER_S),
+                         EVENT_REPORT, i, 0);
+    }
+}
+
+void Node__Event(const EVENT_T *event)
+{
+    const NETSIM_CONFIG_T *config = &Netsim__Config;
+    SIM_TIME_T now = Events__Now();
+
+    switch (event->type)
+    {
+        case EVENT_SAMPLE:
+        {
+            if (config->stack == STACK_FIRMWARE)
+            {
+                Heat(event->node);
+                Events__Schedule(now + NODE_ROOM_STEP_S * NETSIM_US_PER_S, EVENT_SAMPLE, event->node, 0);
+            }
+            else
+            {
+                Sample(event->node);
+                Events__Schedule(now + config->sample_s * NETSIM_US_PER_S, EVENT_SAMPLE, event->node, 0);
+            }
+            break;
+        }
+        case EVENT_REQUEST:
+        {
+            Request(event->node);
+            break;
+        }
+        case EVENT_REPORT:
+        {
+            Report(event->node);
+            Events__Schedule(now + config->report_s * NETSIM_US_PER_S, EVENT_REPORT, event->node, 0);
+            break;
+        }
+        case EVENT_BATCH:
+        {
+            if (event->tag == Netsim__Nodes[event->node].batch_generation)
+            {
+                Ready(event->node);
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief   The packet in flight is done, acknowledged or given up
+ */
+void Node__Sent(uint16_t id, uint8_t acknowledged)
+{
+    (void)acknowledged;
+    if (id == NETSIM_GATEWAY && Requests_Count != 0)
+    {
+        // Asked again at the retry, if there is no response
+        Netsim__Nodes[Requests[Requests_Head]].requested = 0;
+        Requests_Head = (uint16_t)((Requests_Head + 1) % Netsim__Config.nodes);
+        Requests_Count--;
+        Esb__Send(id);
+        return;
+    }
+    Ready(id);
+}
+
+/**
+ * @brief   A new packet reached a node
+ */
+void Node__Receive(uint16_t id, const TRANSMISSION_T *transmission)
+{
+    uint8_t i;
+
+    if (Firmware__Runs(id))
+    {
+        Nrf24__Receive(id, transmission->payload);
+        return;
+    }
+    if (Firmware__Runs(transmission->source))
+    {
+        Gateway(transmission);
+        return;
+    }
+    for (i = 0; i < transmission->reports_number; i++)
+    {
+        if (id == NETSIM_GATEWAY)
+        {
+            Deliver(&transmission->reports[i]);
+        }
+        else
+        {
+            Netsim__Nodes[id].forwarded++;
+            Enqueue(id, &transmission->reports[i]);
+        }
+    }
+}
+
+/**
+ * @brief   Copy the reports at the head of the queue, without taking them
+ */
+uint8_t Node__TakeReports(uint16_t id, REPORT_T *reports, uint8_t max)
+{
+    const NODE_T *node = &Netsim__Nodes[id];
+    uint8_t number = (node->queue_count < max) ? node->queue_count : max;
+    uint8_t i;
+
+    for (i = 0; i < number; i++)
+    {
+        reports[i] = node->queue[(node->queue_head + i) % NETSIM_QUEUE_SIZE];
+    }
+    return number;
+}
+
+void Node__DropReports(uint16_t id, uint8_t number)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+
+    node->queue_head = (uint8_t)((node->queue_head + number) % NETSIM_QUEUE_SIZE);
+    node->queue_count -= number;
+}
+
+/**
+ * @brief   Copy the request at the head of the queue of the gateway
+ *
+ * @return  Its node, NETSIM_NOBODY if none
+ */
+uint16_t Node__TakeRequest(uint8_t *payload)
+{
+    if (Requests_Count == 0)
+    {
+        return NETSIM_NOBODY;
+    }
+    memset(payload, 0, NETSIM_PAYLOAD_MAX);
+    payload[0] = COMMAND_REQUEST_TAG;
+    payload[1] = 3;
+    payload[2] = 0;     // sequence
+    payload[3] = COMMAND_OP_REPORT;
+    payload[4] = 1;
+    return Requests[Requests_Head];
+}
+
+/**
+ * @brief   A payload in the TX FIFO of a node that runs the firmware
+ */
+void Node__Loaded(uint16_t id, const uint8_t *payload)
+{
+    NODE_T *node = &Netsim__Nodes[id];
+
+    if (payload[0] == COMMAND_REPORT_TAG)
+    {
+        node->generated++;
+        node->loaded = Firmware__Now();
+    }
+}
+
+uint32_t Node__GetLatencies(double **latencies_ms)
+{
+    *latencies_ms = Latencies_Ms;
+    return Latencies_Number;
+}
+
+/**
+ * @brief   DS18B20 of the running node, in its room
+ */
+int16_t Host__GetTemperature(void)
+{
+    const NODE_T *node = &Netsim__Nodes[Firmware__Current()];
+
+    return (int16_t)lround(node->room * 16) + (int16_t)(Netsim__Random() % 3) - 1;
+}
@@ -0,0 +1,338 @@
+/**
+ * @file nrf24.c
+ *
+ * @brief nRF24L01+ on the SPI bus of a node that runs the firmware,
+ *        network simulator
+ *
+ * @details The registers, a TX FIFO of one payload and the RX FIFO, as
+ *          radio.c uses them: static payloads of NETSIM_PAYLOAD_MAX bytes
+ *          on pipe 0, auto acknowledge. The select line has no edge
+ *          between two transfers in the host model, so a transaction ends
+ *          after the data bytes of its command. CE is PB1, IRQ drives INT0
+ *          on PD2 with a falling edge. A CE pulse in PTX with a payload
+ *          starts a burst in esb.c, which tells the end of it here, with
+ *          TX_DS or MAX_RT; received payloads come from esb.c as well.
+ *          ARC and ARD are those of SETUP_RETR; the data rate and output
+ *          power stay those of the options.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <string.h>
+#include <avr/io.h>
+#include "host.h"
+#include "radio.h"
+#include "command.h"
+#include "netsim.h"
+
+#define NRF24_STATUS_IRQ    ((1 << BIT_RX_DR) | (1 << BIT_TX_DS) | (1 << BIT_MAX_RT))
+#define NRF24_RX_P_NO_EMPTY (0x07 << BIT_RX_P_NO)
+#define NRF24_ARD_STEP_US   250
+
+static uint8_t IsAddress(uint8_t reg)
+{
+    return reg == REG_RX_ADDR_P0 || reg == REG_RX_ADDR_P1 || reg == REG_TX_ADDR;
+}
+
+static uint8_t Status(const NRF24_T *chip)
+{
+    return (chip->registers[REG_STATUS] & NRF24_STATUS_IRQ) |
+           ((chip->rx_count == 0) ? NRF24_RX_P_NO_EMPTY : 0) |
+           (chip->tx_full ? (1 << BIT_TX_FULL) : 0);
+}
+
+static uint8_t FifoStatus(const NRF24_T *chip)
+{
+    return (chip->tx_full ? (1 << BIT_FIFO_FULL) : (1 << BIT_TX_EMPTY)) |
+           ((chip->rx_count == NETSIM_RX_FIFO) ? (1 << BIT_RX_FULL) : 0) |
+           ((chip->rx_count == 0) ? (1 << BIT_RX_EMPTY) : 0);
+}
+
+/**
+ * @brief   The IRQ line follows the flags that are not masked
+ */
+static void UpdateIrq(uint16_t node)
+{
+    NRF24_T *chip = &Netsim__Nodes[node].chip;
+    uint8_t masked = chip->registers[REG_CONFIG] & NRF24_STATUS_IRQ;
+    uint8_t low = (chip->registers[REG_STATUS] & NRF24_STATUS_IRQ & (uint8_t)~masked) != 0;
+
+    if (low && chip->irq == 0)
+    {
+        chip->edge = 1;
+        Firmware__Wake(node, Events__Now());
+    }
+    chip->irq = low;
+}
+
+/**
+ * @return  Data bytes after the command
+ */
+static uint8_t Length(const NRF24_T *chip, uint8_t command)
+{
+    uint8_t reg = command & CMD_REGISTER_MASK;
+
+    if (command < CMD_ACTIVATE)
+    {
+        // R_REGISTER, W_REGISTER; SETUP_AW 1 to 3 for 3 to 5 bytes
+        return IsAddress(reg) ? (uint8_t)((chip->registers[REG_SETUP_AW] & 0x03) + 2) : 1;
+    }
+    if (command == CMD_R_RX_PAYLOAD || command == CMD_W_TX_PAYLOAD)
+    {
+        return NETSIM_PAYLOAD_MAX;
+    }
+    return 0;
+}
+
+static void WriteRegister(uint16_t node, uint8_t reg, uint8_t value)
+{
+    NRF24_T *chip = &Netsim__Nodes[node].chip;
+
+    if (reg == REG_STATUS)
+    {
+        // Written one, a flag is cleared
+        chip->registers[REG_STATUS] &= (uint8_t)~(value & NRF24_STATUS_IRQ);
+        UpdateIrq(node);
+    }
+    else if (reg == REG_CONFIG)
+    {
+        chip->registers[REG_CONFIG] = value;
+        UpdateIrq(node);
+        Esb__Refresh(node);
+    }
+    else if (reg != REG_FIFO_STATUS)
+    {
+        chip->registers[reg] = value;
+    }
+}
+
+static uint8_t ReadRegister(const NRF24_T *chip, uint8_t reg)
+{
+    if (reg == REG_STATUS)
+    {
+        return Status(chip);
+    }
+    if (reg == REG_FIFO_STATUS)
+    {
+        return FifoStatus(chip);
+    }
+    return chip->registers[reg];
+}
+
+/**
+ * @brief   The last byte of a command is in
+ */
+static void Execute(uint16_t node)
+{
+    NRF24_T *chip = &Netsim__Nodes[node].chip;
+
+    switch (chip->command)
+    {
+        case CMD_R_RX_PAYLOAD:
+        {
+            if (chip->rx_count != 0)
+            {
+                chip->rx_count--;
+                memmove(chip->rx[0], chip->rx[1], (size_t)chip->rx_count * NETSIM_PAYLOAD_MAX);
+            }
+            break;
+        }
+        case CMD_W_TX_PAYLOAD:
+        {
+            chip->tx_full = 1;
+            Node__Loaded(node, chip->tx);
+            break;
+        }
+        case CMD_FLUSH_TX:
+        {
+            chip->tx_full = 0;
+            break;
+        }
+        case CMD_FLUSH_RX:
+        {
+            chip->rx_count = 0;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+void Nrf24__Initialize(uint16_t node)
+{
+    NRF24_T *chip = &Netsim__Nodes[node].chip;
+
+    // Reset values
+    memset(chip, 0, sizeof(*chip));
+    chip->registers[REG_CONFIG] = (1 << BIT_EN_CRC);
+    chip->registers[REG_EN_AA] = 0x3F;
+    chip->registers[REG_EN_RXADDR] = (1 << BIT_ERX_P1) | (1 << BIT_ERX_P0);
+    chip->registers[REG_SETUP_AW] = 0x03;
+    chip->registers[REG_SETUP_RETR] = 0x03;
+    chip->registers[REG_RF_CH] = 0x02;
+    chip->registers[REG_RF_SETUP] = 0x0E;
+}
+
+RADIO_STATE_T Nrf24__GetState(uint16_t node)
+{
+    const NRF24_T *chip = &Netsim__Nodes[node].chip;
+
+    if ((chip->registers[REG_CONFIG] & (1 << BIT_PWR_UP)) == 0)
+    {
+        return RADIO_OFF;
+    }
+    if ((chip->registers[REG_CONFIG] & (1 << BIT_PRIM_RX)) && chip->ce)
+    {
+        return RADIO_RX;
+    }
+    return RADIO_STANDBY;
+}
+
+uint8_t Nrf24__GetRetransmits(uint16_t node)
+{
+    return Netsim__Nodes[node].chip.registers[REG_SETUP_RETR] & 0x0F;
+}
+
+uint16_t Nrf24__GetRetransmitDelayUs(uint16_t node)
+{
+    return (uint16_t)(((Netsim__Nodes[node].chip.registers[REG_SETUP_RETR] >> BIT_ARD) + 1) * NRF24_ARD_STEP_US);
+}
+
+void Nrf24__GetPayload(uint16_t node, uint8_t *payload)
+{
+    memcpy(payload, Netsim__Nodes[node].chip.tx, NETSIM_PAYLOAD_MAX);
+}
+
+/**
+ * @return  1 if a packet would not be acknowledged
+ */
+uint8_t Nrf24__IsRxFull(uint16_t node)
+{
+    return Netsim__Nodes[node].chip.rx_count == NETSIM_RX_FIFO;
+}
+
+void Nrf24__Receive(uint16_t node, const uint8_t *payload)
+{
+    NRF24_T *chip = &Netsim__Nodes[node].chip;
+
+    memcpy(chip->rx[chip->rx_count++], payload, NETSIM_PAYLOAD_MAX);
+    chip->registers[REG_STATUS] |= (1 << BIT_RX_DR);
+    UpdateIrq(node);
+}
+
+/**
+ * @brief   End of a burst: out of the TX FIFO when acknowledged, else it
+ *          stays there
+ */
+void Nrf24__Sent(uint16_t node, uint8_t acknowledged)
+{
+    NRF24_T *chip = &Netsim__Nodes[node].chip;
+
+    if (acknowledged)
+    {
+        chip->tx_full = 0;
+        chip->registers[REG_STATUS] |= (1 << BIT_TX_DS);
+    }
+    else
+    {
+        chip->registers[REG_STATUS] |= (1 << BIT_MAX_RT);
+        if (chip->tx[0] == COMMAND_REPORT_TAG)
+        {
+            Netsim__Nodes[node].lost_reports++;
+        }
+    }
+    UpdateIrq(node);
+}
+
+/**
+ * @brief   A byte on the SPI bus of the running node
+ */
+uint8_t Host__SpiExchange(uint8_t data)
+{
+    uint16_t node = Firmware__Current();
+    NRF24_T *chip = &Netsim__Nodes[node].chip;
+    uint8_t reg = chip->command & CMD_REGISTER_MASK;
+    uint8_t index = chip->index;
+    uint8_t out = 0xFF;
+
+    if (PORTB & (1 << PORTB2))
+    {
+        // Not selected
+        return 0xFF;
+    }
+    if (index == 0)
+    {
+        chip->command = data;
+        chip->length = Length(chip, data);
+        out = Status(chip);
+    }
+    else if (chip->command < CMD_W_REGISTER)
+    {
+        out = (index == 1) ? ReadRegister(chip, reg) : 0;
+    }
+    else if (chip->command < CMD_ACTIVATE)
+    {
+        if (index == 1)
+        {
+            WriteRegister(node, reg, data);
+        }
+    }
+    else if (chip->command == CMD_R_RX_PAYLOAD)
+    {
+        out = chip->rx[0][index - 1];
+    }
+    else if (chip->command == CMD_W_TX_PAYLOAD)
+    {
+        chip->tx[index - 1] = data;
+    }
+
+    if (index == chip->length)
+    {
+        chip->index = 0;
+        Execute(node);
+    }
+    else
+    {
+        chip->index++;
+    }
+    return out;
+}
+
+/**
+ * @brief   The pins of the running node, at each step of its time
+ */
+void Host__SamplePins(uint64_t now)
+{
+    uint16_t node = Firmware__Current();
+    NRF24_T *chip;
+    uint8_t ce;
+
+    (void)now;
+    if (node == NETSIM_NOBODY)
+    {
+        return;
+    }
+    chip = &Netsim__Nodes[node].chip;
+    ce = (PORTB & (1 << PORTB1)) ? 1 : 0;
+    if (ce != chip->ce)
+    {
+        chip->ce = ce;
+        if (ce && (chip->registers[REG_CONFIG] & ((1 << BIT_PWR_UP) | (1 << BIT_PRIM_RX))) ==
+                  (1 << BIT_PWR_UP) && chip->tx_full)
+        {
+            Esb__Burst(node, Firmware__Now());
+        }
+        else
+        {
+            Esb__Refresh(node);
+        }
+    }
+    if (chip->edge)
+    {
+        chip->edge = 0;
+        EIFR |= (1 << INTF0);
+    }
+}
@@ -0,0 +1,811 @@
+/**
+ * @file command.c
+ *
+ * @brief Remote commands
+ *
+ * @details A request is a sequence number followed by a list of operations.
+ *          All the operations of a request are applied together: the SETs
+ *          are made on a copy of the parameters, published only if every
+ *          operation succeeded, so a node is reconfigured with one frame
+ *          and never left half configured. In the same way, time,
+ *          override, schedule and temperatures are applied only after
+ *          every operation has been checked.
+ *          The response is the sequence number and a status, followed by
+ *          the output of each operation on success, or by the index of the
+ *          failed operation.
+ *          Command__Process does not depend on the transport. Both are
+ *          handled here: the USART frames, and the radio payloads, which
+ *          carry the same frame without the CRC since the module checks
+ *          its own. A request and its response fit one payload.
+ *          On request, a report frame with the last board temperature is
+ *          sent after each sample, without polling, on the link of the
+ *          request. On the radio, the metering report of one relay
+ *          follows it, the other relay at the next sample.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <util/crc16.h>
+#include "micro.h"
+#include "timer.h"
+#include "usart.h"
+#include "parameters.h"
+#include "relays.h"
+#include "metering.h"
+#include "logger.h"
+#include "schedule.h"
+#include "optimal_start.h"
+#include "thermostat.h"
+#include "relay_tuning.h"
+#include "trace.h"
+#include "critical.h"
+#include "memory.h"
+#include "fsm.h"
+#include "event.h"
+#include "probe.h"
+#include "radio.h"
+#include "command.h"
+
+#define COMMAND_RX_TIMEOUT_MS       200 // a frame is dropped after a silence this long
+
+typedef char COMMAND_RADIO_FRAME_SIZE_CHECK[(COMMAND_RADIO_FRAME_SIZE + 2 <= RADIO_PAYLOAD_SIZE) ? 1 : -1];
+
+typedef enum {
+    STATE_WAIT_TAG,
+    STATE_WAIT_LENGTH,
+    STATE_WAIT_PAYLOAD,
+    STATE_WAIT_CRC,
+    STATE_SEND_RESPONSE,
+} COMMAND_STATE_T;
+
+static COMMAND_STATE_T Command_State;
+static uint8_t Request[COMMAND_FRAME_SIZE];
+static uint8_t Request_Length;
+static uint8_t Request_Idx;
+static uint8_t Response[COMMAND_FRAME_SIZE];
+static uint8_t Response_Length;
+static uint8_t Crc;
+static uint32_t Last_Rx_Ms;
+static BOOL_T Report_Enabled[COMMAND_LINKS_NUMBER];
+static uint8_t Report_Sample;   // last sample taken
+static BOOL_T Report_Pending[COMMAND_LINKS_NUMBER];
+static BOOL_T Metering_Pending; // after the report, on the radio
+static uint8_t Radio_Request[RADIO_PAYLOAD_SIZE];
+static uint8_t Radio_Response[RADIO_PAYLOAD_SIZE];
+static BOOL_T Radio_Response_Pending;
+
+static void OnSampleTaken(const EVENT_RECORD_T *event);
+
+void Command__Initialize(void)
+{
+    uint8_t i;
+
+    Command_State = STATE_WAIT_TAG;
+    Last_Rx_Ms = 0;
+    for (i = 0; i < COMMAND_LINKS_NUMBER; i++)
+    {
+        Report_Enabled[i] = FALSE;
+        Report_Pending[i] = FALSE;
+    }
+    Report_Sample = 0;
+    Metering_Pending = FALSE;
+    Radio_Response_Pending = FALSE;
+    Event__Subscribe(EVENT_SAMPLE_TAKEN, OnSampleTaken);
+    Radio__TurnOn();
+}
+
+/**
+ * @brief   Execute a request
+ *
+ * @details Main loop only, since it updates the parameters
+ *
+ * @param   response    COMMAND_FRAME_SIZE bytes, COMMAND_RADIO_FRAME_SIZE
+ *                      for the radio
+ * @param   link        where the request came from, and the response goes
+ *
+ * @return  Length of the response, 0 if there is nothing to answer
+ */
+uint8_t Command__Process(const uint8_t *request, uint8_t length, uint8_t *response,
+                         COMMAND_LINK_T link)
+{
+    uint8_t frame_size = (link == COMMAND_LINK_RADIO) ? COMMAND_RADIO_FRAME_SIZE : COMMAND_FRAME_SIZE;
+    PARAM_T *update = NULL;
+    BOOL_T persist = FALSE;
+    uint8_t dump_idx = 0;
+    uint8_t trace_idx = 0;
+    uint8_t critical_clear = CRITICAL_SITES_NUMBER;
+    CRITICAL_REPORT_T critical;
+    uint16_t memory_alarm = 0;
+    MEMORY_REPORT_T memory;
+    uint8_t fsm_state;
+    uint32_t fsm_time;
+    BOOL_T set_time = FALSE;
+    uint32_t time = 0;
+    BOOL_T set_override = FALSE;
+    int16_t override_setpoint = 0;
+    uint16_t override_minutes = 0;
+    BOOL_T set_schedule = FALSE;
+    SCHEDULE_PROGRAM_T schedule;
+    BOOL_T set_outdoor = FALSE;
+    int16_t outdoor = 0;
+    uint8_t zone = THERMOSTAT_ZONES_NUMBER;
+    int16_t zone_temperature = 0;
+    uint8_t tuning_relay = 0;
+    BOOL_T tuning_start = FALSE;
+    uint8_t tuning_idx = 0;
+    BOOL_T set_report = FALSE;
+    BOOL_T report = FALSE;
+    uint8_t i;
+    uint8_t op_number = 0;
+    uint8_t in = 1;
+    uint8_t out = 2;
+    uint8_t id;
+    int16_t value;
+    const PARAM_DESCRIPTOR_T *descriptor;
+    COMMAND_STATUS_T status = COMMAND_OK;
+
+    if (length == 0)
+    {
+        return 0;
+    }
+    response[0] = request[0];
+
+    while (in < length && status == COMMAND_OK)
+    {
+        switch (request[in])
+        {
+            case COMMAND_OP_GET:
+            {
+                if (in + 2 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else if (out + 2 > frame_size)
+                {
+                    status = COMMAND_RESPONSE_TOO_LONG;
+                }
+                else if (Parameters__GetDescriptor(request[in + 1]) == NULL)
+                {
+                    status = COMMAND_BAD_ID;
+                }
+                else
+                {
+                    // A GET after a SET of the same request sees the new value
+                    value = Parameters__GetValue(
+                            (update != NULL) ? update : Parameters__Get(), request[in + 1]);
+                    response[out++] = (uint8_t)((uint16_t)value >> 8);
+                    response[out++] = (uint8_t)value;
+                    in += 2;
+                }
+                break;
+            }
+            case COMMAND_OP_SET:
+            {
+                if (in + 4 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                    break;
+                }
+                id = request[in + 1];
+                descriptor = Parameters__GetDescriptor(id);
+                if (descriptor == NULL)
+                {
+                    status = COMMAND_BAD_ID;
+                    break;
+                }
+                if (update == NULL)
+                {
+                    update = Parameters__BeginUpdate();
+                }
+                value = (int16_t)(((uint16_t)request[in + 2] << 8) | request[in + 3]);
+                if (Parameters__SetValue(update, id, value) == FALSE)
+                {
+                    status = COMMAND_OUT_OF_RANGE;
+                    break;
+                }
+                if (descriptor->flags & PARAM_FLAG_PERSISTENT)
+                {
+                    persist = TRUE;
+                }
+                in += 4;
+                break;
+            }
+            case COMMAND_OP_METERING:
+            {
+                if (in + 2 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else if (request[in + 1] >= METERING_CHANNELS_NUMBER)
+                {
+                    status = COMMAND_BAD_ID;
+                }
+                else if (out + METERING_REPORT_SIZE > frame_size)
+                {
+                    status = COMMAND_RESPONSE_TOO_LONG;
+                }
+                else
+                {
+                    out += Metering__SerializeCounters((RELAY_T)request[in + 1], &response[out]);
+                    in += 2;
+                }
+                break;
+            }
+            case COMMAND_OP_LOG_DUMP:
+            {
+                if (out + 1 > frame_size)
+                {
+                    status = COMMAND_RESPONSE_TOO_LONG;
+                }
+                else
+                {
+                    // Started only once the whole request is known to be valid
+                    dump_idx = out;
+                    response[out++] = 0;
+                    in += 1;
+                }
+                break;
+            }
+            case COMMAND_OP_TRACE_DUMP:
+            {
+                if (out + 1 > frame_size)
+                {
+                    status = COMMAND_RESPONSE_TOO_LONG;
+                }
+                else
+                {
+                    trace_idx = out;
+                    response[out++] = 0;
+                    in += 1;
+                }
+                break;
+            }
+            case COMMAND_OP_CRITICAL:
+            {
+                if (in + 3 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else if (request[in + 1] >= CRITICAL_SITES_NUMBER)
+                {
+                    status = COMMAND_BAD_ID;
+                }
+                else if (out + 8 > frame_size)
+                {
+                    status = COMMAND_RESPONSE_TOO_LONG;
+                }
+                else
+                {
+                    Critical__GetReport((CRITICAL_SITE_T)request[in + 1], &critical);
+                    response[out++] = (uint8_t)(critical.calls >> 8);
+                    response[out++] = (uint8_t)critical.calls;
+                    response[out++] = (uint8_t)(critical.max_us >> 8);
+                    response[out++] = (uint8_t)critical.max_us;
+                    response[out++] = (uint8_t)(critical.total_us >> 24);
+                    response[out++] = (uint8_t)(critical.total_us >> 16);
+                    response[out++] = (uint8_t)(critical.total_us >> 8);
+                    response[out++] = (uint8_t)critical.total_us;
+                    if (request[in + 2] != 0)
+                    {
+                        critical_clear = request[in + 1];
+                    }
+                    in += 3;
+                }
+                break;
+            }
+            case COMMAND_OP_MEMORY:
+            {
+                if (in + 3 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else if (out + 8 > frame_size)
+                {
+                    status = COMMAND_RESPONSE_TOO_LONG;
+                }
+                else
+                {
+                    Memory__GetReport(&memory);
+                    response[out++] = (uint8_t)(memory.static_bytes >> 8);
+                    response[out++] = (uint8_t)memory.static_bytes;
+                    response[out++] = (uint8_t)(memory.boot_free >> 8);
+                    response[out++] = (uint8_t)memory.boot_free;
+                    response[out++] = (uint8_t)(memory.lowest_free >> 8);
+                    response[out++] = (uint8_t)memory.lowest_free;
+                    response[out++] = (uint8_t)(memory.stack_bytes >> 8);
+                    response[out++] = (uint8_t)memory.stack_bytes;
+                    memory_alarm = ((uint16_t)request[in + 1] << 8) | request[in + 2];
+                    in += 3;
+                }
+                break;
+            }
+            case COMMAND_OP_FSM:
+            {
+                if (in + 3 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else if (out + 5 > frame_size)
+                {
+                    status = COMMAND_RESPONSE_TOO_LONG;
+                }
+                else if (Fsm__GetTimeUs(request[in + 1], request[in + 2], &fsm_state, &fsm_time) == FALSE)
+                {
+                    status = COMMAND_BAD_ID;
+                }
+                else
+                {
+                    response[out++] = fsm_state;
+                    response[out++] = (uint8_t)(fsm_time >> 24);
+                    response[out++] = (uint8_t)(fsm_time >> 16);
+                    response[out++] = (uint8_t)(fsm_time >> 8);
+                    response[out++] = (uint8_t)fsm_time;
+                    in += 3;
+                }
+                break;
+            }
+            case COMMAND_OP_TIME:
+            {
+                if (in + 5 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else
+                {
+                    time = ((uint32_t)request[in + 1] << 24) | ((uint32_t)request[in + 2] << 16) |
+                           ((uint32_t)request[in + 3] << 8) | request[in + 4];
+                    set_time = TRUE;
+                    in += 5;
+                }
+                break;
+            }
+            case COMMAND_OP_OVERRIDE:
+            {
+                descriptor = Parameters__GetDescriptor(PARAM_ID_TEMP_SET);
+                if (in + 5 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                    break;
+                }
+                override_setpoint = (int16_t)(((uint16_t)request[in + 1] << 8) | request[in + 2]);
+                override_minutes = ((uint16_t)request[in + 3] << 8) | request[in + 4];
+                if (override_setpoint < descriptor->min || override_setpoint > descriptor->max)
+                {
+                    status = COMMAND_OUT_OF_RANGE;
+                    break;
+                }
+                set_override = TRUE;
+                in += 5;
+                break;
+            }
+            case COMMAND_OP_SCHEDULE:
+            {
+                if (in + 1 + 2 * SCHEDULE_LEVELS_NUMBER + 1 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                    break;
+                }
+                in++;
+                for (i = 0; i < SCHEDULE_LEVELS_NUMBER; i++)
+                {
+                    schedule.levels[i] = (int16_t)(((uint16_t)request[in] << 8) | request[in + 1]);
+                    in += 2;
+                }
+                schedule.count = request[in++];
+                if (schedule.count > SCHEDULE_POINTS_MAX || in + 2 * schedule.count > length)
+                {
+                    status = COMMAND_MALFORMED;
+                    break;
+                }
+                for (i = 0; i < schedule.count; i++)
+                {
+                    schedule.points[i] = ((uint16_t)request[in] << 8) | request[in + 1];
+                    in += 2;
+                }
+                if (Schedule__IsValid(&schedule) == FALSE)
+                {
+                    status = COMMAND_OUT_OF_RANGE;
+                }
+                else if (Schedule__IsSaving())
+                {
+                    status = COMMAND_BUSY;
+                }
+                else
+                {
+                    set_schedule = TRUE;
+                }
+                break;
+            }
+            case COMMAND_OP_OUTDOOR:
+            {
+                if (in + 3 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else
+                {
+                    outdoor = (int16_t)(((uint16_t)request[in + 1] << 8) | request[in + 2]);
+                    set_outdoor = TRUE;
+                    in += 3;
+                }
+                break;
+            }
+            case COMMAND_OP_ZONE_TEMP:
+            {
+                if (in + 4 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else if (request[in + 1] >= THERMOSTAT_ZONES_NUMBER)
+                {
+                    status = COMMAND_BAD_ID;
+                }
+                else
+                {
+                    zone = request[in + 1];
+                    zone_temperature = (int16_t)(((uint16_t)request[in + 2] << 8) | request[in + 3]);
+                    in += 4;
+                }
+                break;
+            }
+            case COMMAND_OP_RELAY_TUNING:
+            {
+                if (in + 3 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else if (request[in + 1] >= RELAYS_NUMBER)
+                {
+                    status = COMMAND_BAD_ID;
+                }
+                else if (out + 1 > frame_size)
+                {
+                    status = COMMAND_RESPONSE_TOO_LONG;
+                }
+                else
+                {
+                    // Started, and answered, once the whole request is valid
+                    tuning_relay = request[in + 1];
+                    tuning_start = (request[in + 2] != 0) ? TRUE : FALSE;
+                    tuning_idx = out;
+                    response[out++] = RELAY_TUNING_NONE;
+                    in += 3;
+                }
+                break;
+            }
+            case COMMAND_OP_REPORT:
+            {
+                if (in + 2 > length)
+                {
+                    status = COMMAND_MALFORMED;
+                }
+                else
+                {
+                    report = (request[in + 1] != 0) ? TRUE : FALSE;
+                    set_report = TRUE;
+                    in += 2;
+                }
+                break;
+            }
+            default:
+            {
+                status = COMMAND_BAD_OPERATION;
+                break;
+            }
+        }
+
+        if (status == COMMAND_OK)
+        {
+            op_number++;
+        }
+    }
+
+    response[1] = status;
+    if (status != COMMAND_OK)
+    {
+        // The copy being updated is simply not published
+        response[2] = op_number;
+        return 3;
+    }
+
+    if (update != NULL)
+    {
+        Parameters__Publish(persist);
+    }
+    if (set_time)
+    {
+        Logger__SetTime(time);
+    }
+    if (set_schedule)
+    {
+        Schedule__SetProgram(&schedule);
+    }
+    if (set_override)
+    {
+        Schedule__SetOverride(override_setpoint, override_minutes);
+    }
+    if (set_outdoor)
+    {
+        OptimalStart__SetOutdoorTemperature(outdoor);
+    }
+    if (zone < THERMOSTAT_ZONES_NUMBER)
+    {
+        Thermostat__SetRemoteTemperature(zone, zone_temperature);
+    }
+    if (tuning_idx != 0)
+    {
+        if (tuning_start)
+        {
+            RelayTuning__Start((RELAY_T)tuning_relay);
+        }
+        response[tuning_idx] = RelayTuning__GetResult((RELAY_T)tuning_relay);
+    }
+    if (dump_idx != 0)
+    {
+        response[dump_idx] = Logger__StartDump(
+                (link == COMMAND_LINK_RADIO) ? LOGGER_LINK_RADIO : LOGGER_LINK_USART);
+    }
+    if (memory_alarm != 0)
+    {
+        Memory__SetAlarm(memory_alarm);
+    }
+    if (critical_clear < CRITICAL_SITES_NUMBER)
+    {
+        Critical__ClearReport((CRITICAL_SITE_T)critical_clear);
+    }
+    if (set_report)
+    {
+        // From the next sample on
+        Report_Pending[link] = FALSE;
+        Metering_Pending = FALSE;
+        Report_Enabled[link] = report;
+    }
+    if (trace_idx != 0)
+    {
+        // One stream at a time on the USART
+        response[trace_idx] = (Logger__IsDumping(LOGGER_LINK_USART) == FALSE) ?
+                Trace__StartDump() : FALSE;
+    }
+    return out;
+}
+
+/**
+ * @brief   A report is due, if enabled
+ */
+static void OnSampleTaken(const EVENT_RECORD_T *event)
+{
+    uint8_t i;
+
+    Report_Sample = event->arg;
+    for (i = 0; i < COMMAND_LINKS_NUMBER; i++)
+    {
+        Report_Pending[i] = Report_Enabled[i];
+    }
+}
+
+/**
+ * @param   report  COMMAND_REPORT_SIZE bytes
+ */
+static void BuildReport(uint8_t *report)
+{
+    int16_t temperature;
+
+    report[0] = Report_Sample;
+    report[3] = Thermostat__GetTemperature(0, &temperature) ? COMMAND_REPORT_VALID : 0;
+    report[1] = (uint8_t)((uint16_t)temperature >> 8);
+    report[2] = (uint8_t)temperature;
+    if (Relays__IsSet(RELAY_0))
+    {
+        report[3] |= COMMAND_REPORT_RELAY_0;
+    }
+    if (Relays__IsSet(RELAY_1))
+    {
+        report[3] |= COMMAND_REPORT_RELAY_1;
+    }
+}
+
+/**
+ * @brief   Report frame of the last sample, delayed while the USART is busy
+ */
+static void SendReport(void)
+{
+    uint8_t report[COMMAND_REPORT_SIZE];
+    uint8_t crc;
+    uint8_t i;
+
+    if (Logger__IsDumping(LOGGER_LINK_USART) || Trace__IsDumping() ||
+        Usart__GetTxFreeSpace() < COMMAND_REPORT_SIZE + 3)
+    {
+        return;
+    }
+    Report_Pending[COMMAND_LINK_USART] = FALSE;
+    BuildReport(report);
+
+    crc = _crc8_ccitt_update(0, COMMAND_REPORT_SIZE);
+    Usart__PutChar(COMMAND_REPORT_TAG);
+    Usart__PutChar(COMMAND_REPORT_SIZE);
+    for (i = 0; i < COMMAND_REPORT_SIZE; i++)
+    {
+        Usart__PutChar(report[i]);
+        crc = _crc8_ccitt_update(crc, report[i]);
+    }
+    Usart__PutChar(crc);
+    Probe__Mark(PROBE_FRAME_QUEUED, Report_Sample);
+}
+
+/**
+ * @brief   Report payload of the last sample, delayed while the radio is busy
+ */
+static void TransmitReport(void)
+{
+    uint8_t payload[RADIO_PAYLOAD_SIZE] = {COMMAND_REPORT_TAG, COMMAND_REPORT_SIZE};
+
+    BuildReport(&payload[2]);
+    if (Radio__Transmit(payload))
+    {
+        Report_Pending[COMMAND_LINK_RADIO] = FALSE;
+        Metering_Pending = TRUE;
+    }
+}
+
+/**
+ * @brief   Radio transport
+ *
+ * @details A request is taken once the response to the previous one is
+ *          handed to the driver. A payload that is not a request is
+ *          ignored.
+ */
+static void RadioTask(void)
+{
+    uint8_t length;
+
+    if (Radio_Response_Pending)
+    {
+        if (Radio__Transmit(Radio_Response))
+        {
+            Radio_Response_Pending = FALSE;
+        }
+    }
+    else if (Radio__Receive(Radio_Request))
+    {
+        length = Radio_Request[1];
+        if (Radio_Request[0] == COMMAND_REQUEST_TAG &&
+            length != 0 && length <= COMMAND_RADIO_FRAME_SIZE)
+        {
+            Probe__Mark(PROBE_COMMAND_PARSED, Radio_Request[2]);
+            memset(Radio_Response, 0, RADIO_PAYLOAD_SIZE);
+            length = Command__Process(&Radio_Request[2], length, &Radio_Response[2],
+                                      COMMAND_LINK_RADIO);
+            if (length != 0)
+            {
+                Radio_Response[0] = COMMAND_RESPONSE_TAG;
+                Radio_Response[1] = length;
+                Radio_Response_Pending = TRUE;
+            }
+        }
+    }
+    else if (Report_Pending[COMMAND_LINK_RADIO])
+    {
+        TransmitReport();
+    }
+    else if (Metering_Pending)
+    {
+        if (Metering__TransmitReport((RELAY_T)(Report_Sample % METERING_CHANNELS_NUMBER)))
+        {
+            Metering_Pending = FALSE;
+        }
+    }
+}
+
+/**
+ * @brief   USART and radio transports
+ *
+ * @details Call it from the main loop. A request with a wrong CRC is
+ *          ignored. The response waits for the end of a log or trace dump,
+ *          so they never mix on the line.
+ */
+void Command__FastTask(void)
+{
+    COMMAND_STATE_T next_state;
+    uint8_t c;
+    uint8_t i;
+
+    next_state = Command_State;
+
+    if (Command_State != STATE_WAIT_TAG &&
+        Command_State != STATE_SEND_RESPONSE &&
+        Timer__GetMs() - Last_Rx_Ms >= COMMAND_RX_TIMEOUT_MS)
+    {
+        next_state = STATE_WAIT_TAG;
+    }
+    else if (Command_State != STATE_SEND_RESPONSE && Usart__IsRxBufferEmpty() == FALSE)
+    {
+        c = Usart__GetChar();
+        Last_Rx_Ms = Timer__GetMs();
+
+        switch (Command_State)
+        {
+            case STATE_WAIT_TAG:
+            {
+                if (c == COMMAND_REQUEST_TAG)
+                {
+                    next_state = STATE_WAIT_LENGTH;
+                }
+                break;
+            }
+            case STATE_WAIT_LENGTH:
+            {
+                if (c == 0 || c > COMMAND_FRAME_SIZE)
+                {
+                    next_state = STATE_WAIT_TAG;
+                }
+                else
+                {
+                    Request_Length = c;
+                    Request_Idx = 0;
+                    Crc = _crc8_ccitt_update(0, c);
+                    next_state = STATE_WAIT_PAYLOAD;
+                }
+                break;
+            }
+            case STATE_WAIT_PAYLOAD:
+            {
+                Request[Request_Idx++] = c;
+                Crc = _crc8_ccitt_update(Crc, c);
+                if (Request_Idx == Request_Length)
+                {
+                    next_state = STATE_WAIT_CRC;
+                }
+                break;
+            }
+            case STATE_WAIT_CRC:
+            {
+                next_state = STATE_WAIT_TAG;
+                if (c == Crc)
+                {
+                    Probe__Mark(PROBE_COMMAND_PARSED, Request[0]);
+                    Response_Length = Command__Process(Request, Request_Length, Response,
+                                                       COMMAND_LINK_USART);
+                    if (Response_Length != 0)
+                    {
+                        next_state = STATE_SEND_RESPONSE;
+                    }
+                }
+                break;
+            }
+            default:
+            {
+                next_state = STATE_WAIT_TAG;
+                break;
+            }
+        }
+    }
+    else if (Command_State == STATE_SEND_RESPONSE)
+    {
+        if (Logger__IsDumping(LOGGER_LINK_USART) == FALSE && Trace__IsDumping() == FALSE &&
+            Usart__GetTxFreeSpace() >= Response_Length + 3)
+        {
+            Crc = _crc8_ccitt_update(0, Response_Length);
+            Usart__PutChar(COMMAND_RESPONSE_TAG);
+            Usart__PutChar(Response_Length);
+            for (i = 0; i < Response_Length; i++)
+            {
+                Usart__PutChar(Response[i]);
+                Crc = _crc8_ccitt_update(Crc, Response[i]);
+            }
+            Usart__PutChar(Crc);
+            next_state = STATE_WAIT_TAG;
+        }
+    }
+    else if (Command_State == STATE_WAIT_TAG && Report_Pending[COMMAND_LINK_USART])
+    {
+        SendReport();
+    }
+
+    Command_State = next_state;
+
+    RadioTask();
+}
@@ -0,0 +1,66 @@
+/**
+ * @file command.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include "micro.h"
+
+#define COMMAND_FRAME_SIZE          32 // max request or response on the USART
+#define COMMAND_RADIO_FRAME_SIZE    30 // in a radio payload, after the tag and the length
+
+// USART framing: tag, length, payload, CRC-8 of length and payload
+// Radio framing: tag, length, payload, zero padded to RADIO_PAYLOAD_SIZE
+#define COMMAND_REQUEST_TAG     'C'
+#define COMMAND_RESPONSE_TAG    'R'
+#define COMMAND_REPORT_TAG      'S' // unsolicited: sequence, temperature (2 bytes), COMMAND_REPORT_*
+
+#define COMMAND_REPORT_SIZE     4
+#define COMMAND_REPORT_VALID    0x01 // the temperature is fresh
+#define COMMAND_REPORT_RELAY_0  0x02
+#define COMMAND_REPORT_RELAY_1  0x04
+
+// Operations, several in one request. Values are big endian.
+#define COMMAND_OP_GET          0x01 // id                  -> value (2 bytes)
+#define COMMAND_OP_SET          0x02 // id, value (2 bytes)
+#define COMMAND_OP_METERING     0x03 // relay               -> metering report
+#define COMMAND_OP_LOG_DUMP     0x04 // on this link          -> 1 if the dump started
+#define COMMAND_OP_TIME         0x05 // local seconds since 1970 (4 bytes)
+#define COMMAND_OP_OVERRIDE     0x06 // setpoint (2 bytes), minutes (2 bytes), 0 to cancel
+#define COMMAND_OP_SCHEDULE     0x07 // levels (4 x 2 bytes), count, points (count x 2 bytes)
+#define COMMAND_OP_OUTDOOR      0x08 // outdoor temperature (2 bytes)
+#define COMMAND_OP_ZONE_TEMP    0x09 // zone, temperature (2 bytes), zones with a remote source
+#define COMMAND_OP_RELAY_TUNING 0x0A // relay, 1 to start the self-test -> RELAY_TUNING_RESULT_T
+#define COMMAND_OP_TRACE_DUMP   0x0B // on the USART          -> 1 if the dump started
+#define COMMAND_OP_CRITICAL     0x0C // site, 1 to clear it after -> calls (2), worst us (2), total us (4)
+#define COMMAND_OP_MEMORY       0x0D // alarm bytes (2), 0 to keep it -> MEMORY_REPORT_T (4 x 2 bytes)
+#define COMMAND_OP_REPORT       0x0E // 1 to send a report after each sample, 0 to stop, on this link;
+                                     // on the radio, the metering report of a relay follows, in turn
+#define COMMAND_OP_FSM          0x0F // FSM_ID_T, state        -> current state, us in the state (4 bytes)
+
+typedef enum {
+    COMMAND_LINK_USART = 0,
+    COMMAND_LINK_RADIO,
+    COMMAND_LINKS_NUMBER,
+} COMMAND_LINK_T;
+
+typedef enum {
+    COMMAND_OK,
+    COMMAND_BAD_OPERATION,
+    COMMAND_BAD_ID,
+    COMMAND_OUT_OF_RANGE,
+    COMMAND_MALFORMED,
+    COMMAND_RESPONSE_TOO_LONG,
+    COMMAND_BUSY,
+} COMMAND_STATUS_T;
+
+void Command__Initialize(void);
+uint8_t Command__Process(const uint8_t *request, uint8_t length, uint8_t *response,
+                         COMMAND_LINK_T link);
+void Command__FastTask(void);
+
+#endif /* COMMAND_H_ */
@@ -1,28 +1,254 @@
 /*
  * \file adc.c
  *
+ * \brief Interrupt driven ADC driver with channel sequencing and oversampling
+ *
+ * \details The converter runs either free running or triggered by the
+ *          Timer 0 compare match, and walks through a sequence of up to
+ *          ADC_SEQUENCE_MAX_LENGTH channels. For each channel the ISR
+ *          accumulates 4^n samples and decimates them by n bits, giving
+ *          10 + n bits of resolution.
+ *          Completed results are published in a double buffered sample
+ *          block: the ISR only writes the back buffer and flips the index,
+ *          the readers detect a flip through the block counter and retry,
+ *          so interrupts are never disabled on the reading side.
+ *
  * \date: 22/11/2014 19:28:36
  * \author: Leonardo Ricupero
- */ 
+ */
 
+#include "micro.h"
+#include "critical.h"
 #include "adc.h"
 
+// User parameters
+#define ADC_PRESCALER 128 // 16MHz / 128 = 125kHz, ~9.6k conversions per second
+
+#if (ADC_PRESCALER == 16)
+    #define ADC_PRESCALER_BITS ((1 << ADPS2) | (0 << ADPS1) | (0 << ADPS0))
+#elif (ADC_PRESCALER == 32)
+    #define ADC_PRESCALER_BITS ((1 << ADPS2) | (0 << ADPS1) | (1 << ADPS0))
+#elif (ADC_PRESCALER == 64)
+    #define ADC_PRESCALER_BITS ((1 << ADPS2) | (1 << ADPS1) | (0 << ADPS0))
+#elif (ADC_PRESCALER == 128)
+    #define ADC_PRESCALER_BITS ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))
+#else
+    #error "Invalid ADC prescaler value!!"
+#endif
+
+#define ADC_MUX_MASK 0x0F
+
+#define ADC__SELECT_CHANNEL(ch) {ADMUX = (ADMUX & ~ADC_MUX_MASK) | ((ch) & ADC_MUX_MASK);}
+
+static inline uint8_t NextSlot(uint8_t slot);
+
+static ADC_CONFIG_T Config;
+static ADC_SAMPLE_BLOCK_T Blocks[2];
+static uint16_t Accumulator[ADC_SEQUENCE_MAX_LENGTH];
+static volatile uint8_t Ready_Index;
+static volatile uint8_t Block_Counter;
+static uint8_t Write_Index;
+static uint8_t Converting_Slot; // slot of the conversion in progress
+static uint8_t Latched_Slot;    // slot of the conversion queued after it (free running)
+static uint8_t Rounds;
+static uint8_t Discard;
+
 /**
  * \brief Initializes the ADC
- * 
+ *
+ * \details AVCC reference, right adjusted result, converter left disabled
+ *          until Adc__Start is called
+ *
  * \return void
  */
-void ADCinit(void)
-{
-	// To-Do: complete initialization
-	// Reference selection: AVCC
-	ADMUX |= (1 << REFS0);
-	ADMUX &= ~(1 << REFS1);
-	// Channel selection: ADC0
-	ADMUX &= (1 << MUX0) & (1 << MUX1) & (1 << MUX2) & (1 << MUX3);
-	// Left Adjust (8 bit resolution)
-	ADMUX |= (1 << ADLAR);
-	// 
-	ADCSRA &= ~(1 << ADPS0);
-	ADCSRA |= (1 << ADPS1) | (1 << ADPS2);
+void Adc__Initialize(void)
+{
+    PRR &= ~(1 << PRADC);
+
+    // Reference selection: AVCC, right adjusted, channel ADC0
+    ADMUX = (0 << REFS1) | (1 << REFS0) | (0 << ADLAR);
+    ADCSRA = ADC_PRESCALER_BITS;
+    ADCSRB = 0;
+
+    Config.trigger = ADC_TRIGGER_FREE_RUNNING;
+    Config.oversampling_bits = 0;
+    Config.length = 1;
+    Config.sequence[0] = ADC_CHANNEL_0;
+    Config.callback = NULL;
+
+    Ready_Index = 0;
+    Write_Index = 1;
+    Block_Counter = 0;
+}
+
+/**
+ * \brief Set trigger, sequence and oversampling
+ *
+ * \details The converter is stopped, call Adc__Start to resume
+ */
+void Adc__Configure(const ADC_CONFIG_T *config)
+{
+    uint8_t i;
+
+    Adc__Stop();
+
+    Config = *config;
+    if (Config.length == 0 || Config.length > ADC_SEQUENCE_MAX_LENGTH)
+    {
+        Config.length = ADC_SEQUENCE_MAX_LENGTH;
+    }
+    if (Config.oversampling_bits > ADC_OVERSAMPLING_MAX_BITS)
+    {
+        Config.oversampling_bits = ADC_OVERSAMPLING_MAX_BITS;
+    }
+
+    // Disable the digital input buffers of the used pins
+    for (i = 0; i < Config.length; i++)
+    {
+        if (Config.sequence[i] <= ADC_CHANNEL_5)
+        {
+            DIDR0 |= (1 << Config.sequence[i]);
+        }
+    }
+}
+
+void Adc__Start(void)
+{
+    uint8_t i;
+
+    CRITICAL_BLOCK(CRITICAL_SITE_ADC)
+    {
+        for (i = 0; i < ADC_SEQUENCE_MAX_LENGTH; i++)
+        {
+            Accumulator[i] = 0;
+        }
+        Rounds = 0;
+        Converting_Slot = 0;
+        Latched_Slot = 0;
+        ADC__SELECT_CHANNEL(Config.sequence[0]);
+
+        ADCSRB = Config.trigger;
+        Micro__Write(ADCSRA, ADCSRA | (1 << ADEN) | (1 << ADIF) | (1 << ADATE) | (1 << ADIE));
+
+        if (Config.trigger == ADC_TRIGGER_FREE_RUNNING)
+        {
+            // The channel for the second conversion is latched before we
+            // can change it, so the first result is thrown away
+            Discard = 1;
+            Micro__Write(ADCSRA, ADCSRA | (1 << ADSC));
+        }
+        else
+        {
+            Discard = 0;
+        }
+    }
+}
+
+void Adc__Stop(void)
+{
+    ADCSRA &= ~((1 << ADEN) | (1 << ADATE) | (1 << ADIE));
+}
+
+/**
+ * \brief Get the counter of the published sample blocks
+ *
+ * \details Increments by one for each new block, compare it with the
+ *          counter of the last block read to know if a new one is ready
+ */
+uint8_t Adc__GetBlockCounter(void)
+{
+    return Block_Counter;
+}
+
+/**
+ * \brief Copy the last completed sample block
+ *
+ * \details Lock free: if the ISR publishes a new block while copying,
+ *          the copy is repeated
+ */
+void Adc__ReadBlock(ADC_SAMPLE_BLOCK_T *block)
+{
+    uint8_t counter;
+    uint8_t i;
+    const ADC_SAMPLE_BLOCK_T *source;
+
+    do
+    {
+        counter = Block_Counter;
+        source = &Blocks[Ready_Index];
+        for (i = 0; i < ADC_SEQUENCE_MAX_LENGTH; i++)
+        {
+            block->value[i] = source->value[i];
+        }
+    } while (counter != Block_Counter);
+
+    block->counter = counter;
+}
+
+static inline uint8_t NextSlot(uint8_t slot)
+{
+    slot++;
+    if (slot >= Config.length)
+    {
+        slot = 0;
+    }
+    return slot;
+}
+
+/**
+ * ADC conversion complete ISR
+ *
+ */
+ISR(ADC_vect)
+{
+    uint16_t sample;
+    uint8_t slot;
+    uint8_t i;
+
+    sample = ADC;
+    slot = Converting_Slot;
+
+    // Move the channel pipeline forward. In free running mode the next
+    // conversion has already started with the channel latched before.
+    if (Config.trigger == ADC_TRIGGER_FREE_RUNNING)
+    {
+        Converting_Slot = Latched_Slot;
+        Latched_Slot = NextSlot(Latched_Slot);
+        ADC__SELECT_CHANNEL(Config.sequence[Latched_Slot]);
+    }
+    else
+    {
+        Converting_Slot = NextSlot(Converting_Slot);
+        ADC__SELECT_CHANNEL(Config.sequence[Converting_Slot]);
+    }
+
+    if (Discard != 0)
+    {
+        Discard--;
+        return;
+    }
+
+    Accumulator[slot] += sample;
+
+    if (slot == Config.length - 1)
+    {
+        Rounds++;
+        if (Rounds >> (Config.oversampling_bits << 1))
+        {
+            Rounds = 0;
+            for (i = 0; i < Config.length; i++)
+            {
+                sample = Accumulator[i] >> Config.oversampling_bits;
+                Accumulator[i] = 0;
+                Blocks[Write_Index].value[i] = sample;
+                if (Config.callback != NULL)
+                {
+                    Config.callback(i, sample);
+                }
+            }
+            Ready_Index = Write_Index;
+            Write_Index ^= 1;
+            Block_Counter++;
+        }
+    }
 }
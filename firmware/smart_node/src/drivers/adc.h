@@ -1,16 +1,63 @@
 /*
- * \file amperometer.h
+ * \file adc.h
  *
  * \date: 22/11/2014 19:29:07
  * \author: Leonardo Ricupero
- */ 
+ */
 
 
 #ifndef ADC_H_
 #define ADC_H_
 
-#include <avr/io.h>
+#include "micro.h"
 
+#define ADC_SEQUENCE_MAX_LENGTH     4
+#define ADC_OVERSAMPLING_MAX_BITS   3 // 4^3 = 64 samples still fit 16 bits
 
+typedef enum {
+    ADC_CHANNEL_0 = 0,
+    ADC_CHANNEL_1,
+    ADC_CHANNEL_2,
+    ADC_CHANNEL_3,
+    ADC_CHANNEL_4,
+    ADC_CHANNEL_5,
+    ADC_CHANNEL_6,
+    ADC_CHANNEL_7,
+    ADC_CHANNEL_BANDGAP = 14,
+    ADC_CHANNEL_GND = 15,
+} ADC_CHANNEL_T;
+
+typedef enum {
+    ADC_TRIGGER_FREE_RUNNING = 0,
+    ADC_TRIGGER_TIMER0_COMPARE = 3, // one conversion per system tick (1ms)
+} ADC_TRIGGER_T;
+
+/**
+ * Called from the ADC ISR for each decimated result
+ *
+ * @param slot  position of the channel in the sequence
+ * @param value result with (10 + oversampling_bits) bits, right aligned
+ */
+typedef void (*ADC_CALLBACK_T)(uint8_t slot, uint16_t value);
+
+typedef struct {
+    ADC_TRIGGER_T trigger;
+    uint8_t oversampling_bits; // extra bits of resolution, 4^n samples each
+    uint8_t length;
+    ADC_CHANNEL_T sequence[ADC_SEQUENCE_MAX_LENGTH];
+    ADC_CALLBACK_T callback; // optional, may be NULL
+} ADC_CONFIG_T;
+
+typedef struct {
+    uint16_t value[ADC_SEQUENCE_MAX_LENGTH];
+    uint8_t counter;
+} ADC_SAMPLE_BLOCK_T;
+
+void Adc__Initialize(void);
+void Adc__Configure(const ADC_CONFIG_T *config);
+void Adc__Start(void);
+void Adc__Stop(void);
+uint8_t Adc__GetBlockCounter(void);
+void Adc__ReadBlock(ADC_SAMPLE_BLOCK_T *block);
 
 #endif /* ADC_H_ */
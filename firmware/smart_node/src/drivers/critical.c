@@ -0,0 +1,91 @@
+/**
+ * @file critical.c
+ *
+ * @brief Critical section profiler
+ *
+ * @details A CRITICAL_BLOCK reads the counter of the tick timer when it
+ *          disables the interrupts and again when it restores them. The
+ *          tick cannot be served meanwhile, so a pending compare match
+ *          means one wrap of the counter: sections up to about 2ms are
+ *          measured, with TIMER_US_PER_COUNT resolution. Only the outermost
+ *          block is measured, a block run with the interrupts already
+ *          disabled adds nothing to the time they stay masked.
+ *          Each site keeps the number of calls, the worst and the total
+ *          time. A section longer than CRITICAL_BUDGET_US is also recorded
+ *          in the trace, with its site, to find what it was overlapping.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <string.h>
+#include "micro.h"
+#include "timer.h"
+#include "trace.h"
+#include "critical.h"
+
+#define CRITICAL_BUDGET_COUNTS  (CRITICAL_BUDGET_US / TIMER_US_PER_COUNT)
+
+typedef struct {
+    uint16_t calls;
+    uint16_t max_counts;
+    uint32_t total_counts;
+} CRITICAL_STATS_T;
+
+static CRITICAL_STATS_T Stats[CRITICAL_SITES_NUMBER];
+
+void Critical__Initialize(void)
+{
+    memset(Stats, 0, sizeof(Stats));
+}
+
+#ifndef CRITICAL_PROFILING_DISABLED
+
+void Critical__Exit(const CRITICAL_T *section)
+{
+    CRITICAL_STATS_T *stats;
+    uint16_t counts;
+
+    if (section->sreg & (1 << SREG_I))
+    {
+        counts = Critical__Now() - section->start;
+        stats = &Stats[section->site];
+        if (stats->calls != UINT16_MAX)
+        {
+            stats->calls++;
+        }
+        stats->total_counts += counts;
+        if (counts > stats->max_counts)
+        {
+            stats->max_counts = counts;
+        }
+        if (counts > CRITICAL_BUDGET_COUNTS)
+        {
+            Trace__Append(TRACE_SOURCE_CRITICAL, TRACE_EVENT_ERROR, section->site);
+        }
+    }
+    SREG = section->sreg;
+}
+
+#endif
+
+void Critical__GetReport(CRITICAL_SITE_T site, CRITICAL_REPORT_T *report)
+{
+    CRITICAL_STATS_T stats;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        stats = Stats[site];
+    }
+    report->calls = stats.calls;
+    report->max_us = stats.max_counts * TIMER_US_PER_COUNT;
+    report->total_us = stats.total_counts * TIMER_US_PER_COUNT;
+}
+
+void Critical__ClearReport(CRITICAL_SITE_T site)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        memset(&Stats[site], 0, sizeof(Stats[site]));
+    }
+}
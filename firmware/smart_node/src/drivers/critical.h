@@ -0,0 +1,103 @@
+/**
+ * @file critical.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef CRITICAL_H_
+#define CRITICAL_H_
+
+#include "micro.h"
+#include "timer.h"
+
+#ifndef CRITICAL_BUDGET_US
+    #define CRITICAL_BUDGET_US  250 // longest interrupts-off time allowed
+#endif
+
+/**
+ * Profiled critical sections. Several blocks of a module may share a site.
+ */
+typedef enum {
+    CRITICAL_SITE_ONEWIRE_WRITE_BIT = 0,
+    CRITICAL_SITE_ONEWIRE_READ_BIT,
+    CRITICAL_SITE_INT_EEPROM,
+    CRITICAL_SITE_EXT_EEPROM,
+    CRITICAL_SITE_TWI,
+    CRITICAL_SITE_ADC,
+    CRITICAL_SITE_RELAYS,
+    CRITICAL_SITE_METERING,
+    CRITICAL_SITE_LOGGER,
+    CRITICAL_SITE_PARAMETERS,
+    CRITICAL_SITES_NUMBER
+} CRITICAL_SITE_T;
+
+typedef struct {
+    uint16_t calls;     // saturates
+    uint16_t max_us;
+    uint32_t total_us;  // wraps after 71 minutes
+} CRITICAL_REPORT_T;
+
+#ifdef CRITICAL_PROFILING_DISABLED
+
+#define CRITICAL_BLOCK(site) ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+
+#else
+
+typedef struct {
+    uint8_t sreg;
+    uint8_t site;
+    uint8_t todo;
+    uint16_t start;     // timer counts
+} CRITICAL_T;
+
+/**
+ * Drop-in replacement of ATOMIC_BLOCK(ATOMIC_RESTORESTATE) that measures
+ * how long the interrupts stay disabled. Leaving the block in any way,
+ * break and return included, ends the measurement.
+ */
+#define CRITICAL_BLOCK(site) \
+    for (CRITICAL_T critical_section __attribute__((__cleanup__(Critical__Exit))) = \
+             Critical__Enter(site); \
+         critical_section.todo; critical_section.todo = 0)
+
+void Critical__Exit(const CRITICAL_T *section);
+
+/**
+ * Timer counts since the last tick served, interrupts disabled
+ */
+static inline uint16_t Critical__Now(void)
+{
+    uint16_t counts = TCNT0;
+
+    if (TIFR0 & (1 << OCF0A))
+    {
+        // The counter may have wrapped after the read
+        counts = TCNT0 + TIMER_COMPARE_VALUE;
+    }
+    return counts;
+}
+
+/**
+ * Inline as the ATOMIC_BLOCK setup, so the compiler sees the body of a
+ * CRITICAL_BLOCK always run once
+ */
+static inline CRITICAL_T Critical__Enter(CRITICAL_SITE_T site)
+{
+    CRITICAL_T section;
+
+    section.sreg = SREG;
+    cli();
+    section.site = site;
+    section.todo = 1;
+    section.start = Critical__Now();
+    return section;
+}
+
+#endif
+
+void Critical__Initialize(void);
+void Critical__GetReport(CRITICAL_SITE_T site, CRITICAL_REPORT_T *report);
+void Critical__ClearReport(CRITICAL_SITE_T site);
+
+#endif /* CRITICAL_H_ */
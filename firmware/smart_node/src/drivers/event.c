@@ -0,0 +1,161 @@
+/**
+ * @file event.c
+ *
+ * @brief Events between the interrupts and the main loop
+ *
+ * @details A queue has one producer and one consumer, each moving its own
+ *          index only: a record is written before the head moves past it
+ *          and read before the tail does, and a one byte index is read and
+ *          written atomically, so neither side ever takes a lock or masks
+ *          the interrupts. A producer may interrupt its consumer and the
+ *          other way round, but two producers on a queue need two queues.
+ *          A full queue drops the new event and traces the loss.
+ *          The bus takes the events of the timer ISR to the main loop, in
+ *          one queue for the 1ms tasks and one for the 100ms tasks, since
+ *          a tick may interrupt the 100ms tasks of the previous one:
+ *          Event__FastTask hands each event to the handlers subscribed to
+ *          its type, in the order they subscribed.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <stddef.h>
+#include "trace.h"
+#include "event.h"
+
+#define EVENT_QUEUE_MASK    (EVENT_QUEUE_SIZE - 1)
+
+// The record must be complete before the index moves, and read before
+#define EVENT_BARRIER()     __asm__ __volatile__ ("" ::: "memory")
+
+typedef struct {
+    EVENT_HANDLER_T handler;
+    uint8_t type;
+} EVENT_SUBSCRIBER_T;
+
+static EVENT_QUEUE_T Bus[EVENT_BUS_NUMBER];
+static EVENT_SUBSCRIBER_T Subscribers[EVENT_SUBSCRIBERS];
+static uint8_t Subscribers_Number;
+
+/**
+ * @brief   Empty the bus and drop the subscriptions
+ *
+ * @details Before the modules subscribe
+ */
+void Event__Initialize(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < EVENT_BUS_NUMBER; i++)
+    {
+        Event__InitQueue(&Bus[i]);
+    }
+    Subscribers_Number = 0;
+}
+
+void Event__InitQueue(EVENT_QUEUE_T *queue)
+{
+    queue->head = 0;
+    queue->tail = 0;
+}
+
+/**
+ * @brief   Queue an event, producer side
+ *
+ * @return  FALSE if the queue is full, the event is lost
+ */
+BOOL_T Event__Post(EVENT_QUEUE_T *queue, EVENT_ID_T type, uint8_t arg, int16_t value)
+{
+    uint8_t head = queue->head;
+    uint8_t next = (head + 1) & EVENT_QUEUE_MASK;
+    EVENT_RECORD_T *record;
+
+    if (next == queue->tail)
+    {
+        Trace__Append(TRACE_SOURCE_EVENT, TRACE_EVENT_ERROR, type);
+        return FALSE;
+    }
+    record = &queue->records[head];
+    record->type = type;
+    record->arg = arg;
+    record->value = value;
+    EVENT_BARRIER();
+    queue->head = next;
+    return TRUE;
+}
+
+/**
+ * @brief   Take the oldest event, consumer side
+ *
+ * @return  FALSE if the queue is empty
+ */
+BOOL_T Event__Get(EVENT_QUEUE_T *queue, EVENT_RECORD_T *event)
+{
+    uint8_t tail = queue->tail;
+
+    if (tail == queue->head)
+    {
+        return FALSE;
+    }
+    EVENT_BARRIER();
+    *event = queue->records[tail];
+    EVENT_BARRIER();
+    queue->tail = (tail + 1) & EVENT_QUEUE_MASK;
+    return TRUE;
+}
+
+/**
+ * @brief   Have a handler called in the main loop for each event of a type
+ *
+ * @details At the initialization, before the interrupts are enabled
+ *
+ * @return  FALSE if there are EVENT_SUBSCRIBERS already
+ */
+BOOL_T Event__Subscribe(EVENT_ID_T type, EVENT_HANDLER_T handler)
+{
+    if (Subscribers_Number >= EVENT_SUBSCRIBERS)
+    {
+        return FALSE;
+    }
+    Subscribers[Subscribers_Number].handler = handler;
+    Subscribers[Subscribers_Number].type = type;
+    Subscribers_Number++;
+    return TRUE;
+}
+
+/**
+ * @brief   Send an event to the main loop
+ *
+ * @details From the tasks of the timer ISR, on the queue of their period
+ */
+BOOL_T Event__Publish(EVENT_BUS_T bus, EVENT_ID_T type, uint8_t arg, int16_t value)
+{
+    return Event__Post(&Bus[bus], type, arg, value);
+}
+
+/**
+ * @brief   Dispatch the events of the bus
+ *
+ * @details Call it from the main loop, the consumer of the bus
+ */
+void Event__FastTask(void)
+{
+    EVENT_RECORD_T event;
+    uint8_t bus;
+    uint8_t i;
+
+    for (bus = 0; bus < EVENT_BUS_NUMBER; bus++)
+    {
+        while (Event__Get(&Bus[bus], &event))
+        {
+            for (i = 0; i < Subscribers_Number; i++)
+            {
+                if (Subscribers[i].type == event.type)
+                {
+                    Subscribers[i].handler(&event);
+                }
+            }
+        }
+    }
+}
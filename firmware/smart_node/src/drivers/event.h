@@ -0,0 +1,67 @@
+/**
+ * @file event.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef EVENT_H_
+#define EVENT_H_
+
+#include "micro.h"
+
+#define EVENT_QUEUE_SIZE    4   // records, power of two
+#define EVENT_SUBSCRIBERS   4   // on the bus, all the types together
+
+typedef enum {
+    EVENT_TEMP_SENSOR_CONFIGURE = 0,    // request to the sensor
+    EVENT_TEMP_SENSOR_START,            // request to the sensor
+    EVENT_TEMPERATURE_READY,            // value: temperature, Q12.4
+    EVENT_TEMPERATURE_ERROR,            // arg: TEMP_SENSOR_ERROR_T
+    EVENT_SAMPLE_TAKEN,                 // arg: board sensor samples, wraps
+    EVENT_RADIO_TURN_ON,                // request to the radio
+    EVENT_RADIO_TURN_OFF,               // request to the radio
+    EVENT_RADIO_TRANSMIT,               // request to the radio
+    EVENT_RADIO_IRQ,                    // from the radio ISR
+} EVENT_ID_T;
+
+/**
+ * One record, 4 bytes
+ */
+typedef struct {
+    uint8_t type;   // EVENT_ID_T
+    uint8_t arg;
+    int16_t value;
+} EVENT_RECORD_T;
+
+/**
+ * Single producer, single consumer
+ */
+typedef struct {
+    EVENT_RECORD_T records[EVENT_QUEUE_SIZE];
+    volatile uint8_t head;  // written by the producer only
+    volatile uint8_t tail;  // written by the consumer only
+} EVENT_QUEUE_T;
+
+/**
+ * The producers of the bus, a queue each: the 1ms tasks interrupt the
+ * 100ms tasks, which run in the same nested timer ISR
+ */
+typedef enum {
+    EVENT_BUS_1MS = 0,
+    EVENT_BUS_100MS,
+    EVENT_BUS_NUMBER,
+} EVENT_BUS_T;
+
+typedef void (*EVENT_HANDLER_T)(const EVENT_RECORD_T *event);
+
+void Event__Initialize(void);
+void Event__InitQueue(EVENT_QUEUE_T *queue);
+BOOL_T Event__Post(EVENT_QUEUE_T *queue, EVENT_ID_T type, uint8_t arg, int16_t value);
+BOOL_T Event__Get(EVENT_QUEUE_T *queue, EVENT_RECORD_T *event);
+#define Event__IsEmpty(queue) ((queue)->head == (queue)->tail)
+BOOL_T Event__Subscribe(EVENT_ID_T type, EVENT_HANDLER_T handler);
+BOOL_T Event__Publish(EVENT_BUS_T bus, EVENT_ID_T type, uint8_t arg, int16_t value);
+void Event__FastTask(void);
+
+#endif /* EVENT_H_ */
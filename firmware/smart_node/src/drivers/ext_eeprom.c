@@ -0,0 +1,340 @@
+/**
+ * @file ext_eeprom.c
+ *
+ * @brief Driver of the 24FC1025 external EEPROM
+ *
+ * @details Requests are queued and served one after the other by the 1ms
+ *          task over the TWI driver. Writes are split on the 128 bytes page
+ *          boundaries, reads on the 64 KiB block boundary, so callers can
+ *          use any address and length. The end of each write cycle is
+ *          detected with ACK polling, once per millisecond, instead of
+ *          waiting for the worst case 5ms.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "critical.h"
+#include "twi.h"
+#include "trace.h"
+#include "ext_eeprom.h"
+
+// User parameters
+#define EXT_EEPROM_CHIP_ADDRESS     0x00 // A1 A0 pins
+#define EXT_EEPROM_QUEUE_SIZE       4    // must be a power of 2
+#define EXT_EEPROM_WRITE_TIMEOUT_MS 10   // twice the datasheet write cycle
+#define EXT_EEPROM_MAX_RETRIES      3
+
+#define EXT_EEPROM_QUEUE_MASK       (EXT_EEPROM_QUEUE_SIZE - 1)
+
+// Control byte: 1 0 1 0 B0 A1 A0
+#define EXT_EEPROM_SLAVE_ADDRESS(address) \
+    (0x50 | ((uint8_t)((address) >> 14) & 0x04) | EXT_EEPROM_CHIP_ADDRESS)
+
+typedef enum {
+    STATE_IDLE = 0,
+    STATE_TRANSFER,
+    STATE_WRITE_CYCLE,
+    STATE_POLLING,
+} EXT_EEPROM_STATE_T;
+
+typedef struct {
+    uint32_t address;
+    uint8_t *data;
+    uint16_t length;
+    uint8_t write;
+    EXT_EEPROM_CALLBACK_T callback;
+} EXT_EEPROM_REQUEST_T;
+
+typedef union {
+    struct {
+        uint8_t transfer_done :1;
+        uint8_t transfer_ok :1;
+        uint8_t transfer_nack :1;
+    };
+    uint8_t all;
+} EXT_EEPROM_EVENTS_T;
+
+static BOOL_T Enqueue(uint32_t address, uint8_t *data, uint16_t length,
+                      uint8_t write, EXT_EEPROM_CALLBACK_T callback);
+static void StartChunk(void);
+static void StartPolling(void);
+static void Complete(EXT_EEPROM_RESULT_T result);
+static void OnTransferDone(TWI_RESULT_T result);
+
+static EXT_EEPROM_REQUEST_T Queue[EXT_EEPROM_QUEUE_SIZE];
+static volatile uint8_t Queue_Head;
+static volatile uint8_t Queue_Tail;
+
+static EXT_EEPROM_STATE_T ExtEeprom_State;
+static volatile EXT_EEPROM_EVENTS_T ExtEeprom_Events;
+static EXT_EEPROM_REQUEST_T Current;     // remaining part of the request in progress
+static uint16_t Chunk_Length;
+static uint8_t Address_Header[2];
+static uint8_t Timeout_Counter_Ms;
+static uint8_t Retries;
+
+void ExtEeprom__Initialize(void)
+{
+    Twi__Initialize();
+
+    Queue_Head = 0;
+    Queue_Tail = 0;
+    ExtEeprom_State = STATE_IDLE;
+    ExtEeprom_Events.all = 0;
+}
+
+/**
+ * @brief   Queue a read
+ *
+ * @details The buffer must stay valid until the callback is called
+ *
+ * @return  FALSE if the queue is full
+ */
+BOOL_T ExtEeprom__Read(uint32_t address, uint8_t *data, uint16_t length,
+                       EXT_EEPROM_CALLBACK_T callback)
+{
+    return Enqueue(address, data, length, 0, callback);
+}
+
+/**
+ * @brief   Queue a write
+ *
+ * @details The buffer must stay valid until the callback is called.
+ *          Writes aligned to EXT_EEPROM_PAGE_SIZE cost one write cycle
+ *          per page.
+ *
+ * @return  FALSE if the queue is full
+ */
+BOOL_T ExtEeprom__Write(uint32_t address, const uint8_t *data, uint16_t length,
+                        EXT_EEPROM_CALLBACK_T callback)
+{
+    return Enqueue(address, (uint8_t *)data, length, 1, callback);
+}
+
+BOOL_T ExtEeprom__IsIdle(void)
+{
+    BOOL_T result = FALSE;
+
+    if (ExtEeprom_State == STATE_IDLE && Queue_Head == Queue_Tail)
+    {
+        result = TRUE;
+    }
+    return result;
+}
+
+void ExtEeprom__1msTask(void)
+{
+    EXT_EEPROM_STATE_T next_state;
+    EXT_EEPROM_EVENTS_T events;
+
+    next_state = ExtEeprom_State;
+
+    CRITICAL_BLOCK(CRITICAL_SITE_EXT_EEPROM)
+    {
+        events.all = ExtEeprom_Events.all;
+        ExtEeprom_Events.all = 0;
+    }
+
+    switch (ExtEeprom_State)
+    {
+        case STATE_IDLE:
+        {
+            if (Queue_Head != Queue_Tail)
+            {
+                Current = Queue[Queue_Tail];
+                Queue_Tail = (Queue_Tail + 1) & EXT_EEPROM_QUEUE_MASK;
+                Retries = 0;
+                StartChunk();
+                next_state = STATE_TRANSFER;
+            }
+            break;
+        }
+        case STATE_TRANSFER:
+        {
+            if (events.transfer_done)
+            {
+                if (events.transfer_ok)
+                {
+                    Current.address += Chunk_Length;
+                    Current.data += Chunk_Length;
+                    Current.length -= Chunk_Length;
+                    Retries = 0;
+
+                    if (Current.write)
+                    {
+                        Timeout_Counter_Ms = EXT_EEPROM_WRITE_TIMEOUT_MS;
+                        next_state = STATE_WRITE_CYCLE;
+                    }
+                    else if (Current.length != 0)
+                    {
+                        StartChunk();
+                    }
+                    else
+                    {
+                        Complete(EXT_EEPROM_RESULT_OK);
+                        next_state = STATE_IDLE;
+                    }
+                }
+                else if (Retries < EXT_EEPROM_MAX_RETRIES)
+                {
+                    // Still busy with a write cycle started by someone else
+                    Retries++;
+                    StartChunk();
+                }
+                else
+                {
+                    Complete(EXT_EEPROM_RESULT_ERROR);
+                    next_state = STATE_IDLE;
+                }
+            }
+            break;
+        }
+        case STATE_WRITE_CYCLE:
+        {
+            // The device does not answer until the write cycle is over
+            StartPolling();
+            next_state = STATE_POLLING;
+            break;
+        }
+        case STATE_POLLING:
+        {
+            if (events.transfer_done)
+            {
+                Timeout_Counter_Ms--;
+                if (events.transfer_ok)
+                {
+                    if (Current.length != 0)
+                    {
+                        StartChunk();
+                        next_state = STATE_TRANSFER;
+                    }
+                    else
+                    {
+                        Complete(EXT_EEPROM_RESULT_OK);
+                        next_state = STATE_IDLE;
+                    }
+                }
+                else if (events.transfer_nack && Timeout_Counter_Ms != 0)
+                {
+                    StartPolling();
+                }
+                else
+                {
+                    Complete(EXT_EEPROM_RESULT_ERROR);
+                    next_state = STATE_IDLE;
+                }
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    if (next_state != ExtEeprom_State)
+    {
+        Trace__Append(TRACE_SOURCE_EXT_EEPROM, TRACE_EVENT_STATE, next_state);
+    }
+    ExtEeprom_State = next_state;
+}
+
+static BOOL_T Enqueue(uint32_t address, uint8_t *data, uint16_t length,
+                      uint8_t write, EXT_EEPROM_CALLBACK_T callback)
+{
+    BOOL_T result = FALSE;
+    uint8_t next_head;
+
+    if (length == 0 || address + length > EXT_EEPROM_SIZE)
+    {
+        return FALSE;
+    }
+
+    CRITICAL_BLOCK(CRITICAL_SITE_EXT_EEPROM)
+    {
+        next_head = (Queue_Head + 1) & EXT_EEPROM_QUEUE_MASK;
+        if (next_head != Queue_Tail)
+        {
+            Queue[Queue_Head].address = address;
+            Queue[Queue_Head].data = data;
+            Queue[Queue_Head].length = length;
+            Queue[Queue_Head].write = write;
+            Queue[Queue_Head].callback = callback;
+            Queue_Head = next_head;
+            result = TRUE;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief   Start the transfer of the next part of the current request
+ *
+ * @details Writes stop at the page boundary, reads at the block boundary
+ */
+static void StartChunk(void)
+{
+    TWI_TRANSFER_T transfer;
+    uint32_t room;
+
+    if (Current.write)
+    {
+        room = EXT_EEPROM_PAGE_SIZE - ((uint8_t)Current.address & (EXT_EEPROM_PAGE_SIZE - 1));
+    }
+    else
+    {
+        room = EXT_EEPROM_BLOCK_SIZE - (uint16_t)Current.address;
+    }
+    Chunk_Length = (Current.length < room) ? Current.length : (uint16_t)room;
+
+    Address_Header[0] = (uint8_t)(Current.address >> 8);
+    Address_Header[1] = (uint8_t)Current.address;
+
+    transfer.address = EXT_EEPROM_SLAVE_ADDRESS(Current.address);
+    transfer.header = Address_Header;
+    transfer.header_length = sizeof(Address_Header);
+    transfer.data = Current.data;
+    transfer.length = Chunk_Length;
+    transfer.read = !Current.write;
+    transfer.callback = OnTransferDone;
+    Twi__Start(&transfer);
+}
+
+static void StartPolling(void)
+{
+    TWI_TRANSFER_T transfer;
+
+    transfer.address = EXT_EEPROM_SLAVE_ADDRESS(Current.address);
+    transfer.header = NULL;
+    transfer.header_length = 0;
+    transfer.data = NULL;
+    transfer.length = 0;
+    transfer.read = 0;
+    transfer.callback = OnTransferDone;
+    Twi__Start(&transfer);
+}
+
+static void Complete(EXT_EEPROM_RESULT_T result)
+{
+    if (result != EXT_EEPROM_RESULT_OK)
+    {
+        Trace__Append(TRACE_SOURCE_EXT_EEPROM, TRACE_EVENT_ERROR, result);
+    }
+    if (Current.callback != NULL)
+    {
+        Current.callback(result);
+    }
+}
+
+/**
+ * TWI callback, runs in the TWI ISR
+ */
+static void OnTransferDone(TWI_RESULT_T result)
+{
+    ExtEeprom_Events.transfer_ok = (result == TWI_RESULT_OK);
+    ExtEeprom_Events.transfer_nack = (result == TWI_RESULT_NACK);
+    ExtEeprom_Events.transfer_done = 1;
+}
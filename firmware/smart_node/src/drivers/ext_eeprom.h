@@ -0,0 +1,36 @@
+/**
+ * @file ext_eeprom.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef EXT_EEPROM_H_
+#define EXT_EEPROM_H_
+
+#include "micro.h"
+
+// 24FC1025
+#define EXT_EEPROM_SIZE         131072UL
+#define EXT_EEPROM_BLOCK_SIZE   65536UL
+#define EXT_EEPROM_PAGE_SIZE    128
+
+typedef enum {
+    EXT_EEPROM_RESULT_OK = 0,
+    EXT_EEPROM_RESULT_ERROR,
+} EXT_EEPROM_RESULT_T;
+
+/**
+ * Called from the 1ms task when a request is completed
+ */
+typedef void (*EXT_EEPROM_CALLBACK_T)(EXT_EEPROM_RESULT_T result);
+
+void ExtEeprom__Initialize(void);
+BOOL_T ExtEeprom__Read(uint32_t address, uint8_t *data, uint16_t length,
+                       EXT_EEPROM_CALLBACK_T callback);
+BOOL_T ExtEeprom__Write(uint32_t address, const uint8_t *data, uint16_t length,
+                        EXT_EEPROM_CALLBACK_T callback);
+BOOL_T ExtEeprom__IsIdle(void);
+void ExtEeprom__1msTask(void);
+
+#endif /* EXT_EEPROM_H_ */
@@ -0,0 +1,135 @@
+/**
+ * @file fsm.c
+ *
+ * @brief Table driven state machines
+ *
+ * @details A machine is a table of states in program memory, each with its
+ *          rows of transitions: event, guard, action, next state. A
+ *          dispatch goes straight to the rows of the current state and
+ *          takes the first one with the event and a true guard, or none,
+ *          so its cost is bound by the rows of a state, not by the size of
+ *          the machine. The guards run in order, so a guard may consume
+ *          the input it tests (e.g. an event flag cleared once read) and
+ *          a later row without guard is its else branch.
+ *          The state changes go in the trace, as TRACE_EVENT_STATE records
+ *          of the source of the machine, and the time spent in each state
+ *          is summed in microseconds, both only if the machine asks for
+ *          it: a machine run in a short ISR, as the 1-Wire bit timing,
+ *          pays neither.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <stddef.h>
+#include "timer.h"
+#include "trace.h"
+#include "fsm.h"
+
+static FSM_T *Machines[FSM_NUMBER];
+
+/**
+ * @param   states      FSM_STATE_T in program memory, indexed by state
+ * @param   trace       TRACE_SOURCE_T of the state records, FSM_NO_TRACE for none
+ * @param   time_us     one counter per state, NULL for no accounting
+ */
+void Fsm__Initialize(FSM_ID_T id, FSM_T *fsm, const FSM_STATE_T *states, uint8_t states_number,
+                     uint8_t initial, uint8_t trace, uint32_t *time_us)
+{
+    fsm->states = states;
+    fsm->states_number = states_number;
+    fsm->time_us = time_us;
+    fsm->entered_us = (time_us != NULL) ? Timer__GetUs() : 0;
+    fsm->state = initial;
+    fsm->trace = trace;
+    Machines[id] = fsm;
+}
+
+/**
+ * @brief   Take the first row of the current state for the event whose
+ *          guard holds: run its action, then move to its next state
+ *
+ * @details The action may itself move the machine, the next state of the
+ *          row is applied after it.
+ *
+ * @return  FALSE if no row took the event
+ */
+BOOL_T Fsm__Dispatch(FSM_T *fsm, uint8_t event)
+{
+    FSM_STATE_T state;
+    FSM_TRANSITION_T row;
+    uint8_t i;
+
+    memcpy_P(&state, &fsm->states[fsm->state], sizeof(state));
+    for (i = 0; i < state.count; i++)
+    {
+        memcpy_P(&row, &state.rows[i], sizeof(row));
+        if (row.event == event && (row.guard == NULL || row.guard()))
+        {
+            if (row.action != NULL)
+            {
+                row.action();
+            }
+            Fsm__SetState(fsm, row.next);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @brief   Move the machine, outside of the table too (e.g. on a timeout)
+ */
+void Fsm__SetState(FSM_T *fsm, uint8_t state)
+{
+    uint32_t now;
+
+    if (state == fsm->state)
+    {
+        return;
+    }
+    if (fsm->time_us != NULL)
+    {
+        now = Timer__GetUs();
+        fsm->time_us[fsm->state] += now - fsm->entered_us;
+        fsm->entered_us = now;
+    }
+    if (fsm->trace != FSM_NO_TRACE)
+    {
+        Trace__Append(fsm->trace, TRACE_EVENT_STATE, state);
+    }
+    fsm->state = state;
+}
+
+/**
+ * @brief   Time spent in a state of a machine, the current stay included
+ *
+ * @details Main loop only. Wraps after 71 minutes, 0 without accounting.
+ *
+ * @param   current     the current state, written
+ *
+ * @return  FALSE for an unknown machine or state
+ */
+BOOL_T Fsm__GetTimeUs(uint8_t id, uint8_t state, uint8_t *current, uint32_t *time_us)
+{
+    const FSM_T *fsm = (id < FSM_NUMBER) ? Machines[id] : NULL;
+
+    if (fsm == NULL || state >= fsm->states_number)
+    {
+        return FALSE;
+    }
+    *time_us = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        *current = fsm->state;
+        if (fsm->time_us != NULL)
+        {
+            *time_us = fsm->time_us[state];
+            if (state == fsm->state)
+            {
+                *time_us += Timer__GetUs() - fsm->entered_us;
+            }
+        }
+    }
+    return TRUE;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file fsm.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef FSM_H_
+#define FSM_H_
+
+#include <avr/pgmspace.h>
+#include "micro.h"
+
+#define FSM_NO_TRACE        0xFF    // trace source of a machine without state records
+
+typedef BOOL_T (*FSM_GUARD_T)(void);
+typedef void (*FSM_ACTION_T)(void);
+
+/**
+ * One row of a transition table, in program memory. The state is the one
+ * of the FSM_STATE_T holding the row.
+ */
+typedef struct {
+    uint8_t event;
+    FSM_GUARD_T guard;      // NULL: always
+    FSM_ACTION_T action;    // NULL: none
+    uint8_t next;
+} FSM_TRANSITION_T;
+
+/**
+ * The rows of a state, indexed by the state in the table of the machine
+ */
+typedef struct {
+    const FSM_TRANSITION_T *rows;
+    uint8_t count;
+} FSM_STATE_T;
+
+#define FSM_STATE(rows)     {(rows), sizeof(rows) / sizeof((rows)[0])}
+#define FSM_NO_ROWS         {NULL, 0}
+
+typedef enum {
+    FSM_TEMP_SENSOR = 0,
+    FSM_THERMOSTAT,
+    FSM_ONEWIRE,
+    FSM_RADIO,
+    FSM_NUMBER,
+} FSM_ID_T;
+
+typedef struct {
+    const FSM_STATE_T *states;  // program memory
+    uint32_t *time_us;          // per state, NULL for no accounting
+    uint32_t entered_us;
+    uint8_t states_number;
+    volatile uint8_t state;     // may move in an ISR
+    uint8_t trace;              // TRACE_SOURCE_T, or FSM_NO_TRACE
+} FSM_T;
+
+void Fsm__Initialize(FSM_ID_T id, FSM_T *fsm, const FSM_STATE_T *states, uint8_t states_number,
+                     uint8_t initial, uint8_t trace, uint32_t *time_us);
+BOOL_T Fsm__Dispatch(FSM_T *fsm, uint8_t event);
+void Fsm__SetState(FSM_T *fsm, uint8_t state);
+#define Fsm__GetState(fsm)  ((fsm)->state)
+BOOL_T Fsm__GetTimeUs(uint8_t id, uint8_t state, uint8_t *current, uint32_t *time_us);
+
+#endif /* FSM_H_ */
@@ -0,0 +1,122 @@
+/**
+ * @file int_eeprom.c
+ *
+ * @brief Non-blocking writer for the internal EEPROM
+ *
+ * @details Each byte takes 3.3ms to be programmed. Instead of waiting for
+ *          it, the bytes are written one by one from the EEPROM ready ISR.
+ *          Bytes already holding the right value are skipped, saving both
+ *          time and wear.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "critical.h"
+#include "int_eeprom.h"
+
+static const uint8_t *Write_Data;
+static uint16_t Write_Address;
+static uint8_t Write_Length;
+static uint8_t Write_Idx;
+static volatile BOOL_T Busy;
+
+void IntEeprom__Initialize(void)
+{
+    EECR &= ~(1 << EERIE);
+    Busy = FALSE;
+}
+
+/**
+ * @brief   Read a block
+ *
+ * @details Reading takes a few cycles per byte, and can be interleaved with
+ *          a write in progress: each byte waits only for the programming of
+ *          the current byte, with interrupts enabled
+ */
+void IntEeprom__Read(uint16_t address, uint8_t *data, uint8_t length)
+{
+    uint8_t i;
+    BOOL_T done;
+
+    for (i = 0; i < length; i++)
+    {
+        done = FALSE;
+        while (done == FALSE)
+        {
+            CRITICAL_BLOCK(CRITICAL_SITE_INT_EEPROM)
+            {
+                if ((EECR & (1 << EEPE)) == 0)
+                {
+                    EEAR = address + i;
+                    Micro__Write(EECR, EECR | (1 << EERE));
+                    data[i] = EEDR;
+                    done = TRUE;
+                }
+            }
+            Micro__BusyWait();
+        }
+    }
+}
+
+/**
+ * @brief   Start writing a block
+ *
+ * @details The data must stay valid until IntEeprom__IsIdle returns TRUE
+ *
+ * @return  FALSE if a write is in progress
+ */
+BOOL_T IntEeprom__Write(uint16_t address, const uint8_t *data, uint8_t length)
+{
+    BOOL_T result = FALSE;
+
+    CRITICAL_BLOCK(CRITICAL_SITE_INT_EEPROM)
+    {
+        if (Busy == FALSE && length != 0)
+        {
+            Write_Data = data;
+            Write_Address = address;
+            Write_Length = length;
+            Write_Idx = 0;
+            Busy = TRUE;
+            EECR |= (1 << EERIE);
+            result = TRUE;
+        }
+    }
+
+    return result;
+}
+
+BOOL_T IntEeprom__IsIdle(void)
+{
+    return (Busy == FALSE) ? TRUE : FALSE;
+}
+
+/**
+ * EEPROM ready ISR
+ *
+ */
+ISR(EE_READY_vect)
+{
+    uint8_t data;
+
+    while (Write_Idx < Write_Length)
+    {
+        data = Write_Data[Write_Idx];
+        EEAR = Write_Address + Write_Idx;
+        Write_Idx++;
+
+        Micro__Write(EECR, EECR | (1 << EERE));
+        if (EEDR != data)
+        {
+            EEDR = data;
+            EECR |= (1 << EEMPE);
+            Micro__Write(EECR, EECR | (1 << EEPE));
+            return;
+        }
+    }
+
+    EECR &= ~(1 << EERIE);
+    Busy = FALSE;
+}
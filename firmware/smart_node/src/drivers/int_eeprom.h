@@ -0,0 +1,28 @@
+/**
+ * @file int_eeprom.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef INT_EEPROM_H_
+#define INT_EEPROM_H_
+
+#include "micro.h"
+
+#define INT_EEPROM_SIZE (E2END + 1)
+
+// Internal EEPROM map
+#define INT_EEPROM_PARAMETERS_BASE  0x000
+#define INT_EEPROM_PARAMETERS_SIZE  0x200
+#define INT_EEPROM_SCHEDULE_BASE    0x200
+#define INT_EEPROM_SCHEDULE_SIZE    0x40
+#define INT_EEPROM_OPTIMAL_START_BASE 0x240
+#define INT_EEPROM_OPTIMAL_START_SIZE 0x10
+
+void IntEeprom__Initialize(void);
+void IntEeprom__Read(uint16_t address, uint8_t *data, uint8_t length);
+BOOL_T IntEeprom__Write(uint16_t address, const uint8_t *data, uint8_t length);
+BOOL_T IntEeprom__IsIdle(void);
+
+#endif /* INT_EEPROM_H_ */
@@ -0,0 +1,123 @@
+/**
+ * @file memory.c
+ *
+ * @brief Stack high-water mark and RAM budget
+ *
+ * @details The firmware allocates nothing at run time: the RAM above the
+ *          static data (.data, .bss, then .noinit) up to RAMEND belongs to
+ *          the stack, which grows down from RAMEND. Before main, the whole
+ *          free region is painted with MEMORY_PAINT. Every MEMORY_CHECK_MS
+ *          the main loop counts the painted bytes left from the bottom: the
+ *          first byte overwritten is the deepest point the stack, nested
+ *          ISRs included, has ever reached.
+ *          When the bytes left fall below the alarm threshold a memory
+ *          fault is raised, once, in the trace, which freezes and dumps it.
+ *          The per module static usage is not known on target, see
+ *          tools/ram_report.py for the table built from the linker map.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "timer.h"
+#include "trace.h"
+#include "memory.h"
+
+#define MEMORY_PAINT    0xC5
+
+static void Paint(void) MICRO_BOOT_HOOK;
+static void OnCheck(void *context);
+
+static TIMER_T Check_Timer;
+static volatile BOOL_T Check_Pending;
+static uint16_t Boot_Free;
+static uint16_t Lowest_Free;
+static uint16_t Alarm_Bytes;
+static BOOL_T Alarm_Raised;
+
+void Memory__Initialize(void)
+{
+    Boot_Free = (uint16_t)(MICRO_RAM_END - MICRO_STATIC_END) + 1;
+    Lowest_Free = Boot_Free;
+    Alarm_Bytes = MEMORY_LOW_WATER_BYTES;
+    Alarm_Raised = FALSE;
+    Check_Pending = TRUE;
+
+    Timer__Init(&Check_Timer, OnCheck, NULL);
+    Timer__Arm(&Check_Timer, MEMORY_CHECK_MS, MEMORY_CHECK_MS);
+}
+
+/**
+ * @brief   Free bytes below the deepest stack that raise the memory fault
+ *
+ * @details A new threshold is checked again, even if the fault was raised
+ */
+void Memory__SetAlarm(uint16_t low_water_bytes)
+{
+    Alarm_Bytes = low_water_bytes;
+    Alarm_Raised = FALSE;
+    Check_Pending = TRUE;
+}
+
+void Memory__GetReport(MEMORY_REPORT_T *report)
+{
+    report->static_bytes = (uint16_t)(MICRO_STATIC_END - MICRO_STATIC_START);
+    report->boot_free = Boot_Free;
+    report->lowest_free = Lowest_Free;
+    report->stack_bytes = (uint16_t)(MICRO_RAM_END - Micro__GetStackPointer());
+}
+
+/**
+ * @brief   Measure the high-water mark, when due
+ *
+ * @details Call it from the main loop, the scan takes a few hundred
+ *          microseconds
+ */
+void Memory__FastTask(void)
+{
+    const volatile uint8_t *p = MICRO_STATIC_END;
+    uint16_t left = 0;
+
+    if (Check_Pending == FALSE)
+    {
+        return;
+    }
+    Check_Pending = FALSE;
+
+    // The mark only goes down, no need to look further than the last one
+    while (left < Lowest_Free && *p == MEMORY_PAINT)
+    {
+        p++;
+        left++;
+    }
+    Lowest_Free = left;
+
+    if (Lowest_Free < Alarm_Bytes && Alarm_Raised == FALSE)
+    {
+        Alarm_Raised = TRUE;
+        Trace__Fault(TRACE_SOURCE_MEMORY, (Lowest_Free > 0xFF) ? 0xFF : (uint8_t)Lowest_Free);
+    }
+}
+
+/**
+ * @brief   Paint the free RAM, before the static data is initialized
+ *
+ * @details Runs before main, in .init3 on the AVR: the stack pointer is set
+ *          and holds nothing yet
+ */
+static void Paint(void)
+{
+    uint8_t *p = MICRO_STATIC_END;
+
+    while (p <= Micro__GetStackPointer())
+    {
+        *p++ = MEMORY_PAINT;
+    }
+}
+
+static void OnCheck(void *context)
+{
+    (void)context;
+    Check_Pending = TRUE;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file memory.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include "micro.h"
+
+#ifndef MEMORY_LOW_WATER_BYTES
+    #define MEMORY_LOW_WATER_BYTES  128 // free bytes left below the deepest stack
+#endif
+
+#define MEMORY_CHECK_MS     1000
+
+typedef struct {
+    uint16_t static_bytes;  // .data, .bss and .noinit
+    uint16_t boot_free;     // between the static data and the stack at boot
+    uint16_t lowest_free;   // never touched by the stack so far
+    uint16_t stack_bytes;   // in use right now
+} MEMORY_REPORT_T;
+
+void Memory__Initialize(void);
+void Memory__SetAlarm(uint16_t low_water_bytes);
+void Memory__GetReport(MEMORY_REPORT_T *report);
+void Memory__FastTask(void);
+
+#endif /* MEMORY_H_ */
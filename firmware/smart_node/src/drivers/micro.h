@@ -30,4 +30,43 @@ void Micro__Initialize(void);
 #define Micro__GetClockFrequency() F_CPU
 #define Micro__EnableInterrupts() sei()
 
+/*
+ * Hardware abstraction. On the AVR these are the plain register accesses,
+ * on the host (MICRO_HOST, see host/host.h) they drive the models.
+ */
+#ifdef MICRO_HOST
+
+// Write of a register whose write has a side effect: strobe, flag clear, data
+#define Micro__Write(reg, value) Host__Write(&(reg), (value))
+// One poll of a register in a busy loop
+#define Micro__BusyWait() Host__BusyWait()
+// End of a pass of the main loop
+#define Micro__Idle() Host__Idle()
+
+// RAM layout, not modelled: a stack that is never used
+#define MICRO_STATIC_START (&Host__Ram[0])
+#define MICRO_STATIC_END (&Host__Ram[0])
+#define MICRO_RAM_END (&Host__Ram[HOST_RAM_SIZE - 1])
+#define Micro__GetStackPointer() MICRO_RAM_END
+#define MICRO_BOOT_HOOK __attribute__((constructor, used))
+
+#else
+
+#define Micro__Write(reg, value) ((reg) = (value))
+#define Micro__BusyWait()
+#define Micro__Idle()
+
+// Linker symbols
+extern uint8_t __data_start;
+extern uint8_t __heap_start;   // end of the static data
+
+#define MICRO_STATIC_START (&__data_start)
+#define MICRO_STATIC_END (&__heap_start)
+#define MICRO_RAM_END ((uint8_t *)RAMEND)
+#define Micro__GetStackPointer() ((uint8_t *)SP)
+// Runs before the static data is initialized, the stack holds nothing yet
+#define MICRO_BOOT_HOOK __attribute__((naked, used, section(".init3")))
+
+#endif
+
 #endif /* SRC_DRIVERS_MICRO_H_ */
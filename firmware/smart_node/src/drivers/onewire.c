@@ -13,6 +13,9 @@
  */ 
 
 #include "micro.h"
+#include "critical.h"
+#include "trace.h"
+#include "fsm.h"
 #include "onewire.h"
 
 // Ticks for a delay of 1 microsecond timer clocked at 2 MHz
@@ -63,17 +66,66 @@ typedef enum {
 	ONEWIRE_WRITE1_RECOVERY,
 	ONEWIRE_WRITE0_RECOVERY,
 	ONEWIRE_READBIT_RECOVERY,
+	ONEWIRE_STATE_NUMBER,
 } ONEWIRE_STATE_T;
 
+typedef enum {
+	ONEWIRE_EVENT_TIMER = 0,	// compare match, the delay is over
+} ONEWIRE_EVENT_T;
+
 ONEWIRE_SAMPLE_T Last_Sample;
 uint8_t Byte_Read;
 
 uint16_t Debug_Counter = 0;
 
-static volatile ONEWIRE_STATE_T Onewire_State;
 static uint8_t Byte_To_Write;
 static uint8_t Last_Byte;
 static uint8_t Remaining_Bits;
+static BOOL_T Reading_Byte;    // not a single bit, such as a conversion poll
+
+static BOOL_T IsWritingOne(void);
+static BOOL_T IsBitLeft(void);
+static BOOL_T IsReadingByte(void);
+static void ReleaseForPresence(void);
+static void SamplePresence(void);
+static void EndPresence(void);
+static void WriteNextBit(void);
+static void ReadNextBit(void);
+static void EndRead(void);
+
+static const FSM_TRANSITION_T Presence_Drive_Low_Rows[] PROGMEM = {
+	{ONEWIRE_EVENT_TIMER, NULL, ReleaseForPresence, ONEWIRE_PRESENCE_SAMPLE},
+};
+static const FSM_TRANSITION_T Presence_Sample_Rows[] PROGMEM = {
+	{ONEWIRE_EVENT_TIMER, NULL, SamplePresence, ONEWIRE_PRESENCE_RECOVERY},
+};
+static const FSM_TRANSITION_T Presence_Recovery_Rows[] PROGMEM = {
+	{ONEWIRE_EVENT_TIMER, NULL, EndPresence, ONEWIRE_IDLE},
+};
+// Both the recoveries of a write go on with the next bit
+static const FSM_TRANSITION_T Write_Recovery_Rows[] PROGMEM = {
+	{ONEWIRE_EVENT_TIMER, IsWritingOne, WriteNextBit, ONEWIRE_WRITE1_RECOVERY},
+	{ONEWIRE_EVENT_TIMER, IsBitLeft, WriteNextBit, ONEWIRE_WRITE0_RECOVERY},
+	{ONEWIRE_EVENT_TIMER, NULL, NULL, ONEWIRE_IDLE},
+};
+static const FSM_TRANSITION_T Readbit_Recovery_Rows[] PROGMEM = {
+	{ONEWIRE_EVENT_TIMER, IsBitLeft, ReadNextBit, ONEWIRE_READBIT_RECOVERY},
+	{ONEWIRE_EVENT_TIMER, IsReadingByte, EndRead, ONEWIRE_IDLE},
+	{ONEWIRE_EVENT_TIMER, NULL, NULL, ONEWIRE_IDLE},
+};
+
+static const FSM_STATE_T Onewire_States[ONEWIRE_STATE_NUMBER] PROGMEM = {
+	[ONEWIRE_IDLE] = FSM_NO_ROWS,
+	[ONEWIRE_PRESENCE_SAMPLE] = FSM_STATE(Presence_Sample_Rows),
+	[ONEWIRE_PRESENCE_DRIVE_LOW] = FSM_STATE(Presence_Drive_Low_Rows),
+	[ONEWIRE_PRESENCE_RECOVERY] = FSM_STATE(Presence_Recovery_Rows),
+	[ONEWIRE_WRITE1_RECOVERY] = FSM_STATE(Write_Recovery_Rows),
+	[ONEWIRE_WRITE0_RECOVERY] = FSM_STATE(Write_Recovery_Rows),
+	[ONEWIRE_READBIT_RECOVERY] = FSM_STATE(Readbit_Recovery_Rows),
+};
+
+// Bit timing, in the ISR: no trace and no time accounting
+static FSM_T Onewire_Fsm;
 
 void Onewire__Initialize(void)
 {
@@ -89,10 +141,12 @@ void Onewire__Initialize(void)
 
     ONEWIRE_RELEASE_BUS();
 
-	Onewire_State = ONEWIRE_IDLE;
+	Fsm__Initialize(FSM_ONEWIRE, &Onewire_Fsm, Onewire_States, ONEWIRE_STATE_NUMBER, ONEWIRE_IDLE,
+					FSM_NO_TRACE, NULL);
 	Last_Sample = ONEWIRE_DATA_NOT_READY;
 	Last_Byte = ONEWIRE_DATA_NOT_READY;
 	Remaining_Bits = 0;
+	Reading_Byte = FALSE;
 	Byte_To_Write = 0xFF;
 	Byte_Read = 0xFF;
 }
@@ -106,7 +160,7 @@ void Onewire__DetectPresence(void)
 	ONEWIRE_DRIVE_BUS_LOW();
 	TIMER1__START();
 
-	Onewire_State = ONEWIRE_PRESENCE_DRIVE_LOW;
+	Fsm__SetState(&Onewire_Fsm, ONEWIRE_PRESENCE_DRIVE_LOW);
 }
 
 
@@ -126,14 +180,14 @@ ONEWIRE_SAMPLE_T Onewire__GetPresence(void)
 
 void Onewire__WriteBit(uint8_t bit)
 {
-	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	CRITICAL_BLOCK(CRITICAL_SITE_ONEWIRE_WRITE_BIT)
     {
         if (bit)
         {
             ONEWIRE_DRIVE_BUS_LOW();
             DELAY_BLOCKING(DELAY_WRITE1_INIT);
             ONEWIRE_RELEASE_BUS();
-            Onewire_State = ONEWIRE_WRITE1_RECOVERY;
+            Fsm__SetState(&Onewire_Fsm, ONEWIRE_WRITE1_RECOVERY);
             TIMER1__TRIGGER_DELAY(DELAY_WRITE1_RECOVERY);
         }
         else
@@ -141,7 +195,7 @@ void Onewire__WriteBit(uint8_t bit)
             ONEWIRE_DRIVE_BUS_LOW();
             DELAY_BLOCKING(DELAY_WRITE0_INIT);
             ONEWIRE_RELEASE_BUS();
-            Onewire_State = ONEWIRE_WRITE0_RECOVERY;
+            Fsm__SetState(&Onewire_Fsm, ONEWIRE_WRITE0_RECOVERY);
             TIMER1__TRIGGER_DELAY(DELAY_WRITE0_RECOVERY);
         }
     }
@@ -149,14 +203,14 @@ void Onewire__WriteBit(uint8_t bit)
 
 uint8_t Onewire__ReadBit(void)
 {
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    CRITICAL_BLOCK(CRITICAL_SITE_ONEWIRE_READ_BIT)
     {
         ONEWIRE_DRIVE_BUS_LOW();
         DELAY_BLOCKING(DELAY_READ_INIT);
         ONEWIRE_RELEASE_BUS();
         DELAY_BLOCKING(DELAY_READ_SAMPLE);
         Last_Sample = ONEWIRE_SAMPLE_BUS();
-        Onewire_State = ONEWIRE_READBIT_RECOVERY;
+        Fsm__SetState(&Onewire_Fsm, ONEWIRE_READBIT_RECOVERY);
         TIMER1__TRIGGER_DELAY(DELAY_READ_RECOVERY);
     }
     return Last_Sample;
@@ -164,6 +218,7 @@ uint8_t Onewire__ReadBit(void)
 
 void Onewire__WriteByte(uint8_t data)
 {
+	Trace__Append(TRACE_SOURCE_ONEWIRE, TRACE_EVENT_BEGIN, data);
 	Byte_To_Write = data;
 	Remaining_Bits = 7;
 	Onewire__WriteBit(Byte_To_Write & 0x1);
@@ -173,6 +228,7 @@ void Onewire__StartReadByte(void)
 {
     Byte_Read = 0;
     Remaining_Bits = 7;
+    Reading_Byte = TRUE;
 	Onewire__ReadBit();
 }
 
@@ -180,7 +236,7 @@ void Onewire__StartReadByte(void)
 uint8_t Onewire__IsIdle(void)
 {
 	uint8_t result = 0;
-	if (Onewire_State == ONEWIRE_IDLE)
+	if (Fsm__GetState(&Onewire_Fsm) == ONEWIRE_IDLE)
 	{
 		result = 1;
 	}
@@ -195,61 +251,62 @@ uint8_t Onewire__IsIdle(void)
 ISR(TIMER1_COMPA_vect)
 {
     TIMER1__STOP();
-	switch (Onewire_State)
-	{
-	    case ONEWIRE_PRESENCE_DRIVE_LOW:
-	    {
-	        ONEWIRE_RELEASE_BUS();
-	        TIMER1__TRIGGER_DELAY(DELAY_70_US);
-	        Onewire_State = ONEWIRE_PRESENCE_SAMPLE;
-	        break;
-	    }
-	    case ONEWIRE_PRESENCE_SAMPLE:
-	    {
-            Last_Sample = ONEWIRE_SAMPLE_BUS();
-            TIMER1__TRIGGER_DELAY(DELAY_410_US);
-            Onewire_State = ONEWIRE_PRESENCE_RECOVERY;
-	        break;
-	    }
-	    case ONEWIRE_PRESENCE_RECOVERY:
-	    {
-	        Onewire_State = ONEWIRE_IDLE;
-	        break;
-	    }
-	    case ONEWIRE_READBIT_RECOVERY:
-	    {
-	        Byte_Read |= (Last_Sample << 7);
-	        if (Remaining_Bits != 0)
-            {
-	            Byte_Read >>= 1;
-                Onewire__ReadBit();
-                Remaining_Bits--;
-            }
-            else
-            {
-                Onewire_State = ONEWIRE_IDLE;
-            }
-	        break;
-	    }
-	    case ONEWIRE_WRITE0_RECOVERY:
-	    case ONEWIRE_WRITE1_RECOVERY:
-	    {
-	        if (Remaining_Bits != 0)
-            {
-                Remaining_Bits--;
-                Byte_To_Write = Byte_To_Write >> 1;
-                Onewire__WriteBit(Byte_To_Write & 0x1);
-            }
-            else
-            {
-                Onewire_State = ONEWIRE_IDLE;
-            }
-	        break;
-	    }
-	    default:
-	    {
-	        break;
-	    }
-	}
+    Fsm__Dispatch(&Onewire_Fsm, ONEWIRE_EVENT_TIMER);
+}
+
+static BOOL_T IsWritingOne(void)
+{
+    return (Remaining_Bits != 0 && (Byte_To_Write & 0x2)) ? TRUE : FALSE;
+}
+
+static BOOL_T IsBitLeft(void)
+{
+    return (Remaining_Bits != 0) ? TRUE : FALSE;
+}
+
+static BOOL_T IsReadingByte(void)
+{
+    return Reading_Byte;
+}
+
+static void ReleaseForPresence(void)
+{
+    ONEWIRE_RELEASE_BUS();
+    TIMER1__TRIGGER_DELAY(DELAY_70_US);
 }
 
+static void SamplePresence(void)
+{
+    Last_Sample = ONEWIRE_SAMPLE_BUS();
+    TIMER1__TRIGGER_DELAY(DELAY_410_US);
+}
+
+static void EndPresence(void)
+{
+    Trace__Append(TRACE_SOURCE_ONEWIRE, TRACE_EVENT_END, Last_Sample);
+}
+
+static void WriteNextBit(void)
+{
+    Remaining_Bits--;
+    Byte_To_Write = Byte_To_Write >> 1;
+    Onewire__WriteBit(Byte_To_Write & 0x1);
+}
+
+/**
+ * @details The bit just sampled goes in first
+ */
+static void ReadNextBit(void)
+{
+    Byte_Read |= (Last_Sample << 7);
+    Byte_Read >>= 1;
+    Onewire__ReadBit();
+    Remaining_Bits--;
+}
+
+static void EndRead(void)
+{
+    Reading_Byte = FALSE;
+    Byte_Read |= (Last_Sample << 7);
+    Trace__Append(TRACE_SOURCE_ONEWIRE, TRACE_EVENT_END, Byte_Read);
+}
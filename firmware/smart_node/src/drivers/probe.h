@@ -0,0 +1,43 @@
+/**
+ * @file probe.h
+ *
+ * @brief Latency probes, for the end-to-end benchmark under simavr
+ *
+ * @details A probe writes its argument in GPIOR1, then the stage in GPIOR0,
+ *          where the simulator watches and timestamps it, two cycles. The
+ *          stage values do not overlap the markers of bench/bench.h.
+ *          The probes are compiled in with PROBE_ENABLED, on the AVR only.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef PROBE_H_
+#define PROBE_H_
+
+// Data space addresses, as seen by the simulator
+#define PROBE_STAGE_ADDRESS     0x3E    // GPIOR0
+#define PROBE_ARG_ADDRESS       0x4A    // GPIOR1
+
+typedef enum {
+    PROBE_SENSOR_READY = 0x10,  // scratchpad read and valid, 1ms task
+    PROBE_DECISION,             // control run, zone, PROBE_DECISION_CHANGE if not for a sample
+    PROBE_FRAME_QUEUED,         // report frame in the USART buffer, its sequence
+    PROBE_COMMAND_PARSED,       // request with a good CRC, its sequence
+} PROBE_STAGE_T;
+
+#define PROBE_DECISION_CHANGE   0x80
+
+#if defined(PROBE_ENABLED) && defined(__AVR__)
+    #include <avr/io.h>
+    #define Probe__Mark(stage, arg) \
+        do \
+        { \
+            GPIOR1 = (uint8_t)(arg); \
+            GPIOR0 = (uint8_t)(stage); \
+        } while (0)
+#else
+    #define Probe__Mark(stage, arg)
+#endif
+
+#endif /* PROBE_H_ */
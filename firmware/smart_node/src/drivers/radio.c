@@ -1,13 +1,32 @@
 /**
  * @file radio.c
  *
+ * @brief nRF24L01+ driver
+ *
+ * @details The 1ms task alone talks to the module, a command at a time
+ *          with Spi__Transfer, and the others send it requests through a
+ *          queue. Powered up, the module listens on pipe 0 with CE high
+ *          and acknowledges what it receives; the 1ms task moves a payload
+ *          at a time from the RX FIFO to a slot, emptied by
+ *          Radio__Receive. To transmit, it leaves RX: a payload waits in
+ *          the TX FIFO until no relay coil is pulsed, then CE starts the
+ *          burst and the coils are held until the module tells the end of
+ *          it on INT0, with the acknowledgement or after the last retry.
+ *          Both waits are bounded: a payload that cannot go is dropped,
+ *          and traced. Then it listens again.
+ *
  * @date 22/09/2014 18:30:05
  * @authors Stefan Engelke, Leonardo Ricupero
  */ 
 
+#include <string.h>
 #include "micro.h"
-#include "usart.h"
+#include "timer.h"
 #include "spi.h"
+#include "relays.h"
+#include "trace.h"
+#include "fsm.h"
+#include "event.h"
 #include "radio.h"
 
 #define DEFAULT_ADDRESS_SIZE 5
@@ -15,38 +34,106 @@
 
 #define DELAY_TPD2STBY 5 // milliseconds
 
+#define RADIO_HOLD_TIMEOUT_MS   50  // longer than two coil pulses in a row
+#define RADIO_TX_TIMEOUT_MS     25  // 15 retries 750us apart, with the airtime
+#define RADIO_CE_PULSE_US       15  // 10us at least
+
+// All the interrupts on INT0, PRIM_RX set while listening
+#define RADIO_CONFIG_TX (0 << BIT_PRIM_RX)
+#define RADIO_CONFIG_RX (1 << BIT_PRIM_RX)
+#define RADIO_STATUS_IRQ ((1 << BIT_RX_DR) | (1 << BIT_TX_DS) | (1 << BIT_MAX_RT))
+
 #define RADIO_DRIVE_CE_LOW()  {PORTB &= ~(1<<PORTB1);}
 #define RADIO_DRIVE_CE_HIGH() {PORTB |= (1<<PORTB1);}
 
 typedef enum {
     STATE_INIT = 0,
     STATE_IDLE,
-    STATE_READING,
     STATE_CONFIGURING,
-    STATE_ERROR_FOUND,
+    STATE_LISTENING,
+    STATE_HOLDING_RELAYS,
+    STATE_TRANSMITTING,
+    STATE_NUMBER,
 } RADIO_STATE_T;
 
-typedef union {
-    struct {
-        uint8_t turning_on: 1;
-        uint8_t on :1;
-        uint8_t transmitting :1;
-        uint8_t receiving :1;
-        uint8_t rx_complete :1;
-    };
-
-    uint8_t all;
-} RADIO_EVENTS_T;
-
-static RADIO_STATE_T Radio_State;
-static RADIO_EVENTS_T Radio_Events;
-
-static uint8_t Node_Address[DEFAULT_ADDRESS_SIZE] = DEFAULT_NODE_ADDRESS;
-
-static void WriteRegister(uint8_t reg, uint8_t value);
+typedef enum {
+    EVENT_TICK = 0,     // 1ms
+    EVENT_TURN_ON,      // EVENT_RADIO_TURN_ON request
+    EVENT_TURN_OFF,     // EVENT_RADIO_TURN_OFF request
+    EVENT_TRANSMIT,     // EVENT_RADIO_TRANSMIT request
+    EVENT_IRQ,          // EVENT_RADIO_IRQ
+} RADIO_EVENT_T;
+
+static uint8_t Command(uint8_t command, const uint8_t *data, uint8_t size);
+static void ReadCommand(uint8_t command, uint8_t *data, uint8_t size);
+static void WriteRegister(uint8_t reg, const uint8_t *val, uint8_t n_val);
+static uint8_t ClearIrq(void);
 static void InitializeIRQ(void);
+static void TakeRequests(void);
+static void EndTransmission(RADIO_ERROR_T error);
+static BOOL_T IsCountdownOver(void);
+static BOOL_T IsRelaysHeld(void);
+static BOOL_T IsPayloadWaiting(void);
+static void StartPowerUp(void);
+static void PowerDown(void);
+static void StartListening(void);
+static void TakeIrq(void);
+static void ReadPayload(void);
+static void LoadPayload(void);
+static void DropPayload(void);
+static void StartBurst(void);
+static void EndBurst(void);
+static void AbortBurst(void);
+
+static const FSM_TRANSITION_T Init_Rows[] PROGMEM = {
+    {EVENT_TURN_ON, NULL, StartPowerUp, STATE_CONFIGURING}, // before the first tick
+    {EVENT_TICK, NULL, NULL, STATE_IDLE},
+};
+static const FSM_TRANSITION_T Idle_Rows[] PROGMEM = {
+    {EVENT_TURN_ON, NULL, StartPowerUp, STATE_CONFIGURING},
+};
+static const FSM_TRANSITION_T Configuring_Rows[] PROGMEM = {
+    {EVENT_TICK, IsCountdownOver, StartListening, STATE_LISTENING},
+    {EVENT_TURN_OFF, NULL, PowerDown, STATE_IDLE},
+};
+static const FSM_TRANSITION_T Listening_Rows[] PROGMEM = {
+    {EVENT_IRQ, NULL, TakeIrq, STATE_LISTENING},
+    {EVENT_TICK, IsPayloadWaiting, ReadPayload, STATE_LISTENING},
+    {EVENT_TRANSMIT, NULL, LoadPayload, STATE_HOLDING_RELAYS},
+    {EVENT_TURN_OFF, NULL, PowerDown, STATE_IDLE},
+};
+// The coils and the PA must not draw at the same time
+static const FSM_TRANSITION_T Holding_Relays_Rows[] PROGMEM = {
+    {EVENT_TICK, IsRelaysHeld, StartBurst, STATE_TRANSMITTING},
+    {EVENT_TICK, IsCountdownOver, DropPayload, STATE_LISTENING},
+};
+static const FSM_TRANSITION_T Transmitting_Rows[] PROGMEM = {
+    {EVENT_IRQ, NULL, EndBurst, STATE_LISTENING},
+    {EVENT_TICK, IsCountdownOver, AbortBurst, STATE_LISTENING},
+};
+
+static const FSM_STATE_T Radio_States[STATE_NUMBER] PROGMEM = {
+    [STATE_INIT] = FSM_STATE(Init_Rows),
+    [STATE_IDLE] = FSM_STATE(Idle_Rows),
+    [STATE_CONFIGURING] = FSM_STATE(Configuring_Rows),
+    [STATE_LISTENING] = FSM_STATE(Listening_Rows),
+    [STATE_HOLDING_RELAYS] = FSM_STATE(Holding_Relays_Rows),
+    [STATE_TRANSMITTING] = FSM_STATE(Transmitting_Rows),
+};
+
+static FSM_T Radio_Fsm;
+static uint32_t State_Time_Us[STATE_NUMBER];
+static EVENT_QUEUE_T Request_Queue;
+static EVENT_QUEUE_T Irq_Queue;     // from the ISR
+static TIMER_T Countdown_Timer;
+static uint8_t Tx_Payload[RADIO_PAYLOAD_SIZE];
+static volatile uint8_t Tx_Busy;    // set by Radio__Transmit, cleared by the 1ms task
+static uint8_t Rx_Payload[RADIO_PAYLOAD_SIZE];
+static volatile uint8_t Rx_Ready;   // set by the 1ms task, cleared by Radio__Receive
+static uint8_t Rx_Pending;          // the RX FIFO may hold a payload
+static uint8_t Frame[1 + RADIO_PAYLOAD_SIZE];
 
-uint8_t* data;
+static uint8_t Node_Address[DEFAULT_ADDRESS_SIZE] = DEFAULT_NODE_ADDRESS;
 
 /**
  * Setup the RF24 module
@@ -58,8 +145,9 @@ uint8_t* data;
 void Radio__Initialize(void)
 {
 	uint8_t val;
-	// Set CE low to start with, because nothing has to be transmitted
+	// Set CE low to start with, it goes high to listen
     RADIO_DRIVE_CE_LOW();
+    DDRB |= (1 << DDB1);
 	
 	// EN_AA - (enable auto-acknowledgments)
 	// Transmitter gets automatic response from receiver in case of successful transmission
@@ -108,235 +196,325 @@ void Radio__Initialize(void)
 //	val[0] = 0x03;
 //	RF24ReadWrite(DYNPD, val, 1);
 	
-	/*
 	// Payload width setup - how many bytes to send per transmission (1-32)
-	val[0] = 32;	// 32 bytes per package (same on RX and TX)
-	RF24ReadWrite(W, RX_PW_P0, val, 1);
-	*/
+	val = RADIO_PAYLOAD_SIZE;	// same on RX and TX
+	WriteRegister(REG_RX_PW_P0, &val, 1);
 	
-	// CONFIG reg setup - boot up the nRF24L01 and choose if it is a transmitter or a receiver
-	val = (0 << BIT_PRIM_RX) | (0 << BIT_PWR_UP) | (1 << BIT_MASK_MAX_RT);
+	// CONFIG reg setup - choose if it is a transmitter or a receiver, powered down
+	// MAX_RT is not masked: it ends a transmission too
+	val = RADIO_CONFIG_RX | (0 << BIT_PWR_UP);
 	WriteRegister(REG_CONFIG, &val, 1);
 	
 	InitializeIRQ();
 
-	Radio_State = STATE_INIT;
-	Radio_Events.all = 0;
+	Fsm__Initialize(FSM_RADIO, &Radio_Fsm, Radio_States, STATE_NUMBER, STATE_INIT,
+	                TRACE_SOURCE_RADIO, State_Time_Us);
+	Event__InitQueue(&Request_Queue);
+	Event__InitQueue(&Irq_Queue);
+	Timer__Init(&Countdown_Timer, NULL, NULL);
+	Tx_Busy = 0;
+	Rx_Ready = 0;
+	Rx_Pending = 0;
 }
 
+/**
+ * @brief   Power the module up, listening after the start-up delay
+ *
+ * @details The requests go through a queue to the 1ms task, which alone
+ *          talks to the module: make them from one context only.
+ */
 void Radio__TurnOn(void)
 {
-    uint8_t val;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    Event__Post(&Request_Queue, EVENT_RADIO_TURN_ON, 0, 0);
+}
+
+void Radio__TurnOff(void)
+{
+    Event__Post(&Request_Queue, EVENT_RADIO_TURN_OFF, 0, 0);
+}
+
+/**
+ * @brief   Send a payload of RADIO_PAYLOAD_SIZE bytes
+ *
+ * @details From the context of Radio__TurnOn. The payload is copied. It is
+ *          dropped, and the error traced, if the radio is not listening,
+ *          if the relays stay busy for RADIO_HOLD_TIMEOUT_MS or if the
+ *          receiver does not acknowledge it.
+ *
+ * @return  FALSE if the previous payload is not sent yet
+ */
+BOOL_T Radio__Transmit(const uint8_t *payload)
+{
+    if (Tx_Busy)
+    {
+        return FALSE;
+    }
+    memcpy(Tx_Payload, payload, RADIO_PAYLOAD_SIZE);
+    Tx_Busy = 1;
+    if (Event__Post(&Request_Queue, EVENT_RADIO_TRANSMIT, 0, 0) == FALSE)
     {
-        // fixme read config first
-        val = (1 << BIT_PWR_UP);
-        WriteRegister(REG_CONFIG, &val, 1);
-        Radio_Events.turning_on = 1;
+        Tx_Busy = 0;
+        return FALSE;
     }
+    return TRUE;
 }
 
-void Radio__TurnOff(void)
+BOOL_T Radio__IsBusy(void)
+{
+    return Tx_Busy ? TRUE : FALSE;
+}
+
+/**
+ * @brief   Take the oldest payload received, RADIO_PAYLOAD_SIZE bytes
+ *
+ * @details From one context only. The slot is free for the next payload
+ *          of the RX FIFO once this one is copied.
+ *
+ * @return  FALSE if there is none
+ */
+BOOL_T Radio__Receive(uint8_t *payload)
 {
-    uint8_t val;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    if (Rx_Ready == 0)
     {
-        // fixme read config first
-        val = (0 << BIT_PWR_UP);
-        WriteRegister(REG_CONFIG, &val, 1);
-        Radio_Events.on = 0;
+        return FALSE;
     }
+    memcpy(payload, Rx_Payload, RADIO_PAYLOAD_SIZE);
+    Rx_Ready = 0;
+    return TRUE;
 }
 
 void Radio__1msTask(void)
 {
-    static down_counter = 0;
-    RADIO_STATE_T next_state = Radio_State;
+    EVENT_RECORD_T irq;
 
-    switch (Radio_State)
+    while (Event__Get(&Irq_Queue, &irq))
     {
-        case STATE_INIT:
+        if (Fsm__Dispatch(&Radio_Fsm, EVENT_IRQ) == FALSE)
         {
-            if (Spi__IsTxBufferEmpty())
-            {
-                next_state = STATE_IDLE;
-            }
-            break;
+            // Not waiting for it: clear it, or the line stays low
+            (void)ClearIrq();
         }
-        case STATE_IDLE:
-        {
-            if (Radio_Events.turning_on)
-            {
-                down_counter = DELAY_TPD2STBY;
-                next_state = STATE_CONFIGURING;
-            }
-            break;
-        }
-        case STATE_CONFIGURING:
+    }
+    TakeRequests();
+    Fsm__Dispatch(&Radio_Fsm, EVENT_TICK);
+}
+
+/**
+ * @details A request the current state does not take is dropped
+ */
+static void TakeRequests(void)
+{
+    EVENT_RECORD_T request;
+
+    while (Event__Get(&Request_Queue, &request))
+    {
+        if (request.type == EVENT_RADIO_TURN_ON)
         {
-            down_counter--;
-            if (down_counter == 0)
-            {
-                if (Radio_Events.turning_on)
-                {
-                    Radio_Events.turning_on = 0;
-                    Radio_Events.on = 1;
-                    next_state = STATE_IDLE;
-                }
-            }
-            break;
+            Fsm__Dispatch(&Radio_Fsm, EVENT_TURN_ON);
         }
-        case STATE_READING:
+        else if (request.type == EVENT_RADIO_TURN_OFF)
         {
-            break;
+            Fsm__Dispatch(&Radio_Fsm, EVENT_TURN_OFF);
         }
-        default:
+        else if (Fsm__Dispatch(&Radio_Fsm, EVENT_TRANSMIT) == FALSE)
         {
-            break;
+            EndTransmission(RADIO_ERROR_NOT_READY);
         }
     }
-
-    Radio_State = next_state;
-
 }
 
 /**
- * \brief Read a register value from nRF24L01
+ * @brief   Send a command and its data, taking the bytes shifted back
  *
- * \param reg
- *
- * \return uint8_t
+ * @return  STATUS, shifted back with the command
  */
-uint8_t RF24GetReg(uint8_t reg)
+static uint8_t Command(uint8_t command, const uint8_t *data, uint8_t size)
 {
-	_delay_us(10);
-	Spi__PutChar(R_REGISTER + reg);	// R_REGISTER = set the RF24 to reading mode, "reg" is the register that will be read back
-	_delay_us(10);
-	Spi__WriteThenRead(NOP); // Send a NOP (dummy byte) in order to read the first byte of the register "reg"
-	reg = Spi__GetChar();
-	_delay_us(10);
-	return reg;	// Return the read register
+    Frame[0] = command;
+    if (size != 0)
+    {
+        memcpy(&Frame[1], data, size);
+    }
+    Spi__Transfer(Frame, size + 1);
+    return Frame[0];
 }
 
 /**
- * \brief Write to or Read from nRF24L01
- *
- * \param ReadWrite		Specifies if we want to read ("R") or write ("W") to the register
- * \param reg			The register to read or write
- * \param val			array to read or write
- * \param nVal			size of the array
- *
- * \return uint8_t *	array of bytes read
+ * @brief   Send a command, taking the data bytes shifted back
  */
-uint8_t *RF24ReadWrite(uint8_t ReadWrite, uint8_t reg, uint8_t *val, uint8_t nVal)
+static void ReadCommand(uint8_t command, uint8_t *data, uint8_t size)
+{
+    Frame[0] = command;
+    memset(&Frame[1], CMD_NOP, size);
+    Spi__Transfer(Frame, size + 1);
+    memcpy(data, &Frame[1], size);
+}
+
+static void WriteRegister(uint8_t reg, const uint8_t *val, uint8_t n_val)
 {
-    //! A static uint8_t is needed to return an array
-    static uint8_t ret[DATA_LEN];
+    (void)Command(CMD_W_REGISTER | reg, val, n_val);
+}
+
+/**
+ * @return  STATUS before the clear
+ */
+static uint8_t ClearIrq(void)
+{
+    uint8_t val = RADIO_STATUS_IRQ;
+
+    return Command(CMD_W_REGISTER | REG_STATUS, &val, 1);
+}
 
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+/**
+ * @brief   The payload is over, sent or not: take the next one
+ */
+static void EndTransmission(RADIO_ERROR_T error)
+{
+    if (error != RADIO_ERROR_NONE)
     {
-	//! If "W" we want to write to nRF24. No need to "R" mode because R=0x00
-	if (ReadWrite == W)
-	{
-		reg = W_REGISTER + reg;	//ex: reg = EN_AA: 0b0010 0000 + 0b0000 0001 = 0b0010 0001
-	}
-
-	//! Makes sure we wait a bit
-	_delay_us(10);
-	Spi__PutChar(reg);	// set to write or read mode the register "reg"
-	_delay_us(10);
-
-	int i;
-	for(i=0; i < nVal; i++)
-	{
-		// We want to read a register
-		if (ReadWrite == R && reg != W_TX_PAYLOAD)
-		{
-			// Send dummy bytes to read the data
-		    Spi__WriteThenRead(NOP);
-			ret[i] = Spi__GetChar();
-			_delay_us(10);
-		}
-		else
-		{
-		    Spi__PutChar(val[i]);
-			_delay_us(10);
-		}
-	}
+        Trace__Append(TRACE_SOURCE_RADIO, TRACE_EVENT_ERROR, error);
     }
+    Tx_Busy = 0;
+}
 
-	return ret;
+/**
+ * @details Counts the milliseconds down
+ */
+static BOOL_T IsCountdownOver(void)
+{
+    return Timer__IsArmed(&Countdown_Timer) ? FALSE : TRUE;
 }
 
+/**
+ * @details Holds the pulses when it succeeds
+ */
+static BOOL_T IsRelaysHeld(void)
+{
+    return Relays__HoldPulses();
+}
 
+/**
+ * @details Once the slot is free
+ */
+static BOOL_T IsPayloadWaiting(void)
+{
+    return (Rx_Pending && (Rx_Ready == 0)) ? TRUE : FALSE;
+}
+
+static void StartPowerUp(void)
+{
+    uint8_t val = RADIO_CONFIG_RX | (1 << BIT_PWR_UP);
+
+    WriteRegister(REG_CONFIG, &val, 1);
+    Timer__Arm(&Countdown_Timer, DELAY_TPD2STBY, 0);
+}
+
+static void PowerDown(void)
+{
+    uint8_t val = RADIO_CONFIG_RX;
+
+    RADIO_DRIVE_CE_LOW();
+    WriteRegister(REG_CONFIG, &val, 1);
+}
 
 /**
- * \brief Transmit a data packet with the radio module
- * 
- * \param WBuff
- * 
- * \return void
+ * @details What came before, or during a transmission, is still in the
+ *          RX FIFO: look at it first
  */
-void RF24TransmitPayload(uint8_t *WBuff)
+static void StartListening(void)
 {
-	// Sends 0xE1 to flush the register from old data
-	RF24ReadWrite(R, FLUSH_TX, WBuff, 0);
-	// Sends data in WBuff to the module
-	// Note that FLUSH_TX and W_TX_PAYLOAD are sent with "R" instead of "W" because
-	// they are on the highest byte-level in the nRF
-	RF24ReadWrite(R, W_TX_PAYLOAD, WBuff, 5);
-	
-	_delay_ms(10);
-	// CE high = transmit the data
-	PORTB |= (1 << PORTB1);
-	_delay_us(20);
-	// CE low = stop transmitting
-	PORTB &= ~(1 << PORTB1);
-	_delay_ms(10);
+    uint8_t val = RADIO_CONFIG_RX | (1 << BIT_PWR_UP);
+
+    WriteRegister(REG_CONFIG, &val, 1);
+    RADIO_DRIVE_CE_HIGH();
+    Rx_Pending = 1;
 }
 
 /**
- * \brief Receive a data packet with the radio module
- * 
- * 
- * \return void
+ * @details Only RX_DR is expected while listening
  */
-void RF24ReceivePayload(void)
+static void TakeIrq(void)
 {
-	// CE high = listens for data
-	PORTB |= (1 << PORTB1);
-	// listens for 1 sec
-	_delay_ms(1000);
-	// CE low = stop listening
-	PORTB &= ~(1 << PORTB1);
+    if (ClearIrq() & (1 << BIT_RX_DR))
+    {
+        Rx_Pending = 1;
+    }
 }
 
 /**
- * \brief Reset IRQ on the nRF24L01
- *
- * 
- * \return void
+ * @brief   Move a payload from the RX FIFO to the slot, until it is empty
+ */
+static void ReadPayload(void)
+{
+    uint8_t fifo_status;
+
+    ReadCommand(CMD_R_REGISTER | REG_FIFO_STATUS, &fifo_status, 1);
+    if (fifo_status & (1 << BIT_RX_EMPTY))
+    {
+        Rx_Pending = 0;
+        return;
+    }
+    ReadCommand(CMD_R_RX_PAYLOAD, Rx_Payload, RADIO_PAYLOAD_SIZE);
+    Rx_Ready = 1;
+}
+
+/**
+ * @details Out of RX first, the burst goes with CE
+ */
+static void LoadPayload(void)
+{
+    uint8_t val = RADIO_CONFIG_TX | (1 << BIT_PWR_UP);
+
+    RADIO_DRIVE_CE_LOW();
+    WriteRegister(REG_CONFIG, &val, 1);
+    (void)Command(CMD_FLUSH_TX, NULL, 0);
+    (void)Command(CMD_W_TX_PAYLOAD, Tx_Payload, RADIO_PAYLOAD_SIZE);
+    Timer__Arm(&Countdown_Timer, RADIO_HOLD_TIMEOUT_MS, 0);
+}
+
+static void DropPayload(void)
+{
+    (void)Command(CMD_FLUSH_TX, NULL, 0);
+    EndTransmission(RADIO_ERROR_RELAYS_BUSY);
+    StartListening();
+}
+
+/**
+ * @brief   A CE pulse sends the payload, the retries go on by themselves
  */
-void RF24ResetIRQ(void)
+static void StartBurst(void)
 {
-	// Write to STATUS register
-	Spi__PutChar(W_REGISTER + STATUS);
-	_delay_us(10);
-	// Reset all IRQ in STATUS register
-	Spi__PutChar(0x70);
-	_delay_us(10);
+    RADIO_DRIVE_CE_HIGH();
+    _delay_us(RADIO_CE_PULSE_US);
+    RADIO_DRIVE_CE_LOW();
+    Timer__Arm(&Countdown_Timer, RADIO_TX_TIMEOUT_MS, 0);
 }
 
-static void WriteRegister(uint8_t reg, uint8_t* val, uint8_t n_val)
+static void EndBurst(void)
 {
-    uint8_t i;
+    RADIO_ERROR_T error = RADIO_ERROR_NONE;
 
-    reg = CMD_W_REGISTER + reg;
-    Spi__PutChar(reg);
-    for (i = 0; i < n_val; i++)
+    if ((ClearIrq() & (1 << BIT_TX_DS)) == 0)
     {
-        Spi__PutChar(val[i]);
+        // Out of retries, the payload is still in the FIFO
+        (void)Command(CMD_FLUSH_TX, NULL, 0);
+        error = RADIO_ERROR_NO_ACK;
     }
+    Relays__ReleasePulses();
+    EndTransmission(error);
+    StartListening();
+}
+
+/**
+ * @brief   No interrupt from the module: give the coils back anyway
+ */
+static void AbortBurst(void)
+{
+    (void)ClearIrq();
+    (void)Command(CMD_FLUSH_TX, NULL, 0);
+    Relays__ReleasePulses();
+    EndTransmission(RADIO_ERROR_NO_IRQ);
+    StartListening();
 }
 
 static void InitializeIRQ(void)
@@ -353,28 +531,13 @@ static void InitializeIRQ(void)
 /**
  * @brief ISR on INT0
  *
- * This is called when successful data receive or transmission
- * happened
- *
- * @todo Avoid 0.5 sec delay
+ * This is called at the end of a transmission, acknowledged or out of
+ * retries, or when a payload is received: the 1ms task reads the module
  *
  * @return void
  */
 ISR(INT0_vect)
 {
-    PORTB &= ~(1 << PORTB1);
-
-    // LED to show success
-    PORTB |= (1 << PORTB0);
-    _delay_ms(500);
-    PORTB &= ~(1 << PORTB0);
-    // Read data from RX FIFO
-    data = RF24ReadWrite(R, R_RX_PAYLOAD, data, 32);
-    // Print data to console
-    for (int i = 0; i < 32; i++)
-    {
-        Usart__PutChar(data[i]);
-    }
-    // Clear IRQ masks in STATUS register
-    RF24ResetIRQ();
+    Trace__Append(TRACE_SOURCE_RADIO, TRACE_EVENT_ISR, 0);
+    Event__Post(&Irq_Queue, EVENT_RADIO_IRQ, 0, 0);
 }
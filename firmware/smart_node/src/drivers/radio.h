@@ -140,19 +140,24 @@
 #define RF_PWR_LOW  1
 #define RF_PWR_HIGH 2
 
-// Read and Write mode
-#define W 1
-#define R 0
+#define RADIO_PAYLOAD_SIZE 32
 
-#define DATA_LEN 32
+// Traced with TRACE_EVENT_ERROR, the payload is dropped
+typedef enum {
+    RADIO_ERROR_NONE = 0,
+    RADIO_ERROR_NOT_READY,      // not listening
+    RADIO_ERROR_RELAYS_BUSY,    // coils pulsed for RADIO_HOLD_TIMEOUT_MS
+    RADIO_ERROR_NO_ACK,         // out of retries
+    RADIO_ERROR_NO_IRQ,         // no end of the burst from the module
+} RADIO_ERROR_T;
 
-uint8_t RF24GetReg(uint8_t reg);
-uint8_t *RF24ReadWrite(uint8_t ReadWrite, uint8_t reg, uint8_t *val, uint8_t nVal);
 void Radio__Initialize(void);
+void Radio__TurnOn(void);
+void Radio__TurnOff(void);
+BOOL_T Radio__Transmit(const uint8_t *payload);
+BOOL_T Radio__IsBusy(void);
+BOOL_T Radio__Receive(uint8_t *payload);
 void Radio__1msTask(void);
-void RF24TransmitPayload(uint8_t *WBuff);
-void RF24ReceivePayload(void);
-void RF24ResetIRQ(void);
 
 
 #endif /* NRF24L01_H_ */
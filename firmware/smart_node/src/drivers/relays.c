@@ -1,230 +1,341 @@
 /**
  * @file
  *
+ * @brief	Bistable relays driver
+ *
+ * @details Each relay has a set and a reset coil, moved by a pulse whose
+ * 			width can be calibrated per relay.
+ * 			A command only updates the position wanted for the relay and
+ * 			queues the relay, once: a later command for a relay still in
+ * 			the queue replaces the previous one, and a relay already in
+ * 			the wanted position is not pulsed, so a set followed by a reset
+ * 			costs nothing and the queue can never overflow.
+ * 			The 1ms task starts the pulses of the queued relays that are not
+ * 			moving, in queue order, as long as the coil currents fit the
+ * 			peak current budget: with enough budget a group command
+ * 			completes in a single pulse window, otherwise the pulses are
+ * 			staggered. No pulse starts while the radio holds the pulses, so
+ * 			coil pulses and PA bursts never overlap on the supply.
+ *
  * @date 21/11/2014
  *
  * @author Leonardo Ricupero
- */ 
+ */
 
 #include "micro.h"
 #include <avr/interrupt.h>
+#include "critical.h"
+#include "trace.h"
 #include "relays.h"
 
-#define RELAYS_ACTION_DELAY_MS 4
-
 typedef enum {
-	STATE_INIT = 0,
-	STATE_WAIT_FOR_INIT_RESET,
+	STATE_UNKNOWN = 0,
 	STATE_SET,
 	STATE_RESET,
 	STATE_WAIT_FOR_SET,
 	STATE_WAIT_FOR_RESET,
 } RELAYS_STATE_T;
 
-typedef enum {
-	EVENT_NO_EVENT,
-	EVENT_RELAY_SET_REQUESTED,
-	EVENT_RELAY_RESET_REQUESTED,
-} RELAYS_EVENT_T;
-
-static RELAY_T Current_Relay;
-static RELAYS_STATE_T Relay0_State;
-static RELAYS_STATE_T Relay1_State;
-static RELAYS_EVENT_T Relays_Event;
-static uint8_t Countdown_Timer_Ms;
-
-static inline void BeginMovePinForSet(RELAY_T relay);
-static inline void EndMovePinForSet(RELAY_T relay);
-static inline void BeginMovePinForReset(RELAY_T relay);
-static inline void EndMovePinForReset(RELAY_T relay);
+typedef struct {
+	volatile uint8_t *ddr;
+	volatile uint8_t *port;
+	uint8_t set_pin;	// bit mask of the set coil driver
+	uint8_t reset_pin;	// bit mask of the reset coil driver
+	uint16_t coil_ma;	// coil current during the pulse
+} RELAY_PINS_T;
+
+typedef struct {
+	RELAYS_STATE_T state;
+	uint8_t countdown_ms;
+	uint8_t pulse_ms;
+} RELAY_CHANNEL_T;
+
+static const RELAY_PINS_T Relay_Pins[RELAYS_NUMBER] = {
+	{&DDRD, &PORTD, (1 << PD3), (1 << PD4), RELAYS_COIL_MA}, // RELAY_0
+	{&DDRD, &PORTD, (1 << PD5), (1 << PD6), RELAYS_COIL_MA}, // RELAY_1
+};
+
+static RELAY_CHANNEL_T Channels[RELAYS_NUMBER];
+static uint8_t Target_Mask;		// bit set: relay wanted in the set position
+static uint8_t Queued_Mask;		// relays in the queue
+static uint8_t Queue[RELAYS_NUMBER];
+static uint8_t Queue_Length;
+static uint16_t Budget_Ma;
+static uint16_t Load_Ma;		// current of the coils being pulsed
+static uint8_t Hold;			// no pulse may start
+
+static void Request(uint8_t mask, BOOL_T set);
+static inline void BeginMove(RELAY_T relay, BOOL_T set);
+static inline void EndMove(RELAY_T relay);
 
 /**
  * @brief	Relays module initialization
  *
  * @details Initializes the relays to a known state, as reported on the
- * 			silkscreen of the board, providing a 4ms pulse on the reset coil
- * 
+ * 			silkscreen of the board, providing a pulse on the reset coil of
+ * 			every relay. With the default budget the pulses are staggered.
+ *
  */
 void Relays__Initialize(void)
 {
-	// Control pin as outputs
-	DDRD |= (1 << DDD3) | (1 << DDD4) | (1 << DDD5) | (1 << DDD6);
+	uint8_t i;
+
+	Target_Mask = 0;
+	Queued_Mask = 0;
+	Queue_Length = 0;
+	Budget_Ma = RELAYS_COIL_MA;
+	Load_Ma = 0;
+	Hold = 0;
+
+	for (i = 0; i < RELAYS_NUMBER; i++)
+	{
+		// Control pins as outputs
+		*Relay_Pins[i].ddr |= Relay_Pins[i].set_pin | Relay_Pins[i].reset_pin;
 
-	Relay0_State = STATE_INIT;
-	Current_Relay = RELAY_0; // only RELAY_0 will have its state automatically changed
-	Relay1_State = STATE_RESET; // so we put STATE_RESET as initial state for RELAY_1
-	Relays_Event = EVENT_RELAY_RESET_REQUESTED;
+		// The position is unknown, so the reset pulse is always given
+		Channels[i].state = STATE_UNKNOWN;
+		Channels[i].countdown_ms = 0;
+		Channels[i].pulse_ms = RELAYS_DEFAULT_PULSE_MS;
+		Queue[Queue_Length++] = i;
+		Queued_Mask |= RELAY_MASK(i);
+	}
 }
 
 
 void Relays__Set(RELAY_T relay)
 {
-	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-    {
-        Current_Relay = relay;
-        Relays_Event = EVENT_RELAY_SET_REQUESTED;
-    }
+	Request(RELAY_MASK(relay), TRUE);
 }
 
 
 void Relays__Reset(RELAY_T relay)
 {
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-    {
-        Current_Relay = relay;
-        Relays_Event = EVENT_RELAY_RESET_REQUESTED;
-    }
+	Request(RELAY_MASK(relay), FALSE);
 }
 
-void Relays__1msTask(void)
+/**
+ * @brief	Set several relays, in the same pulse window
+ *
+ * @param	mask	RELAY_MASK of each relay, RELAYS_ALL_MASK for all
+ */
+void Relays__SetGroup(uint8_t mask)
 {
-	RELAYS_STATE_T current_state, next_state;
+	Request(mask & RELAYS_ALL_MASK, TRUE);
+}
 
-	if (Countdown_Timer_Ms != 0)
+/**
+ * @brief	Reset several relays, in the same pulse window
+ *
+ * @param	mask	RELAY_MASK of each relay, RELAYS_ALL_MASK for all
+ */
+void Relays__ResetGroup(uint8_t mask)
+{
+	Request(mask & RELAYS_ALL_MASK, FALSE);
+}
+
+/**
+ * @brief	Highest coil current allowed at any time
+ *
+ * @details A pulse is always allowed when no other coil is energized, so
+ * 			a budget below the current of one coil serializes the pulses
+ */
+void Relays__SetBudget(uint16_t budget_ma)
+{
+	CRITICAL_BLOCK(CRITICAL_SITE_RELAYS)
 	{
-		Countdown_Timer_Ms--;
+		Budget_Ma = budget_ma;
 	}
+}
 
-	if (Relays_Event != EVENT_NO_EVENT)
+/**
+ * @brief	Coil pulse width of a relay, used from its next pulse
+ *
+ * @param	pulse_ms	1 to RELAYS_MAX_PULSE_MS
+ */
+void Relays__SetPulseWidth(RELAY_T relay, uint8_t pulse_ms)
+{
+	if (pulse_ms == 0 || pulse_ms > RELAYS_MAX_PULSE_MS)
 	{
-		if (Current_Relay == RELAY_0)
-		{
-			current_state = Relay0_State;
-		}
-		else
-		{
-			current_state = Relay1_State;
-		}
-		// by default, remains in the current state
-		next_state = current_state;
+		pulse_ms = RELAYS_DEFAULT_PULSE_MS;
+	}
+	Channels[relay].pulse_ms = pulse_ms;
+}
+
+uint8_t Relays__GetPulseWidth(RELAY_T relay)
+{
+	return Channels[relay].pulse_ms;
+}
 
-		switch (current_state)
+/**
+ * @brief	Keep the coils off, for a radio transmission
+ *
+ * @details The pulses already running are not cut short: the request fails
+ * 			until they are over, the caller retries
+ *
+ * @return	TRUE if no coil is energized, and none will be until
+ * 			Relays__ReleasePulses
+ */
+BOOL_T Relays__HoldPulses(void)
+{
+	BOOL_T held = FALSE;
+
+	CRITICAL_BLOCK(CRITICAL_SITE_RELAYS)
+	{
+		if (Load_Ma == 0)
 		{
-			case STATE_INIT:
-			{
-				BeginMovePinForReset(RELAY_0);
-				BeginMovePinForReset(RELAY_1);
-				Countdown_Timer_Ms = RELAYS_ACTION_DELAY_MS;
-				next_state = STATE_WAIT_FOR_INIT_RESET;
-				break;
-			}
-			case STATE_WAIT_FOR_INIT_RESET:
-			{
-				if (Countdown_Timer_Ms == 0)
-				{
-					EndMovePinForReset(RELAY_0);
-					EndMovePinForReset(RELAY_1);
-					next_state = STATE_RESET;
-				}
-				break;
-			}
-			case STATE_WAIT_FOR_SET:
-			{
-				if (Countdown_Timer_Ms == 0)
-				{
-					EndMovePinForSet(Current_Relay);
-					next_state = STATE_SET;
-				}
-				break;
-			}
-			case STATE_WAIT_FOR_RESET:
-			{
-				if (Countdown_Timer_Ms == 0)
-				{
-					EndMovePinForReset(Current_Relay);
-					next_state = STATE_RESET;
-				}
-				break;
-			}
-			case STATE_SET:
-			{
-				if (Relays_Event == EVENT_RELAY_RESET_REQUESTED)
-				{
-					BeginMovePinForReset(Current_Relay);
-					Countdown_Timer_Ms = RELAYS_ACTION_DELAY_MS;
-					next_state = STATE_WAIT_FOR_RESET;
-				}
-				else
-				{
-					Relays_Event = EVENT_NO_EVENT;
-				}
-				break;
-			}
-			case STATE_RESET:
-			{
-				if (Relays_Event == EVENT_RELAY_SET_REQUESTED)
-				{
-					BeginMovePinForSet(Current_Relay);
-					Countdown_Timer_Ms = RELAYS_ACTION_DELAY_MS;
-					next_state = STATE_WAIT_FOR_SET;
-				}
-				else
-				{
-					Relays_Event = EVENT_NO_EVENT;
-				}
-				break;
-			}
-			default:
-			{
-				break;
-			}
+			Hold = 1;
+			held = TRUE;
 		}
-
-		if (Current_Relay == RELAY_0)
-        {
-            Relay0_State = next_state;
-        }
-        else
-        {
-            Relay1_State = next_state;
-        }
 	}
+	return held;
 }
 
-static inline void BeginMovePinForSet(RELAY_T relay)
+void Relays__ReleasePulses(void)
 {
-	if (relay == RELAY_0)
-	{
-		PORTD |= (1 << PD3);
-	}
-	else if (relay == RELAY_1)
-	{
-		PORTD |= (1 << PD5);
-	}
+	Hold = 0;
 }
 
-static inline void EndMovePinForSet(RELAY_T relay)
+/**
+ * @brief	Consider the position of a relay unknown
+ *
+ * @details For a self-test: the next command pulses the relay even if it
+ * 			is already reported in the wanted position
+ */
+void Relays__ForgetPosition(RELAY_T relay)
 {
-	if (relay == RELAY_0)
+	CRITICAL_BLOCK(CRITICAL_SITE_RELAYS)
 	{
-		PORTD &= ~(1 << PD3);
+		if (Channels[relay].countdown_ms == 0)
+		{
+			Channels[relay].state = STATE_UNKNOWN;
+		}
 	}
-	else if (relay == RELAY_1)
+}
+
+/**
+ * @brief   Check if a relay is in the set position
+ *
+ * @details The relay is reported as set only once its coil pulse is over
+ */
+uint8_t Relays__IsSet(RELAY_T relay)
+{
+    return (Channels[relay].state == STATE_SET);
+}
+
+/**
+ * @brief   Check if a relay has a command waiting or a pulse running
+ */
+uint8_t Relays__IsBusy(RELAY_T relay)
+{
+	uint8_t busy;
+
+	CRITICAL_BLOCK(CRITICAL_SITE_RELAYS)
 	{
-		PORTD &= ~(1 << PD5);
+		busy = ((Queued_Mask & RELAY_MASK(relay)) != 0) ||
+			   (Channels[relay].countdown_ms != 0);
 	}
+	return busy;
 }
 
-static inline void BeginMovePinForReset(RELAY_T relay)
+void Relays__1msTask(void)
 {
-	if (relay == RELAY_0)
+	RELAY_CHANNEL_T *channel;
+	uint8_t relay;
+	uint8_t set;
+	uint8_t i;
+	uint8_t kept = 0;
+	uint8_t blocked = 0;
+
+	// End the pulses
+	for (i = 0; i < RELAYS_NUMBER; i++)
 	{
-		PORTD |= (1 << PD4);
+		channel = &Channels[i];
+		if (channel->countdown_ms != 0)
+		{
+			channel->countdown_ms--;
+			if (channel->countdown_ms == 0)
+			{
+				EndMove(i);
+				Trace__Append(TRACE_SOURCE_RELAYS, TRACE_EVENT_END, i);
+				Load_Ma -= Relay_Pins[i].coil_ma;
+				channel->state = (channel->state == STATE_WAIT_FOR_SET) ? STATE_SET : STATE_RESET;
+			}
+		}
 	}
-	else if (relay == RELAY_1)
+
+	// Start the pulses of the queued relays that are not moving, in order,
+	// until the budget is used up
+	for (i = 0; i < Queue_Length; i++)
 	{
-		PORTD |= (1 << PD6);
+		relay = Queue[i];
+		channel = &Channels[relay];
+
+		if (Hold || blocked || channel->countdown_ms != 0)
+		{
+			// A command for a moving relay waits for the end of the pulse
+			Queue[kept++] = relay;
+			continue;
+		}
+
+		set = ((Target_Mask & RELAY_MASK(relay)) != 0);
+		if ((set && channel->state != STATE_SET) ||
+			(!set && channel->state != STATE_RESET))
+		{
+			if (Load_Ma != 0 && Load_Ma + Relay_Pins[relay].coil_ma > Budget_Ma)
+			{
+				// The later relays wait too, so none is starved
+				blocked = 1;
+				Queue[kept++] = relay;
+				continue;
+			}
+			BeginMove(relay, set);
+			Trace__Append(TRACE_SOURCE_RELAYS, TRACE_EVENT_BEGIN, relay | (set << 7));
+			Load_Ma += Relay_Pins[relay].coil_ma;
+			channel->countdown_ms = channel->pulse_ms;
+			channel->state = set ? STATE_WAIT_FOR_SET : STATE_WAIT_FOR_RESET;
+		}
+		Queued_Mask &= ~RELAY_MASK(relay);
 	}
+	Queue_Length = kept;
 }
 
-static inline void EndMovePinForReset(RELAY_T relay)
+/**
+ * @details Called from the main loop and from the tasks, the 1ms task may
+ * 			preempt it
+ */
+static void Request(uint8_t mask, BOOL_T set)
 {
-	if (relay == RELAY_0)
-	{
-		PORTD &= ~(1 << PD4);
-	}
-	else if (relay == RELAY_1)
+	uint8_t i;
+
+	CRITICAL_BLOCK(CRITICAL_SITE_RELAYS)
 	{
-		PORTD &= ~(1 << PD6);
+		if (set)
+		{
+			Target_Mask |= mask;
+		}
+		else
+		{
+			Target_Mask &= ~mask;
+		}
+
+		for (i = 0; i < RELAYS_NUMBER; i++)
+		{
+			if ((mask & RELAY_MASK(i)) && !(Queued_Mask & RELAY_MASK(i)))
+			{
+				Queue[Queue_Length++] = i;
+				Queued_Mask |= RELAY_MASK(i);
+				Trace__Append(TRACE_SOURCE_RELAYS, TRACE_EVENT_PUT, i | (set << 7));
+			}
+		}
 	}
 }
+
+static inline void BeginMove(RELAY_T relay, BOOL_T set)
+{
+	*Relay_Pins[relay].port |= set ? Relay_Pins[relay].set_pin : Relay_Pins[relay].reset_pin;
+}
+
+static inline void EndMove(RELAY_T relay)
+{
+	*Relay_Pins[relay].port &= ~(Relay_Pins[relay].set_pin | Relay_Pins[relay].reset_pin);
+}
@@ -9,14 +9,34 @@
 #ifndef RELAYS_H_
 #define RELAYS_H_
 
+#include "micro.h"
+
 typedef enum {
 	RELAY_0,
 	RELAY_1,
+	RELAYS_NUMBER,
 } RELAY_T;
 
+#define RELAYS_COIL_MA		80	// coil current of the fitted relays
+#define RELAYS_DEFAULT_PULSE_MS	4
+#define RELAYS_MAX_PULSE_MS	20
+
+#define RELAY_MASK(relay)	(uint8_t)(1 << (relay))
+#define RELAYS_ALL_MASK		(uint8_t)((1 << RELAYS_NUMBER) - 1)
+
 void Relays__Initialize(void);
 void Relays__Set(RELAY_T relay);
 void Relays__Reset(RELAY_T relay);
+void Relays__SetGroup(uint8_t mask);
+void Relays__ResetGroup(uint8_t mask);
+void Relays__SetBudget(uint16_t budget_ma);
+void Relays__SetPulseWidth(RELAY_T relay, uint8_t pulse_ms);
+uint8_t Relays__GetPulseWidth(RELAY_T relay);
+BOOL_T Relays__HoldPulses(void);
+void Relays__ReleasePulses(void);
+void Relays__ForgetPosition(RELAY_T relay);
+uint8_t Relays__IsSet(RELAY_T relay);
+uint8_t Relays__IsBusy(RELAY_T relay);
 void Relays__1msTask(void);
 
 #endif /* RELAYS_H_ */
@@ -36,8 +36,8 @@ static BOOL_T Pending_Read;
  */
 void Spi__Initialize(void)
 {
-	// Set MOSI ,SCK, and CSN as output, all other pin as input
-	DDR_SPI = (1 << DDR_SCK) | (1 << DDR_MOSI) | (1 << DDR_CSN);
+	// Set MOSI ,SCK, and CSN as output, the other pins are left as they are
+	DDR_SPI |= (1 << DDR_SCK) | (1 << DDR_MOSI) | (1 << DDR_CSN);
 	// Enable SPI, Master, set clock rate fck/16, IRQ enabled
 	SPCR = (1 << SPE) | (1 << MSTR) | (1 << SPR0) | (1 << SPIE);
 	// Set CSN high to start with, because nothing has to be transmitted
@@ -79,6 +79,35 @@ void Spi__WriteThenRead(uint8_t c)
     Spi__PutChar(c);
 }
 
+/**
+ * @brief	Exchange a whole command with the slave, polling the transfers
+ *
+ * @details CSN stays low from the first byte to the last, as the nRF24L01+
+ * 			wants for a command and its data, and each byte received takes
+ * 			the place of the one sent. The SPI interrupt is masked meanwhile,
+ * 			so the buffered transfers must be over. About 10us per byte.
+ */
+void Spi__Transfer(uint8_t *data, uint8_t size)
+{
+	uint8_t spcr = SPCR;
+	uint8_t i;
+
+	SPCR = spcr & ~(1 << SPIE);
+	SPI_DRIVE_CSN_LOW();
+	for (i = 0; i < size; i++)
+	{
+		Micro__Write(SPDR, data[i]);
+		while ((SPSR & (1 << SPIF)) == 0)
+		{
+			Micro__BusyWait();
+		}
+		// Reading SPDR after SPSR clears the flag
+		data[i] = SPDR;
+	}
+	SPI_DRIVE_CSN_HIGH();
+	SPCR = spcr;
+}
+
 BOOL_T Spi__IsRxBufferEmpty(void)
 {
     uint8_t res = TRUE;
@@ -111,7 +140,7 @@ void Spi__FastTask(void)
         {
             Tx_Idx--;
             SPI_DRIVE_CSN_LOW();
-            SPDR = Tx_Buffer[Tx_Idx];
+            Micro__Write(SPDR, Tx_Buffer[Tx_Idx]);
             Pending_Write = TRUE;
         }
     }
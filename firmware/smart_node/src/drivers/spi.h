@@ -15,6 +15,7 @@ void Spi__Initialize(void);
 void Spi__PutChar(uint8_t c);
 uint8_t Spi__GetChar(void);
 void Spi__WriteThenRead(uint8_t c);
+void Spi__Transfer(uint8_t *data, uint8_t size);
 BOOL_T Spi__IsRxBufferEmpty(void);
 BOOL_T Spi__IsTxBufferEmpty(void);
 void Spi__FastTask(void);
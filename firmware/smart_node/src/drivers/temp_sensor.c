@@ -5,7 +5,13 @@
  * @author Leonardo Ricupero
  */ 
 
+#include <util/crc16.h>
+#include "timer.h"
 #include "onewire.h"
+#include "trace.h"
+#include "fsm.h"
+#include "event.h"
+#include "probe.h"
 #include "temp_sensor.h"
 
 #define SCRATCHPAD_SIZE		9
@@ -30,6 +36,11 @@
 #define T_ALARM_LOW			0x85 // -5 1000 0101b
 #define RES_CONFIG			0x7F // 12 bit 0111 1111b
 
+// Error handling
+#define TEMP_SENSOR_TIMEOUT_MS          1000 // 750ms conversion + transfers
+#define TEMP_SENSOR_BACKOFF_MIN_MS      250
+#define TEMP_SENSOR_BACKOFF_MAX_SHIFT   7 // 250ms << 7 = 32s
+
 
 typedef enum {
 	STATE_IDLE = 0,
@@ -43,14 +54,19 @@ typedef enum {
 	STATE_READ_SCRATCHPAD,
 	STATE_ACQUIRING_SCRATCHPAD,
 	STATE_ERROR_FOUND,
+	STATE_NUMBER,
 } TEMP_SENSOR_STATE_T;
 
+// The machine moves only with the bus idle, a 1-Wire transfer at a time
+typedef enum {
+	EVENT_BUS_IDLE = 0,
+} TEMP_SENSOR_EVENT_T;
+
 typedef union {
     struct {
 	    uint8_t configuring :1;
 	    uint8_t reading_temp :1;
 	    uint8_t conversion_finished :1;
-	    uint8_t temperature_read :1;
 	    uint8_t configured: 1;
 	    uint8_t timeout_expired: 1;
     };
@@ -58,12 +74,99 @@ typedef union {
 	uint8_t all;
 } TEMP_SENSOR_EVENTS_T;
 
+static void TakeRequests(void);
 static uint8_t IsBusy(void);
+static void HandleError(TEMP_SENSOR_ERROR_T error);
+static BOOL_T IsRequested(void);
+static BOOL_T IsPresent(void);
+static BOOL_T IsConfiguring(void);
+static BOOL_T IsReadingTemperature(void);
+static BOOL_T IsConversionFinished(void);
+static BOOL_T IsConversionOver(void);
+static BOOL_T IsScratchpadLeft(void);
+static BOOL_T IsScratchpadValid(void);
+static void StartPresence(void);
+static void WriteSkipRom(void);
+static void NoPresence(void);
+static void WriteScratchpad(void);
+static void WriteConvert(void);
+static void WriteReadScratchpad(void);
+static void EndConversion(void);
+static void StartScratchpad(void);
+static void ReadNextByte(void);
+static void AcceptScratchpad(void);
+static void RejectScratchpad(void);
+static void WriteAlarmHigh(void);
+static void WriteAlarmLow(void);
+static void WriteResolution(void);
+static void EndConfiguration(void);
+static void Fail(void);
+
+static const FSM_TRANSITION_T Idle_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, IsRequested, StartPresence, STATE_DETECT_PRESENCE},
+};
+static const FSM_TRANSITION_T Detect_Presence_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, IsPresent, WriteSkipRom, STATE_SKIP_ROM},
+	{EVENT_BUS_IDLE, NULL, NoPresence, STATE_ERROR_FOUND},
+};
+// Without a request the machine waits here for the timeout
+static const FSM_TRANSITION_T Skip_Rom_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, IsConfiguring, WriteScratchpad, STATE_CONFIG_PRE},
+	{EVENT_BUS_IDLE, IsReadingTemperature, WriteConvert, STATE_CONVERT_TEMPERATURE},
+	{EVENT_BUS_IDLE, IsConversionFinished, WriteReadScratchpad, STATE_READ_SCRATCHPAD},
+};
+static const FSM_TRANSITION_T Config_Pre_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, NULL, WriteAlarmHigh, STATE_CONFIG_T_ALARM0},
+};
+static const FSM_TRANSITION_T Config_T_Alarm0_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, NULL, WriteAlarmLow, STATE_CONFIG_T_ALARM1},
+};
+static const FSM_TRANSITION_T Config_T_Alarm1_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, NULL, WriteResolution, STATE_CONFIG_RESOLUTION},
+};
+static const FSM_TRANSITION_T Config_Resolution_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, NULL, EndConfiguration, STATE_IDLE},
+};
+static const FSM_TRANSITION_T Convert_Temperature_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, IsConversionOver, EndConversion, STATE_DETECT_PRESENCE},
+};
+static const FSM_TRANSITION_T Read_Scratchpad_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, NULL, StartScratchpad, STATE_ACQUIRING_SCRATCHPAD},
+};
+static const FSM_TRANSITION_T Acquiring_Scratchpad_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, IsScratchpadLeft, ReadNextByte, STATE_ACQUIRING_SCRATCHPAD},
+	{EVENT_BUS_IDLE, IsScratchpadValid, AcceptScratchpad, STATE_IDLE},
+	{EVENT_BUS_IDLE, NULL, RejectScratchpad, STATE_ERROR_FOUND},
+};
+static const FSM_TRANSITION_T Error_Found_Rows[] PROGMEM = {
+	{EVENT_BUS_IDLE, NULL, Fail, STATE_IDLE},
+};
 
-static TEMP_SENSOR_STATE_T TempSensor_State;
-static TEMP_SENSOR_EVENTS_T TempSensor_Events;
+static const FSM_STATE_T TempSensor_States[STATE_NUMBER] PROGMEM = {
+	[STATE_IDLE] = FSM_STATE(Idle_Rows),
+	[STATE_DETECT_PRESENCE] = FSM_STATE(Detect_Presence_Rows),
+	[STATE_SKIP_ROM] = FSM_STATE(Skip_Rom_Rows),
+	[STATE_CONFIG_PRE] = FSM_STATE(Config_Pre_Rows),
+	[STATE_CONFIG_T_ALARM0] = FSM_STATE(Config_T_Alarm0_Rows),
+	[STATE_CONFIG_T_ALARM1] = FSM_STATE(Config_T_Alarm1_Rows),
+	[STATE_CONFIG_RESOLUTION] = FSM_STATE(Config_Resolution_Rows),
+	[STATE_CONVERT_TEMPERATURE] = FSM_STATE(Convert_Temperature_Rows),
+	[STATE_READ_SCRATCHPAD] = FSM_STATE(Read_Scratchpad_Rows),
+	[STATE_ACQUIRING_SCRATCHPAD] = FSM_STATE(Acquiring_Scratchpad_Rows),
+	[STATE_ERROR_FOUND] = FSM_STATE(Error_Found_Rows),
+};
+
+static FSM_T TempSensor_Fsm;
+static uint32_t State_Time_Us[STATE_NUMBER];
+static TEMP_SENSOR_EVENTS_T TempSensor_Events;  // 1ms task only
+static EVENT_QUEUE_T Request_Queue;
 static uint8_t Scratchpad[SCRATCHPAD_SIZE];
 static uint8_t Scratchpad_Read_Index;
+static TEMP_SENSOR_ERROR_T Pending_Error;
+static TEMP_SENSOR_ERROR_COUNTERS_T Error_Counters;
+static TIMER_T Timeout_Timer;
+static TIMER_T Backoff_Timer;   // armed: failing at once, without the bus
+static uint8_t Backoff_Shift;
 
 /**
  * @brief Initialize the module
@@ -75,216 +178,170 @@ void TempSensor__Initialize(void)
 
 	Onewire__Initialize();
 
-	TempSensor_State = STATE_IDLE;
+	Fsm__Initialize(FSM_TEMP_SENSOR, &TempSensor_Fsm, TempSensor_States, STATE_NUMBER, STATE_IDLE,
+					TRACE_SOURCE_TEMP_SENSOR, State_Time_Us);
 	TempSensor_Events.all = 0;
+	Event__InitQueue(&Request_Queue);
 	
 	for (i=0; i<SCRATCHPAD_SIZE; i++)
 	{
 		Scratchpad[i] = 0;
 	}
 	Scratchpad_Read_Index = 0;
+
+	Pending_Error = TEMP_SENSOR_ERROR_NONE;
+	Error_Counters.no_presence = 0;
+	Error_Counters.timeout = 0;
+	Error_Counters.crc = 0;
+	Error_Counters.consecutive = 0;
+	Error_Counters.last_error = TEMP_SENSOR_ERROR_NONE;
+	Timer__Init(&Timeout_Timer, NULL, NULL);
+	Timer__Init(&Backoff_Timer, NULL, NULL);
+	Backoff_Shift = 0;
 }
 
+/**
+ * @brief   Request the configuration of the sensor, if not done yet
+ */
 void TempSensor__Configure(void)
 {
-	if (TempSensor_Events.configured != 1)
-	{
-		TempSensor_Events.configuring = 1;	
-	}
+	Event__Post(&Request_Queue, EVENT_TEMP_SENSOR_CONFIGURE, 0, 0);
 }
 
+/**
+ * @brief   Request a new temperature conversion
+ *
+ * @details The sensor is configured first if needed (e.g. after it has been
+ *          unplugged). While the driver is backing off after a failure the
+ *          request fails at once, without touching the bus. A request made
+ *          while a conversion is ongoing is dropped.
+ *          The requests go through a queue, so the caller and the 1ms
+ *          task never write the same flags. The result is published on the
+ *          bus: EVENT_TEMPERATURE_READY with the temperature in the value,
+ *          in fixed point format Q12.4, or EVENT_TEMPERATURE_ERROR with the
+ *          TEMP_SENSOR_ERROR_T in the argument.
+ */
 void TempSensor__StartAcquisition(void)
 {
-	if (TempSensor_Events.configured == 1 &&
-        IsBusy() == 0)
-    {
-        TempSensor_Events.reading_temp = 1;
-    }
+	Event__Post(&Request_Queue, EVENT_TEMP_SENSOR_START, 0, 0);
 }
 
-/**
- * @brief 	Get the last measured temperature
- *
- * @details The temperature is given in fixed point
- * 			format Q12.4
- *
- * @remarks Call this function in order to start a new conversion
- *
- */
-int16_t TempSensor__GetTemperature(void)
+TEMP_SENSOR_HEALTH_T TempSensor__GetHealth(void)
 {
-	int16_t result;
+	TEMP_SENSOR_HEALTH_T result = TEMP_SENSOR_HEALTH_OK;
 
-	result = Scratchpad[1] << 8;
-	result += Scratchpad[0];
-	TempSensor_Events.temperature_read = 0;
+	if (Error_Counters.consecutive >= TEMP_SENSOR_FAILED_THRESHOLD)
+	{
+		result = TEMP_SENSOR_HEALTH_FAILED;
+	}
+	else if (Error_Counters.consecutive != 0)
+	{
+		result = TEMP_SENSOR_HEALTH_DEGRADED;
+	}
 	return result;
 }
 
-uint8_t TempSensor__IsTemperatureReady(void)
+const TEMP_SENSOR_ERROR_COUNTERS_T* TempSensor__GetErrorCounters(void)
 {
-	uint8_t result = 0;
-    if (TempSensor_Events.temperature_read)
-    {
-        TempSensor_Events.temperature_read = 0;
-        result = 1;
-    }
-	return result;
+	return &Error_Counters;
 }
 
 void TempSensor__1msTask(void)
 {
-	TEMP_SENSOR_STATE_T next_state;
-	
-	next_state = TempSensor_State;
-	uint8_t temp;
-	// todo implementation of a timer for timeout
-	switch(TempSensor_State)
+	uint8_t state = Fsm__GetState(&TempSensor_Fsm);
+
+	TakeRequests();
+
+	if (state != STATE_IDLE &&
+		state != STATE_ERROR_FOUND &&
+		Timer__IsArmed(&Timeout_Timer) == FALSE)
 	{
-		case STATE_IDLE:
+		TempSensor_Events.timeout_expired = 1;
+	}
+
+	if (Onewire__IsIdle())
+	{
+		if (TempSensor_Events.timeout_expired)
 		{
-			if (TempSensor_Events.configuring ||
-				TempSensor_Events.reading_temp)
-			{
-				Onewire__DetectPresence();
-				next_state = STATE_DETECT_PRESENCE;
-			}
-			break;
+			TempSensor_Events.timeout_expired = 0;
+			Pending_Error = TEMP_SENSOR_ERROR_TIMEOUT;
+			Fsm__SetState(&TempSensor_Fsm, STATE_ERROR_FOUND);
 		}
-		case STATE_DETECT_PRESENCE:
-		{
-			next_state = STATE_DETECT_PRESENCE;
+		Fsm__Dispatch(&TempSensor_Fsm, EVENT_BUS_IDLE);
+	}
+}
 
-			if (Onewire__IsIdle())
-			{
-				temp = Onewire__GetPresence();
-				if (temp == ONEWIRE_PRESENCE_OK)
-				{
-					Onewire__WriteByte(SKIP_ROM);
-					next_state = STATE_SKIP_ROM;
-				}
-				else
-				{
-					next_state = STATE_ERROR_FOUND;
-				}
-			}
-			break;
-		}
-		case STATE_SKIP_ROM:
-		{
-			next_state = STATE_SKIP_ROM;
+static void TakeRequests(void)
+{
+	EVENT_RECORD_T request;
 
-			if (Onewire__IsIdle())
-			{
-				if (TempSensor_Events.configuring)
-				{
-                    Onewire__WriteByte(WRITE_SCRATCHPAD);
-                    next_state = STATE_CONFIG_PRE;
-				}
-				else if (TempSensor_Events.reading_temp)
-				{
-					Onewire__WriteByte(CONVERT_T);
-					next_state = STATE_CONVERT_TEMPERATURE;
-				}
-				else if (TempSensor_Events.conversion_finished)
-				{
-				    TempSensor_Events.conversion_finished = 0;
-					Onewire__WriteByte(READ_SCRATCHPAD);
-					next_state = STATE_READ_SCRATCHPAD;
-				}
-			}
-			break;
-		}
-		case STATE_CONVERT_TEMPERATURE:
+	while (Event__Get(&Request_Queue, &request))
+	{
+		if (request.type == EVENT_TEMP_SENSOR_CONFIGURE)
 		{
-			next_state = STATE_CONVERT_TEMPERATURE;
-
-			if (Onewire__IsIdle())
+			if (TempSensor_Events.configured != 1)
 			{
-				if (Onewire__ReadBit())
-				{
-				    TempSensor_Events.conversion_finished = 1;// = EVENT_CONVERSION_FINISHED;
-                    TempSensor_Events.reading_temp = 0;
-                    Onewire__DetectPresence();
-                    next_state = STATE_DETECT_PRESENCE;
-                }
+				TempSensor_Events.configuring = 1;
 			}
-			break;
 		}
-		case STATE_READ_SCRATCHPAD:
+		else if (IsBusy() == 0)
 		{
-			next_state = STATE_READ_SCRATCHPAD;
-
-			if (Onewire__IsIdle())
+			if (Timer__IsArmed(&Backoff_Timer))
 			{
-				Onewire__StartReadByte();
-				next_state = STATE_ACQUIRING_SCRATCHPAD;
+				Event__Publish(EVENT_BUS_1MS, EVENT_TEMPERATURE_ERROR, Error_Counters.last_error, 0);
 			}
-			break;
-		}
-		case STATE_ACQUIRING_SCRATCHPAD:
-		{
-			next_state = STATE_ACQUIRING_SCRATCHPAD;
-
-			if (Scratchpad_Read_Index < SCRATCHPAD_SIZE)
+			else
 			{
-				if (Onewire__IsIdle())
+				if (TempSensor_Events.configured == 0)
 				{
-					Scratchpad[Scratchpad_Read_Index] = Onewire__GetLastByte();
-					Scratchpad_Read_Index++;
-					Onewire__StartReadByte();
+					TempSensor_Events.configuring = 1;
 				}
+				TempSensor_Events.reading_temp = 1;
 			}
-			else
-			{
-			    Scratchpad_Read_Index = 0;
-                TempSensor_Events.reading_temp = 0;
-				TempSensor_Events.temperature_read = 1;
-                next_state = STATE_IDLE;
-			}
-			break;
 		}
-        case STATE_CONFIG_PRE:
-        {
-            if (Onewire__IsIdle())
-            {
-                Onewire__WriteByte(T_ALARM_HIGH);
-                next_state = STATE_CONFIG_T_ALARM0;
-            }
-            break;
-        }
-		case STATE_CONFIG_T_ALARM0:
-		{
-			next_state = STATE_CONFIG_T_ALARM0;
+	}
+}
 
-			if (Onewire__IsIdle())
-			{
-				Onewire__WriteByte(T_ALARM_LOW);
-				next_state = STATE_CONFIG_T_ALARM1;
-			}
+static uint8_t IsBusy(void)
+{
+    if (TempSensor_Events.configuring == 0 && 
+        TempSensor_Events.conversion_finished == 0 &&
+        TempSensor_Events.reading_temp == 0)
+    {
+        return 0;
+    }
+    else
+    {
+        return 1;
+    }
+}
+
+/**
+ * @brief   Abort the ongoing transaction and schedule the next probe
+ *
+ * @details The re-probing delay doubles at each consecutive failure, up to
+ *          TEMP_SENSOR_BACKOFF_MIN_MS << TEMP_SENSOR_BACKOFF_MAX_SHIFT.
+ *          The sensor is configured again at the next acquisition, since
+ *          a power cycle of the probe restores its EEPROM settings.
+ */
+static void HandleError(TEMP_SENSOR_ERROR_T error)
+{
+	Trace__Append(TRACE_SOURCE_TEMP_SENSOR, TRACE_EVENT_ERROR, error);
+	switch (error)
+	{
+		case TEMP_SENSOR_ERROR_NO_PRESENCE:
+		{
+			Error_Counters.no_presence++;
 			break;
 		}
-		case STATE_CONFIG_T_ALARM1:
+		case TEMP_SENSOR_ERROR_TIMEOUT:
 		{
-			next_state = STATE_CONFIG_T_ALARM1;
-
-			if (Onewire__IsIdle())
-			{
-				Onewire__WriteByte(RES_CONFIG);
-				next_state = STATE_CONFIG_RESOLUTION;
-			}
+			Error_Counters.timeout++;
 			break;
 		}
-		case STATE_CONFIG_RESOLUTION:
+		case TEMP_SENSOR_ERROR_CRC:
 		{
-			next_state = STATE_CONFIG_RESOLUTION;
-
-			if (Onewire__IsIdle())
-			{
-                TempSensor_Events.configuring = 0;
-				TempSensor_Events.configured = 1;
-                next_state = STATE_IDLE;
-			}
+			Error_Counters.crc++;
 			break;
 		}
 		default:
@@ -292,20 +349,190 @@ void TempSensor__1msTask(void)
 			break;
 		}
 	}
+	Error_Counters.last_error = error;
+	if (Error_Counters.consecutive != 0xFF)
+	{
+		Error_Counters.consecutive++;
+	}
+
+	Timer__Arm(&Backoff_Timer, TEMP_SENSOR_BACKOFF_MIN_MS << Backoff_Shift, 0);
+	if (Backoff_Shift < TEMP_SENSOR_BACKOFF_MAX_SHIFT)
+	{
+		Backoff_Shift++;
+	}
 
-	TempSensor_State = next_state;
+	Scratchpad_Read_Index = 0;
+	Pending_Error = TEMP_SENSOR_ERROR_NONE;
+	TempSensor_Events.configuring = 0;
+	TempSensor_Events.configured = 0;
+	TempSensor_Events.reading_temp = 0;
+	TempSensor_Events.conversion_finished = 0;
+	TempSensor_Events.timeout_expired = 0;
+	Event__Publish(EVENT_BUS_1MS, EVENT_TEMPERATURE_ERROR, error, 0);
 }
 
-static uint8_t IsBusy(void)
+/**
+ * @brief   Check the Dallas CRC8 of the scratchpad
+ *
+ * @details A scratchpad made only of zeroes has a valid CRC, but it is what
+ *          a bus shorted to ground reads, so it is rejected as well.
+ *          The last byte, the CRC, is taken from the bus here.
+ */
+static BOOL_T IsScratchpadValid(void)
 {
-    if (TempSensor_Events.configuring == 0 && 
-        TempSensor_Events.conversion_finished == 0 &&
-        TempSensor_Events.reading_temp == 0)
-    {
-        return 0;
-    }
-    else
-    {
-        return 1;
-    }
+	uint8_t crc = 0;
+	uint8_t or_all = 0;
+	uint8_t i;
+
+	Scratchpad[SCRATCHPAD_SIZE - 1] = Onewire__GetLastByte();
+	for (i = 0; i < SCRATCHPAD_SIZE - 1; i++)
+	{
+		crc = _crc_ibutton_update(crc, Scratchpad[i]);
+		or_all |= Scratchpad[i];
+	}
+
+	if (crc != Scratchpad[SCRATCHPAD_SIZE - 1] || or_all == 0)
+	{
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL_T IsRequested(void)
+{
+	return (TempSensor_Events.configuring || TempSensor_Events.reading_temp) ? TRUE : FALSE;
+}
+
+/**
+ * @details Consumes the presence sample
+ */
+static BOOL_T IsPresent(void)
+{
+	return (Onewire__GetPresence() == ONEWIRE_PRESENCE_OK) ? TRUE : FALSE;
+}
+
+static BOOL_T IsConfiguring(void)
+{
+	return TempSensor_Events.configuring ? TRUE : FALSE;
+}
+
+static BOOL_T IsReadingTemperature(void)
+{
+	return TempSensor_Events.reading_temp ? TRUE : FALSE;
+}
+
+static BOOL_T IsConversionFinished(void)
+{
+	return TempSensor_Events.conversion_finished ? TRUE : FALSE;
+}
+
+/**
+ * @details Reads a bit: the sensor holds the bus low while converting
+ */
+static BOOL_T IsConversionOver(void)
+{
+	return Onewire__ReadBit() ? TRUE : FALSE;
+}
+
+static BOOL_T IsScratchpadLeft(void)
+{
+	return (Scratchpad_Read_Index < SCRATCHPAD_SIZE - 1) ? TRUE : FALSE;
+}
+
+static void StartPresence(void)
+{
+	Timer__Arm(&Timeout_Timer, TEMP_SENSOR_TIMEOUT_MS, 0);
+	Onewire__DetectPresence();
+}
+
+static void WriteSkipRom(void)
+{
+	Onewire__WriteByte(SKIP_ROM);
+}
+
+/**
+ * @brief   Nobody on the bus: fail now, do not wait for the timeout
+ */
+static void NoPresence(void)
+{
+	Pending_Error = TEMP_SENSOR_ERROR_NO_PRESENCE;
+}
+
+static void WriteScratchpad(void)
+{
+	Onewire__WriteByte(WRITE_SCRATCHPAD);
+}
+
+static void WriteConvert(void)
+{
+	Onewire__WriteByte(CONVERT_T);
+}
+
+static void WriteReadScratchpad(void)
+{
+	TempSensor_Events.conversion_finished = 0;
+	Onewire__WriteByte(READ_SCRATCHPAD);
+}
+
+static void EndConversion(void)
+{
+	TempSensor_Events.conversion_finished = 1;
+	TempSensor_Events.reading_temp = 0;
+	Onewire__DetectPresence();
+}
+
+static void StartScratchpad(void)
+{
+	Scratchpad_Read_Index = 0;
+	Onewire__StartReadByte();
+}
+
+static void ReadNextByte(void)
+{
+	Scratchpad[Scratchpad_Read_Index] = Onewire__GetLastByte();
+	Scratchpad_Read_Index++;
+	Onewire__StartReadByte();
+}
+
+static void AcceptScratchpad(void)
+{
+	Scratchpad_Read_Index = 0;
+	TempSensor_Events.reading_temp = 0;
+	Error_Counters.consecutive = 0;
+	Backoff_Shift = 0;
+	Event__Publish(EVENT_BUS_1MS, EVENT_TEMPERATURE_READY, 0, (int16_t)((Scratchpad[1] << 8) + Scratchpad[0]));
+	Probe__Mark(PROBE_SENSOR_READY, 0);
+}
+
+static void RejectScratchpad(void)
+{
+	Scratchpad_Read_Index = 0;
+	TempSensor_Events.reading_temp = 0;
+	Pending_Error = TEMP_SENSOR_ERROR_CRC;
+}
+
+static void WriteAlarmHigh(void)
+{
+	Onewire__WriteByte(T_ALARM_HIGH);
+}
+
+static void WriteAlarmLow(void)
+{
+	Onewire__WriteByte(T_ALARM_LOW);
+}
+
+static void WriteResolution(void)
+{
+	Onewire__WriteByte(RES_CONFIG);
+}
+
+static void EndConfiguration(void)
+{
+	TempSensor_Events.configuring = 0;
+	TempSensor_Events.configured = 1;
+}
+
+static void Fail(void)
+{
+	HandleError(Pending_Error);
 }
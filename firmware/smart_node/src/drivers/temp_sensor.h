@@ -13,11 +13,35 @@
 
 #define REAL_TO_FIXED_TEMPERATURE(val) (int16_t)(val * 16.0f)
 
+// Consecutive failures after which the sensor is reported as failed
+#define TEMP_SENSOR_FAILED_THRESHOLD 3
+
+typedef enum {
+    TEMP_SENSOR_HEALTH_OK = 0,
+    TEMP_SENSOR_HEALTH_DEGRADED,
+    TEMP_SENSOR_HEALTH_FAILED,
+} TEMP_SENSOR_HEALTH_T;
+
+typedef enum {
+    TEMP_SENSOR_ERROR_NONE = 0,
+    TEMP_SENSOR_ERROR_NO_PRESENCE,
+    TEMP_SENSOR_ERROR_TIMEOUT,
+    TEMP_SENSOR_ERROR_CRC,
+} TEMP_SENSOR_ERROR_T;
+
+typedef struct {
+    uint16_t no_presence;
+    uint16_t timeout;
+    uint16_t crc;
+    uint8_t consecutive;
+    TEMP_SENSOR_ERROR_T last_error;
+} TEMP_SENSOR_ERROR_COUNTERS_T;
+
 void TempSensor__Initialize(void);
 void TempSensor__Configure(void);
 void TempSensor__StartAcquisition(void);
-uint8_t TempSensor__IsTemperatureReady(void);
-int16_t TempSensor__GetTemperature(void);
+TEMP_SENSOR_HEALTH_T TempSensor__GetHealth(void);
+const TEMP_SENSOR_ERROR_COUNTERS_T* TempSensor__GetErrorCounters(void);
 void TempSensor__1msTask(void);
 
 
@@ -1,50 +1,68 @@
 /**
  * @file
  *
+ * @brief	System tick, time base and software timers
+ *
+ * @details	Timer 0 interrupts every millisecond. The tick counts a 32-bit
+ * 			millisecond clock (wraps after 49 days, compare differences),
+ * 			and the counter of the timer gives the microseconds within the
+ * 			millisecond.
+ * 			Software timers are kept in a hierarchical wheel: TIMER_WHEEL_LEVELS
+ * 			levels of 2^TIMER_WHEEL_BITS slots, level n slots being
+ * 			2^(n * TIMER_WHEEL_BITS) ms wide. A timer is linked in the slot
+ * 			of its expiry at the coarsest level that still resolves it, and
+ * 			moves one level down whenever the lower level wraps around. The
+ * 			tick only looks at the current slot of level 0, and cascades one
+ * 			slot every 16 ticks, so its cost does not grow with the number
+ * 			of armed timers: each timer is touched at most once per level.
+ *
  * @date 25/09/2015 23:23:35
  * @author Leonardo Ricupero
- */ 
+ */
 
+#include <stddef.h>
 #include "micro.h"
 #include "timer.h"
 
-// User parameters
-#define TIMER_PRESCALER 	64
-#define TIMER_COMPARE_VALUE 250
-
-#if (TIMER_PRESCALER == 1)
-	#define TIMER_PRESC_SHIFT 0
-#elif (TIMER_PRESCALER == 8)
-	#define TIMER_PRESC_SHIFT 3
-#elif (TIMER_PRESCALER == 64)
-	#define TIMER_PRESC_SHIFT 6
-#elif (TIMER_PRESCALER == 256)
-	#define TIMER_PRESC_SHIFT 8
-#elif (TIMER_PRESCALER == 1024)
-	#define TIMER_PRESC_SHIFT 10
-#else
-	#error "Invalid timer prescaler value!!"
-#endif
+#define TIMER_WHEEL_SLOTS		(1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK		(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_SLOT(expires, level) \
+	(uint8_t)(((expires) >> ((level) * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK)
 
 uint16_t Timer_Counter;
 
-static uint32_t Timer_Frequency;
+static volatile uint32_t Timer_Ms;
+static TIMER_T *Wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+
+static void Link(TIMER_T *timer);
+static void Unlink(TIMER_T *timer);
+static void Cascade(uint8_t level);
 
 
 void Timer__Initialize(void)
 {
+	uint8_t level;
+	uint8_t slot;
+
 	// Mode selection
 	// CTC
 	TCCR0A |= (1 << WGM01) | (0 << WGM00);
 
-	// Top value for CTC mode
-	OCR0A = TIMER_COMPARE_VALUE;
+	// Top value for CTC mode, the period is OCR0A + 1 counts
+	OCR0A = TIMER_COMPARE_VALUE - 1;
 
 	// Interrupt enable
 	TIMSK0 |= (1 << OCIE0A);
 
-	Timer_Frequency = Micro__GetClockFrequency() >> TIMER_PRESC_SHIFT;
 	Timer_Counter = 0;
+	Timer_Ms = 0;
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		for (slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+		{
+			Wheel[level][slot] = NULL;
+		}
+	}
 	Timer__Start();
 
 }
@@ -64,3 +82,208 @@ void Timer__Start(void)
         TCCR0B |= (1  << CS02) | (0 << CS01) | (1 << CS00);
     #endif
 }
+
+/**
+ * @brief	Milliseconds since boot
+ */
+uint32_t Timer__GetMs(void)
+{
+	uint32_t ms;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ms = Timer_Ms;
+	}
+	return ms;
+}
+
+/**
+ * @brief	Microseconds since boot, TIMER_US_PER_COUNT resolution
+ *
+ * @details	Wraps after about 71 minutes, for intervals only. A compare match
+ * 			not served yet is accounted for, so the value never goes back.
+ */
+uint32_t Timer__GetUs(void)
+{
+	uint32_t ms;
+	uint8_t counts;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ms = Timer_Ms;
+		counts = TCNT0;
+		if (TIFR0 & (1 << OCF0A))
+		{
+			// The counter wrapped, the tick is pending
+			ms++;
+			counts = TCNT0;
+		}
+	}
+	return ms * 1000UL + (uint16_t)counts * TIMER_US_PER_COUNT;
+}
+
+/**
+ * @brief	Timestamp in timer counts, TIMER_US_PER_COUNT each
+ *
+ * @details	Wraps after 2^16 counts, for intervals shorter than that only.
+ * 			Cheaper than Timer__GetUs, for the trace records.
+ */
+uint16_t Timer__GetCounts(void)
+{
+	uint16_t ms;
+	uint8_t counts;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ms = (uint16_t)Timer_Ms;
+		counts = TCNT0;
+		if (TIFR0 & (1 << OCF0A))
+		{
+			ms++;
+			counts = TCNT0;
+		}
+	}
+	return ms * TIMER_COMPARE_VALUE + counts;
+}
+
+/**
+ * @brief	Prepare a timer, before any other use
+ *
+ * @details	Without a callback the timer is a timeout, polled with
+ * 			Timer__IsArmed
+ */
+void Timer__Init(TIMER_T *timer, TIMER_CALLBACK_T callback, void *context)
+{
+	timer->next = NULL;
+	timer->pprev = NULL;
+	timer->period_ms = 0;
+	timer->callback = callback;
+	timer->context = context;
+}
+
+/**
+ * @brief	Start or restart a timer
+ *
+ * @param	delay_ms	to the first expiry, 0 is taken as 1
+ * @param	period_ms	between the next ones, 0 for a one shot timer
+ */
+void Timer__Arm(TIMER_T *timer, uint16_t delay_ms, uint16_t period_ms)
+{
+	if (delay_ms == 0)
+	{
+		delay_ms = 1;
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (timer->pprev != NULL)
+		{
+			Unlink(timer);
+		}
+		timer->expires = Timer_Ms + delay_ms;
+		timer->period_ms = period_ms;
+		Link(timer);
+	}
+}
+
+void Timer__Disarm(TIMER_T *timer)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (timer->pprev != NULL)
+		{
+			Unlink(timer);
+		}
+	}
+}
+
+BOOL_T Timer__IsArmed(const TIMER_T *timer)
+{
+	return (timer->pprev != NULL) ? TRUE : FALSE;
+}
+
+/**
+ * @brief	Advance the clock and run the expired timers
+ *
+ * @details	First thing in the timer ISR, so the timestamps taken by the
+ * 			other tasks are up to date
+ */
+void Timer__1msTask(void)
+{
+	TIMER_T *timer;
+	TIMER_T **slot;
+	uint8_t level;
+
+	Timer_Ms++;
+
+	// Bring the timers of the next coarser slots one level down
+	for (level = 1; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		if (TIMER_SLOT(Timer_Ms, level - 1) != 0)
+		{
+			break;
+		}
+		Cascade(level);
+	}
+
+	// Timers armed by the callbacks expire later, never in this slot
+	slot = &Wheel[0][TIMER_SLOT(Timer_Ms, 0)];
+	while ((timer = *slot) != NULL)
+	{
+		Unlink(timer);
+		if (timer->period_ms != 0)
+		{
+			timer->expires += timer->period_ms;
+			Link(timer);
+		}
+		if (timer->callback != NULL)
+		{
+			timer->callback(timer->context);
+		}
+	}
+}
+
+static void Link(TIMER_T *timer)
+{
+	uint32_t delta = timer->expires - Timer_Ms;
+	uint8_t level = 0;
+	TIMER_T **slot;
+
+	while (level < TIMER_WHEEL_LEVELS - 1 &&
+		   delta >= ((uint32_t)1 << ((level + 1) * TIMER_WHEEL_BITS)))
+	{
+		level++;
+	}
+
+	slot = &Wheel[level][TIMER_SLOT(timer->expires, level)];
+	timer->next = *slot;
+	if (timer->next != NULL)
+	{
+		timer->next->pprev = &timer->next;
+	}
+	timer->pprev = slot;
+	*slot = timer;
+}
+
+static void Unlink(TIMER_T *timer)
+{
+	*timer->pprev = timer->next;
+	if (timer->next != NULL)
+	{
+		timer->next->pprev = timer->pprev;
+	}
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+static void Cascade(uint8_t level)
+{
+	TIMER_T **slot = &Wheel[level][TIMER_SLOT(Timer_Ms, level)];
+	TIMER_T *timer;
+
+	while ((timer = *slot) != NULL)
+	{
+		Unlink(timer);
+		Link(timer);
+	}
+}
@@ -3,7 +3,7 @@
  *
  * @date 25/09/2015 23:23:52
  * @author Leonardo Ricupero
- */ 
+ */
 
 
 #ifndef TIMER_H_
@@ -11,6 +11,51 @@
 
 #include "micro.h"
 
+// User parameters
+#define TIMER_PRESCALER 	64
+#define TIMER_COMPARE_VALUE 250 // counts per tick
+
+#if (TIMER_PRESCALER == 1)
+	#define TIMER_PRESC_SHIFT 0
+#elif (TIMER_PRESCALER == 8)
+	#define TIMER_PRESC_SHIFT 3
+#elif (TIMER_PRESCALER == 64)
+	#define TIMER_PRESC_SHIFT 6
+#elif (TIMER_PRESCALER == 256)
+	#define TIMER_PRESC_SHIFT 8
+#elif (TIMER_PRESCALER == 1024)
+	#define TIMER_PRESC_SHIFT 10
+#else
+	#error "Invalid timer prescaler value!!"
+#endif
+
+#define TIMER_FREQUENCY_HZ		(F_CPU >> TIMER_PRESC_SHIFT)
+#define TIMER_US_PER_COUNT		(1000000UL / TIMER_FREQUENCY_HZ)
+
+#if (TIMER_FREQUENCY_HZ != TIMER_COMPARE_VALUE * 1000UL) || (1000000UL % TIMER_FREQUENCY_HZ != 0)
+	#error "The timer does not tick every millisecond!!"
+#endif
+
+#define TIMER_WHEEL_BITS	4	// 16 slots per level
+#define TIMER_WHEEL_LEVELS	4	// delays up to 2^16 - 1 ms
+
+typedef void (*TIMER_CALLBACK_T)(void *context);
+
+/**
+ * Software timer, owned by the caller and linked in the wheel while armed.
+ * The callback runs from the 1ms tick, in the timer ISR with the interrupts
+ * enabled: keep it short. It may start or stop any timer. A timer without
+ * callback is over once Timer__IsArmed returns FALSE.
+ */
+typedef struct TIMER_S {
+	struct TIMER_S *next;
+	struct TIMER_S **pprev;	// NULL when not armed
+	uint32_t expires;		// Timer__GetMs() value
+	uint16_t period_ms;		// 0 for a one shot timer
+	TIMER_CALLBACK_T callback;
+	void *context;
+} TIMER_T;
+
 extern uint16_t Timer_Counter;
 
 #define Timer__Stop() {TCCR0B &= 0b11111000;}
@@ -19,6 +64,14 @@ extern uint16_t Timer_Counter;
 
 void Timer__Initialize(void);
 void Timer__Start(void);
+uint32_t Timer__GetMs(void);
+uint32_t Timer__GetUs(void);
+uint16_t Timer__GetCounts(void);
+void Timer__Init(TIMER_T *timer, TIMER_CALLBACK_T callback, void *context);
+void Timer__Arm(TIMER_T *timer, uint16_t delay_ms, uint16_t period_ms);
+void Timer__Disarm(TIMER_T *timer);
+BOOL_T Timer__IsArmed(const TIMER_T *timer);
+void Timer__1msTask(void);
 
 
 #endif /* TIMER_H_ */
@@ -0,0 +1,236 @@
+/**
+ * @file trace.c
+ *
+ * @brief Binary event trace of the drivers
+ *
+ * @details The state machines and the ISRs append 4-byte records to a RAM
+ *          ring: a timestamp in timer counts, the source and the event in
+ *          one byte, and an argument. Appending only masks the interrupts
+ *          for the few cycles it takes to fill the record and bump the
+ *          single byte write index, so it may be called from any ISR and
+ *          is cheap enough to be always compiled in.
+ *          The 16-bit timestamp wraps after 262ms: after a longer silence a
+ *          TRACE_EVENT_GAP record comes first, with the time elapsed, so
+ *          the timeline can be rebuilt.
+ *          The ring is not cleared at reset. After a watchdog or brown-out
+ *          reset the previous trace is kept, and dumped at boot, so the
+ *          events that led to the fault can be seen. Trace__Fault freezes
+ *          the ring and dumps it the same way.
+ *          The dump is TRACE_DUMP_TAG, the number of records, then the
+ *          records from the oldest one: time (2 bytes, big endian), code
+ *          and argument. Recording is suspended meanwhile.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "usart.h"
+#include "timer.h"
+#include "trace.h"
+
+#define TRACE_MASK          (TRACE_RECORDS - 1)
+#define TRACE_MAGIC         0x7ACE
+#define TRACE_GAP_MS        200     // well before the timestamp wraps
+#define TRACE_GAP_UNIT_MS   100
+
+#if (TRACE_RECORDS & TRACE_MASK) != 0 || TRACE_RECORDS > 128
+    #error "TRACE_RECORDS must be a power of two, up to 128!!"
+#endif
+
+typedef enum {
+    DUMP_IDLE = 0,
+    DUMP_PENDING,   // frozen, waiting for the line
+    DUMP_HEADER,
+    DUMP_RECORDS,
+} TRACE_DUMP_STATE_T;
+
+// Kept across a reset that is not a power-on
+static TRACE_RECORD_T Ring[TRACE_RECORDS] __attribute__((section(".noinit")));
+static uint8_t Write_Idx __attribute__((section(".noinit")));
+static uint8_t Count __attribute__((section(".noinit")));
+static uint16_t Magic __attribute__((section(".noinit")));
+
+static uint32_t Last_Ms;
+static volatile TRACE_DUMP_STATE_T Dump_State;
+static uint8_t Dump_Idx;
+static uint8_t Dump_Left;
+
+static void Put(uint8_t code, uint8_t arg);
+static void Store(uint8_t code, uint8_t arg);
+
+/**
+ * @brief   Start the trace, before the interrupts are enabled
+ *
+ * @details Read the reset flags: after a watchdog or brown-out reset the
+ *          trace of the previous run is kept and dumped
+ */
+void Trace__Initialize(void)
+{
+    uint8_t reset_flags = MCUSR;
+
+    MCUSR = 0;
+    Dump_State = DUMP_IDLE;
+
+    if (Magic != TRACE_MAGIC || Count > TRACE_RECORDS || (reset_flags & (1 << PORF)))
+    {
+        Write_Idx = 0;
+        Count = 0;
+        Magic = TRACE_MAGIC;
+    }
+    else if (reset_flags & ((1 << WDRF) | (1 << BORF)))
+    {
+        Dump_State = DUMP_PENDING;
+    }
+
+    // The clock starts again from 0, the boot record begins a new timeline
+    Last_Ms = Timer__GetMs();
+    Put(TRACE_CODE(TRACE_SOURCE_TRACE, TRACE_EVENT_BOOT), reset_flags);
+}
+
+/**
+ * @brief   Append a record, use Trace__Append
+ *
+ * @details From the main loop or any ISR. Dropped while the ring is frozen.
+ */
+void Trace__Record(uint8_t code, uint8_t arg)
+{
+    uint8_t sreg = SREG;
+
+    cli();
+    if (Dump_State == DUMP_IDLE)
+    {
+        Put(code, arg);
+    }
+    SREG = sreg;
+}
+
+/**
+ * @brief   Record a fault, then freeze the ring and dump it
+ *
+ * @details The dump starts when the USART is free
+ */
+void Trace__Fault(TRACE_SOURCE_T source, uint8_t arg)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (Dump_State == DUMP_IDLE)
+        {
+            Put(TRACE_CODE(source, TRACE_EVENT_FAULT), arg);
+            Dump_State = DUMP_PENDING;
+        }
+    }
+}
+
+/**
+ * @brief   Freeze the ring and dump it
+ *
+ * @return  FALSE if a dump is in progress
+ */
+BOOL_T Trace__StartDump(void)
+{
+    BOOL_T started = FALSE;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (Dump_State == DUMP_IDLE)
+        {
+            Dump_State = DUMP_PENDING;
+            started = TRUE;
+        }
+    }
+    return started;
+}
+
+BOOL_T Trace__IsDumping(void)
+{
+    return (Dump_State != DUMP_IDLE) ? TRUE : FALSE;
+}
+
+/**
+ * @brief   Dump
+ *
+ * @details Call it from the main loop, only while no one else is streaming
+ *          on the USART: a pending dump waits
+ */
+void Trace__FastTask(void)
+{
+    const TRACE_RECORD_T *record;
+
+    switch (Dump_State)
+    {
+        case DUMP_PENDING:
+        {
+            Dump_Left = Count;
+            Dump_Idx = (uint8_t)(Write_Idx - Count);
+            Dump_State = DUMP_HEADER;
+            break;
+        }
+        case DUMP_HEADER:
+        {
+            if (Usart__GetTxFreeSpace() >= 2)
+            {
+                Usart__PutChar(TRACE_DUMP_TAG);
+                Usart__PutChar(Dump_Left);
+                Dump_State = DUMP_RECORDS;
+            }
+            break;
+        }
+        case DUMP_RECORDS:
+        {
+            while (Dump_Left != 0 && Usart__GetTxFreeSpace() >= sizeof(TRACE_RECORD_T))
+            {
+                record = &Ring[Dump_Idx & TRACE_MASK];
+                Usart__PutChar((uint8_t)(record->time >> 8));
+                Usart__PutChar((uint8_t)record->time);
+                Usart__PutChar(record->code);
+                Usart__PutChar(record->arg);
+                Dump_Idx++;
+                Dump_Left--;
+            }
+            if (Dump_Left == 0)
+            {
+                // The trace goes on from the records dumped
+                Dump_State = DUMP_IDLE;
+            }
+            break;
+        }
+        case DUMP_IDLE:
+        default:
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @details Called with interrupts disabled
+ */
+static void Put(uint8_t code, uint8_t arg)
+{
+    uint32_t ms = Timer__GetMs();
+    uint32_t gap = ms - Last_Ms;
+
+    Last_Ms = ms;
+    if (gap >= TRACE_GAP_MS)
+    {
+        gap /= TRACE_GAP_UNIT_MS;
+        Store(TRACE_CODE(TRACE_SOURCE_TRACE, TRACE_EVENT_GAP), (gap > 0xFF) ? 0xFF : (uint8_t)gap);
+    }
+    Store(code, arg);
+}
+
+static void Store(uint8_t code, uint8_t arg)
+{
+    TRACE_RECORD_T *record;
+
+    record = &Ring[Write_Idx & TRACE_MASK];
+    record->time = Timer__GetCounts();
+    record->code = code;
+    record->arg = arg;
+    Write_Idx++;
+    if (Count < TRACE_RECORDS)
+    {
+        Count++;
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * @file trace.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "micro.h"
+
+#ifndef TRACE_RECORDS
+    #define TRACE_RECORDS   32  // power of two, up to 128
+#endif
+
+#define TRACE_DUMP_TAG      'T'
+
+typedef enum {
+    TRACE_SOURCE_TRACE = 0,
+    TRACE_SOURCE_ONEWIRE,
+    TRACE_SOURCE_TEMP_SENSOR,
+    TRACE_SOURCE_RELAYS,
+    TRACE_SOURCE_EXT_EEPROM,
+    TRACE_SOURCE_RADIO,
+    TRACE_SOURCE_USART,
+    TRACE_SOURCE_THERMOSTAT,
+    TRACE_SOURCE_COMMAND,
+    TRACE_SOURCE_CRITICAL,  // section over budget, the argument is the site
+    TRACE_SOURCE_MEMORY,    // stack too deep, the argument is the free RAM left
+    TRACE_SOURCE_EVENT,     // event lost on a full queue, the argument is its type
+} TRACE_SOURCE_T;   // up to 16
+
+typedef enum {
+    TRACE_EVENT_STATE = 0,  // new state
+    TRACE_EVENT_ISR,        // ISR entry, source specific argument
+    TRACE_EVENT_PUT,        // item queued
+    TRACE_EVENT_GET,        // item taken from the queue
+    TRACE_EVENT_BEGIN,      // operation started
+    TRACE_EVENT_END,        // operation over
+    TRACE_EVENT_ERROR,      // error code
+    TRACE_EVENT_FAULT,      // the ring is frozen after this record
+    TRACE_EVENT_BOOT,       // MCUSR reset flags
+    TRACE_EVENT_GAP,        // no record for the argument times 100ms, 255 or more
+} TRACE_EVENT_T;    // up to 16
+
+/**
+ * One record, 4 bytes
+ */
+typedef struct {
+    uint16_t time;  // timer counts, 4us, wraps after 262ms
+    uint8_t code;   // source in the high nibble, event in the low one
+    uint8_t arg;
+} TRACE_RECORD_T;
+
+#define TRACE_CODE(source, event)   (uint8_t)(((source) << 4) | (event))
+
+#ifdef TRACE_DISABLED
+    #define Trace__Append(source, event, arg)
+#else
+    #define Trace__Append(source, event, arg) \
+        Trace__Record(TRACE_CODE(source, event), (uint8_t)(arg))
+#endif
+
+void Trace__Initialize(void);
+void Trace__Record(uint8_t code, uint8_t arg);
+void Trace__Fault(TRACE_SOURCE_T source, uint8_t arg);
+BOOL_T Trace__StartDump(void);
+BOOL_T Trace__IsDumping(void);
+void Trace__FastTask(void);
+
+#endif /* TRACE_H_ */
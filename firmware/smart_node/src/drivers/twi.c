@@ -0,0 +1,211 @@
+/**
+ * @file twi.c
+ *
+ * @brief Interrupt driven TWI (I2C) master
+ *
+ * @details One transfer at a time, every bus event is handled in the
+ *          TWI ISR, so the caller never waits for the bus. The end of the
+ *          transfer is notified through the callback of the transfer.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "critical.h"
+#include "twi.h"
+
+// User parameters
+#define TWI_BITRATE 400000UL
+
+#define TWI_BITRATE_REGISTER ((F_CPU / TWI_BITRATE - 16) / 2) // prescaler 1
+
+// Status codes, master transmitter and receiver
+#define TWI_STATUS_MASK         0xF8
+#define TWI_START               0x08
+#define TWI_REP_START           0x10
+#define TWI_MT_SLA_ACK          0x18
+#define TWI_MT_SLA_NACK         0x20
+#define TWI_MT_DATA_ACK         0x28
+#define TWI_MT_DATA_NACK        0x30
+#define TWI_ARB_LOST            0x38
+#define TWI_MR_SLA_ACK          0x40
+#define TWI_MR_SLA_NACK         0x48
+#define TWI_MR_DATA_ACK         0x50
+#define TWI_MR_DATA_NACK        0x58
+
+#define TWI__SEND_START()   {Micro__Write(TWCR, (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE));}
+#define TWI__SEND_STOP()    {Micro__Write(TWCR, (1 << TWINT) | (1 << TWSTO) | (1 << TWEN));}
+#define TWI__CONTINUE()     {Micro__Write(TWCR, (1 << TWINT) | (1 << TWEN) | (1 << TWIE));}
+#define TWI__CONTINUE_ACK() {Micro__Write(TWCR, (1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE));}
+
+#define TWI_READ_BIT 1
+
+static void Finish(TWI_RESULT_T result);
+
+static TWI_TRANSFER_T Transfer;
+static volatile BOOL_T Busy;
+static uint8_t Header_Idx;
+static uint16_t Data_Idx;
+static uint8_t Reading; // the repeated start for the read phase has been sent
+
+void Twi__Initialize(void)
+{
+    PRR &= ~(1 << PRTWI);
+
+    // Internal pull-ups, external ones are mounted anyway
+    PORTC |= (1 << PC4) | (1 << PC5);
+
+    TWSR = 0; // prescaler 1
+    TWBR = (uint8_t)TWI_BITRATE_REGISTER;
+    Micro__Write(TWCR, (1 << TWEN));
+
+    Busy = FALSE;
+}
+
+/**
+ * @brief   Start a transfer
+ *
+ * @details The transfer descriptor is copied, the header and data buffers
+ *          must stay valid until the callback is called
+ *
+ * @return  FALSE if another transfer is in progress
+ */
+BOOL_T Twi__Start(const TWI_TRANSFER_T *transfer)
+{
+    BOOL_T result = FALSE;
+
+    CRITICAL_BLOCK(CRITICAL_SITE_TWI)
+    {
+        if (Busy == FALSE)
+        {
+            Transfer = *transfer;
+            if (Transfer.length == 0)
+            {
+                Transfer.read = 0;
+            }
+            Header_Idx = 0;
+            Data_Idx = 0;
+            Reading = 0;
+            Busy = TRUE;
+            result = TRUE;
+        }
+    }
+
+    if (result == TRUE)
+    {
+        // The stop condition of the previous transfer takes a few cycles
+        while (TWCR & (1 << TWSTO))
+        {
+            Micro__BusyWait();
+        }
+        TWI__SEND_START();
+    }
+
+    return result;
+}
+
+BOOL_T Twi__IsIdle(void)
+{
+    return (Busy == FALSE) ? TRUE : FALSE;
+}
+
+static void Finish(TWI_RESULT_T result)
+{
+    TWI__SEND_STOP();
+    Busy = FALSE;
+    if (Transfer.callback != NULL)
+    {
+        Transfer.callback(result);
+    }
+}
+
+/**
+ * TWI ISR
+ *
+ */
+ISR(TWI_vect)
+{
+    switch (TWSR & TWI_STATUS_MASK)
+    {
+        case TWI_START:
+        case TWI_REP_START:
+        {
+            TWDR = (Transfer.address << 1) | (Reading ? TWI_READ_BIT : 0);
+            TWI__CONTINUE();
+            break;
+        }
+        case TWI_MT_SLA_ACK:
+        case TWI_MT_DATA_ACK:
+        {
+            if (Header_Idx < Transfer.header_length)
+            {
+                TWDR = Transfer.header[Header_Idx];
+                Header_Idx++;
+                TWI__CONTINUE();
+            }
+            else if (Transfer.read)
+            {
+                Reading = 1;
+                TWI__SEND_START();
+            }
+            else if (Data_Idx < Transfer.length)
+            {
+                TWDR = Transfer.data[Data_Idx];
+                Data_Idx++;
+                TWI__CONTINUE();
+            }
+            else
+            {
+                Finish(TWI_RESULT_OK);
+            }
+            break;
+        }
+        case TWI_MT_SLA_NACK:
+        case TWI_MR_SLA_NACK:
+        {
+            Finish(TWI_RESULT_NACK);
+            break;
+        }
+        case TWI_MR_SLA_ACK:
+        {
+            // NACK the last byte to tell the slave to release the bus
+            if (Transfer.length > 1)
+            {
+                TWI__CONTINUE_ACK();
+            }
+            else
+            {
+                TWI__CONTINUE();
+            }
+            break;
+        }
+        case TWI_MR_DATA_ACK:
+        {
+            Transfer.data[Data_Idx] = TWDR;
+            Data_Idx++;
+            if (Data_Idx < Transfer.length - 1)
+            {
+                TWI__CONTINUE_ACK();
+            }
+            else
+            {
+                TWI__CONTINUE();
+            }
+            break;
+        }
+        case TWI_MR_DATA_NACK:
+        {
+            Transfer.data[Data_Idx] = TWDR;
+            Finish(TWI_RESULT_OK);
+            break;
+        }
+        case TWI_MT_DATA_NACK:
+        case TWI_ARB_LOST:
+        default:
+        {
+            Finish(TWI_RESULT_ERROR);
+            break;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/**
+ * @file twi.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef TWI_H_
+#define TWI_H_
+
+#include "micro.h"
+
+typedef enum {
+    TWI_RESULT_OK = 0,
+    TWI_RESULT_NACK,    // the slave did not acknowledge its address
+    TWI_RESULT_ERROR,
+} TWI_RESULT_T;
+
+/**
+ * Called from the TWI ISR at the end of a transfer
+ */
+typedef void (*TWI_CALLBACK_T)(TWI_RESULT_T result);
+
+/**
+ * A transfer writes the header, then either writes or reads the data.
+ * A read is done with a repeated start after the header.
+ * A transfer with no header and no data only checks if the slave answers.
+ */
+typedef struct {
+    const uint8_t *header;
+    uint8_t *data;
+    uint16_t length;
+    uint8_t header_length;
+    uint8_t address;    // 7 bit slave address
+    uint8_t read;
+    TWI_CALLBACK_T callback;
+} TWI_TRANSFER_T;
+
+void Twi__Initialize(void);
+BOOL_T Twi__Start(const TWI_TRANSFER_T *transfer);
+BOOL_T Twi__IsIdle(void);
+
+#endif /* TWI_H_ */
@@ -6,18 +6,23 @@
  */ 
 
 #include "micro.h"
+#include "trace.h"
 #include "usart.h"
 
 #define BAUD_PRESCALE (uint16_t) ((F_CPU / (16.0f * USART_BAUDRATE)) -1)
 
-#define TX_BUFFER_SIZE 16
-#define RX_BUFFER_SIZE 16
+#define TX_BUFFER_SIZE 64 // must be a power of 2
+#define TX_BUFFER_MASK (TX_BUFFER_SIZE - 1)
+#define RX_BUFFER_SIZE 64 // must be a power of 2
+#define RX_BUFFER_MASK (RX_BUFFER_SIZE - 1)
 
 static uint8_t Tx_Buffer[TX_BUFFER_SIZE];
 static uint8_t Rx_Buffer[RX_BUFFER_SIZE];
 
-static uint8_t Tx_Idx;
-static uint8_t Rx_Idx;
+static volatile uint8_t Tx_Head; // next byte to write
+static volatile uint8_t Tx_Tail; // next byte to send
+static volatile uint8_t Rx_Head; // next byte to receive
+static volatile uint8_t Rx_Tail; // next byte to read
 
 /**
  * \brief Initializes the USART
@@ -43,38 +48,59 @@ void Usart__Initialize(void)
     UCSR0B |= (1 << RXEN0) | (1 << TXEN0);
 
     // Buffers initialization
-    Tx_Idx = 0;
-    Rx_Idx = 0;
+    Tx_Head = 0;
+    Tx_Tail = 0;
+    Rx_Head = 0;
+    Rx_Tail = 0;
 }
 
+/**
+ * \brief Get the oldest received byte
+ *
+ * \details Returns 0 if the buffer is empty, check Usart__IsRxBufferEmpty
+ *          first
+ */
 uint8_t Usart__GetChar(void)
 {
     uint8_t c = 0;
 
-    c = Rx_Buffer[Rx_Idx];
-    if (Rx_Idx >= 0)
+    if (Rx_Head != Rx_Tail)
     {
-        Rx_Idx--;
+        c = Rx_Buffer[Rx_Tail];
+        Rx_Tail = (Rx_Tail + 1) & RX_BUFFER_MASK;
     }
 
     return c;
 }
 
+/**
+ * \brief Queue a byte for transmission
+ *
+ * \details The byte is dropped if the buffer is full, check
+ *          Usart__GetTxFreeSpace before queueing a whole frame
+ */
 void Usart__PutChar(uint8_t c)
 {
-    if (Tx_Idx >= TX_BUFFER_SIZE - 1)
+    uint8_t next_head;
+
+    next_head = (Tx_Head + 1) & TX_BUFFER_MASK;
+    if (next_head != Tx_Tail)
     {
-        Tx_Idx = 0;
+        Tx_Buffer[Tx_Head] = c;
+        Tx_Head = next_head;
     }
-    Tx_Buffer[Tx_Idx] = c;
-    Tx_Idx++;
+}
+
+uint8_t Usart__GetTxFreeSpace(void)
+{
+    return (Tx_Tail - Tx_Head - 1) & TX_BUFFER_MASK;
 }
 
 BOOL_T Usart__IsRxBufferEmpty(void)
 {
     uint8_t res = TRUE;
 
-    if (Rx_Idx != 0)
+    if (Rx_Head != Rx_Tail)
     {
         res = FALSE;
     }
@@ -86,7 +112,7 @@ BOOL_T Usart__IsTxBufferEmpty(void)
 {
     uint8_t res = TRUE;
 
-    if (Tx_Idx != 0)
+    if (Tx_Head != Tx_Tail)
     {
         res = FALSE;
     }
@@ -94,27 +120,35 @@ BOOL_T Usart__IsTxBufferEmpty(void)
     return res;
 }
 
+/**
+ * \brief Receive ISR, the byte is dropped if the buffer is full
+ */
 ISR(USART_RX_vect)
 {
-    Rx_Buffer[Rx_Idx] = UDR0;
-    if (Rx_Idx < RX_BUFFER_SIZE)
+    uint8_t c;
+    uint8_t next_head;
+
+    c = UDR0;
+    next_head = (Rx_Head + 1) & RX_BUFFER_MASK;
+    if (next_head != Rx_Tail)
     {
-        Rx_Idx++;
+        Rx_Buffer[Rx_Head] = c;
+        Rx_Head = next_head;
     }
     else
     {
-        Rx_Idx = 0;
+        Trace__Append(TRACE_SOURCE_USART, TRACE_EVENT_ERROR, c);
     }
 }
 
 void Usart__FastTask(void)
 {
-    if (Tx_Idx > 0)
+    if (Tx_Head != Tx_Tail)
     {
-        if ((UCSR0A & (1<<UDRE0)) == 1)
+        if (UCSR0A & (1<<UDRE0))
         {
-            Tx_Idx--;
-            UDR0 = Tx_Buffer[Tx_Idx];
+            Micro__Write(UDR0, Tx_Buffer[Tx_Tail]);
+            Tx_Tail = (Tx_Tail + 1) & TX_BUFFER_MASK;
         }
     }
 }
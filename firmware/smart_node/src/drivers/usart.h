@@ -16,6 +16,7 @@
 void Usart__Initialize(void);
 uint8_t Usart__GetChar(void);
 void Usart__PutChar(uint8_t c);
+uint8_t Usart__GetTxFreeSpace(void);
 BOOL_T Usart__IsRxBufferEmpty(void);
 BOOL_T Usart__IsTxBufferEmpty(void);
 void Usart__FastTask(void);
@@ -0,0 +1,814 @@
+/**
+ * @file host.c
+ *
+ * @brief Core of the host backend: registers, virtual time, interrupts
+ *
+ * @details The time only moves in Host__Delay and Host__Idle, in steps
+ *          that end at the next peripheral event. After each step the
+ *          models process their events, the pins are sampled and the
+ *          pending interrupts dispatched. A peripheral sees the registers
+ *          written by the code at the next step, except for the strobes
+ *          that go through Host__Write.
+ *          An idle main loop, with no register written and no interrupt
+ *          since the last pass, jumps to the next event. Otherwise one pass
+ *          takes HOST_LOOP_CYCLES.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "host.h"
+
+#define HOST_F_CPU                  16000000ULL
+#define HOST_CYCLES_PER_MS          (HOST_F_CPU / 1000)
+
+#define HOST_LOOP_CYCLES            160     // one pass of a busy main loop
+#define HOST_BUSY_WAIT_CYCLES       8       // one poll of a register
+
+#define HOST_EEPROM_SIZE            (E2END + 1)
+#define HOST_EEPROM_WRITE_CYCLES    54400   // 3.4ms erase and write
+#define HOST_EEPROM_HALF_CYCLES     28800   // 1.8ms erase or write only
+
+#define HOST_ADC_FIRST_CLOCKS       25
+#define HOST_ADC_CLOCKS             13
+#define HOST_ADC_TRIGGER_FREE       0
+#define HOST_ADC_TRIGGER_TIMER0     3
+#define HOST_ADC_MIDSCALE           512
+
+#define HOST_USART_FRAME_BITS       10
+
+typedef void (*HOST_VECTOR_T)(void);
+
+typedef struct {
+    uint64_t base;          // cycle of the last counter clock
+} HOST_TIMER_T;
+
+volatile uint8_t Host__Io[HOST_IO_SIZE] __attribute__((aligned(2)));
+uint8_t Host__Ram[HOST_RAM_SIZE];
+
+// The vectors the firmware does not define stay NULL
+void INT0_vect(void) __attribute__((weak));
+void TIMER1_COMPA_vect(void) __attribute__((weak));
+void TIMER0_COMPA_vect(void) __attribute__((weak));
+void SPI_STC_vect(void) __attribute__((weak));
+void USART_RX_vect(void) __attribute__((weak));
+void ADC_vect(void) __attribute__((weak));
+void EE_READY_vect(void) __attribute__((weak));
+void TWI_vect(void) __attribute__((weak));
+
+static const uint16_t Timer_Prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+static const uint8_t Adc_Prescalers[8] = {2, 2, 4, 8, 16, 32, 64, 128};
+static const uint8_t Spi_Prescalers[4] = {4, 16, 64, 128};
+
+static uint64_t Now;
+static uint64_t Next_Due;
+static uint64_t Run_Until;
+static volatile sig_atomic_t Stop_Requested;
+static uint8_t Activity;
+
+static HOST_TIMER_T Timer0;
+static HOST_TIMER_T Timer1;
+
+static uint8_t Eeprom[HOST_EEPROM_SIZE];
+static uint64_t Eeprom_Due;
+
+static uint64_t Adc_Due;
+static uint8_t Adc_Channel;
+static uint8_t Adc_First;
+
+static uint64_t Spi_Due;
+static uint8_t Spi_Out;
+
+static uint64_t Tx_Due;
+static uint8_t Tx_Shift;
+static uint8_t Tx_Buffer;
+static uint8_t Tx_Buffered;
+static uint8_t Tx_Pending_Flush;
+static uint64_t Rx_Due;
+static uint8_t Rx_Closed;
+
+static struct timespec Wall_Start;
+static uint64_t Interrupts;
+static uint64_t Loops;
+
+static void Update(void);
+static uint8_t Dispatch(void);
+
+/*
+ * Timers, CTC or normal mode
+ */
+
+/*
+ * Counts to the next compare match. The flag is set on the count that
+ * follows the match, when the counter is cleared in CTC mode.
+ */
+static uint32_t CountsToMatch(uint32_t counter, uint32_t compare, uint32_t top, uint32_t max)
+{
+    if (counter > top)
+    {
+        top = max;
+    }
+    if (counter <= compare)
+    {
+        return compare - counter + 1;
+    }
+    return (top - counter + 1) + compare + 1;
+}
+
+static uint64_t TimerDue(const HOST_TIMER_T *timer, uint8_t clock_select,
+                         uint32_t counter, uint32_t compare, uint32_t top, uint32_t max)
+{
+    uint16_t prescaler = Timer_Prescalers[clock_select & 0x07];
+
+    if (prescaler == 0)
+    {
+        return HOST_NEVER;
+    }
+    return timer->base + (uint64_t)CountsToMatch(counter, compare, top, max) * prescaler;
+}
+
+/**
+ * @return  1 on a compare match. The steps end at the events, there is
+ *          at most one match per call.
+ */
+static uint8_t TimerStep(HOST_TIMER_T *timer, uint8_t clock_select,
+                         uint32_t *counter, uint32_t compare, uint32_t top, uint32_t max)
+{
+    uint16_t prescaler = Timer_Prescalers[clock_select & 0x07];
+    uint32_t to_match;
+    uint64_t counts;
+    uint8_t match = 0;
+
+    if (prescaler == 0)
+    {
+        timer->base = Now;
+        return 0;
+    }
+
+    counts = (Now - timer->base) / prescaler;
+    timer->base += counts * prescaler;
+    if (counts == 0)
+    {
+        return 0;
+    }
+
+    to_match = CountsToMatch(*counter, compare, top, max);
+    if (counts >= to_match)
+    {
+        match = 1;
+    }
+    if (*counter > top)
+    {
+        top = max;
+    }
+    *counter = (uint32_t)((*counter + counts) % ((uint64_t)top + 1));
+
+    return match;
+}
+
+static uint8_t Timer0Top(void)
+{
+    return (TCCR0A & (1 << WGM01)) ? OCR0A : 0xFF;
+}
+
+static uint16_t Timer1Top(void)
+{
+    return (TCCR1B & (1 << WGM12)) ? OCR1A : 0xFFFF;
+}
+
+/*
+ * Internal EEPROM
+ */
+
+static void EepromWrite(uint8_t old, uint8_t value)
+{
+    uint16_t address = EEAR & E2END;
+    uint8_t next = value & (uint8_t)~(1 << EERE);
+
+    if ((value & (1 << EERE)) && (old & (1 << EEPE)) == 0)
+    {
+        EEDR = Eeprom[address];
+    }
+
+    if ((value & (1 << EEPE)) && (old & (1 << EEPE)) == 0 && (old & (1 << EEMPE)))
+    {
+        switch ((value >> EEPM0) & 0x03)
+        {
+            case 0:
+            {
+                Eeprom[address] = EEDR;
+                Eeprom_Due = Now + HOST_EEPROM_WRITE_CYCLES;
+                break;
+            }
+            case 1:
+            {
+                Eeprom[address] = 0xFF;
+                Eeprom_Due = Now + HOST_EEPROM_HALF_CYCLES;
+                break;
+            }
+            default:
+            {
+                Eeprom[address] &= EEDR;
+                Eeprom_Due = Now + HOST_EEPROM_HALF_CYCLES;
+                break;
+            }
+        }
+        next = (next | (1 << EEPE)) & (uint8_t)~(1 << EEMPE);
+    }
+    else
+    {
+        next = (next & (uint8_t)~(1 << EEPE)) | (old & (1 << EEPE));
+    }
+
+    EECR = next;
+}
+
+/*
+ * ADC
+ */
+
+static void AdcStart(void)
+{
+    uint8_t clocks = Adc_First ? HOST_ADC_FIRST_CLOCKS : HOST_ADC_CLOCKS;
+
+    Adc_Channel = ADMUX & 0x0F;
+    Adc_Due = Now + (uint64_t)clocks * Adc_Prescalers[ADCSRA & 0x07];
+    ADCSRA |= (1 << ADSC);
+}
+
+static void AdcWrite(uint8_t old, uint8_t value)
+{
+    uint8_t next = value & (uint8_t)~(1 << ADIF);
+
+    // Writing one clears the flag
+    if ((value & (1 << ADIF)) == 0)
+    {
+        next |= old & (1 << ADIF);
+    }
+
+    if ((value & (1 << ADEN)) == 0)
+    {
+        Adc_Due = HOST_NEVER;
+        Adc_First = 1;
+        next &= (uint8_t)~(1 << ADSC);
+    }
+    ADCSRA = next;
+
+    if ((value & (1 << ADEN)) && (value & (1 << ADSC)) && Adc_Due == HOST_NEVER)
+    {
+        AdcStart();
+    }
+}
+
+static void AdcComplete(void)
+{
+    Adc_Due = HOST_NEVER;
+    Adc_First = 0;
+    ADC = Host__AdcSample(Adc_Channel) & 0x03FF;
+    ADCSRA = (ADCSRA | (1 << ADIF)) & (uint8_t)~(1 << ADSC);
+
+    if ((ADCSRA & (1 << ADATE)) && (ADCSRB & 0x07) == HOST_ADC_TRIGGER_FREE)
+    {
+        AdcStart();
+    }
+}
+
+uint16_t Host__AdcSample(uint8_t channel) __attribute__((weak));
+uint16_t Host__AdcSample(uint8_t channel)
+{
+    return HOST_ADC_MIDSCALE;
+}
+
+/*
+ * USART, 8 data bits
+ */
+
+static uint64_t UsartFrameCycles(void)
+{
+    uint8_t cycles_per_bit = (UCSR0A & (1 << U2X0)) ? 8 : 16;
+
+    return (uint64_t)HOST_USART_FRAME_BITS * cycles_per_bit * ((UBRR0 & 0x0FFF) + 1);
+}
+
+static void UsartTransmit(uint8_t data)
+{
+    if ((UCSR0B & (1 << TXEN0)) == 0)
+    {
+        return;
+    }
+
+    UCSR0A &= (uint8_t)~(1 << TXC0);
+    if (Tx_Due == HOST_NEVER)
+    {
+        Tx_Shift = data;
+        Tx_Due = Now + UsartFrameCycles();
+    }
+    else
+    {
+        Tx_Buffer = data;
+        Tx_Buffered = 1;
+        UCSR0A &= (uint8_t)~(1 << UDRE0);
+    }
+}
+
+static void UsartUpdate(void)
+{
+    uint8_t data;
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+
+    if (Now >= Tx_Due)
+    {
+        Host__UsartTransmit(Tx_Shift);
+        Tx_Pending_Flush = 1;
+        if (Tx_Buffered)
+        {
+            Tx_Shift = Tx_Buffer;
+            Tx_Buffered = 0;
+            Tx_Due += UsartFrameCycles();
+            UCSR0A |= (1 << UDRE0);
+        }
+        else
+        {
+            Tx_Due = HOST_NEVER;
+            UCSR0A |= (1 << TXC0);
+        }
+    }
+
+    if ((UCSR0B & (1 << RXEN0)) == 0 || Rx_Closed)
+    {
+        Rx_Due = HOST_NEVER;
+    }
+    else if (Rx_Due == HOST_NEVER)
+    {
+        Rx_Due = Now + UsartFrameCycles();
+    }
+    else if (Now >= Rx_Due)
+    {
+        // One frame time per byte, when there is one
+        Rx_Due = Now + UsartFrameCycles();
+        if (poll(&input, 1, 0) > 0)
+        {
+            if (read(STDIN_FILENO, &data, 1) == 1)
+            {
+                if (UCSR0A & (1 << RXC0))
+                {
+                    UCSR0A |= (1 << DOR0);
+                }
+                else
+                {
+                    UDR0 = data;
+                    UCSR0A |= (1 << RXC0);
+                }
+            }
+            else
+            {
+                Rx_Closed = 1;
+            }
+        }
+    }
+}
+
+void Host__UsartTransmit(uint8_t data) __attribute__((weak));
+void Host__UsartTransmit(uint8_t data)
+{
+    putchar(data);
+}
+
+/*
+ * SPI master, the slave is Host__SpiExchange, nothing on the bus by default
+ */
+
+static void SpiWrite(uint8_t data)
+{
+    uint8_t cycles_per_bit = Spi_Prescalers[SPCR & 0x03];
+
+    if ((SPCR & (1 << SPE)) == 0)
+    {
+        return;
+    }
+    // The flag of the last byte, read by the code before: SPSR then SPDR
+    SPSR &= (uint8_t)~(1 << SPIF);
+    if (SPSR & (1 << SPI2X))
+    {
+        cycles_per_bit >>= 1;
+    }
+    Spi_Out = data;
+    Spi_Due = Now + 8ULL * cycles_per_bit;
+}
+
+uint8_t Host__SpiExchange(uint8_t data) __attribute__((weak));
+uint8_t Host__SpiExchange(uint8_t data)
+{
+    return 0xFF;
+}
+
+/*
+ * Registers
+ */
+
+/**
+ * @brief   Write a register with side effects
+ */
+void Host__Write(volatile uint8_t *reg, uint8_t value)
+{
+    uint8_t old = *reg;
+
+    Activity = 1;
+
+    if (reg == &PINB || reg == &PINC || reg == &PIND)
+    {
+        // Writing one toggles the port bit
+        reg[2] ^= value;
+    }
+    else if (reg == &EECR)
+    {
+        EepromWrite(old, value);
+    }
+    else if (reg == &ADCSRA)
+    {
+        AdcWrite(old, value);
+    }
+    else if (reg == &SPDR)
+    {
+        SpiWrite(value);
+    }
+    else if (reg == &TWCR)
+    {
+        HostTwi__Write(value);
+    }
+    else if (reg == &UDR0)
+    {
+        UsartTransmit(value);
+    }
+    else
+    {
+        *reg = value;
+    }
+
+    Update();
+}
+
+/*
+ * Interrupts, in the order of the AVR vector table
+ */
+
+static HOST_VECTOR_T TakePending(void)
+{
+    if ((EIFR & (1 << INTF0)) && (EIMSK & (1 << INT0)) && INT0_vect)
+    {
+        EIFR &= (uint8_t)~(1 << INTF0);
+        return INT0_vect;
+    }
+    if ((TIFR1 & (1 << OCF1A)) && (TIMSK1 & (1 << OCIE1A)) && TIMER1_COMPA_vect)
+    {
+        TIFR1 &= (uint8_t)~(1 << OCF1A);
+        return TIMER1_COMPA_vect;
+    }
+    if ((TIFR0 & (1 << OCF0A)) && (TIMSK0 & (1 << OCIE0A)) && TIMER0_COMPA_vect)
+    {
+        TIFR0 &= (uint8_t)~(1 << OCF0A);
+        return TIMER0_COMPA_vect;
+    }
+    if ((SPSR & (1 << SPIF)) && (SPCR & (1 << SPIE)) && SPI_STC_vect)
+    {
+        SPSR &= (uint8_t)~(1 << SPIF);
+        return SPI_STC_vect;
+    }
+    if ((UCSR0A & (1 << RXC0)) && (UCSR0B & (1 << RXCIE0)) && USART_RX_vect)
+    {
+        // The ISR reads UDR0, which clears both
+        UCSR0A &= (uint8_t)~((1 << RXC0) | (1 << DOR0));
+        return USART_RX_vect;
+    }
+    if ((ADCSRA & (1 << ADIF)) && (ADCSRA & (1 << ADIE)) && ADC_vect)
+    {
+        ADCSRA &= (uint8_t)~(1 << ADIF);
+        return ADC_vect;
+    }
+    if ((EECR & (1 << EERIE)) && (EECR & (1 << EEPE)) == 0 && EE_READY_vect)
+    {
+        return EE_READY_vect;
+    }
+    if ((TWCR & (1 << TWINT)) && (TWCR & (1 << TWIE)) && TWI_vect)
+    {
+        return TWI_vect;
+    }
+    return NULL;
+}
+
+/**
+ * @return  1 if at least one ISR ran
+ */
+static uint8_t Dispatch(void)
+{
+    HOST_VECTOR_T vector;
+    uint8_t dispatched = 0;
+
+    while (SREG & (1 << SREG_I))
+    {
+        vector = TakePending();
+        if (vector == NULL)
+        {
+            break;
+        }
+        SREG &= (uint8_t)~(1 << SREG_I);
+        Interrupts++;
+        vector();
+        SREG |= (1 << SREG_I);
+        dispatched = 1;
+    }
+
+    return dispatched;
+}
+
+void Host__SetSreg(uint8_t sreg)
+{
+    SREG = sreg;
+    if (sreg & (1 << SREG_I))
+    {
+        Dispatch();
+    }
+}
+
+/**
+ * @brief   Prologue of the ISRs, nested is 1 for ISR_NOBLOCK
+ */
+void Host__EnterIsr(uint8_t nested)
+{
+    if (nested)
+    {
+        Host__SetSreg(SREG | (1 << SREG_I));
+    }
+}
+
+/*
+ * Virtual time
+ */
+
+static uint64_t Earliest(uint64_t a, uint64_t b)
+{
+    return (a < b) ? a : b;
+}
+
+void Host__SamplePins(uint64_t now) __attribute__((weak));
+void Host__SamplePins(uint64_t now)
+{
+}
+
+static void UpdatePins(void)
+{
+    uint8_t master_low;
+
+    // Nothing else connected: the inputs read their pull-up
+    PINB = PORTB;
+    PINC = PORTC;
+
+    // 1-Wire bus on PD7, with its pull-up
+    master_low = (DDRD & (1 << DDD7)) && (PORTD & (1 << PORTD7)) == 0;
+    HostOnewire__Update(Now, master_low);
+    PIND = (PORTD & DDRD) | ((PORTD | (1 << PIND7)) & (uint8_t)~DDRD);
+    if (master_low || HostOnewire__IsLow(Now))
+    {
+        PIND &= (uint8_t)~(1 << PIND7);
+    }
+
+    Host__SamplePins(Now);
+}
+
+/**
+ * @brief   Process the events due, and find the next one
+ */
+static void Update(void)
+{
+    uint32_t counter;
+    uint64_t due;
+
+    counter = TCNT0;
+    if (TimerStep(&Timer0, TCCR0B, &counter, OCR0A, Timer0Top(), 0xFF))
+    {
+        TIFR0 |= (1 << OCF0A);
+        if ((ADCSRA & (1 << ADEN)) && (ADCSRA & (1 << ADATE)) &&
+            (ADCSRB & 0x07) == HOST_ADC_TRIGGER_TIMER0 && Adc_Due == HOST_NEVER)
+        {
+            AdcStart();
+        }
+    }
+    TCNT0 = (uint8_t)counter;
+
+    counter = TCNT1;
+    if (TimerStep(&Timer1, TCCR1B, &counter, OCR1A, Timer1Top(), 0xFFFF))
+    {
+        TIFR1 |= (1 << OCF1A);
+    }
+    TCNT1 = (uint16_t)counter;
+
+    if (Now >= Eeprom_Due)
+    {
+        Eeprom_Due = HOST_NEVER;
+        EECR &= (uint8_t)~(1 << EEPE);
+    }
+    if (Now >= Adc_Due)
+    {
+        AdcComplete();
+    }
+    if (Now >= Spi_Due)
+    {
+        Spi_Due = HOST_NEVER;
+        SPDR = Host__SpiExchange(Spi_Out);
+        SPSR |= (1 << SPIF);
+    }
+    UsartUpdate();
+    UpdatePins();
+
+    due = TimerDue(&Timer0, TCCR0B, TCNT0, OCR0A, Timer0Top(), 0xFF);
+    due = Earliest(due, TimerDue(&Timer1, TCCR1B, TCNT1, OCR1A, Timer1Top(), 0xFFFF));
+    due = Earliest(due, Eeprom_Due);
+    due = Earliest(due, Adc_Due);
+    due = Earliest(due, Spi_Due);
+    due = Earliest(due, Tx_Due);
+    due = Earliest(due, Rx_Due);
+    due = Earliest(due, HostTwi__Update(Now));
+    Next_Due = due;
+}
+
+static void Advance(uint64_t target)
+{
+    Update();
+    Dispatch();
+    while (Now < target)
+    {
+        Now = Earliest(Next_Due, target);
+        Update();
+        Dispatch();
+    }
+}
+
+uint64_t Host__GetCycles(void)
+{
+    return Now;
+}
+
+void Host__Delay(uint64_t cycles)
+{
+    Advance(Now + cycles);
+}
+
+/**
+ * @brief   One poll of a register in a busy loop
+ */
+void Host__BusyWait(void)
+{
+    Advance(Now + HOST_BUSY_WAIT_CYCLES);
+}
+
+uint64_t Host__Wait(uint64_t due) __attribute__((weak));
+uint64_t Host__Wait(uint64_t due)
+{
+    return due;
+}
+
+/**
+ * @brief   End of a pass of the main loop
+ */
+void Host__Idle(void)
+{
+    Loops++;
+    if (Now >= Run_Until || Stop_Requested)
+    {
+        exit(0);
+    }
+
+    Update();
+    if (Dispatch())
+    {
+        Activity = 1;
+    }
+    if (Activity)
+    {
+        Activity = 0;
+        Advance(Now + HOST_LOOP_CYCLES);
+    }
+    else
+    {
+        if (Tx_Pending_Flush)
+        {
+            Tx_Pending_Flush = 0;
+            fflush(stdout);
+        }
+        Advance(Host__Wait(Earliest(Earliest(Next_Due, Run_Until), Now + HOST_CYCLES_PER_MS)));
+    }
+}
+
+/*
+ * Set up and exit
+ */
+
+void Host__LoadImage(const char *variable, uint8_t *data, uint32_t size)
+{
+    const char *path = getenv(variable);
+    FILE *file;
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        data[i] = 0xFF;
+    }
+    if (path != NULL && (file = fopen(path, "rb")) != NULL)
+    {
+        if (fread(data, 1, size, file) != size)
+        {
+            fprintf(stderr, "smart_node: %s is short, the rest is erased\n", path);
+        }
+        fclose(file);
+    }
+}
+
+void Host__SaveImage(const char *variable, const uint8_t *data, uint32_t size)
+{
+    const char *path = getenv(variable);
+    FILE *file;
+
+    if (path == NULL)
+    {
+        return;
+    }
+    if ((file = fopen(path, "wb")) == NULL || fwrite(data, 1, size, file) != size)
+    {
+        fprintf(stderr, "smart_node: cannot save %s\n", path);
+    }
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+}
+
+static void OnSignal(int number)
+{
+    Stop_Requested = 1;
+}
+
+static void Exit(void)
+{
+    struct timespec wall_end;
+    double seconds;
+    double simulated_ms = (double)Now / HOST_CYCLES_PER_MS;
+
+    if (Loops == 0)
+    {
+        // Never run: the image of a simulator, which ran copies of it
+        return;
+    }
+    fflush(stdout);
+    Host__SaveImage("SMART_NODE_EEPROM", Eeprom, sizeof(Eeprom));
+    HostTwi__Exit();
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    seconds = (wall_end.tv_sec - Wall_Start.tv_sec) + (wall_end.tv_nsec - Wall_Start.tv_nsec) / 1e9;
+    fprintf(stderr, "smart_node: %.0f ms in %.3f s, %.0f ticks/s, %llu interrupts, %llu loops\n",
+            simulated_ms, seconds, (seconds > 0) ? simulated_ms / seconds : 0.0,
+            (unsigned long long)Interrupts, (unsigned long long)Loops);
+}
+
+/**
+ * @brief   Power-on reset of the micro and of the models
+ */
+void Host__Reset(void)
+{
+    const char *run_ms = getenv("SMART_NODE_RUN_MS");
+
+    Run_Until = (run_ms != NULL) ? strtoull(run_ms, NULL, 0) * HOST_CYCLES_PER_MS : HOST_NEVER;
+
+    // Reset values
+    MCUSR = (1 << PORF);
+    UCSR0A = (1 << UDRE0);
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    SP = RAMEND;
+    Eeprom_Due = HOST_NEVER;
+    Adc_Due = HOST_NEVER;
+    Adc_First = 1;
+    Spi_Due = HOST_NEVER;
+    Tx_Due = HOST_NEVER;
+    Rx_Due = HOST_NEVER;
+
+    Host__LoadImage("SMART_NODE_EEPROM", Eeprom, sizeof(Eeprom));
+    HostTwi__Initialize();
+    HostOnewire__Initialize();
+}
+
+static void Initialize(void) __attribute__((constructor));
+static void Initialize(void)
+{
+    Host__Reset();
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    clock_gettime(CLOCK_MONOTONIC, &Wall_Start);
+    atexit(Exit);
+}
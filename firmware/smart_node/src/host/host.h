@@ -0,0 +1,98 @@
+/**
+ * @file host.h
+ *
+ * @brief Host backend of the hardware abstraction
+ *
+ * @details The firmware runs as a native Linux executable on a model of
+ *          the ATmega328P: the I/O registers live in Host__Io at their AVR
+ *          data addresses, and include/ replaces the avr-libc headers. Time
+ *          is virtual, counted in CPU cycles: it only moves in the delays
+ *          and busy waits, and in Micro__Idle at the end of the main loop,
+ *          which jumps to the next peripheral event. The interrupts are
+ *          dispatched there, in the AVR priority order, when enabled.
+ *
+ *          Modelled: timer 0 and 1 in CTC mode, USART (stdin to RX, TX to
+ *          stdout), ADC with auto trigger, internal EEPROM, SPI master
+ *          (nothing on the bus, see Host__SpiExchange), TWI master with a
+ *          24FC1025 at address 0, a DS18B20 on the 1-Wire bus and the GPIO
+ *          ports. The code sees no difference in the registers except for
+ *          the strobes, written with Micro__Write. The AVR RAM layout and
+ *          the stack are not modelled.
+ *
+ *          Build, from src/:
+ *
+ *              gcc -std=gnu99 -O2 -g -DMICRO_HOST -Ihost/include -Ihost \
+ *                  -I. -Idrivers -o smart_node_host $(find . -name '*.c')
+ *
+ *          Environment:
+ *          SMART_NODE_RUN_MS       virtual time to run, forever if not set
+ *          SMART_NODE_TEMPERATURE  DS18B20 reading in Celsius, 20 if not
+ *                                  set, "none" for no sensor
+ *          SMART_NODE_EEPROM       internal EEPROM image, loaded at start
+ *          SMART_NODE_EXT_EEPROM   and saved at exit, erased if not set
+ *
+ *          At exit, the virtual and wall-clock time are printed on stderr.
+ *
+ *          The board around the micro is a set of weak functions: the
+ *          network simulator, sim/, links its own, with a node on the
+ *          radio, and runs a copy of the firmware for each node.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdint.h>
+
+#define HOST_IO_SIZE        0x100   // registers, from address 0
+#define HOST_RAM_SIZE       2048
+
+#define HOST_NEVER          UINT64_MAX
+
+extern volatile uint8_t Host__Io[HOST_IO_SIZE];
+extern uint8_t Host__Ram[HOST_RAM_SIZE];
+
+// Register access
+void Host__Write(volatile uint8_t *reg, uint8_t value);
+
+// Interrupts
+void Host__SetSreg(uint8_t sreg);
+void Host__EnterIsr(uint8_t nested);
+
+// Virtual time
+uint64_t Host__GetCycles(void);
+void Host__Delay(uint64_t cycles);
+void Host__BusyWait(void);
+void Host__Idle(void);
+
+// Inputs of the models, weak: a test can link its own
+uint16_t Host__AdcSample(uint8_t channel);
+int16_t Host__GetTemperature(void);   // 1/16 Celsius
+
+// The board around the micro, weak: nothing connected by default, a
+// simulator of several nodes links its own
+uint8_t Host__SpiExchange(uint8_t data);    // byte shifted in for data
+void Host__SamplePins(uint64_t now);        // after each step, may set EIFR
+void Host__UsartTransmit(uint8_t data);     // to stdout
+uint64_t Host__Wait(uint64_t due);          // idle loop, cycle to resume at
+
+// Peripheral models, called by the core
+void HostTwi__Initialize(void);
+void HostTwi__Write(uint8_t twcr);
+uint64_t HostTwi__Update(uint64_t now);
+void HostTwi__Exit(void);
+
+void HostOnewire__Initialize(void);
+void HostOnewire__Update(uint64_t now, uint8_t master_low);
+uint8_t HostOnewire__IsLow(uint64_t now);
+
+// Set up, at start
+void Host__Reset(void);
+
+// Image files of the EEPROMs
+void Host__LoadImage(const char *variable, uint8_t *data, uint32_t size);
+void Host__SaveImage(const char *variable, const uint8_t *data, uint32_t size);
+
+#endif /* HOST_H_ */
@@ -0,0 +1,255 @@
+/**
+ * @file host_onewire.c
+ *
+ * @brief DS18B20 model on the 1-Wire bus, host backend
+ *
+ * @details The device follows the low pulses of the master, timed at each
+ *          step of the virtual time: a long one is a reset, answered with
+ *          the presence pulse, a short one a write 1 or the start of a read
+ *          slot, a 15us or longer one a write 0. In a read slot the device
+ *          holds the bus low for a 0 bit.
+ *          Skip ROM only, then convert T, read and write scratchpad. The
+ *          temperature is taken from Host__GetTemperature at the end of the
+ *          conversion, which takes the time of the configured resolution.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <util/crc16.h>
+#include "host.h"
+
+#define HOST_CYCLES_PER_US          16ULL
+
+#define HOST_ONEWIRE_RESET_US       450     // shorter than the 480us of the spec
+#define HOST_ONEWIRE_WRITE0_US      15
+#define HOST_ONEWIRE_PRESENCE_WAIT_US   30
+#define HOST_ONEWIRE_PRESENCE_US    120
+#define HOST_ONEWIRE_READ0_US       30
+#define HOST_ONEWIRE_CONVERT_US     750000  // 12 bit, halved for each bit less
+
+#define HOST_ONEWIRE_DEFAULT_TEMPERATURE    (20 * 16)
+
+// Commands
+#define SKIP_ROM            0xCC
+#define CONVERT_T           0x44
+#define WRITE_SCRATCHPAD    0x4E
+#define READ_SCRATCHPAD     0xBE
+
+#define SCRATCHPAD_SIZE     9
+#define SCRATCHPAD_CONFIG   4
+#define SCRATCHPAD_WRITTEN  3   // TH, TL and configuration
+
+typedef enum {
+    DEVICE_IDLE = 0,    // until the next reset
+    DEVICE_ROM_COMMAND,
+    DEVICE_FUNCTION_COMMAND,
+    DEVICE_WRITING_SCRATCHPAD,
+    DEVICE_SENDING,
+    DEVICE_CONVERTING,
+} DEVICE_STATE_T;
+
+static uint8_t Present;
+static int16_t Temperature;
+static DEVICE_STATE_T State;
+static uint8_t Master_Low;
+static uint64_t Low_Since;
+static uint64_t Drive_From;
+static uint64_t Drive_Until;
+
+static uint8_t Shift;
+static uint8_t Bits;
+static uint8_t Written;
+static uint16_t Sent_Bits;
+static uint64_t Convert_Done;
+static uint8_t Convert_Pending;
+
+// Power-on values, 85 Celsius
+static uint8_t Scratchpad[SCRATCHPAD_SIZE] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0x00};
+
+static void Drive(uint64_t from, uint64_t until)
+{
+    Drive_From = from;
+    Drive_Until = until;
+}
+
+static uint64_t ConversionCycles(void)
+{
+    uint8_t resolution = (Scratchpad[SCRATCHPAD_CONFIG] >> 5) & 0x03;
+
+    return (HOST_ONEWIRE_CONVERT_US * HOST_CYCLES_PER_US) >> (3 - resolution);
+}
+
+static void Latch(uint64_t now)
+{
+    uint8_t resolution = (Scratchpad[SCRATCHPAD_CONFIG] >> 5) & 0x03;
+    uint16_t temperature;
+
+    if (Convert_Pending && now >= Convert_Done)
+    {
+        Convert_Pending = 0;
+        temperature = (uint16_t)Host__GetTemperature() & (uint16_t)~((1 << (3 - resolution)) - 1);
+        Scratchpad[0] = (uint8_t)temperature;
+        Scratchpad[1] = (uint8_t)(temperature >> 8);
+    }
+}
+
+static void Receive(uint8_t data, uint64_t now)
+{
+    uint8_t i;
+    uint8_t crc = 0;
+
+    switch (State)
+    {
+        case DEVICE_ROM_COMMAND:
+        {
+            State = (data == SKIP_ROM) ? DEVICE_FUNCTION_COMMAND : DEVICE_IDLE;
+            break;
+        }
+        case DEVICE_FUNCTION_COMMAND:
+        {
+            if (data == CONVERT_T)
+            {
+                Convert_Done = now + ConversionCycles();
+                Convert_Pending = 1;
+                State = DEVICE_CONVERTING;
+            }
+            else if (data == READ_SCRATCHPAD)
+            {
+                for (i = 0; i < SCRATCHPAD_SIZE - 1; i++)
+                {
+                    crc = _crc_ibutton_update(crc, Scratchpad[i]);
+                }
+                Scratchpad[SCRATCHPAD_SIZE - 1] = crc;
+                Sent_Bits = 0;
+                State = DEVICE_SENDING;
+            }
+            else if (data == WRITE_SCRATCHPAD)
+            {
+                Written = 0;
+                State = DEVICE_WRITING_SCRATCHPAD;
+            }
+            else
+            {
+                State = DEVICE_IDLE;
+            }
+            break;
+        }
+        case DEVICE_WRITING_SCRATCHPAD:
+        {
+            Scratchpad[2 + Written] = data;
+            Written++;
+            if (Written == SCRATCHPAD_WRITTEN)
+            {
+                Scratchpad[SCRATCHPAD_CONFIG] |= 0x1F;
+                State = DEVICE_IDLE;
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+static void Falling(uint64_t now)
+{
+    uint8_t bit;
+
+    Low_Since = now;
+    if (State == DEVICE_SENDING)
+    {
+        bit = (Scratchpad[Sent_Bits >> 3] >> (Sent_Bits & 0x07)) & 0x01;
+        Sent_Bits++;
+        if (Sent_Bits == SCRATCHPAD_SIZE * 8)
+        {
+            State = DEVICE_IDLE;
+        }
+        if (bit == 0)
+        {
+            Drive(now, now + HOST_ONEWIRE_READ0_US * HOST_CYCLES_PER_US);
+        }
+    }
+    else if (State == DEVICE_CONVERTING && now < Convert_Done)
+    {
+        Drive(now, now + HOST_ONEWIRE_READ0_US * HOST_CYCLES_PER_US);
+    }
+}
+
+static void Rising(uint64_t now)
+{
+    uint64_t low = now - Low_Since;
+
+    if (low >= HOST_ONEWIRE_RESET_US * HOST_CYCLES_PER_US)
+    {
+        State = DEVICE_ROM_COMMAND;
+        Bits = 0;
+        Drive(now + HOST_ONEWIRE_PRESENCE_WAIT_US * HOST_CYCLES_PER_US,
+              now + (HOST_ONEWIRE_PRESENCE_WAIT_US + HOST_ONEWIRE_PRESENCE_US) * HOST_CYCLES_PER_US);
+    }
+    else if (State == DEVICE_ROM_COMMAND || State == DEVICE_FUNCTION_COMMAND ||
+             State == DEVICE_WRITING_SCRATCHPAD)
+    {
+        // LSB first
+        Shift >>= 1;
+        if (low < HOST_ONEWIRE_WRITE0_US * HOST_CYCLES_PER_US)
+        {
+            Shift |= 0x80;
+        }
+        Bits++;
+        if (Bits == 8)
+        {
+            Bits = 0;
+            Receive(Shift, now);
+        }
+    }
+}
+
+void HostOnewire__Initialize(void)
+{
+    const char *temperature = getenv("SMART_NODE_TEMPERATURE");
+
+    Present = (temperature == NULL || strcmp(temperature, "none") != 0);
+    Temperature = (temperature != NULL && Present) ?
+                  (int16_t)(strtod(temperature, NULL) * 16) : HOST_ONEWIRE_DEFAULT_TEMPERATURE;
+    State = DEVICE_IDLE;
+}
+
+/**
+ * @brief   Follow the bus, at each step of the virtual time
+ */
+void HostOnewire__Update(uint64_t now, uint8_t master_low)
+{
+    if (Present == 0)
+    {
+        return;
+    }
+
+    Latch(now);
+    if (master_low && Master_Low == 0)
+    {
+        Falling(now);
+    }
+    else if (master_low == 0 && Master_Low)
+    {
+        Rising(now);
+    }
+    Master_Low = master_low;
+}
+
+/**
+ * @return  1 while the device holds the bus low
+ */
+uint8_t HostOnewire__IsLow(uint64_t now)
+{
+    return (now >= Drive_From && now < Drive_Until) ? 1 : 0;
+}
+
+int16_t Host__GetTemperature(void) __attribute__((weak));
+int16_t Host__GetTemperature(void)
+{
+    return Temperature;
+}
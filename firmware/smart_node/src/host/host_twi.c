@@ -0,0 +1,235 @@
+/**
+ * @file host_twi.c
+ *
+ * @brief TWI master and 24FC1025 EEPROM model, host backend
+ *
+ * @details A byte takes 9 SCL periods, then TWINT is set with the status
+ *          of the master transmitter or receiver. The EEPROM answers at
+ *          address 0, A1 and A0 low, with the block select bit in the
+ *          slave address. Written bytes wrap around in their page and are
+ *          programmed at the stop condition; the EEPROM does not acknowledge
+ *          during the following 5ms.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <avr/io.h>
+#include "host.h"
+
+#define HOST_TWI_EEPROM_SIZE        0x20000UL
+#define HOST_TWI_PAGE_SIZE          128
+#define HOST_TWI_SLAVE_ADDRESS      0x50
+#define HOST_TWI_BLOCK_BIT          0x04
+#define HOST_TWI_WRITE_CYCLES       80000   // 5ms
+
+// Status codes, master transmitter and receiver
+#define HOST_TWI_START              0x08
+#define HOST_TWI_REP_START          0x10
+#define HOST_TWI_MT_SLA_ACK         0x18
+#define HOST_TWI_MT_SLA_NACK        0x20
+#define HOST_TWI_MT_DATA_ACK        0x28
+#define HOST_TWI_MT_DATA_NACK       0x30
+#define HOST_TWI_MR_SLA_ACK         0x40
+#define HOST_TWI_MR_SLA_NACK        0x48
+#define HOST_TWI_MR_DATA_ACK        0x50
+#define HOST_TWI_MR_DATA_NACK       0x58
+
+typedef enum {
+    BUS_IDLE = 0,
+    BUS_ADDRESS,    // after a start, the slave address comes next
+    BUS_WRITING,
+    BUS_READING,
+    BUS_IGNORED,    // not acknowledged, until the stop
+} BUS_STATE_T;
+
+static uint8_t *Memory;     // one per reset, a simulator runs several
+static BUS_STATE_T Bus_State;
+static uint8_t Bus_Owned;
+static uint64_t Byte_Due;
+static uint64_t Stop_Due;
+static uint8_t Status;
+static uint8_t Read_Data;
+static uint8_t Read_Pending;
+
+static uint32_t Block;
+static uint16_t Pointer;
+static uint8_t Pointer_Bytes;
+static uint8_t Written;
+static uint64_t Busy_Until;
+
+static uint64_t BitCycles(void)
+{
+    static const uint8_t prescalers[4] = {1, 4, 16, 64};
+
+    return 16 + 2ULL * TWBR * prescalers[TWSR & 0x03];
+}
+
+static void Address(uint8_t sla, uint64_t now)
+{
+    uint8_t slave = sla >> 1;
+    uint8_t match = ((slave & (uint8_t)~HOST_TWI_BLOCK_BIT) == HOST_TWI_SLAVE_ADDRESS) &&
+                    now >= Busy_Until;
+
+    Block = (slave & HOST_TWI_BLOCK_BIT) ? 0x10000UL : 0;
+    if (sla & 0x01)
+    {
+        Status = match ? HOST_TWI_MR_SLA_ACK : HOST_TWI_MR_SLA_NACK;
+        Bus_State = match ? BUS_READING : BUS_IGNORED;
+    }
+    else
+    {
+        Status = match ? HOST_TWI_MT_SLA_ACK : HOST_TWI_MT_SLA_NACK;
+        Bus_State = match ? BUS_WRITING : BUS_IGNORED;
+        Pointer_Bytes = 0;
+        Written = 0;
+    }
+}
+
+static void Receive(uint8_t data)
+{
+    Status = HOST_TWI_MT_DATA_ACK;
+    if (Pointer_Bytes == 0)
+    {
+        Pointer = (uint16_t)data << 8;
+        Pointer_Bytes++;
+    }
+    else if (Pointer_Bytes == 1)
+    {
+        Pointer |= data;
+        Pointer_Bytes++;
+    }
+    else
+    {
+        Memory[Block | Pointer] = data;
+        Pointer = (Pointer & (uint16_t)~(HOST_TWI_PAGE_SIZE - 1)) |
+                  ((Pointer + 1) & (HOST_TWI_PAGE_SIZE - 1));
+        Written = 1;
+    }
+}
+
+static void Send(uint8_t ack)
+{
+    Read_Data = Memory[Block | Pointer];
+    Read_Pending = 1;
+    Pointer++;
+    Status = ack ? HOST_TWI_MR_DATA_ACK : HOST_TWI_MR_DATA_NACK;
+}
+
+void HostTwi__Initialize(void)
+{
+    Memory = malloc(HOST_TWI_EEPROM_SIZE);
+    if (Memory == NULL)
+    {
+        fprintf(stderr, "smart_node: no memory for the external EEPROM\n");
+        exit(1);
+    }
+    Host__LoadImage("SMART_NODE_EXT_EEPROM", Memory, HOST_TWI_EEPROM_SIZE);
+    TWSR = 0xF8;    // no relevant state
+    Byte_Due = HOST_NEVER;
+    Stop_Due = HOST_NEVER;
+}
+
+/**
+ * @brief   TWCR written: an action starts when TWINT is written to one
+ */
+void HostTwi__Write(uint8_t twcr)
+{
+    uint64_t now = Host__GetCycles();
+    uint8_t next = twcr & (uint8_t)~(1 << TWINT);
+
+    if ((twcr & (1 << TWINT)) == 0)
+    {
+        next |= TWCR & (1 << TWINT);
+    }
+    TWCR = next;
+
+    if ((twcr & (1 << TWEN)) == 0)
+    {
+        Bus_State = BUS_IDLE;
+        Bus_Owned = 0;
+        Byte_Due = HOST_NEVER;
+        return;
+    }
+    if ((twcr & (1 << TWINT)) == 0)
+    {
+        return;
+    }
+
+    if (twcr & (1 << TWSTO))
+    {
+        if (Bus_State == BUS_WRITING && Written)
+        {
+            Busy_Until = now + HOST_TWI_WRITE_CYCLES;
+        }
+        Bus_State = BUS_IDLE;
+        Bus_Owned = 0;
+        Stop_Due = now + BitCycles();
+    }
+    else if (twcr & (1 << TWSTA))
+    {
+        Status = Bus_Owned ? HOST_TWI_REP_START : HOST_TWI_START;
+        Bus_Owned = 1;
+        Bus_State = BUS_ADDRESS;
+        Byte_Due = now + BitCycles();
+    }
+    else
+    {
+        switch (Bus_State)
+        {
+            case BUS_ADDRESS:
+            {
+                Address(TWDR, now);
+                break;
+            }
+            case BUS_WRITING:
+            {
+                Receive(TWDR);
+                break;
+            }
+            case BUS_READING:
+            {
+                Send(twcr & (1 << TWEA));
+                break;
+            }
+            default:
+            {
+                Status = HOST_TWI_MT_DATA_NACK;
+                break;
+            }
+        }
+        Byte_Due = now + 9 * BitCycles();
+    }
+}
+
+/**
+ * @return  Cycle of the next event
+ */
+uint64_t HostTwi__Update(uint64_t now)
+{
+    if (now >= Byte_Due)
+    {
+        Byte_Due = HOST_NEVER;
+        if (Read_Pending)
+        {
+            Read_Pending = 0;
+            TWDR = Read_Data;
+        }
+        TWSR = (TWSR & 0x03) | Status;
+        TWCR |= (1 << TWINT);
+    }
+    if (now >= Stop_Due)
+    {
+        Stop_Due = HOST_NEVER;
+        TWCR &= (uint8_t)~(1 << TWSTO);
+    }
+
+    return (Byte_Due < Stop_Due) ? Byte_Due : Stop_Due;
+}
+
+void HostTwi__Exit(void)
+{
+    Host__SaveImage("SMART_NODE_EXT_EEPROM", Memory, HOST_TWI_EEPROM_SIZE);
+}
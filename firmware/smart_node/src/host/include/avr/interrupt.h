@@ -0,0 +1,37 @@
+/**
+ * @file interrupt.h
+ *
+ * @brief Interrupts, host backend
+ *
+ * @details An ISR is an ordinary function, called by the dispatcher of
+ *          host.c with the I bit cleared. ISR_NOBLOCK sets it back on entry,
+ *          as the sei of the AVR prologue does.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define sei()   Host__SetSreg(SREG | (1 << SREG_I))
+#define cli()   (SREG &= (uint8_t)~(1 << SREG_I))
+
+#define ISR_BLOCK       0
+#define ISR_NOBLOCK     1
+
+// Second argument, 0 if there is only one
+#define HOST_ISR_NESTED(first, second, ...)     second
+
+#define ISR(vector, ...) \
+    static void vector##_Body(void); \
+    void vector(void) \
+    { \
+        Host__EnterIsr(HOST_ISR_NESTED(0, ##__VA_ARGS__, 0)); \
+        vector##_Body(); \
+    } \
+    static void vector##_Body(void)
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
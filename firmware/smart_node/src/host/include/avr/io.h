@@ -0,0 +1,423 @@
+/**
+ * @file io.h
+ *
+ * @brief ATmega328P registers, host backend
+ *
+ * @details Same names, addresses and bits as avr-libc, the registers are
+ *          bytes of Host__Io
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "host.h"
+
+typedef uint16_t HOST_REG16_T __attribute__((aligned(1)));
+
+#define _SFR_MEM8(address)  (*(volatile uint8_t *)&Host__Io[address])
+#define _SFR_MEM16(address) (*(volatile HOST_REG16_T *)&Host__Io[address])
+#define _BV(bit)            (1 << (bit))
+
+#define RAMSTART    0x100
+#define RAMEND      0x8FF
+#define E2END       0x3FF
+#define E2PAGESIZE  4
+
+// Ports
+#define PINB    _SFR_MEM8(0x23)
+#define DDRB    _SFR_MEM8(0x24)
+#define PORTB   _SFR_MEM8(0x25)
+#define PINC    _SFR_MEM8(0x26)
+#define DDRC    _SFR_MEM8(0x27)
+#define PORTC   _SFR_MEM8(0x28)
+#define PIND    _SFR_MEM8(0x29)
+#define DDRD    _SFR_MEM8(0x2A)
+#define PORTD   _SFR_MEM8(0x2B)
+
+#define PINB0 0
+#define PINB1 1
+#define PINB2 2
+#define PINB3 3
+#define PINB4 4
+#define PINB5 5
+#define PINB6 6
+#define PINB7 7
+#define DDB0 0
+#define DDB1 1
+#define DDB2 2
+#define DDB3 3
+#define DDB4 4
+#define DDB5 5
+#define DDB6 6
+#define DDB7 7
+#define PORTB0 0
+#define PORTB1 1
+#define PORTB2 2
+#define PORTB3 3
+#define PORTB4 4
+#define PORTB5 5
+#define PORTB6 6
+#define PORTB7 7
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+
+#define PINC0 0
+#define PINC1 1
+#define PINC2 2
+#define PINC3 3
+#define PINC4 4
+#define PINC5 5
+#define PINC6 6
+#define DDC0 0
+#define DDC1 1
+#define DDC2 2
+#define DDC3 3
+#define DDC4 4
+#define DDC5 5
+#define DDC6 6
+#define PORTC0 0
+#define PORTC1 1
+#define PORTC2 2
+#define PORTC3 3
+#define PORTC4 4
+#define PORTC5 5
+#define PORTC6 6
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+
+#define PIND0 0
+#define PIND1 1
+#define PIND2 2
+#define PIND3 3
+#define PIND4 4
+#define PIND5 5
+#define PIND6 6
+#define PIND7 7
+#define DDD0 0
+#define DDD1 1
+#define DDD2 2
+#define DDD3 3
+#define DDD4 4
+#define DDD5 5
+#define DDD6 6
+#define DDD7 7
+#define PORTD0 0
+#define PORTD1 1
+#define PORTD2 2
+#define PORTD3 3
+#define PORTD4 4
+#define PORTD5 5
+#define PORTD6 6
+#define PORTD7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+// Interrupt flags and masks
+#define TIFR0   _SFR_MEM8(0x35)
+#define TOV0    0
+#define OCF0A   1
+#define OCF0B   2
+
+#define TIFR1   _SFR_MEM8(0x36)
+#define TOV1    0
+#define OCF1A   1
+#define OCF1B   2
+#define ICF1    5
+
+#define EIFR    _SFR_MEM8(0x3C)
+#define INTF0   0
+#define INTF1   1
+
+#define EIMSK   _SFR_MEM8(0x3D)
+#define INT0    0
+#define INT1    1
+
+#define EICRA   _SFR_MEM8(0x69)
+#define ISC00   0
+#define ISC01   1
+#define ISC10   2
+#define ISC11   3
+
+#define TIMSK0  _SFR_MEM8(0x6E)
+#define TOIE0   0
+#define OCIE0A  1
+#define OCIE0B  2
+
+#define TIMSK1  _SFR_MEM8(0x6F)
+#define TOIE1   0
+#define OCIE1A  1
+#define OCIE1B  2
+#define ICIE1   5
+
+// EEPROM
+#define EECR    _SFR_MEM8(0x3F)
+#define EERE    0
+#define EEPE    1
+#define EEMPE   2
+#define EERIE   3
+#define EEPM0   4
+#define EEPM1   5
+
+#define EEDR    _SFR_MEM8(0x40)
+#define EEAR    _SFR_MEM16(0x41)
+#define EEARL   _SFR_MEM8(0x41)
+#define EEARH   _SFR_MEM8(0x42)
+
+// Timer 0
+#define TCCR0A  _SFR_MEM8(0x44)
+#define WGM00   0
+#define WGM01   1
+#define COM0B0  4
+#define COM0B1  5
+#define COM0A0  6
+#define COM0A1  7
+
+#define TCCR0B  _SFR_MEM8(0x45)
+#define CS00    0
+#define CS01    1
+#define CS02    2
+#define WGM02   3
+
+#define TCNT0   _SFR_MEM8(0x46)
+#define OCR0A   _SFR_MEM8(0x47)
+#define OCR0B   _SFR_MEM8(0x48)
+
+// SPI
+#define SPCR    _SFR_MEM8(0x4C)
+#define SPR0    0
+#define SPR1    1
+#define CPHA    2
+#define CPOL    3
+#define MSTR    4
+#define DORD    5
+#define SPE     6
+#define SPIE    7
+
+#define SPSR    _SFR_MEM8(0x4D)
+#define SPI2X   0
+#define WCOL    6
+#define SPIF    7
+
+#define SPDR    _SFR_MEM8(0x4E)
+
+// System
+#define SMCR    _SFR_MEM8(0x53)
+#define SE      0
+#define SM0     1
+#define SM1     2
+#define SM2     3
+
+#define MCUSR   _SFR_MEM8(0x54)
+#define PORF    0
+#define EXTRF   1
+#define BORF    2
+#define WDRF    3
+
+#define MCUCR   _SFR_MEM8(0x55)
+
+#define SP      _SFR_MEM16(0x5D)
+#define SPL     _SFR_MEM8(0x5D)
+#define SPH     _SFR_MEM8(0x5E)
+
+#define SREG    _SFR_MEM8(0x5F)
+#define SREG_C  0
+#define SREG_Z  1
+#define SREG_N  2
+#define SREG_V  3
+#define SREG_S  4
+#define SREG_H  5
+#define SREG_T  6
+#define SREG_I  7
+
+#define WDTCSR  _SFR_MEM8(0x60)
+#define WDP0    0
+#define WDP1    1
+#define WDP2    2
+#define WDE     3
+#define WDCE    4
+#define WDP3    5
+#define WDIE    6
+#define WDIF    7
+
+#define PRR     _SFR_MEM8(0x64)
+#define PRADC   0
+#define PRUSART0 1
+#define PRSPI   2
+#define PRTIM1  3
+#define PRTIM0  5
+#define PRTIM2  6
+#define PRTWI   7
+
+// ADC
+#define ADC     _SFR_MEM16(0x78)
+#define ADCW    _SFR_MEM16(0x78)
+#define ADCL    _SFR_MEM8(0x78)
+#define ADCH    _SFR_MEM8(0x79)
+
+#define ADCSRA  _SFR_MEM8(0x7A)
+#define ADPS0   0
+#define ADPS1   1
+#define ADPS2   2
+#define ADIE    3
+#define ADIF    4
+#define ADATE   5
+#define ADSC    6
+#define ADEN    7
+
+#define ADCSRB  _SFR_MEM8(0x7B)
+#define ADTS0   0
+#define ADTS1   1
+#define ADTS2   2
+#define ACME    6
+
+#define ADMUX   _SFR_MEM8(0x7C)
+#define MUX0    0
+#define MUX1    1
+#define MUX2    2
+#define MUX3    3
+#define ADLAR   5
+#define REFS0   6
+#define REFS1   7
+
+#define DIDR0   _SFR_MEM8(0x7E)
+#define ADC0D   0
+#define ADC1D   1
+#define ADC2D   2
+#define ADC3D   3
+#define ADC4D   4
+#define ADC5D   5
+
+// Timer 1
+#define TCCR1A  _SFR_MEM8(0x80)
+#define WGM10   0
+#define WGM11   1
+#define COM1B0  4
+#define COM1B1  5
+#define COM1A0  6
+#define COM1A1  7
+
+#define TCCR1B  _SFR_MEM8(0x81)
+#define CS10    0
+#define CS11    1
+#define CS12    2
+#define WGM12   3
+#define WGM13   4
+#define ICES1   6
+#define ICNC1   7
+
+#define TCCR1C  _SFR_MEM8(0x82)
+#define TCNT1   _SFR_MEM16(0x84)
+#define ICR1    _SFR_MEM16(0x86)
+#define OCR1A   _SFR_MEM16(0x88)
+#define OCR1B   _SFR_MEM16(0x8A)
+
+// TWI
+#define TWBR    _SFR_MEM8(0xB8)
+
+#define TWSR    _SFR_MEM8(0xB9)
+#define TWPS0   0
+#define TWPS1   1
+#define TWS3    3
+#define TWS4    4
+#define TWS5    5
+#define TWS6    6
+#define TWS7    7
+
+#define TWAR    _SFR_MEM8(0xBA)
+#define TWDR    _SFR_MEM8(0xBB)
+
+#define TWCR    _SFR_MEM8(0xBC)
+#define TWIE    0
+#define TWEN    2
+#define TWWC    3
+#define TWSTO   4
+#define TWSTA   5
+#define TWEA    6
+#define TWINT   7
+
+// USART
+#define UCSR0A  _SFR_MEM8(0xC0)
+#define MPCM0   0
+#define U2X0    1
+#define UPE0    2
+#define DOR0    3
+#define FE0     4
+#define UDRE0   5
+#define TXC0    6
+#define RXC0    7
+
+#define UCSR0B  _SFR_MEM8(0xC1)
+#define TXB80   0
+#define RXB80   1
+#define UCSZ02  2
+#define TXEN0   3
+#define RXEN0   4
+#define UDRIE0  5
+#define TXCIE0  6
+#define RXCIE0  7
+
+#define UCSR0C  _SFR_MEM8(0xC2)
+#define UCPOL0  0
+#define UCSZ00  1
+#define UCSZ01  2
+#define USBS0   3
+#define UPM00   4
+#define UPM01   5
+#define UMSEL00 6
+#define UMSEL01 7
+
+#define UBRR0   _SFR_MEM16(0xC4)
+#define UBRR0L  _SFR_MEM8(0xC4)
+#define UBRR0H  _SFR_MEM8(0xC5)
+#define UDR0    _SFR_MEM8(0xC6)
+
+// Interrupt vectors
+#define INT0_vect           __vector_1
+#define INT1_vect           __vector_2
+#define PCINT0_vect         __vector_3
+#define PCINT1_vect         __vector_4
+#define PCINT2_vect         __vector_5
+#define WDT_vect            __vector_6
+#define TIMER2_COMPA_vect   __vector_7
+#define TIMER2_COMPB_vect   __vector_8
+#define TIMER2_OVF_vect     __vector_9
+#define TIMER1_CAPT_vect    __vector_10
+#define TIMER1_COMPA_vect   __vector_11
+#define TIMER1_COMPB_vect   __vector_12
+#define TIMER1_OVF_vect     __vector_13
+#define TIMER0_COMPA_vect   __vector_14
+#define TIMER0_COMPB_vect   __vector_15
+#define TIMER0_OVF_vect     __vector_16
+#define SPI_STC_vect        __vector_17
+#define USART_RX_vect       __vector_18
+#define USART_UDRE_vect     __vector_19
+#define USART_TX_vect       __vector_20
+#define ADC_vect            __vector_21
+#define EE_READY_vect       __vector_22
+#define ANALOG_COMP_vect    __vector_23
+#define TWI_vect            __vector_24
+#define SPM_READY_vect      __vector_25
+
+#endif /* HOST_AVR_IO_H_ */
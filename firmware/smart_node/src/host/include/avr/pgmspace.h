@@ -0,0 +1,23 @@
+/**
+ * @file pgmspace.h
+ *
+ * @brief Program memory, host backend: one address space, plain reads
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(address)      (*(const uint8_t *)(address))
+#define pgm_read_word(address)      (*(const uint16_t *)(address))
+#define pgm_read_ptr(address)       (*(const void * const *)(address))
+#define memcpy_P(dest, src, size)   memcpy((dest), (src), (size))
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
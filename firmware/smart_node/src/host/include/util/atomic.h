@@ -0,0 +1,62 @@
+/**
+ * @file atomic.h
+ *
+ * @brief Atomic blocks, host backend
+ *
+ * @details Same semantic as avr-libc: restoring the I bit dispatches the
+ *          interrupts that became pending meanwhile
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef HOST_UTIL_ATOMIC_H_
+#define HOST_UTIL_ATOMIC_H_
+
+#include <avr/interrupt.h>
+
+static __inline__ uint8_t __iCliRetVal(void)
+{
+    cli();
+    return 1;
+}
+
+static __inline__ uint8_t __iSeiRetVal(void)
+{
+    sei();
+    return 1;
+}
+
+static __inline__ void __iRestore(const uint8_t *sreg)
+{
+    Host__SetSreg(*sreg);
+}
+
+static __inline__ void __iCliParam(const uint8_t *unused)
+{
+    cli();
+    (void)unused;
+}
+
+static __inline__ void __iSeiParam(const uint8_t *unused)
+{
+    sei();
+    (void)unused;
+}
+
+#define ATOMIC_BLOCK(type) \
+    for (type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0)
+
+#define NONATOMIC_BLOCK(type) \
+    for (type, __ToDo = __iSeiRetVal(); __ToDo; __ToDo = 0)
+
+#define ATOMIC_RESTORESTATE \
+    uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON \
+    uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+#define NONATOMIC_RESTORESTATE \
+    uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define NONATOMIC_FORCEOFF \
+    uint8_t sreg_save __attribute__((__cleanup__(__iCliParam))) = 0
+
+#endif /* HOST_UTIL_ATOMIC_H_ */
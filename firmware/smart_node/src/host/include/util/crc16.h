@@ -0,0 +1,109 @@
+/**
+ * @file crc16.h
+ *
+ * @brief CRC updates, host backend: the C equivalents given by avr-libc
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef HOST_UTIL_CRC16_H_
+#define HOST_UTIL_CRC16_H_
+
+#include <stdint.h>
+
+// Polynomial 0xA001 (x^16 + x^15 + x^2 + 1), reflected
+static __inline__ uint16_t _crc16_update(uint16_t crc, uint8_t a)
+{
+    int i;
+
+    crc ^= a;
+    for (i = 0; i < 8; ++i)
+    {
+        if (crc & 1)
+        {
+            crc = (crc >> 1) ^ 0xA001;
+        }
+        else
+        {
+            crc = (crc >> 1);
+        }
+    }
+
+    return crc;
+}
+
+// Polynomial 0x1021 (x^16 + x^12 + x^5 + 1)
+static __inline__ uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data)
+{
+    int i;
+
+    crc = crc ^ ((uint16_t)data << 8);
+    for (i = 0; i < 8; i++)
+    {
+        if (crc & 0x8000)
+        {
+            crc = (crc << 1) ^ 0x1021;
+        }
+        else
+        {
+            crc <<= 1;
+        }
+    }
+
+    return crc;
+}
+
+// Polynomial 0x8408, reflected 0x1021
+static __inline__ uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+    data ^= (uint8_t)crc;
+    data ^= data << 4;
+
+    return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4)
+            ^ ((uint16_t)data << 3));
+}
+
+// Maxim 1-Wire, polynomial 0x8C (x^8 + x^5 + x^4 + 1), reflected
+static __inline__ uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)
+{
+    uint8_t i;
+
+    crc = crc ^ data;
+    for (i = 0; i < 8; i++)
+    {
+        if (crc & 0x01)
+        {
+            crc = (crc >> 1) ^ 0x8C;
+        }
+        else
+        {
+            crc >>= 1;
+        }
+    }
+
+    return crc;
+}
+
+// Polynomial 0x07 (x^8 + x^2 + x + 1)
+static __inline__ uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+    uint8_t i;
+
+    crc ^= data;
+    for (i = 0; i < 8; i++)
+    {
+        if (crc & 0x80)
+        {
+            crc = (crc << 1) ^ 0x07;
+        }
+        else
+        {
+            crc <<= 1;
+        }
+    }
+
+    return crc;
+}
+
+#endif /* HOST_UTIL_CRC16_H_ */
@@ -0,0 +1,22 @@
+/**
+ * @file delay.h
+ *
+ * @brief Delays, host backend: they advance the virtual time
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#include <util/delay_basic.h>
+
+#ifndef F_CPU
+    #define F_CPU 16000000UL
+#endif
+
+#define _delay_us(us)   Host__Delay((uint64_t)((us) * (F_CPU / 1e6)))
+#define _delay_ms(ms)   Host__Delay((uint64_t)((ms) * (F_CPU / 1e3)))
+
+#endif /* HOST_UTIL_DELAY_H_ */
@@ -0,0 +1,28 @@
+/**
+ * @file delay_basic.h
+ *
+ * @brief Busy loops, host backend: they advance the virtual time
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef HOST_UTIL_DELAY_BASIC_H_
+#define HOST_UTIL_DELAY_BASIC_H_
+
+#include <stdint.h>
+#include "host.h"
+
+// 3 cycles per count, 0 is 256 counts
+static __inline__ void _delay_loop_1(uint8_t count)
+{
+    Host__Delay(3 * (count ? count : 256UL));
+}
+
+// 4 cycles per count, 0 is 65536 counts
+static __inline__ void _delay_loop_2(uint16_t count)
+{
+    Host__Delay(4 * (count ? count : 65536UL));
+}
+
+#endif /* HOST_UTIL_DELAY_BASIC_H_ */
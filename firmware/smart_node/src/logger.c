@@ -0,0 +1,805 @@
+/**
+ * @file logger.c
+ *
+ * @brief Circular data log in the external EEPROM
+ *
+ * @details Records are collected in a RAM page and written to the EEPROM
+ *          only when the page is full, with a single page write. Two RAM
+ *          pages are used, so records can still be appended while the
+ *          previous page is being written.
+ *          Each page carries a sequence number increasing by one, so at
+ *          boot the newest page is found with a binary search on the
+ *          sequence numbers (about ten page header reads), not with a full
+ *          scan of the memory.
+ *          The whole log can be streamed over the USART, oldest page first,
+ *          as fast as the USART drains its buffer.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <string.h>
+#include <util/crc16.h>
+#include "micro.h"
+#include "critical.h"
+#include "usart.h"
+#include "ext_eeprom.h"
+#include "trace.h"
+#include "radio.h"
+#include "logger.h"
+
+#define LOGGER_DUMP_CHUNK_SIZE  32
+#define LOGGER_PROBE_SIZE       4 // sequence number only
+#define LOGGER_RECOVERY_RETRIES 3
+
+typedef char LOGGER_PAGE_SIZE_CHECK[(sizeof(LOGGER_PAGE_T) == EXT_EEPROM_PAGE_SIZE) ? 1 : -1];
+typedef char LOGGER_RADIO_CHUNK_CHECK[((LOGGER_DUMP_CHUNK_SIZE % LOGGER_DUMP_RADIO_CHUNK) == 0 &&
+                                       (4 + LOGGER_DUMP_RADIO_CHUNK <= RADIO_PAYLOAD_SIZE)) ? 1 : -1];
+
+typedef enum {
+    STATE_RECOVERY_START = 0,
+    STATE_RECOVERY_FIRST,
+    STATE_RECOVERY_SEARCH,
+    STATE_RECOVERY_WRAP,
+    STATE_RECOVERY_HEAD,
+    STATE_READY,
+    STATE_DISABLED, // no working EEPROM, records are dropped
+} LOGGER_STATE_T;
+
+typedef enum {
+    DUMP_IDLE = 0,
+    DUMP_PAGE_HEADER,
+    DUMP_READ_CHUNK,
+    DUMP_WAIT_CHUNK,
+    DUMP_COPY_RAM_CHUNK,
+    DUMP_SEND_CHUNK,
+    DUMP_END,
+} LOGGER_DUMP_STATE_T;
+
+typedef union {
+    struct {
+        uint8_t probe_done :1;
+        uint8_t probe_ok :1;
+        uint8_t page_done :1;
+        uint8_t page_ok :1;
+        uint8_t dump_done :1;
+        uint8_t dump_ok :1;
+    };
+    uint8_t all;
+} LOGGER_EVENTS_T;
+
+static void RecoveryTask(LOGGER_EVENTS_T events);
+static void FlushTask(LOGGER_EVENTS_T events);
+static void DumpTask(LOGGER_EVENTS_T events);
+static BOOL_T SendPageHeader(void);
+static BOOL_T SendChunk(void);
+static BOOL_T SendEnd(void);
+static BOOL_T CloseActivePage(void);
+static void StartProbe(uint16_t page);
+static uint32_t GetProbeSequence(void);
+static uint16_t PageCrc(const LOGGER_PAGE_T *page);
+static inline uint16_t NextPage(uint16_t page);
+static uint16_t NextDumpPage(uint16_t page);
+static void OnProbeRead(EXT_EEPROM_RESULT_T result);
+static void OnPageTransfer(EXT_EEPROM_RESULT_T result);
+static void OnDumpRead(EXT_EEPROM_RESULT_T result);
+
+static LOGGER_PAGE_T Pages[2];
+static volatile uint8_t Active_Page;     // filled by Logger__Append
+static volatile uint8_t Active_Records;
+static volatile uint8_t Flush_Pending;   // the other page is full, to be written
+static uint8_t Flush_In_Progress;
+static uint16_t Flush_Target;
+static uint16_t Dropped_Records;
+
+static LOGGER_STATE_T Logger_State;
+static volatile LOGGER_EVENTS_T Logger_Events;
+static uint16_t Head_Page;               // newest page written
+static uint16_t Tail_Page;               // oldest page written
+static uint16_t Pages_Used;
+static uint32_t Next_Sequence;
+static uint32_t First_Sequence;
+static uint16_t Search_Low;
+static uint16_t Search_High;
+static uint16_t Search_Mid;
+static uint8_t Probe_Buffer[LOGGER_PROBE_SIZE];
+static uint8_t Recovery_Retries;
+
+static uint32_t Logger_Time_S;
+static uint8_t Time_Prescaler;
+static BOOL_T Time_Synced; // FALSE while the time only resumes from the log
+
+static LOGGER_DUMP_STATE_T Dump_State;
+static LOGGER_LINK_T Dump_Link;
+static uint16_t Dump_Page;
+static const LOGGER_PAGE_T *Dump_Source;    // RAM page being sent, NULL if empty
+static uint8_t Dump_Offset;
+static uint8_t Dump_Idx;
+static uint8_t Dump_Buffer[LOGGER_DUMP_CHUNK_SIZE];
+
+void Logger__Initialize(void)
+{
+    Active_Page = 0;
+    Active_Records = 0;
+    Flush_Pending = 0;
+    Flush_In_Progress = 0;
+    Dropped_Records = 0;
+
+    Head_Page = LOGGER_PAGES_NUMBER - 1;
+    Tail_Page = 0;
+    Pages_Used = 0;
+    Next_Sequence = 0;
+
+    Logger_Time_S = 0;
+    Time_Prescaler = 0;
+    Time_Synced = FALSE;
+
+    Logger_State = STATE_RECOVERY_START;
+    Logger_Events.all = 0;
+    Recovery_Retries = 0;
+    Dump_State = DUMP_IDLE;
+}
+
+/**
+ * @brief   Add a record to the log
+ *
+ * @details Can be called from the tasks. The record is kept in RAM until
+ *          its page is full.
+ *
+ * @return  FALSE if the record has been dropped because both RAM pages
+ *          are full
+ */
+BOOL_T Logger__Append(int16_t temperature, uint8_t status, uint8_t error)
+{
+    BOOL_T result = TRUE;
+    LOGGER_PAGE_T *page;
+    LOGGER_RECORD_T *record;
+    uint32_t now;
+
+    CRITICAL_BLOCK(CRITICAL_SITE_LOGGER)
+    {
+        now = Logger_Time_S;
+        page = &Pages[Active_Page];
+
+        // The page is closed early if the time delta would not fit
+        if (Active_Records != 0 &&
+            (Active_Records >= LOGGER_RECORDS_PER_PAGE ||
+             now - page->base_time >= LOGGER_TIME_UNUSED) &&
+            CloseActivePage() == FALSE)
+        {
+            Dropped_Records++;
+            result = FALSE;
+        }
+        else
+        {
+            page = &Pages[Active_Page];
+            if (Active_Records == 0)
+            {
+                memset(page, 0xFF, sizeof(LOGGER_PAGE_T));
+                page->base_time = now;
+            }
+
+            record = &page->records[Active_Records];
+            record->time_delta = (uint16_t)(now - page->base_time);
+            record->temperature = temperature;
+            record->status = status;
+            record->error = error;
+            Active_Records++;
+
+            if (Active_Records == LOGGER_RECORDS_PER_PAGE)
+            {
+                // If the other page is still being written, the next
+                // append retries
+                CloseActivePage();
+            }
+
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief   Set the log time, e.g. from a time synchronization message
+ */
+void Logger__SetTime(uint32_t seconds)
+{
+    CRITICAL_BLOCK(CRITICAL_SITE_LOGGER)
+    {
+        Logger_Time_S = seconds;
+        Time_Prescaler = 0;
+        Time_Synced = TRUE;
+    }
+}
+
+/**
+ * @brief   TRUE once the time has been set, since boot
+ */
+BOOL_T Logger__IsTimeSynced(void)
+{
+    return Time_Synced;
+}
+
+uint32_t Logger__GetTime(void)
+{
+    uint32_t result;
+
+    CRITICAL_BLOCK(CRITICAL_SITE_LOGGER)
+    {
+        result = Logger_Time_S;
+    }
+    return result;
+}
+
+/**
+ * @brief   Stream the whole log over the USART or the radio
+ *
+ * @details On the USART, each page is sent as LOGGER_DUMP_TAG, the page
+ *          index (2 bytes, big endian) and the raw page. On the radio, a
+ *          payload carries LOGGER_DUMP_TAG, the page index, the offset in
+ *          the page and LOGGER_DUMP_RADIO_CHUNK bytes of it, so a payload
+ *          lost on the air shows as a gap. The pages are sent from the
+ *          oldest one up to the newest, the pages written meanwhile
+ *          included. Then a full page waiting for its write is sent with
+ *          index LOGGER_DUMP_PENDING_PAGE, if any, and the page being
+ *          filled with index LOGGER_DUMP_RAM_PAGE, all 0xFF if it holds no
+ *          record yet. Then LOGGER_DUMP_END_TAG, alone in its payload on
+ *          the radio.
+ *
+ * @return  FALSE if the log is not recovered yet, a dump of the log is in
+ *          progress, or one of the trace on the USART
+ */
+BOOL_T Logger__StartDump(LOGGER_LINK_T link)
+{
+    if (Logger_State != STATE_READY || Dump_State != DUMP_IDLE ||
+        (link == LOGGER_LINK_USART && Trace__IsDumping()))
+    {
+        return FALSE;
+    }
+
+    if (Pages_Used != 0)
+    {
+        Dump_Page = Tail_Page;
+    }
+    else
+    {
+        Dump_Page = Flush_Pending ? LOGGER_DUMP_PENDING_PAGE : LOGGER_DUMP_RAM_PAGE;
+    }
+    Dump_Link = link;
+    Dump_State = DUMP_PAGE_HEADER;
+    return TRUE;
+}
+
+BOOL_T Logger__IsReady(void)
+{
+    return (Logger_State == STATE_READY) ? TRUE : FALSE;
+}
+
+/**
+ * @return  TRUE while a dump goes on the link
+ */
+BOOL_T Logger__IsDumping(LOGGER_LINK_T link)
+{
+    return (Dump_State != DUMP_IDLE && Dump_Link == link) ? TRUE : FALSE;
+}
+
+void Logger__100msTask(void)
+{
+    Time_Prescaler++;
+    if (Time_Prescaler >= 10)
+    {
+        Time_Prescaler = 0;
+        Logger_Time_S++;
+    }
+}
+
+/**
+ * @brief   Recovery, page write-back and dump
+ *
+ * @details Call it from the main loop, it never waits
+ */
+void Logger__FastTask(void)
+{
+    LOGGER_EVENTS_T events;
+
+    CRITICAL_BLOCK(CRITICAL_SITE_LOGGER)
+    {
+        events.all = Logger_Events.all;
+        Logger_Events.all = 0;
+    }
+
+    if (Logger_State < STATE_READY)
+    {
+        RecoveryTask(events);
+    }
+    else if (Logger_State == STATE_READY)
+    {
+        FlushTask(events);
+        DumpTask(events);
+    }
+}
+
+/**
+ * @brief   Find head and tail of the log
+ *
+ * @details Pages 0..head hold the sequence numbers first..first+head. The
+ *          pages after the head are either erased or older, so the head is
+ *          the last page for which sequence == first + index.
+ */
+static void RecoveryTask(LOGGER_EVENTS_T events)
+{
+    LOGGER_STATE_T next_state = Logger_State;
+    uint32_t sequence;
+    uint32_t time;
+    LOGGER_PAGE_T *page;
+    uint8_t i;
+
+    if (events.probe_done && !events.probe_ok)
+    {
+        // Never guess on a failed read, an empty log would be rewritten
+        // from page 0: start again, then give up
+        Recovery_Retries++;
+        Logger_State = (Recovery_Retries < LOGGER_RECOVERY_RETRIES) ?
+                STATE_RECOVERY_START : STATE_DISABLED;
+        return;
+    }
+
+    switch (Logger_State)
+    {
+        case STATE_RECOVERY_START:
+        {
+            StartProbe(0);
+            next_state = STATE_RECOVERY_FIRST;
+            break;
+        }
+        case STATE_RECOVERY_FIRST:
+        {
+            if (events.probe_done)
+            {
+                First_Sequence = GetProbeSequence();
+                if (First_Sequence == LOGGER_SEQUENCE_ERASED)
+                {
+                    // Empty log
+                    next_state = STATE_READY;
+                }
+                else
+                {
+                    Search_Low = 0;
+                    Search_High = LOGGER_PAGES_NUMBER - 1;
+                    Search_Mid = 0;
+                    events.probe_done = 0;
+                    next_state = STATE_RECOVERY_SEARCH;
+                }
+            }
+            if (next_state != STATE_RECOVERY_SEARCH)
+            {
+                break;
+            }
+        }
+        // fall through
+        case STATE_RECOVERY_SEARCH:
+        {
+            if (events.probe_done)
+            {
+                if (GetProbeSequence() == First_Sequence + Search_Mid)
+                {
+                    Search_Low = Search_Mid;
+                }
+                else
+                {
+                    Search_High = Search_Mid - 1;
+                }
+            }
+            else if (Search_Mid != 0)
+            {
+                break; // probe in progress
+            }
+
+            if (Search_Low < Search_High)
+            {
+                Search_Mid = (Search_Low + Search_High + 1) >> 1;
+                StartProbe(Search_Mid);
+            }
+            else
+            {
+                Head_Page = Search_Low;
+                Next_Sequence = First_Sequence + Head_Page + 1;
+                if (Head_Page == LOGGER_PAGES_NUMBER - 1)
+                {
+                    Pages_Used = LOGGER_PAGES_NUMBER;
+                    Tail_Page = 0;
+                    next_state = STATE_RECOVERY_HEAD;
+                }
+                else
+                {
+                    StartProbe(Head_Page + 1);
+                    next_state = STATE_RECOVERY_WRAP;
+                }
+            }
+            break;
+        }
+        case STATE_RECOVERY_WRAP:
+        {
+            if (events.probe_done)
+            {
+                sequence = GetProbeSequence();
+                if (sequence != LOGGER_SEQUENCE_ERASED)
+                {
+                    Pages_Used = LOGGER_PAGES_NUMBER;
+                    Tail_Page = Head_Page + 1;
+                }
+                else
+                {
+                    Pages_Used = Head_Page + 1;
+                    Tail_Page = 0;
+                }
+                next_state = STATE_RECOVERY_HEAD;
+            }
+            break;
+        }
+        case STATE_RECOVERY_HEAD:
+        {
+            // Read the newest page in the spare RAM page to resume the
+            // time from its last record, unless its write was torn
+            if (events.page_done)
+            {
+                page = &Pages[Flush_Target];
+                if (events.page_ok && Flush_Pending == 0 && page->crc == PageCrc(page))
+                {
+                    for (i = LOGGER_RECORDS_PER_PAGE; i > 0; i--)
+                    {
+                        if (page->records[i - 1].time_delta != LOGGER_TIME_UNUSED)
+                        {
+                            time = page->base_time + page->records[i - 1].time_delta + 1;
+                            if (time > Logger__GetTime())
+                            {
+                                Logger__SetTime(time);
+                            }
+                            break;
+                        }
+                    }
+                }
+                next_state = STATE_READY;
+            }
+            else if (Flush_In_Progress == 0)
+            {
+                Flush_Target = Active_Page ^ 1;
+                Flush_In_Progress = ExtEeprom__Read(
+                        (uint32_t)Head_Page * EXT_EEPROM_PAGE_SIZE,
+                        (uint8_t *)&Pages[Flush_Target], EXT_EEPROM_PAGE_SIZE,
+                        OnPageTransfer);
+                if (Flush_In_Progress == FALSE)
+                {
+                    next_state = STATE_READY;
+                }
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    if (next_state == STATE_READY)
+    {
+        Flush_In_Progress = 0;
+    }
+    Logger_State = next_state;
+}
+
+static void FlushTask(LOGGER_EVENTS_T events)
+{
+    LOGGER_PAGE_T *page;
+    uint8_t flush_page;
+
+    if (Flush_In_Progress)
+    {
+        if (events.page_done)
+        {
+            if (events.page_ok)
+            {
+                Head_Page = Flush_Target;
+                Next_Sequence++;
+                if (Pages_Used < LOGGER_PAGES_NUMBER)
+                {
+                    Pages_Used++;
+                }
+                else
+                {
+                    Tail_Page = NextPage(Tail_Page);
+                }
+            }
+            else
+            {
+                Dropped_Records += LOGGER_RECORDS_PER_PAGE;
+            }
+            Flush_In_Progress = 0;
+            Flush_Pending = 0;
+        }
+    }
+    else if (Flush_Pending)
+    {
+        flush_page = Active_Page ^ 1;
+        page = &Pages[flush_page];
+        page->sequence = Next_Sequence;
+        page->crc = PageCrc(page);
+        Flush_Target = NextPage(Head_Page);
+        Flush_In_Progress = ExtEeprom__Write(
+                (uint32_t)Flush_Target * EXT_EEPROM_PAGE_SIZE,
+                (const uint8_t *)page, EXT_EEPROM_PAGE_SIZE,
+                OnPageTransfer);
+    }
+}
+
+static void DumpTask(LOGGER_EVENTS_T events)
+{
+    const uint8_t *source;
+
+    switch (Dump_State)
+    {
+        case DUMP_PAGE_HEADER:
+        {
+            if (SendPageHeader())
+            {
+                Dump_Offset = 0;
+                if (Dump_Page == LOGGER_DUMP_PENDING_PAGE)
+                {
+                    Dump_Source = &Pages[Active_Page ^ 1];
+                    Dump_State = DUMP_COPY_RAM_CHUNK;
+                }
+                else if (Dump_Page == LOGGER_DUMP_RAM_PAGE)
+                {
+                    // Right after a page is closed, the buffer still holds
+                    // an older page, already written
+                    CRITICAL_BLOCK(CRITICAL_SITE_LOGGER)
+                    {
+                        Dump_Source = (Active_Records != 0) ? &Pages[Active_Page] : NULL;
+                    }
+                    Dump_State = DUMP_COPY_RAM_CHUNK;
+                }
+                else
+                {
+                    Dump_State = DUMP_READ_CHUNK;
+                }
+            }
+            break;
+        }
+        case DUMP_READ_CHUNK:
+        {
+            if (ExtEeprom__Read((uint32_t)Dump_Page * EXT_EEPROM_PAGE_SIZE + Dump_Offset,
+                                Dump_Buffer, LOGGER_DUMP_CHUNK_SIZE, OnDumpRead))
+            {
+                Dump_State = DUMP_WAIT_CHUNK;
+            }
+            break;
+        }
+        case DUMP_WAIT_CHUNK:
+        {
+            if (events.dump_done)
+            {
+                if (!events.dump_ok)
+                {
+                    memset(Dump_Buffer, 0xFF, LOGGER_DUMP_CHUNK_SIZE);
+                }
+                Dump_Idx = 0;
+                Dump_State = DUMP_SEND_CHUNK;
+            }
+            break;
+        }
+        case DUMP_COPY_RAM_CHUNK:
+        {
+            if (Dump_Source == NULL)
+            {
+                memset(Dump_Buffer, 0xFF, LOGGER_DUMP_CHUNK_SIZE);
+            }
+            else
+            {
+                CRITICAL_BLOCK(CRITICAL_SITE_LOGGER)
+                {
+                    source = (const uint8_t *)Dump_Source;
+                    memcpy(Dump_Buffer, source + Dump_Offset, LOGGER_DUMP_CHUNK_SIZE);
+                }
+            }
+            Dump_Idx = 0;
+            Dump_State = DUMP_SEND_CHUNK;
+            break;
+        }
+        case DUMP_SEND_CHUNK:
+        {
+            if (SendChunk())
+            {
+                Dump_Offset += LOGGER_DUMP_CHUNK_SIZE;
+                if (Dump_Offset < EXT_EEPROM_PAGE_SIZE)
+                {
+                    Dump_State = (Dump_Page >= LOGGER_DUMP_PENDING_PAGE) ?
+                            DUMP_COPY_RAM_CHUNK : DUMP_READ_CHUNK;
+                }
+                else if (Dump_Page == LOGGER_DUMP_RAM_PAGE)
+                {
+                    Dump_State = DUMP_END;
+                }
+                else
+                {
+                    Dump_Page = NextDumpPage(Dump_Page);
+                    Dump_State = DUMP_PAGE_HEADER;
+                }
+            }
+            break;
+        }
+        case DUMP_END:
+        {
+            if (SendEnd())
+            {
+                Dump_State = DUMP_IDLE;
+            }
+            break;
+        }
+        case DUMP_IDLE:
+        default:
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @details On the radio, the page index goes in each payload instead
+ */
+static BOOL_T SendPageHeader(void)
+{
+    if (Dump_Link == LOGGER_LINK_RADIO)
+    {
+        return TRUE;
+    }
+    if (Usart__GetTxFreeSpace() < 3)
+    {
+        return FALSE;
+    }
+    Usart__PutChar(LOGGER_DUMP_TAG);
+    Usart__PutChar((uint8_t)(Dump_Page >> 8));
+    Usart__PutChar((uint8_t)Dump_Page);
+    return TRUE;
+}
+
+/**
+ * @brief   Send what is left of the chunk, as the link takes it
+ *
+ * @return  TRUE once the whole chunk is sent
+ */
+static BOOL_T SendChunk(void)
+{
+    uint8_t payload[RADIO_PAYLOAD_SIZE] = {LOGGER_DUMP_TAG};
+
+    if (Dump_Link == LOGGER_LINK_RADIO)
+    {
+        payload[1] = (uint8_t)(Dump_Page >> 8);
+        payload[2] = (uint8_t)Dump_Page;
+        payload[3] = Dump_Offset + Dump_Idx;
+        memcpy(&payload[4], &Dump_Buffer[Dump_Idx], LOGGER_DUMP_RADIO_CHUNK);
+        if (Radio__Transmit(payload))
+        {
+            Dump_Idx += LOGGER_DUMP_RADIO_CHUNK;
+        }
+    }
+    else
+    {
+        while (Dump_Idx < LOGGER_DUMP_CHUNK_SIZE && Usart__GetTxFreeSpace() != 0)
+        {
+            Usart__PutChar(Dump_Buffer[Dump_Idx]);
+            Dump_Idx++;
+        }
+    }
+    return (Dump_Idx == LOGGER_DUMP_CHUNK_SIZE) ? TRUE : FALSE;
+}
+
+static BOOL_T SendEnd(void)
+{
+    uint8_t payload[RADIO_PAYLOAD_SIZE] = {LOGGER_DUMP_END_TAG};
+
+    if (Dump_Link == LOGGER_LINK_RADIO)
+    {
+        return Radio__Transmit(payload);
+    }
+    if (Usart__GetTxFreeSpace() == 0)
+    {
+        return FALSE;
+    }
+    Usart__PutChar(LOGGER_DUMP_END_TAG);
+    return TRUE;
+}
+
+/**
+ * @brief   Hand the active page over to the write-back
+ *
+ * @details Called with interrupts disabled
+ */
+static BOOL_T CloseActivePage(void)
+{
+    if (Flush_Pending)
+    {
+        return FALSE;
+    }
+
+    Flush_Pending = 1;
+    Active_Page ^= 1;
+    Active_Records = 0;
+    return TRUE;
+}
+
+/**
+ * @brief   Page to dump after this one: the EEPROM pages up to the head,
+ *          which moves if a page is written meanwhile, then the full page
+ *          waiting for its write, then the page being filled
+ */
+static uint16_t NextDumpPage(uint16_t page)
+{
+    if (page == LOGGER_DUMP_PENDING_PAGE)
+    {
+        return LOGGER_DUMP_RAM_PAGE;
+    }
+    if (page != Head_Page)
+    {
+        return NextPage(page);
+    }
+    return Flush_Pending ? LOGGER_DUMP_PENDING_PAGE : LOGGER_DUMP_RAM_PAGE;
+}
+
+static void StartProbe(uint16_t page)
+{
+    if (ExtEeprom__Read((uint32_t)page * EXT_EEPROM_PAGE_SIZE, Probe_Buffer,
+                        LOGGER_PROBE_SIZE, OnProbeRead) == FALSE)
+    {
+        Logger_Events.probe_ok = 0;
+        Logger_Events.probe_done = 1;
+    }
+}
+
+static uint32_t GetProbeSequence(void)
+{
+    uint32_t result;
+
+    memcpy(&result, Probe_Buffer, sizeof(result));
+    return result;
+}
+
+static uint16_t PageCrc(const LOGGER_PAGE_T *page)
+{
+    const uint8_t *data = (const uint8_t *)page;
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    for (i = 0; i < sizeof(LOGGER_PAGE_T) - sizeof(page->crc); i++)
+    {
+        crc = _crc16_update(crc, data[i]);
+    }
+    return crc;
+}
+
+static inline uint16_t NextPage(uint16_t page)
+{
+    page++;
+    if (page >= LOGGER_PAGES_NUMBER)
+    {
+        page = 0;
+    }
+    return page;
+}
+
+static void OnProbeRead(EXT_EEPROM_RESULT_T result)
+{
+    Logger_Events.probe_ok = (result == EXT_EEPROM_RESULT_OK);
+    Logger_Events.probe_done = 1;
+}
+
+static void OnPageTransfer(EXT_EEPROM_RESULT_T result)
+{
+    Logger_Events.page_ok = (result == EXT_EEPROM_RESULT_OK);
+    Logger_Events.page_done = 1;
+}
+
+static void OnDumpRead(EXT_EEPROM_RESULT_T result)
+{
+    Logger_Events.dump_ok = (result == EXT_EEPROM_RESULT_OK);
+    Logger_Events.dump_done = 1;
+}
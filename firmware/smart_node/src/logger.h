@@ -0,0 +1,65 @@
+/**
+ * @file logger.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include "micro.h"
+#include "ext_eeprom.h"
+
+#define LOGGER_RECORDS_PER_PAGE 19
+#define LOGGER_PAGES_NUMBER     (uint16_t)(EXT_EEPROM_SIZE / EXT_EEPROM_PAGE_SIZE)
+#define LOGGER_SEQUENCE_ERASED  0xFFFFFFFFUL
+#define LOGGER_TIME_UNUSED      0xFFFF
+
+#define LOGGER_DUMP_TAG             'L'
+#define LOGGER_DUMP_END_TAG         'E'
+#define LOGGER_DUMP_RAM_PAGE        0xFFFF // page index of the page being filled
+#define LOGGER_DUMP_PENDING_PAGE    0xFFFE // page index of a full page not written yet
+#define LOGGER_DUMP_RADIO_CHUNK     16     // bytes of a page per radio payload
+
+// Record status bits
+#define LOGGER_STATUS_RELAY_0   0x01
+#define LOGGER_STATUS_RELAY_1   0x02
+#define LOGGER_STATUS_DEGRADED  0x04
+#define LOGGER_STATUS_FAILSAFE  0x08
+
+typedef enum {
+    LOGGER_LINK_USART = 0,
+    LOGGER_LINK_RADIO,
+} LOGGER_LINK_T;
+
+typedef struct {
+    uint16_t time_delta;    // seconds after the page base time
+    int16_t temperature;    // Q12.4
+    uint8_t status;
+    uint8_t error;
+} LOGGER_RECORD_T;
+
+/**
+ * One EEPROM page, little endian. Unused records are left erased (0xFF).
+ */
+typedef struct {
+    uint32_t sequence;      // increases by one for each page written
+    uint32_t base_time;     // seconds
+    LOGGER_RECORD_T records[LOGGER_RECORDS_PER_PAGE];
+    uint8_t reserved[4];
+    uint16_t crc;           // CRC-16 of all the previous bytes
+} LOGGER_PAGE_T;
+
+void Logger__Initialize(void);
+BOOL_T Logger__Append(int16_t temperature, uint8_t status, uint8_t error);
+void Logger__SetTime(uint32_t seconds);
+uint32_t Logger__GetTime(void);
+BOOL_T Logger__IsTimeSynced(void);
+BOOL_T Logger__StartDump(LOGGER_LINK_T link);
+BOOL_T Logger__IsReady(void);
+BOOL_T Logger__IsDumping(LOGGER_LINK_T link);
+void Logger__100msTask(void);
+void Logger__FastTask(void);
+
+#endif /* LOGGER_H_ */
@@ -17,13 +17,25 @@
 
 #include "micro.h"
 #include "timer.h"
+#include "trace.h"
+#include "event.h"
+#include "critical.h"
+#include "memory.h"
 #include "usart.h"
+#include "adc.h"
+#include "ext_eeprom.h"
 #include "spi.h"
 #include "radio.h"
 #include "temp_sensor.h"
 #include "thermostat.h"
 #include "parameters.h"
+#include "schedule.h"
+#include "optimal_start.h"
 #include "relays.h"
+#include "metering.h"
+#include "relay_tuning.h"
+#include "logger.h"
+#include "command.h"
 #include "ui.h"
 #include "main.h"
 
@@ -31,11 +43,26 @@ int main(void)
 {
 	// Initialization routines
 	Timer__Initialize();
+	Trace__Initialize();
+	Event__Initialize();
+	Critical__Initialize();
+	Memory__Initialize();
 	Usart__Initialize();
+	Adc__Initialize();
+	ExtEeprom__Initialize();
+	Spi__Initialize();
 	Relays__Initialize();
+	Radio__Initialize();
 	Ui__Initialize();
 	TempSensor__Initialize();
+	Parameters__Initialize();
+	Schedule__Initialize();
+	OptimalStart__Initialize();
 	Thermostat__Initialize();
+	Metering__Initialize();
+	RelayTuning__Initialize();
+	Logger__Initialize();
+	Command__Initialize();
 	Micro__EnableInterrupts();
 
 	Ui__LedBlink500ms(5);
@@ -44,6 +71,17 @@ int main(void)
 	while(1)
     {
 	    Usart__FastTask();
+	    Event__FastTask();
+	    Logger__FastTask();
+	    if (Logger__IsDumping(LOGGER_LINK_USART) == FALSE)
+	    {
+	        // A fault dump waits for the end of a log dump
+	        Trace__FastTask();
+	    }
+	    Command__FastTask();
+	    RelayTuning__FastTask();
+	    Memory__FastTask();
+	    Micro__Idle();
     }
 }
 
@@ -56,19 +94,29 @@ ISR(TIMER0_COMPA_vect, ISR_NOBLOCK)
 {
     uint8_t prescaler;
     
-	// Increment the base counter
-    prescaler = Timer__GetCounter()++;
+	// Clock and software timers first, for the timestamps of the tasks
+    Timer__1msTask();
+
+	// Increment the base counter, 100 ticks per period
+    prescaler = ++Timer__GetCounter();
 
 	// Execute the 1ms tasks
     TempSensor__1msTask();
     Relays__1msTask();
+    Radio__1msTask();
+    ExtEeprom__1msTask();
     
 	// Execute the 100ms tasks
 	if (prescaler == 100)
 	{
 	    Timer__ResetCounter();
+        Parameters__100msTask();
+        Schedule__100msTask();
+        OptimalStart__100msTask();
         Thermostat__100msTask();
-	    Ui__100msTask();
+        Metering__100msTask();
+        RelayTuning__100msTask();
+        Logger__100msTask();
 	}
 
 }
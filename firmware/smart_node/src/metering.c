@@ -0,0 +1,341 @@
+/**
+ * @file metering.c
+ *
+ * @brief RMS current and energy metering of the relay loads
+ *
+ * @details The ADC is triggered by the 1ms system tick and samples one
+ *          current sensor per relay, so each measurement window covers a
+ *          whole number of mains cycles. The ADC ISR only accumulates the
+ *          sum and the sum of squares of the samples; the RMS value (integer
+ *          square root) and the energy are computed once per window from the
+ *          100ms task.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "critical.h"
+#include "adc.h"
+#include "relays.h"
+#include "usart.h"
+#include "radio.h"
+#include "metering.h"
+
+// User parameters
+#define METERING_MAINS_FREQUENCY_HZ 50
+#define METERING_MAINS_VOLTAGE_V    230
+#define METERING_WINDOW_CYCLES      10
+#define METERING_INRUSH_WINDOWS     5 // 1 second after switch on
+#define METERING_NOISE_FLOOR_MA     50
+#define METERING_MA_PER_COUNT_Q8    6758 // 26.4 mA/count, ACS712-5A on 5V AVCC
+
+#define METERING_SAMPLE_RATE_HZ     (1000 / METERING_CHANNELS_NUMBER)
+#define METERING_SAMPLES_PER_WINDOW \
+    (METERING_SAMPLE_RATE_HZ / METERING_MAINS_FREQUENCY_HZ * METERING_WINDOW_CYCLES)
+#define METERING_WINDOW_MS          (METERING_WINDOW_CYCLES * 1000 / METERING_MAINS_FREQUENCY_HZ)
+#define METERING_MWMS_PER_MWH       3600000UL
+
+#define METERING_REPORT_TAG         'M'
+
+#if (METERING_SAMPLE_RATE_HZ % METERING_MAINS_FREQUENCY_HZ) != 0
+    #error "Sampling is not synchronous with the mains frequency!!"
+#endif
+
+typedef struct {
+    uint32_t sum;
+    uint32_t sum_squares; // of the samples minus the offset
+    uint16_t samples;
+    uint16_t peak;        // highest absolute deviation from the offset
+    int16_t offset;       // sensor zero, mean of the previous window
+} METERING_ACCUMULATOR_T;
+
+typedef struct {
+    uint32_t sum;
+    uint32_t sum_squares;
+    uint16_t peak;
+    int16_t offset;
+    volatile uint8_t ready;
+} METERING_WINDOW_T;
+
+// ADC channel of the current sensor of each relay
+static const ADC_CHANNEL_T Metering_Channels[METERING_CHANNELS_NUMBER] = {
+    ADC_CHANNEL_0, // RELAY_0
+    ADC_CHANNEL_1, // RELAY_1
+};
+
+static METERING_ACCUMULATOR_T Accumulators[METERING_CHANNELS_NUMBER];
+static METERING_WINDOW_T Windows[METERING_CHANNELS_NUMBER];
+static METERING_COUNTERS_T Counters[METERING_CHANNELS_NUMBER];
+static uint32_t Energy_Remainder[METERING_CHANNELS_NUMBER]; // mW*ms
+static uint8_t Inrush_Windows[METERING_CHANNELS_NUMBER];
+static uint8_t Load_Active[METERING_CHANNELS_NUMBER];
+
+static void OnSample(uint8_t slot, uint16_t value);
+static void ProcessWindow(uint8_t slot);
+static uint16_t SquareRoot(uint32_t value);
+
+void Metering__Initialize(void)
+{
+    ADC_CONFIG_T config;
+    uint8_t i;
+
+    for (i = 0; i < METERING_CHANNELS_NUMBER; i++)
+    {
+        Accumulators[i].sum = 0;
+        Accumulators[i].sum_squares = 0;
+        Accumulators[i].samples = 0;
+        Accumulators[i].peak = 0;
+        Accumulators[i].offset = 512; // mid scale
+        Windows[i].ready = 0;
+        Counters[i].energy_mwh = 0;
+        Counters[i].rms_ma = 0;
+        Counters[i].peak_ma = 0;
+        Counters[i].inrush_ma = 0;
+        Counters[i].switch_count = 0;
+        Counters[i].overruns = 0;
+        Energy_Remainder[i] = 0;
+        Inrush_Windows[i] = 0;
+        Load_Active[i] = 0;
+
+        config.sequence[i] = Metering_Channels[i];
+    }
+
+    config.trigger = ADC_TRIGGER_TIMER0_COMPARE;
+    config.oversampling_bits = 0;
+    config.length = METERING_CHANNELS_NUMBER;
+    config.callback = OnSample;
+    Adc__Configure(&config);
+    Adc__Start();
+}
+
+void Metering__100msTask(void)
+{
+    uint8_t i;
+    uint8_t active;
+
+    for (i = 0; i < METERING_CHANNELS_NUMBER; i++)
+    {
+        // Track switch on events to catch the inrush current
+        active = Relays__IsSet((RELAY_T)i);
+        if (active && !Load_Active[i])
+        {
+            Counters[i].switch_count++;
+            // The window holding the switching may already be processed
+            Counters[i].inrush_ma = Counters[i].peak_ma;
+            Inrush_Windows[i] = METERING_INRUSH_WINDOWS;
+        }
+        Load_Active[i] = active;
+
+        if (Windows[i].ready)
+        {
+            ProcessWindow(i);
+            Windows[i].ready = 0;
+        }
+    }
+}
+
+void Metering__GetCounters(RELAY_T relay, METERING_COUNTERS_T *counters)
+{
+    CRITICAL_BLOCK(CRITICAL_SITE_METERING)
+    {
+        *counters = Counters[relay];
+    }
+}
+
+/**
+ * @brief   Write the counters of a relay in a report frame
+ *
+ * @details Multi-byte fields are big endian. The frame fits a single
+ *          radio payload.
+ *
+ * @return  the number of bytes written, METERING_REPORT_SIZE
+ */
+uint8_t Metering__SerializeCounters(RELAY_T relay, uint8_t *buffer)
+{
+    METERING_COUNTERS_T counters;
+
+    Metering__GetCounters(relay, &counters);
+
+    buffer[0] = METERING_REPORT_TAG;
+    buffer[1] = relay;
+    buffer[2] = (uint8_t)(counters.energy_mwh >> 24);
+    buffer[3] = (uint8_t)(counters.energy_mwh >> 16);
+    buffer[4] = (uint8_t)(counters.energy_mwh >> 8);
+    buffer[5] = (uint8_t)counters.energy_mwh;
+    buffer[6] = (uint8_t)(counters.rms_ma >> 8);
+    buffer[7] = (uint8_t)counters.rms_ma;
+    buffer[8] = (uint8_t)(counters.peak_ma >> 8);
+    buffer[9] = (uint8_t)counters.peak_ma;
+    buffer[10] = (uint8_t)(counters.inrush_ma >> 8);
+    buffer[11] = (uint8_t)counters.inrush_ma;
+    buffer[12] = (uint8_t)(counters.switch_count >> 8);
+    buffer[13] = (uint8_t)counters.switch_count;
+    buffer[14] = counters.overruns;
+
+    return METERING_REPORT_SIZE;
+}
+
+/**
+ * @brief   Send the counters of a relay over the USART
+ *
+ * @return  FALSE if the USART buffer has no room for the whole frame
+ */
+BOOL_T Metering__SendReport(RELAY_T relay)
+{
+    uint8_t buffer[METERING_REPORT_SIZE];
+    uint8_t size;
+    uint8_t i;
+
+    if (Usart__GetTxFreeSpace() < METERING_REPORT_SIZE)
+    {
+        return FALSE;
+    }
+
+    size = Metering__SerializeCounters(relay, buffer);
+    for (i = 0; i < size; i++)
+    {
+        Usart__PutChar(buffer[i]);
+    }
+    return TRUE;
+}
+
+/**
+ * @brief   Send the counters of a relay in a radio payload, zero padded
+ *
+ * @details From the context of Radio__Transmit
+ *
+ * @return  FALSE if the radio has not sent the previous payload yet
+ */
+BOOL_T Metering__TransmitReport(RELAY_T relay)
+{
+    uint8_t payload[RADIO_PAYLOAD_SIZE] = {0};
+
+    (void)Metering__SerializeCounters(relay, payload);
+    return Radio__Transmit(payload);
+}
+
+/**
+ * ADC callback, runs in the ADC ISR at METERING_SAMPLE_RATE_HZ per channel
+ */
+static void OnSample(uint8_t slot, uint16_t value)
+{
+    METERING_ACCUMULATOR_T *acc = &Accumulators[slot];
+    int16_t deviation;
+
+    deviation = (int16_t)value - acc->offset;
+    acc->sum += value;
+    acc->sum_squares += (uint32_t)((int32_t)deviation * deviation);
+    if (deviation < 0)
+    {
+        deviation = -deviation;
+    }
+    if ((uint16_t)deviation > acc->peak)
+    {
+        acc->peak = deviation;
+    }
+
+    acc->samples++;
+    if (acc->samples == METERING_SAMPLES_PER_WINDOW)
+    {
+        if (Windows[slot].ready == 0)
+        {
+            Windows[slot].sum = acc->sum;
+            Windows[slot].sum_squares = acc->sum_squares;
+            Windows[slot].peak = acc->peak;
+            Windows[slot].offset = acc->offset;
+            Windows[slot].ready = 1;
+        }
+        else if (Counters[slot].overruns != 0xFF)
+        {
+            Counters[slot].overruns++;
+        }
+        acc->sum = 0;
+        acc->sum_squares = 0;
+        acc->samples = 0;
+        acc->peak = 0;
+    }
+}
+
+static void ProcessWindow(uint8_t slot)
+{
+    METERING_WINDOW_T *window = &Windows[slot];
+    METERING_COUNTERS_T *counters = &Counters[slot];
+    int16_t mean;
+    int16_t drift;
+    uint32_t mean_square;
+    uint32_t drift_square;
+    uint16_t rms_ma;
+    uint16_t peak_ma;
+
+    // Variance around the real mean, the ISR used the previous mean as offset
+    mean = (int16_t)(window->sum / METERING_SAMPLES_PER_WINDOW);
+    drift = mean - window->offset;
+    mean_square = window->sum_squares / METERING_SAMPLES_PER_WINDOW;
+    drift_square = (uint32_t)((int32_t)drift * drift);
+    mean_square = (mean_square > drift_square) ? (mean_square - drift_square) : 0;
+
+    rms_ma = (uint16_t)(((uint32_t)SquareRoot(mean_square) * METERING_MA_PER_COUNT_Q8) >> 8);
+    peak_ma = (uint16_t)(((uint32_t)window->peak * METERING_MA_PER_COUNT_Q8) >> 8);
+    if (rms_ma < METERING_NOISE_FLOOR_MA)
+    {
+        rms_ma = 0;
+    }
+
+    CRITICAL_BLOCK(CRITICAL_SITE_METERING)
+    {
+        Accumulators[slot].offset = mean;
+
+        counters->rms_ma = rms_ma;
+        counters->peak_ma = peak_ma;
+        if (Inrush_Windows[slot] != 0)
+        {
+            Inrush_Windows[slot]--;
+            if (peak_ma > counters->inrush_ma)
+            {
+                counters->inrush_ma = peak_ma;
+            }
+        }
+    }
+
+    // Resistive loads: P = V * I
+    Energy_Remainder[slot] += (uint32_t)METERING_MAINS_VOLTAGE_V * rms_ma * METERING_WINDOW_MS;
+    if (Energy_Remainder[slot] >= METERING_MWMS_PER_MWH)
+    {
+        CRITICAL_BLOCK(CRITICAL_SITE_METERING)
+        {
+            counters->energy_mwh += Energy_Remainder[slot] / METERING_MWMS_PER_MWH;
+        }
+        Energy_Remainder[slot] %= METERING_MWMS_PER_MWH;
+    }
+}
+
+/**
+ * @brief   Integer square root, bit by bit
+ */
+static uint16_t SquareRoot(uint32_t value)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while (bit != 0)
+    {
+        if (value >= result + bit)
+        {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint16_t)result;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file metering.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef METERING_H_
+#define METERING_H_
+
+#include "micro.h"
+#include "relays.h"
+
+#define METERING_CHANNELS_NUMBER    2 // one current sensor per relay
+#define METERING_REPORT_SIZE        15
+
+typedef struct {
+    uint32_t energy_mwh;    // since boot
+    uint16_t rms_ma;        // last measurement window
+    uint16_t peak_ma;       // highest instantaneous current, last window
+    uint16_t inrush_ma;     // highest instantaneous current after the last switch on
+    uint16_t switch_count;  // switch on events since boot
+    uint8_t overruns;       // windows lost because the task was late
+} METERING_COUNTERS_T;
+
+void Metering__Initialize(void);
+void Metering__100msTask(void);
+void Metering__GetCounters(RELAY_T relay, METERING_COUNTERS_T *counters);
+uint8_t Metering__SerializeCounters(RELAY_T relay, uint8_t *buffer);
+BOOL_T Metering__SendReport(RELAY_T relay);
+BOOL_T Metering__TransmitReport(RELAY_T relay);
+
+#endif /* METERING_H_ */
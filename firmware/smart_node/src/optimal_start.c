@@ -0,0 +1,304 @@
+/**
+ * @file optimal_start.c
+ *
+ * @brief Optimal start: pre-heat just in time for the next schedule change
+ *
+ * @details Each time the setpoint steps up, the time taken to reach it is
+ *          measured and turned into a heating rate, in Q12.4 units per
+ *          minute with 8 fractional bits. Rates are kept per bucket of
+ *          indoor - outdoor temperature, averaged with an exponential
+ *          weight, and stored in the internal EEPROM.
+ *          Before a scheduled rise, the time needed to heat up is predicted
+ *          from the rate of the current bucket, and the next setpoint is
+ *          used as soon as the change is that close, not earlier.
+ *          The outdoor temperature comes from the gateway; without a
+ *          recent one, OPTIMAL_START_DEFAULT_OUTDOOR is assumed.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <util/crc16.h>
+#include "micro.h"
+#include "int_eeprom.h"
+#include "schedule.h"
+#include "thermostat.h"
+#include "optimal_start.h"
+
+#define OPTIMAL_START_MAX_PREHEAT_MIN       180
+#define OPTIMAL_START_DEFAULT_RATE          68  // 1 C/h
+#define OPTIMAL_START_MIN_RATE              8   // ~0.1 C/h, bounds the prediction
+#define OPTIMAL_START_EWMA_SHIFT            2   // new measure weighs 1/4
+#define OPTIMAL_START_MIN_RISE              REAL_TO_FIXED_TEMPERATURE(0.5f)
+#define OPTIMAL_START_MIN_MEASURE_MIN       10
+#define OPTIMAL_START_MAX_MEASURE_MIN       360
+#define OPTIMAL_START_OUTDOOR_MAX_AGE_MIN   120
+#define OPTIMAL_START_DEFAULT_OUTDOOR       REAL_TO_FIXED_TEMPERATURE(5.0f)
+#define OPTIMAL_START_100MS_PER_MIN         600
+
+typedef struct {
+    uint16_t rates[OPTIMAL_START_BUCKETS_NUMBER];
+    uint16_t crc;
+} OPTIMAL_START_MODEL_T;
+
+typedef char OPTIMAL_START_MODEL_SIZE_CHECK[(sizeof(OPTIMAL_START_MODEL_T) <= INT_EEPROM_OPTIMAL_START_SIZE) ? 1 : -1];
+
+static OPTIMAL_START_MODEL_T Model; // also the EEPROM write buffer
+static BOOL_T Save_Pending;
+static BOOL_T Saving;
+static int16_t Setpoint;
+static int16_t Last_Setpoint;
+static BOOL_T Preheating;
+static int16_t Preheat_Target;
+static int16_t Outdoor_Temperature;
+static uint16_t Outdoor_Age_Min;
+static uint16_t Minute_Prescaler;
+static BOOL_T Measuring;
+static int16_t Measure_Start_Temperature;
+static int16_t Measure_Target;
+static uint16_t Measure_Minutes;
+static uint8_t Measure_Bucket;
+
+static uint8_t Bucket(int16_t temperature);
+static uint16_t PredictMinutes(int16_t temperature, int16_t target);
+static void Learn(BOOL_T valid, int16_t temperature);
+static void UpdateModel(uint8_t bucket, uint16_t rate);
+static uint16_t ModelCrc(const OPTIMAL_START_MODEL_T *model);
+
+void OptimalStart__Initialize(void)
+{
+    BOOL_T valid;
+    uint8_t i;
+
+    Save_Pending = FALSE;
+    Saving = FALSE;
+    Preheating = FALSE;
+    Measuring = FALSE;
+    Minute_Prescaler = 0;
+    Outdoor_Age_Min = OPTIMAL_START_OUTDOOR_MAX_AGE_MIN;
+    Setpoint = Schedule__GetSetpoint();
+    Last_Setpoint = Setpoint;
+
+    IntEeprom__Read(INT_EEPROM_OPTIMAL_START_BASE, (uint8_t *)&Model, sizeof(Model));
+    valid = (ModelCrc(&Model) == Model.crc) ? TRUE : FALSE;
+    for (i = 0; i < OPTIMAL_START_BUCKETS_NUMBER; i++)
+    {
+        if (valid == FALSE || Model.rates[i] < OPTIMAL_START_MIN_RATE)
+        {
+            Model.rates[i] = OPTIMAL_START_DEFAULT_RATE;
+        }
+    }
+}
+
+/**
+ * @brief   Outdoor temperature from the gateway, Q12.4
+ */
+void OptimalStart__SetOutdoorTemperature(int16_t temperature)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        Outdoor_Temperature = temperature;
+        Outdoor_Age_Min = 0;
+    }
+}
+
+/**
+ * @brief   Schedule setpoint, or the next one while pre-heating, Q12.4
+ */
+int16_t OptimalStart__GetSetpoint(void)
+{
+    return Setpoint;
+}
+
+/**
+ * @return  learnt heating rate, Q12.4 per minute with 8 fractional bits
+ */
+uint16_t OptimalStart__GetRate(uint8_t bucket)
+{
+    return Model.rates[bucket];
+}
+
+/**
+ * @details Run it after the schedule and before the thermostat
+ */
+void OptimalStart__100msTask(void)
+{
+    int16_t schedule_setpoint;
+    int16_t next_setpoint;
+    int16_t temperature;
+    uint16_t minutes;
+    BOOL_T valid;
+
+    Minute_Prescaler++;
+    if (Minute_Prescaler >= OPTIMAL_START_100MS_PER_MIN)
+    {
+        Minute_Prescaler = 0;
+        if (Outdoor_Age_Min < OPTIMAL_START_OUTDOOR_MAX_AGE_MIN)
+        {
+            Outdoor_Age_Min++;
+        }
+        if (Measuring)
+        {
+            Measure_Minutes++;
+        }
+    }
+
+    if (Saving)
+    {
+        if (IntEeprom__IsIdle())
+        {
+            Saving = FALSE;
+        }
+    }
+    else if (Save_Pending)
+    {
+        Model.crc = ModelCrc(&Model);
+        if (IntEeprom__Write(INT_EEPROM_OPTIMAL_START_BASE, (const uint8_t *)&Model, sizeof(Model)))
+        {
+            Save_Pending = FALSE;
+            Saving = TRUE;
+        }
+    }
+
+    schedule_setpoint = Schedule__GetSetpoint();
+    valid = Thermostat__GetTemperature(0, &temperature); // learnt on the first zone
+
+    if (Preheating)
+    {
+        // Over once the schedule gets there, or if the change is gone
+        if (schedule_setpoint >= Preheat_Target ||
+            Schedule__GetNextChange(OPTIMAL_START_MAX_PREHEAT_MIN, &minutes, &next_setpoint) == FALSE ||
+            next_setpoint != Preheat_Target)
+        {
+            Preheating = FALSE;
+        }
+    }
+    else if (valid &&
+             Schedule__GetNextChange(OPTIMAL_START_MAX_PREHEAT_MIN, &minutes, &next_setpoint) &&
+             next_setpoint > schedule_setpoint &&
+             minutes <= PredictMinutes(temperature, next_setpoint))
+    {
+        Preheating = TRUE;
+        Preheat_Target = next_setpoint;
+    }
+
+    Setpoint = Preheating ? Preheat_Target : schedule_setpoint;
+
+    Learn(valid, temperature);
+}
+
+/**
+ * @brief   Measure the time taken to reach a higher setpoint
+ */
+static void Learn(BOOL_T valid, int16_t temperature)
+{
+    uint16_t rate;
+
+    if (valid == FALSE)
+    {
+        Measuring = FALSE;
+    }
+    else if (Measuring)
+    {
+        if (Setpoint < Measure_Target || Measure_Minutes > OPTIMAL_START_MAX_MEASURE_MIN)
+        {
+            Measuring = FALSE;
+        }
+        else if (temperature >= Measure_Target)
+        {
+            Measuring = FALSE;
+            if (Measure_Minutes >= OPTIMAL_START_MIN_MEASURE_MIN &&
+                temperature - Measure_Start_Temperature >= OPTIMAL_START_MIN_RISE)
+            {
+                rate = (uint16_t)(((int32_t)(temperature - Measure_Start_Temperature) << 8) /
+                                  Measure_Minutes);
+                UpdateModel(Measure_Bucket, rate);
+            }
+        }
+    }
+    else if (Setpoint > Last_Setpoint && Setpoint - temperature >= OPTIMAL_START_MIN_RISE)
+    {
+        Measuring = TRUE;
+        Measure_Start_Temperature = temperature;
+        Measure_Target = Setpoint;
+        Measure_Minutes = 0;
+        Measure_Bucket = Bucket(temperature);
+    }
+
+    Last_Setpoint = Setpoint;
+}
+
+static void UpdateModel(uint8_t bucket, uint16_t rate)
+{
+    int32_t average;
+
+    // The buffer must not change while it is being written
+    if (Saving)
+    {
+        return;
+    }
+
+    average = Model.rates[bucket];
+    average += ((int32_t)rate - average) >> OPTIMAL_START_EWMA_SHIFT;
+    if (average < OPTIMAL_START_MIN_RATE)
+    {
+        average = OPTIMAL_START_MIN_RATE;
+    }
+    Model.rates[bucket] = (uint16_t)average;
+    Save_Pending = TRUE;
+}
+
+static uint8_t Bucket(int16_t temperature)
+{
+    int16_t outdoor = OPTIMAL_START_DEFAULT_OUTDOOR;
+    int16_t delta;
+
+    if (Outdoor_Age_Min < OPTIMAL_START_OUTDOOR_MAX_AGE_MIN)
+    {
+        outdoor = Outdoor_Temperature;
+    }
+
+    delta = temperature - outdoor;
+    if (delta <= 0)
+    {
+        return 0;
+    }
+    if (delta >= OPTIMAL_START_BUCKET_WIDTH * (OPTIMAL_START_BUCKETS_NUMBER - 1))
+    {
+        return OPTIMAL_START_BUCKETS_NUMBER - 1;
+    }
+    return delta / OPTIMAL_START_BUCKET_WIDTH;
+}
+
+/**
+ * @return  minutes needed to heat from temperature to target
+ */
+static uint16_t PredictMinutes(int16_t temperature, int16_t target)
+{
+    int32_t minutes;
+
+    if (target <= temperature)
+    {
+        return 0;
+    }
+
+    minutes = ((int32_t)(target - temperature) << 8) / Model.rates[Bucket(temperature)];
+    if (minutes > UINT16_MAX)
+    {
+        minutes = UINT16_MAX;
+    }
+    return (uint16_t)minutes;
+}
+
+static uint16_t ModelCrc(const OPTIMAL_START_MODEL_T *model)
+{
+    const uint8_t *data = (const uint8_t *)model;
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    for (i = 0; i < sizeof(OPTIMAL_START_MODEL_T) - sizeof(model->crc); i++)
+    {
+        crc = _crc16_update(crc, data[i]);
+    }
+    return crc;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file optimal_start.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef OPTIMAL_START_H_
+#define OPTIMAL_START_H_
+
+#include "micro.h"
+#include "temp_sensor.h"
+
+#define OPTIMAL_START_BUCKETS_NUMBER    4
+#define OPTIMAL_START_BUCKET_WIDTH      REAL_TO_FIXED_TEMPERATURE(5.0f) // indoor - outdoor
+
+void OptimalStart__Initialize(void);
+void OptimalStart__SetOutdoorTemperature(int16_t temperature);
+int16_t OptimalStart__GetSetpoint(void);
+uint16_t OptimalStart__GetRate(uint8_t bucket);
+void OptimalStart__100msTask(void);
+
+#endif /* OPTIMAL_START_H_ */
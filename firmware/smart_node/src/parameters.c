@@ -1,8 +1,364 @@
 /**
  * @file configuration.c
  *
+ * @brief Persistent parameters
+ *
+ * @details The parameters are stored in the internal EEPROM as records
+ *          made of version, generation counter, PARAM_T and CRC-16.
+ *          Each save goes to the next slot of a ring, so the wear is spread
+ *          over PARAMETERS_SLOTS_NUMBER slots. At boot the valid record with
+ *          the highest generation is loaded.
+ *          Saves are deferred: each change restarts a timer, and the record
+ *          is written only when no change has been made for
+ *          PARAMETERS_WRITE_DELAY_100MS, so a burst of changes costs one
+ *          write. The bytes are programmed from the EEPROM ISR, without
+ *          stalling the CPU.
+ *          In RAM the parameters are double buffered: the writer fills the
+ *          inactive copy and publishes it by flipping a single byte index,
+ *          so the tasks running from the timer ISR can read them without
+ *          disabling the interrupts.
+ *
  * @date 08/11/2014 17:23:30
  * @author Leo
  */ 
 
+#include <stddef.h>
+#include <util/crc16.h>
+#include "critical.h"
+#include "int_eeprom.h"
 #include "parameters.h"
+
+#define PARAMETERS_SLOT_SIZE        64
+#define PARAMETERS_SLOTS_NUMBER     (INT_EEPROM_PARAMETERS_SIZE / PARAMETERS_SLOT_SIZE)
+#define PARAMETERS_WRITE_DELAY_100MS 30 // 3 seconds
+
+#define PARAMETERS_SLOT_ADDRESS(slot) \
+    (INT_EEPROM_PARAMETERS_BASE + (uint16_t)(slot) * PARAMETERS_SLOT_SIZE)
+
+typedef struct
+{
+	uint8_t		version;
+	uint16_t	generation;
+	PARAM_T		data;
+	uint16_t	crc;
+} PARAMETERS_RECORD_T;
+
+typedef char PARAMETERS_RECORD_SIZE_CHECK[(sizeof(PARAMETERS_RECORD_T) <= PARAMETERS_SLOT_SIZE) ? 1 : -1];
+
+static void LoadDefault(PARAM_T *param);
+static uint16_t RecordCrc(const PARAMETERS_RECORD_T *record);
+
+#define PARAMETERS_DESCRIPTOR(id, field, min_value, max_value, param_flags) \
+	[id] = { \
+		.offset = offsetof(PARAM_T, field), \
+		.size = sizeof(((PARAM_T *)0)->field), \
+		.min = (min_value), \
+		.max = (max_value), \
+		.flags = (param_flags), \
+	},
+
+static const PARAM_DESCRIPTOR_T Descriptors[PARAM_ID_NUMBER] = {
+	PARAMETERS_TABLE(PARAMETERS_DESCRIPTOR)
+};
+
+static PARAM_T Buffer[2];
+static volatile uint8_t Active_Idx;
+static volatile uint8_t Generation;
+
+static PARAMETERS_RECORD_T Write_Record; // stays untouched while being written
+static uint16_t Last_Generation;
+static uint8_t Last_Slot;
+static volatile uint8_t Dirty;
+static volatile uint8_t Write_Delay_100ms;
+static uint8_t Writing;
+
+/**
+ * @brief	Publish and save the default values
+ */
+void configLoadDefault(void)
+{
+	LoadDefault(Parameters__BeginUpdate());
+	Parameters__Publish(TRUE);
+}
+
+/**
+ * @brief	Load the newest valid record, or the defaults
+ *
+ * @details	Only the slot headers are read to sort the candidates, the CRC
+ * 			is checked starting from the newest one
+ */
+void Parameters__Initialize(void)
+{
+	PARAMETERS_RECORD_T record;
+	uint16_t generations[PARAMETERS_SLOTS_NUMBER];
+	uint8_t valid[PARAMETERS_SLOTS_NUMBER];
+	uint8_t slot;
+	uint8_t best;
+	uint8_t found = 0;
+
+	IntEeprom__Initialize();
+
+	Active_Idx = 0;
+	Generation = 0;
+	Dirty = 0;
+	Writing = 0;
+	Write_Delay_100ms = 0;
+	Last_Generation = 0;
+	Last_Slot = PARAMETERS_SLOTS_NUMBER - 1;
+
+	for (slot = 0; slot < PARAMETERS_SLOTS_NUMBER; slot++)
+	{
+		IntEeprom__Read(PARAMETERS_SLOT_ADDRESS(slot), (uint8_t *)&record,
+		                sizeof(record.version) + sizeof(record.generation));
+		generations[slot] = record.generation;
+		valid[slot] = (record.version == PARAMETERS_VERSION);
+	}
+
+	while (found == 0)
+	{
+		// Newest candidate left, generations compared with wrap around
+		best = PARAMETERS_SLOTS_NUMBER;
+		for (slot = 0; slot < PARAMETERS_SLOTS_NUMBER; slot++)
+		{
+			if (valid[slot] &&
+			    (best == PARAMETERS_SLOTS_NUMBER ||
+			     (int16_t)(generations[slot] - generations[best]) > 0))
+			{
+				best = slot;
+			}
+		}
+		if (best == PARAMETERS_SLOTS_NUMBER)
+		{
+			break;
+		}
+
+		IntEeprom__Read(PARAMETERS_SLOT_ADDRESS(best), (uint8_t *)&record, sizeof(record));
+		if (RecordCrc(&record) == record.crc)
+		{
+			Buffer[0] = record.data;
+			Last_Generation = record.generation;
+			Last_Slot = best;
+			found = 1;
+		}
+		else
+		{
+			valid[best] = 0;
+		}
+	}
+
+	if (found == 0)
+	{
+		LoadDefault(&Buffer[0]);
+	}
+}
+
+/**
+ * @brief	Get the published parameters
+ *
+ * @details	Safe to call from the ISR tasks. The pointed copy is not modified
+ * 			until the next Parameters__BeginUpdate, which is called only from
+ * 			the main loop: don't keep the pointer across calls.
+ */
+const PARAM_T *Parameters__Get(void)
+{
+	return &Buffer[Active_Idx];
+}
+
+/**
+ * @brief	Counter increased on each publish, to detect changes cheaply
+ */
+uint8_t Parameters__GetGeneration(void)
+{
+	return Generation;
+}
+
+/**
+ * @brief	Start a change of the parameters
+ *
+ * @details	Main loop only. Returns the inactive copy, initialized with the
+ * 			published values, to be modified and then published.
+ */
+PARAM_T *Parameters__BeginUpdate(void)
+{
+	PARAM_T *next = &Buffer[Active_Idx ^ 1];
+
+	*next = Buffer[Active_Idx];
+	return next;
+}
+
+/**
+ * @brief	Make the copy returned by Parameters__BeginUpdate the active one
+ *
+ * @param	persist	TRUE to schedule the save in EEPROM
+ */
+void Parameters__Publish(BOOL_T persist)
+{
+	// The copy must be complete before the index is flipped
+	__asm__ __volatile__ ("" ::: "memory");
+	Active_Idx ^= 1;
+	Generation++;
+	if (persist)
+	{
+		Parameters__Save();
+	}
+}
+
+/**
+ * @return	NULL for an unknown id
+ */
+const PARAM_DESCRIPTOR_T *Parameters__GetDescriptor(uint8_t id)
+{
+	if (id >= PARAM_ID_NUMBER)
+	{
+		return NULL;
+	}
+	return &Descriptors[id];
+}
+
+/**
+ * @brief	Read a parameter by id, the id must be valid
+ */
+int16_t Parameters__GetValue(const PARAM_T *param, uint8_t id)
+{
+	const PARAM_DESCRIPTOR_T *descriptor = &Descriptors[id];
+	const uint8_t *field = &param->data[descriptor->offset];
+
+	if (descriptor->size == 1)
+	{
+		return *field;
+	}
+	return *(const int16_t *)field;
+}
+
+/**
+ * @brief	Write a parameter by id, usually in the copy returned by
+ * 			Parameters__BeginUpdate
+ *
+ * @return	FALSE if the id is unknown or the value out of range
+ */
+BOOL_T Parameters__SetValue(PARAM_T *param, uint8_t id, int16_t value)
+{
+	const PARAM_DESCRIPTOR_T *descriptor = Parameters__GetDescriptor(id);
+	uint8_t *field;
+
+	if (descriptor == NULL || value < descriptor->min || value > descriptor->max)
+	{
+		return FALSE;
+	}
+
+	field = &param->data[descriptor->offset];
+	if (descriptor->size == 1)
+	{
+		*field = (uint8_t)value;
+	}
+	else
+	{
+		*(int16_t *)field = value;
+	}
+	return TRUE;
+}
+
+/**
+ * @brief	Request to save the parameters
+ *
+ * @details	Called by Parameters__Publish. The write happens once no other
+ * 			change has been requested for PARAMETERS_WRITE_DELAY_100MS.
+ */
+void Parameters__Save(void)
+{
+	CRITICAL_BLOCK(CRITICAL_SITE_PARAMETERS)
+	{
+		Dirty = 1;
+		Write_Delay_100ms = PARAMETERS_WRITE_DELAY_100MS;
+	}
+}
+
+BOOL_T Parameters__IsSaved(void)
+{
+	return (Dirty == 0 && Writing == 0) ? TRUE : FALSE;
+}
+
+void Parameters__100msTask(void)
+{
+	uint8_t slot;
+
+	if (Writing)
+	{
+		if (IntEeprom__IsIdle())
+		{
+			Writing = 0;
+		}
+	}
+	else if (Dirty)
+	{
+		if (Write_Delay_100ms != 0)
+		{
+			Write_Delay_100ms--;
+		}
+		else
+		{
+			slot = Last_Slot + 1;
+			if (slot >= PARAMETERS_SLOTS_NUMBER)
+			{
+				slot = 0;
+			}
+			Write_Record.data = *Parameters__Get();
+			Write_Record.version = PARAMETERS_VERSION;
+			Write_Record.generation = Last_Generation + 1;
+			Write_Record.crc = RecordCrc(&Write_Record);
+
+			// The schedule or the optimal start may be writing: retry at the next tick
+			if (IntEeprom__Write(PARAMETERS_SLOT_ADDRESS(slot),
+			                     (const uint8_t *)&Write_Record, sizeof(Write_Record)))
+			{
+				Dirty = 0;
+				Last_Slot = slot;
+				Last_Generation = Write_Record.generation;
+				Writing = 1;
+			}
+		}
+	}
+}
+
+static void LoadDefault(PARAM_T *param)
+{
+	uint8_t zone;
+	uint8_t relay;
+
+	for (zone = 0; zone < THERMOSTAT_ZONES_NUMBER; zone++)
+	{
+		param->thermostat[zone].mode = THERMOSTAT_MODE(zone);
+		param->thermostat[zone].tempSet = THERMOSTAT_TEMPERATURE_SET;
+		param->thermostat[zone].hist = THERMOSTAT_TEMPERATURE_HISTERESYS;
+		param->thermostat[zone].control = THERMOSTAT_CONTROL;
+		param->thermostat[zone].kp = THERMOSTAT_PI_KP;
+		param->thermostat[zone].ki = THERMOSTAT_PI_KI;
+		param->thermostat[zone].cycle = THERMOSTAT_CYCLE_MIN;
+		param->thermostat[zone].minOnOff = THERMOSTAT_MIN_ON_OFF_S;
+		param->thermostat[zone].source = THERMOSTAT_SOURCE(zone);
+		param->thermostat[zone].scheduled = THERMOSTAT_SCHEDULED(zone);
+		param->thermostat[zone].state.active = 0;
+		param->thermostat[zone].state.tempSign = PLUS;
+		param->thermostat[zone].state.temp100 = 0;
+		param->thermostat[zone].state.tempRaw = 0;
+	}
+
+	param->relays.budget = RELAYS_BUDGET_MA;
+	for (relay = 0; relay < RELAYS_NUMBER; relay++)
+	{
+		param->relays.pulse[relay] = RELAYS_DEFAULT_PULSE_MS;
+	}
+}
+
+static uint16_t RecordCrc(const PARAMETERS_RECORD_T *record)
+{
+	const uint8_t *data = (const uint8_t *)record;
+	uint16_t crc = 0xFFFF;
+	uint8_t i;
+
+	for (i = 0; i < sizeof(PARAMETERS_RECORD_T) - sizeof(record->crc); i++)
+	{
+		crc = _crc16_update(crc, data[i]);
+	}
+	return crc;
+}
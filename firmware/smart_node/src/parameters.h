@@ -11,6 +11,8 @@
 
 #include "micro.h"
 #include "temp_sensor.h"
+#include "relays.h"
+#include "thermostat.h"
 
 #define SUMMER	0
 #define WINTER	1
@@ -18,9 +20,27 @@
 #define MINUS	1
 #define ON		1
 #define OFF		0
+#define CONTROL_HYSTERESIS	0
+#define CONTROL_PI			1
+#define SOURCE_LOCAL		0	// temperature sensor of the board
+#define SOURCE_REMOTE		1	// readings sent by another node
 
+// Default values, used when no valid record is found in EEPROM
 #define THERMOSTAT_TEMPERATURE_SET          REAL_TO_FIXED_TEMPERATURE(25.0f)
 #define THERMOSTAT_TEMPERATURE_HISTERESYS   REAL_TO_FIXED_TEMPERATURE(1.5f)
+#define THERMOSTAT_CONTROL                  CONTROL_HYSTERESIS
+#define THERMOSTAT_PI_KP                    2048 // full duty at 2 C below the setpoint
+#define THERMOSTAT_PI_KI                    11   // full duty after ~30 min at 1 C below
+#define THERMOSTAT_CYCLE_MIN                10
+#define THERMOSTAT_MIN_ON_OFF_S             60
+// Zone 0 reproduces the single zone thermostat, the others start disabled
+#define THERMOSTAT_MODE(zone)               (((zone) == 0) ? WINTER : SUMMER)
+#define THERMOSTAT_SOURCE(zone)             (((zone) == 0) ? SOURCE_LOCAL : SOURCE_REMOTE)
+#define THERMOSTAT_SCHEDULED(zone)          (((zone) == 0) ? ON : OFF)
+#define RELAYS_BUDGET_MA                    RELAYS_COIL_MA // one coil at a time
+
+// Increase it whenever PARAM_T changes layout
+#define PARAMETERS_VERSION 4
 
 typedef struct
 {
@@ -32,21 +52,89 @@ typedef struct
 
 typedef struct
 {
-	uint8_t		mode		: 1;
-	uint8_t					: 7;
-	int16_t		tempSet100;
-	uint16_t	hist100;
+	uint8_t		mode;		// SUMMER or WINTER, a whole byte to be addressable
+	int16_t		tempSet;	// Q12.4
+	uint16_t	hist;		// Q12.4
+	uint8_t		control;	// CONTROL_HYSTERESIS or CONTROL_PI
+	uint16_t	kp;			// Q8, see PI_CONTROLLER_CONFIG_T
+	uint16_t	ki;			// Q8, see PI_CONTROLLER_CONFIG_T
+	uint8_t		cycle;		// PI time proportioning window, minutes
+	uint8_t		minOnOff;	// PI shortest on or off time, seconds
+	uint8_t		source;		// SOURCE_LOCAL or SOURCE_REMOTE
+	uint8_t		scheduled;	// ON to follow the schedule instead of tempSet
 	state_s state;
 } config_thermostat_s;
 
+typedef struct
+{
+	uint16_t	budget;					// peak coil current, mA
+	uint8_t		pulse[RELAYS_NUMBER];	// coil pulse width, ms
+} config_relays_s;
+
 typedef union
 {
-	config_thermostat_s thermostat;
-	uint8_t data[sizeof(config_thermostat_s)];  	
+	struct
+	{
+		config_thermostat_s thermostat[THERMOSTAT_ZONES_NUMBER];
+		config_relays_s relays;
+	};
+	uint8_t data[sizeof(config_thermostat_s) * THERMOSTAT_ZONES_NUMBER + sizeof(config_relays_s)];
 } PARAM_T;
 
-extern PARAM_T config;
+// Parameters reachable by id from the command protocol
+// X(id, field of PARAM_T, min, max, flags). Fields must be 1 or 2 bytes wide.
+#define PARAMETERS_ZONE_TABLE(X, n) \
+	X(PARAM_ID_MODE_Z##n,		thermostat[n].mode,		SUMMER,	WINTER,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_TEMP_SET_Z##n,	thermostat[n].tempSet,	REAL_TO_FIXED_TEMPERATURE(5.0f),	REAL_TO_FIXED_TEMPERATURE(35.0f),	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_HIST_Z##n,		thermostat[n].hist,		REAL_TO_FIXED_TEMPERATURE(0.1f),	REAL_TO_FIXED_TEMPERATURE(5.0f),	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_CONTROL_Z##n,	thermostat[n].control,	CONTROL_HYSTERESIS,	CONTROL_PI,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_KP_Z##n,			thermostat[n].kp,		0,	INT16_MAX,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_KI_Z##n,			thermostat[n].ki,		0,	INT16_MAX,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_CYCLE_Z##n,		thermostat[n].cycle,	1,	60,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_MIN_ON_OFF_Z##n,	thermostat[n].minOnOff,	0,	240,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_SOURCE_Z##n,		thermostat[n].source,	SOURCE_LOCAL,	SOURCE_REMOTE,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_SCHEDULED_Z##n,	thermostat[n].scheduled,	OFF,	ON,	PARAM_FLAG_PERSISTENT)
+
+#define PARAMETERS_TABLE(X) \
+	PARAMETERS_ZONE_TABLE(X, 0) \
+	PARAMETERS_ZONE_TABLE(X, 1) \
+	X(PARAM_ID_RELAY_BUDGET,	relays.budget,	0,	INT16_MAX,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_RELAY_PULSE_0,	relays.pulse[0],	1,	RELAYS_MAX_PULSE_MS,	PARAM_FLAG_PERSISTENT) \
+	X(PARAM_ID_RELAY_PULSE_1,	relays.pulse[1],	1,	RELAYS_MAX_PULSE_MS,	PARAM_FLAG_PERSISTENT)
+
+// Limits shared by all the setpoints
+#define PARAM_ID_TEMP_SET	PARAM_ID_TEMP_SET_Z0
+
+#define PARAM_FLAG_PERSISTENT	0x01	// saved in EEPROM when changed
+
+#define PARAMETERS_ID(id, field, min, max, flags) id,
+typedef enum
+{
+	PARAMETERS_TABLE(PARAMETERS_ID)
+	PARAM_ID_NUMBER,
+} PARAM_ID_T;
+
+typedef struct
+{
+	uint8_t		offset;		// in PARAM_T
+	uint8_t		size;		// bytes
+	int16_t		min;
+	int16_t		max;
+	uint8_t		flags;
+} PARAM_DESCRIPTOR_T;
 
 void configLoadDefault(void);
 
+void Parameters__Initialize(void);
+const PARAM_T *Parameters__Get(void);
+uint8_t Parameters__GetGeneration(void);
+PARAM_T *Parameters__BeginUpdate(void);
+void Parameters__Publish(BOOL_T persist);
+const PARAM_DESCRIPTOR_T *Parameters__GetDescriptor(uint8_t id);
+int16_t Parameters__GetValue(const PARAM_T *param, uint8_t id);
+BOOL_T Parameters__SetValue(PARAM_T *param, uint8_t id, int16_t value);
+void Parameters__Save(void);
+BOOL_T Parameters__IsSaved(void);
+void Parameters__100msTask(void);
+
 #endif /* CONFIGURATION_H_ */
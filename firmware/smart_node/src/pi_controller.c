@@ -0,0 +1,96 @@
+/**
+ * @file pi_controller.c
+ *
+ * @brief Integer PI(D) controller producing a duty cycle
+ *
+ * @details Error and measurement are Q12.4, gains are Q8, and the output
+ *          is a duty cycle from 0 to PI_CONTROLLER_OUTPUT_MAX.
+ *          The derivative acts on the measurement, so a setpoint step does
+ *          not kick the output.
+ *          Anti-windup: the integral is clamped to the output range, and
+ *          it is not increased while the output is saturated in the same
+ *          direction as the error.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "pi_controller.h"
+
+#define PI_CONTROLLER_INTEGRAL_MAX  ((int32_t)PI_CONTROLLER_OUTPUT_MAX << 8)
+
+static inline int32_t Clamp(int32_t value, int32_t min, int32_t max);
+
+void PiController__Initialize(PI_CONTROLLER_T *controller, const PI_CONTROLLER_CONFIG_T *config)
+{
+    controller->config = *config;
+    PiController__Reset(controller);
+}
+
+/**
+ * @brief   Change the gains, keeping the integral
+ */
+void PiController__Configure(PI_CONTROLLER_T *controller, const PI_CONTROLLER_CONFIG_T *config)
+{
+    controller->config = *config;
+}
+
+void PiController__Reset(PI_CONTROLLER_T *controller)
+{
+    controller->integral = 0;
+    controller->last_measurement = 0;
+    controller->output = 0;
+    controller->started = 0;
+}
+
+/**
+ * @brief   Compute a new output, once per sample
+ *
+ * @param setpoint      Q12.4
+ * @param measurement   Q12.4
+ *
+ * @return  duty cycle, 0 to PI_CONTROLLER_OUTPUT_MAX
+ */
+uint8_t PiController__Update(PI_CONTROLLER_T *controller, int16_t setpoint, int16_t measurement)
+{
+    int16_t error;
+    int32_t proportional;
+    int32_t derivative = 0;
+    int32_t output;
+
+    error = setpoint - measurement;
+    proportional = (int32_t)controller->config.kp * error;
+    if (controller->started)
+    {
+        derivative = (int32_t)controller->config.kd *
+                (int16_t)(controller->last_measurement - measurement);
+    }
+    controller->last_measurement = measurement;
+    controller->started = 1;
+
+    output = proportional + controller->integral + derivative;
+    if (!((output >= PI_CONTROLLER_INTEGRAL_MAX && error > 0) ||
+          (output <= 0 && error < 0)))
+    {
+        controller->integral = Clamp(controller->integral + (int32_t)controller->config.ki * error,
+                                     0, PI_CONTROLLER_INTEGRAL_MAX);
+        output = proportional + controller->integral + derivative;
+    }
+
+    controller->output = (uint8_t)(Clamp(output, 0, PI_CONTROLLER_INTEGRAL_MAX) >> 8);
+    return controller->output;
+}
+
+static inline int32_t Clamp(int32_t value, int32_t min, int32_t max)
+{
+    if (value < min)
+    {
+        return min;
+    }
+    if (value > max)
+    {
+        return max;
+    }
+    return value;
+}
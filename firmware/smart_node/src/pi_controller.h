@@ -0,0 +1,36 @@
+/**
+ * @file pi_controller.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef PI_CONTROLLER_H_
+#define PI_CONTROLLER_H_
+
+#include "micro.h"
+
+#define PI_CONTROLLER_OUTPUT_MAX    255 // full duty cycle
+
+typedef struct {
+    uint16_t kp;    // Q8, duty counts per Q12.4 unit of error
+    uint16_t ki;    // Q8, duty counts per Q12.4 unit of error, per sample
+    uint16_t kd;    // Q8, duty counts per Q12.4 unit of change, 0 for a PI
+} PI_CONTROLLER_CONFIG_T;
+
+typedef struct {
+    PI_CONTROLLER_CONFIG_T config;
+    int32_t integral;           // Q8 duty counts, within 0 and OUTPUT_MAX
+    int16_t last_measurement;   // Q12.4
+    uint8_t output;
+    uint8_t started;
+} PI_CONTROLLER_T;
+
+void PiController__Initialize(PI_CONTROLLER_T *controller, const PI_CONTROLLER_CONFIG_T *config);
+void PiController__Configure(PI_CONTROLLER_T *controller, const PI_CONTROLLER_CONFIG_T *config);
+void PiController__Reset(PI_CONTROLLER_T *controller);
+uint8_t PiController__Update(PI_CONTROLLER_T *controller, int16_t setpoint, int16_t measurement);
+
+#define PiController__GetOutput(controller) ((controller)->output)
+
+#endif /* PI_CONTROLLER_H_ */
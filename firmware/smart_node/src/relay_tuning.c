@@ -0,0 +1,333 @@
+/**
+ * @file relay_tuning.c
+ *
+ * @brief Relay coil pulse settings and calibration self-test
+ *
+ * @details The peak current budget and the pulse width of each relay are
+ *          parameters, applied to the relay driver whenever they change.
+ *          The self-test looks for the shortest pulse that reliably moves
+ *          a relay, watching the load current from the metering: with a
+ *          load connected, the relay is set and reset RELAY_TUNING_TRIALS
+ *          times with the pulse under test, starting from
+ *          RELAY_TUNING_MIN_PULSE_MS and lengthening it after any miss.
+ *          The width found, plus a margin, is saved in the parameters and
+ *          the relay is put back where it was. The thermostat leaves the
+ *          relay alone meanwhile.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "relays.h"
+#include "metering.h"
+#include "parameters.h"
+#include "relay_tuning.h"
+
+#define RELAY_TUNING_MIN_PULSE_MS   1
+#define RELAY_TUNING_MARGIN_MS      1
+#define RELAY_TUNING_TRIALS         3
+#define RELAY_TUNING_LOAD_MA        100 // above the metering noise floor
+#define RELAY_TUNING_SETTLE_100MS   6   // two whole metering windows after the pulse
+#define RELAY_TUNING_NO_RELAY       0xFF
+
+typedef enum {
+    STATE_IDLE,
+    STATE_CHECK_OFF,    // reset with the longest pulse, no current expected
+    STATE_CHECK_ON,     // set with the longest pulse, load current expected
+    STATE_RECOVER,      // reset with the longest pulse before a trial
+    STATE_TRIAL_SET,
+    STATE_TRIAL_RESET,
+} RELAY_TUNING_STATE_T;
+
+static RELAY_TUNING_STATE_T Tuning_State;
+static RELAY_TUNING_RESULT_T Results[RELAYS_NUMBER];
+static volatile uint8_t Start_Relay;
+static uint8_t Relay;
+static uint8_t Was_Set;
+static uint8_t Pulse_Ms;
+static uint8_t Trials;
+static uint8_t Settle_100ms;
+static uint8_t Parameters_Generation;
+static volatile BOOL_T Save_Pending;
+static uint8_t Save_Relay;
+static uint8_t Save_Pulse_Ms;
+
+static void Apply(void);
+static void Move(BOOL_T set, uint8_t pulse_ms);
+static RELAY_TUNING_STATE_T Miss(void);
+static void Finish(RELAY_TUNING_RESULT_T result);
+
+void RelayTuning__Initialize(void)
+{
+    uint8_t i;
+
+    Tuning_State = STATE_IDLE;
+    Start_Relay = RELAY_TUNING_NO_RELAY;
+    Relay = RELAY_TUNING_NO_RELAY;
+    Save_Pending = FALSE;
+    for (i = 0; i < RELAYS_NUMBER; i++)
+    {
+        Results[i] = RELAY_TUNING_NONE;
+    }
+
+    Parameters_Generation = Parameters__GetGeneration();
+    Apply();
+}
+
+/**
+ * @brief   Start the self-test of a relay
+ *
+ * @details Main loop only. A load must be connected to the relay, which
+ *          switches it on and off several times.
+ *
+ * @return  FALSE if a self-test is already running
+ */
+BOOL_T RelayTuning__Start(RELAY_T relay)
+{
+    BOOL_T started = FALSE;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (Tuning_State == STATE_IDLE && Start_Relay == RELAY_TUNING_NO_RELAY && Save_Pending == FALSE)
+        {
+            Start_Relay = relay;
+            Results[relay] = RELAY_TUNING_RUNNING;
+            started = TRUE;
+        }
+    }
+    return started;
+}
+
+BOOL_T RelayTuning__IsRunning(RELAY_T relay)
+{
+    return (Results[relay] == RELAY_TUNING_RUNNING) ? TRUE : FALSE;
+}
+
+RELAY_TUNING_RESULT_T RelayTuning__GetResult(RELAY_T relay)
+{
+    return Results[relay];
+}
+
+void RelayTuning__100msTask(void)
+{
+    RELAY_TUNING_STATE_T next_state;
+    METERING_COUNTERS_T counters;
+    BOOL_T loaded;
+
+    if (Parameters_Generation != Parameters__GetGeneration())
+    {
+        Parameters_Generation = Parameters__GetGeneration();
+        Apply();
+    }
+
+    next_state = Tuning_State;
+
+    if (Tuning_State == STATE_IDLE)
+    {
+        if (Start_Relay != RELAY_TUNING_NO_RELAY)
+        {
+            Relay = Start_Relay;
+            Start_Relay = RELAY_TUNING_NO_RELAY;
+            Was_Set = Relays__IsSet(Relay);
+            Move(FALSE, RELAYS_MAX_PULSE_MS);
+            Tuning_State = STATE_CHECK_OFF;
+        }
+        return;
+    }
+
+    if (Settle_100ms != 0)
+    {
+        Settle_100ms--;
+        return;
+    }
+
+    Metering__GetCounters(Relay, &counters);
+    loaded = (counters.rms_ma >= RELAY_TUNING_LOAD_MA) ? TRUE : FALSE;
+
+    switch (Tuning_State)
+    {
+        case STATE_CHECK_OFF:
+        {
+            if (loaded)
+            {
+                Finish(RELAY_TUNING_NO_LOAD);
+                next_state = STATE_IDLE;
+            }
+            else
+            {
+                Move(TRUE, RELAYS_MAX_PULSE_MS);
+                next_state = STATE_CHECK_ON;
+            }
+            break;
+        }
+        case STATE_CHECK_ON:
+        {
+            if (loaded == FALSE)
+            {
+                Finish(RELAY_TUNING_NO_LOAD);
+                next_state = STATE_IDLE;
+            }
+            else
+            {
+                Pulse_Ms = RELAY_TUNING_MIN_PULSE_MS;
+                Trials = 0;
+                Move(FALSE, RELAYS_MAX_PULSE_MS);
+                next_state = STATE_RECOVER;
+            }
+            break;
+        }
+        case STATE_RECOVER:
+        {
+            if (loaded)
+            {
+                // Not even the longest pulse resets it any more
+                Finish(RELAY_TUNING_UNRELIABLE);
+                next_state = STATE_IDLE;
+            }
+            else
+            {
+                Move(TRUE, Pulse_Ms);
+                next_state = STATE_TRIAL_SET;
+            }
+            break;
+        }
+        case STATE_TRIAL_SET:
+        {
+            if (loaded)
+            {
+                Move(FALSE, Pulse_Ms);
+                next_state = STATE_TRIAL_RESET;
+            }
+            else
+            {
+                next_state = Miss();
+            }
+            break;
+        }
+        case STATE_TRIAL_RESET:
+        {
+            if (loaded)
+            {
+                next_state = Miss();
+            }
+            else if (++Trials == RELAY_TUNING_TRIALS)
+            {
+                Finish(RELAY_TUNING_DONE);
+                next_state = STATE_IDLE;
+            }
+            else
+            {
+                Move(TRUE, Pulse_Ms);
+                next_state = STATE_TRIAL_SET;
+            }
+            break;
+        }
+        default:
+        {
+            next_state = STATE_IDLE;
+            break;
+        }
+    }
+
+    Tuning_State = next_state;
+}
+
+/**
+ * @brief   Save the width found by the self-test
+ *
+ * @details Call it from the main loop, where the parameters are updated
+ */
+void RelayTuning__FastTask(void)
+{
+    PARAM_T *param;
+
+    if (Save_Pending)
+    {
+        param = Parameters__BeginUpdate();
+        param->relays.pulse[Save_Relay] = Save_Pulse_Ms;
+        Parameters__Publish(TRUE);
+        Save_Pending = FALSE;
+    }
+}
+
+/**
+ * @brief   Give the parameters to the relay driver
+ */
+static void Apply(void)
+{
+    const PARAM_T *param = Parameters__Get();
+    uint8_t i;
+
+    Relays__SetBudget(param->relays.budget);
+    for (i = 0; i < RELAYS_NUMBER; i++)
+    {
+        // The relay under test keeps the pulse being tried
+        if (i != Relay)
+        {
+            Relays__SetPulseWidth(i, param->relays.pulse[i]);
+        }
+    }
+}
+
+/**
+ * @brief   Pulse the relay under test
+ *
+ * @details Its position is forgotten first, so the pulse is given even if
+ *          the previous one did not move it
+ */
+static void Move(BOOL_T set, uint8_t pulse_ms)
+{
+    Relays__ForgetPosition(Relay);
+    Relays__SetPulseWidth(Relay, pulse_ms);
+    if (set)
+    {
+        Relays__Set(Relay);
+    }
+    else
+    {
+        Relays__Reset(Relay);
+    }
+    Settle_100ms = RELAY_TUNING_SETTLE_100MS;
+}
+
+/**
+ * @brief   The relay did not move, try again with a longer pulse
+ */
+static RELAY_TUNING_STATE_T Miss(void)
+{
+    Trials = 0;
+    Pulse_Ms++;
+    if (Pulse_Ms > RELAYS_MAX_PULSE_MS)
+    {
+        Finish(RELAY_TUNING_UNRELIABLE);
+        return STATE_IDLE;
+    }
+    Move(FALSE, RELAYS_MAX_PULSE_MS);
+    return STATE_RECOVER;
+}
+
+/**
+ * @brief   Put the relay back where it was, with the width to be used
+ */
+static void Finish(RELAY_TUNING_RESULT_T result)
+{
+    uint8_t pulse_ms = Parameters__Get()->relays.pulse[Relay];
+
+    if (result == RELAY_TUNING_DONE)
+    {
+        pulse_ms = Pulse_Ms + RELAY_TUNING_MARGIN_MS;
+        if (pulse_ms > RELAYS_MAX_PULSE_MS)
+        {
+            pulse_ms = RELAYS_MAX_PULSE_MS;
+        }
+        Save_Relay = Relay;
+        Save_Pulse_Ms = pulse_ms;
+        Save_Pending = TRUE;
+    }
+
+    Move(Was_Set, (result == RELAY_TUNING_UNRELIABLE) ? RELAYS_MAX_PULSE_MS : pulse_ms);
+    Settle_100ms = 0;
+    Results[Relay] = result;
+    Relay = RELAY_TUNING_NO_RELAY;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file relay_tuning.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef RELAY_TUNING_H_
+#define RELAY_TUNING_H_
+
+#include "micro.h"
+#include "relays.h"
+
+typedef enum {
+    RELAY_TUNING_NONE,
+    RELAY_TUNING_RUNNING,
+    RELAY_TUNING_DONE,
+    RELAY_TUNING_NO_LOAD,       // no current with the relay set, or some with it reset
+    RELAY_TUNING_UNRELIABLE,    // not switching even with RELAYS_MAX_PULSE_MS
+} RELAY_TUNING_RESULT_T;
+
+void RelayTuning__Initialize(void);
+BOOL_T RelayTuning__Start(RELAY_T relay);
+BOOL_T RelayTuning__IsRunning(RELAY_T relay);
+RELAY_TUNING_RESULT_T RelayTuning__GetResult(RELAY_T relay);
+void RelayTuning__100msTask(void);
+void RelayTuning__FastTask(void);
+
+#endif /* RELAY_TUNING_H_ */
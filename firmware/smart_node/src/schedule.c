@@ -0,0 +1,337 @@
+/**
+ * @file schedule.c
+ *
+ * @brief Weekly setpoint schedule
+ *
+ * @details The program is a list of transition points, each one applying
+ *          to a set of days, so a typical week fits one command frame.
+ *          It is stored in the internal EEPROM and compiled at load time
+ *          into a lookup of one 2-bit level per SCHEDULE_SLOT_MIN of the
+ *          week (168 bytes), so the current setpoint is found in constant
+ *          time from the 100ms task.
+ *          The schedule runs only once the time has been synchronized,
+ *          until then, or with an empty program, the zones use their
+ *          tempSet parameter. A temporary override takes precedence and
+ *          expires by itself.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include <util/crc16.h>
+#include "micro.h"
+#include "int_eeprom.h"
+#include "parameters.h"
+#include "logger.h"
+#include "schedule.h"
+
+#define SCHEDULE_EPOCH_WEEKDAY      3 // 1 Jan 1970 was a Thursday
+#define SCHEDULE_SECONDS_PER_DAY    86400UL
+#define SCHEDULE_SECONDS_PER_SLOT   (SCHEDULE_SLOT_MIN * 60U)
+#define SCHEDULE_LOOKUP_SIZE        (SCHEDULE_SLOTS_NUMBER / 4)
+
+typedef struct {
+    SCHEDULE_PROGRAM_T program;
+    uint16_t crc;
+} SCHEDULE_RECORD_T;
+
+typedef char SCHEDULE_RECORD_SIZE_CHECK[(sizeof(SCHEDULE_RECORD_T) <= INT_EEPROM_SCHEDULE_SIZE) ? 1 : -1];
+
+static SCHEDULE_RECORD_T Record; // program in use, and EEPROM write buffer
+static uint8_t Lookup[SCHEDULE_LOOKUP_SIZE];
+static volatile BOOL_T Compiling;
+static volatile int16_t Setpoint;
+static int16_t Override_Setpoint;
+static uint32_t Override_End;
+static volatile BOOL_T Override_Active;
+static volatile BOOL_T Save_Pending;
+static BOOL_T Saving;
+
+static void Compile(void);
+static uint8_t LevelAfter(uint16_t slot, uint8_t level);
+static uint16_t SlotAt(uint32_t seconds);
+static inline uint8_t LevelOfSlot(uint16_t slot);
+static uint16_t RecordCrc(const SCHEDULE_RECORD_T *record);
+
+void Schedule__Initialize(void)
+{
+    Compiling = FALSE;
+    Override_Active = FALSE;
+    Save_Pending = FALSE;
+    Saving = FALSE;
+
+    IntEeprom__Read(INT_EEPROM_SCHEDULE_BASE, (uint8_t *)&Record, sizeof(Record));
+    if (RecordCrc(&Record) != Record.crc || Schedule__IsValid(&Record.program) == FALSE)
+    {
+        Record.program.count = 0;
+    }
+    Compile();
+
+    Setpoint = Parameters__Get()->thermostat[0].tempSet;
+}
+
+/**
+ * @brief   Replace the program, compile and save it
+ *
+ * @details Main loop only. The program in use is not changed when FALSE
+ *          is returned.
+ *
+ * @return  FALSE if the program is not valid or the previous one is still
+ *          being saved
+ */
+BOOL_T Schedule__SetProgram(const SCHEDULE_PROGRAM_T *program)
+{
+    if (Save_Pending || Saving || Schedule__IsValid(program) == FALSE)
+    {
+        return FALSE;
+    }
+
+    // The 100ms task keeps the last setpoint while the lookup is rebuilt
+    Compiling = TRUE;
+    // Neither the record nor the lookup may move across the flag
+    __asm__ __volatile__ ("" ::: "memory");
+    Record.program = *program;
+    Record.crc = RecordCrc(&Record);
+    Compile();
+    __asm__ __volatile__ ("" ::: "memory");
+    Compiling = FALSE;
+
+    Save_Pending = TRUE;
+    return TRUE;
+}
+
+BOOL_T Schedule__IsSaving(void)
+{
+    return (Save_Pending || Saving) ? TRUE : FALSE;
+}
+
+/**
+ * @brief   Use a setpoint for some time, whatever the program
+ *
+ * @param minutes   0 cancels the override
+ */
+void Schedule__SetOverride(int16_t setpoint, uint16_t minutes)
+{
+    uint32_t now = Logger__GetTime();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        Override_Setpoint = setpoint;
+        Override_End = now + (uint32_t)minutes * 60;
+        Override_Active = (minutes != 0) ? TRUE : FALSE;
+    }
+}
+
+/**
+ * @brief   TRUE if an override or the program gives the setpoint
+ */
+BOOL_T Schedule__IsActive(void)
+{
+    return (Override_Active ||
+            (Record.program.count != 0 && Logger__IsTimeSynced())) ? TRUE : FALSE;
+}
+
+/**
+ * @brief   Setpoint to regulate to, Q12.4
+ */
+int16_t Schedule__GetSetpoint(void)
+{
+    return Setpoint;
+}
+
+/**
+ * @brief   Find the next setpoint change of the program
+ *
+ * @details Call it from the tasks. The lookup is scanned up to max_minutes
+ *          ahead, so keep it short.
+ *
+ * @return  FALSE if the program is not running, is overridden, or does not
+ *          change within max_minutes
+ */
+BOOL_T Schedule__GetNextChange(uint16_t max_minutes, uint16_t *minutes, int16_t *setpoint)
+{
+    uint32_t now;
+    uint16_t slot;
+    uint16_t next;
+    uint16_t steps;
+    uint8_t level;
+
+    if (Override_Active || Compiling || Record.program.count == 0 ||
+        Logger__IsTimeSynced() == FALSE)
+    {
+        return FALSE;
+    }
+
+    now = Logger__GetTime();
+    slot = SlotAt(now);
+    level = LevelOfSlot(slot);
+    next = slot;
+
+    for (steps = 1; steps <= max_minutes / SCHEDULE_SLOT_MIN + 1; steps++)
+    {
+        next++;
+        if (next >= SCHEDULE_SLOTS_NUMBER)
+        {
+            next = 0;
+        }
+        if (LevelOfSlot(next) != level)
+        {
+            *minutes = steps * SCHEDULE_SLOT_MIN - (uint16_t)((now % SCHEDULE_SECONDS_PER_SLOT) / 60);
+            *setpoint = Record.program.levels[LevelOfSlot(next)];
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void Schedule__100msTask(void)
+{
+    uint32_t now;
+
+    if (Saving)
+    {
+        if (IntEeprom__IsIdle())
+        {
+            Saving = FALSE;
+        }
+    }
+    else if (Save_Pending)
+    {
+        if (IntEeprom__Write(INT_EEPROM_SCHEDULE_BASE, (const uint8_t *)&Record, sizeof(Record)))
+        {
+            Save_Pending = FALSE;
+            Saving = TRUE;
+        }
+    }
+
+    now = Logger__GetTime();
+
+    if (Override_Active && (int32_t)(now - Override_End) >= 0)
+    {
+        Override_Active = FALSE;
+    }
+
+    if (Override_Active)
+    {
+        Setpoint = Override_Setpoint;
+    }
+    else if (Compiling == FALSE)
+    {
+        if (Record.program.count != 0 && Logger__IsTimeSynced())
+        {
+            Setpoint = Record.program.levels[LevelOfSlot(SlotAt(now))];
+        }
+        else
+        {
+            Setpoint = Parameters__Get()->thermostat[0].tempSet;
+        }
+    }
+}
+
+/**
+ * @brief   Check the levels range and the points format
+ */
+BOOL_T Schedule__IsValid(const SCHEDULE_PROGRAM_T *program)
+{
+    const PARAM_DESCRIPTOR_T *limits = Parameters__GetDescriptor(PARAM_ID_TEMP_SET);
+    uint8_t i;
+
+    if (program->count > SCHEDULE_POINTS_MAX)
+    {
+        return FALSE;
+    }
+    for (i = 0; i < SCHEDULE_LEVELS_NUMBER; i++)
+    {
+        if (program->levels[i] < limits->min || program->levels[i] > limits->max)
+        {
+            return FALSE;
+        }
+    }
+    for (i = 0; i < program->count; i++)
+    {
+        if (SCHEDULE_POINT_SLOT(program->points[i]) >= SCHEDULE_SLOTS_PER_DAY ||
+            SCHEDULE_POINT_DAYS(program->points[i]) == 0)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief   Build the lookup from Record.program
+ *
+ * @details The first pass only finds the level in force at the end of the
+ *          week, which is the level at its beginning
+ */
+static void Compile(void)
+{
+    uint16_t slot;
+    uint8_t level = 0;
+
+    for (slot = 0; slot < SCHEDULE_SLOTS_NUMBER; slot++)
+    {
+        level = LevelAfter(slot, level);
+    }
+
+    for (slot = 0; slot < SCHEDULE_SLOTS_NUMBER; slot++)
+    {
+        level = LevelAfter(slot, level);
+        if ((slot & 3) == 0)
+        {
+            Lookup[slot >> 2] = 0;
+        }
+        Lookup[slot >> 2] |= level << ((slot & 3) * 2);
+    }
+}
+
+/**
+ * @return  level from the start of the slot, the last matching point wins
+ */
+static uint8_t LevelAfter(uint16_t slot, uint8_t level)
+{
+    uint8_t day = slot / SCHEDULE_SLOTS_PER_DAY;
+    uint8_t time = slot % SCHEDULE_SLOTS_PER_DAY;
+    uint16_t point;
+    uint8_t i;
+
+    for (i = 0; i < Record.program.count; i++)
+    {
+        point = Record.program.points[i];
+        if (SCHEDULE_POINT_SLOT(point) == time && (SCHEDULE_POINT_DAYS(point) & (1 << day)))
+        {
+            level = SCHEDULE_POINT_LEVEL(point);
+        }
+    }
+    return level;
+}
+
+/**
+ * @param seconds   local time, since 1 Jan 1970
+ */
+static uint16_t SlotAt(uint32_t seconds)
+{
+    uint8_t day;
+
+    day = (seconds / SCHEDULE_SECONDS_PER_DAY + SCHEDULE_EPOCH_WEEKDAY) % 7;
+    return day * SCHEDULE_SLOTS_PER_DAY +
+           (uint16_t)((seconds % SCHEDULE_SECONDS_PER_DAY) / SCHEDULE_SECONDS_PER_SLOT);
+}
+
+static inline uint8_t LevelOfSlot(uint16_t slot)
+{
+    return (Lookup[slot >> 2] >> ((slot & 3) * 2)) & 3;
+}
+
+static uint16_t RecordCrc(const SCHEDULE_RECORD_T *record)
+{
+    const uint8_t *data = (const uint8_t *)record;
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    for (i = 0; i < sizeof(SCHEDULE_RECORD_T) - sizeof(record->crc); i++)
+    {
+        crc = _crc16_update(crc, data[i]);
+    }
+    return crc;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file schedule.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef SCHEDULE_H_
+#define SCHEDULE_H_
+
+#include "micro.h"
+
+#define SCHEDULE_LEVELS_NUMBER      4
+#define SCHEDULE_POINTS_MAX         10
+#define SCHEDULE_SLOT_MIN           15 // lookup resolution
+#define SCHEDULE_SLOTS_PER_DAY      (24 * 60 / SCHEDULE_SLOT_MIN)
+#define SCHEDULE_SLOTS_NUMBER       (7 * SCHEDULE_SLOTS_PER_DAY)
+
+/**
+ * Transition point, 16 bits:
+ * - bits 0-6: time of day, in SCHEDULE_SLOT_MIN units
+ * - bits 7-13: days it applies to, bit 7 is Monday
+ * - bits 14-15: level from then on
+ */
+#define SCHEDULE_POINT(days, slot, level) \
+    (uint16_t)(((uint16_t)(level) << 14) | ((uint16_t)(days) << 7) | (slot))
+#define SCHEDULE_POINT_SLOT(point)  ((point) & 0x7F)
+#define SCHEDULE_POINT_DAYS(point)  (((point) >> 7) & 0x7F)
+#define SCHEDULE_POINT_LEVEL(point) ((point) >> 14)
+
+#define SCHEDULE_DAYS_WORKING       0x1F
+#define SCHEDULE_DAYS_WEEKEND       0x60
+#define SCHEDULE_DAYS_ALL           0x7F
+
+/**
+ * Weekly program. With no points the schedule is off and the thermostat
+ * uses the tempSet parameter.
+ */
+typedef struct {
+    int16_t levels[SCHEDULE_LEVELS_NUMBER];     // setpoints, Q12.4
+    uint8_t count;
+    uint16_t points[SCHEDULE_POINTS_MAX];
+} SCHEDULE_PROGRAM_T;
+
+void Schedule__Initialize(void);
+BOOL_T Schedule__IsValid(const SCHEDULE_PROGRAM_T *program);
+BOOL_T Schedule__SetProgram(const SCHEDULE_PROGRAM_T *program);
+BOOL_T Schedule__IsSaving(void);
+void Schedule__SetOverride(int16_t setpoint, uint16_t minutes);
+BOOL_T Schedule__IsActive(void);
+int16_t Schedule__GetSetpoint(void);
+BOOL_T Schedule__GetNextChange(uint16_t max_minutes, uint16_t *minutes, int16_t *setpoint);
+void Schedule__100msTask(void);
+
+#endif /* SCHEDULE_H_ */
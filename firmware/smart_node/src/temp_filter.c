@@ -0,0 +1,171 @@
+/**
+ * @file temp_filter.c
+ *
+ * @brief Integer-only conditioning chain for Q12.4 temperature samples
+ *
+ * @details Each raw sample goes through, in order:
+ *          - a plausibility check, which also drops the DS18B20 power-on
+ *            value (+85 C) unless the room really is that warm
+ *          - a 3-tap median, to reject single spikes
+ *          - a rate-of-change limiter
+ *          - an exponential moving average with a shift-based weight
+ *          The outputs are stored in a small history ring.
+ *          No divisions and no floats are used, so the chain is cheap
+ *          enough to run from the 100ms task.
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#include "micro.h"
+#include "temp_filter.h"
+
+static inline int16_t Median3(int16_t a, int16_t b, int16_t c);
+static inline BOOL_T IsPlausible(const TEMP_FILTER_T *filter, int16_t raw);
+
+void TempFilter__Initialize(TEMP_FILTER_T *filter, const TEMP_FILTER_CONFIG_T *config)
+{
+    uint8_t i;
+
+    filter->config = *config;
+    filter->ema_accumulator = 0;
+    filter->last_limited = 0;
+    filter->output = 0;
+    filter->median_idx = 0;
+    filter->history_idx = 0;
+    filter->samples = 0;
+
+    for (i = 0; i < TEMP_FILTER_MEDIAN_SIZE; i++)
+    {
+        filter->median_window[i] = 0;
+    }
+    for (i = 0; i < TEMP_FILTER_HISTORY_SIZE; i++)
+    {
+        filter->history[i] = 0;
+    }
+}
+
+/**
+ * @brief   Feed a raw sample into the chain
+ *
+ * @details On TEMP_FILTER_REJECTED the sample is discarded and the filter
+ *          state is left untouched, so the previous output is still valid.
+ *
+ * @param filter    filter instance
+ * @param raw       temperature in Q12.4, as in EVENT_TEMPERATURE_READY
+ */
+TEMP_FILTER_RESULT_T TempFilter__Process(TEMP_FILTER_T *filter, int16_t raw)
+{
+    TEMP_FILTER_RESULT_T result = TEMP_FILTER_OK;
+    int16_t median;
+    int16_t delta;
+    uint8_t i;
+
+    if (!IsPlausible(filter, raw))
+    {
+        return TEMP_FILTER_REJECTED;
+    }
+
+    if (filter->samples == 0)
+    {
+        // Prime the whole chain with the first good sample
+        for (i = 0; i < TEMP_FILTER_MEDIAN_SIZE; i++)
+        {
+            filter->median_window[i] = raw;
+        }
+        filter->last_limited = raw;
+        filter->ema_accumulator = (int32_t)raw << filter->config.ema_shift;
+    }
+
+    filter->median_window[filter->median_idx] = raw;
+    filter->median_idx++;
+    if (filter->median_idx >= TEMP_FILTER_MEDIAN_SIZE)
+    {
+        filter->median_idx = 0;
+    }
+    median = Median3(filter->median_window[0],
+                     filter->median_window[1],
+                     filter->median_window[2]);
+
+    delta = median - filter->last_limited;
+    if (delta > filter->config.max_step)
+    {
+        delta = filter->config.max_step;
+        result = TEMP_FILTER_RATE_LIMITED;
+    }
+    else if (delta < -filter->config.max_step)
+    {
+        delta = -filter->config.max_step;
+        result = TEMP_FILTER_RATE_LIMITED;
+    }
+    filter->last_limited += delta;
+
+    // acc += x - acc / 2^shift, output = acc / 2^shift
+    filter->ema_accumulator += filter->last_limited -
+            (filter->ema_accumulator >> filter->config.ema_shift);
+    filter->output = (int16_t)(filter->ema_accumulator >> filter->config.ema_shift);
+
+    filter->history[filter->history_idx] = filter->output;
+    filter->history_idx = (filter->history_idx + 1) & TEMP_FILTER_HISTORY_MASK;
+
+    if (filter->samples != 0xFF)
+    {
+        filter->samples++;
+    }
+
+    return result;
+}
+
+/**
+ * @brief   Get a past output of the filter
+ *
+ * @param age   0 for the latest output, up to TEMP_FILTER_HISTORY_SIZE - 1
+ */
+int16_t TempFilter__GetHistory(const TEMP_FILTER_T *filter, uint8_t age)
+{
+    uint8_t idx;
+
+    idx = (filter->history_idx - 1 - age) & TEMP_FILTER_HISTORY_MASK;
+    return filter->history[idx];
+}
+
+static inline int16_t Median3(int16_t a, int16_t b, int16_t c)
+{
+    int16_t result;
+
+    if (a > b)
+    {
+        result = (b > c) ? b : ((a > c) ? c : a);
+    }
+    else
+    {
+        result = (a > c) ? a : ((b > c) ? c : b);
+    }
+    return result;
+}
+
+static inline BOOL_T IsPlausible(const TEMP_FILTER_T *filter, int16_t raw)
+{
+    int16_t delta;
+
+    if (raw < filter->config.min || raw > filter->config.max)
+    {
+        return FALSE;
+    }
+
+    if (raw == TEMP_FILTER_POWER_ON_VALUE)
+    {
+        // Trust +85 C only if we are already close to it
+        if (filter->samples == 0)
+        {
+            return FALSE;
+        }
+        delta = raw - filter->output;
+        if (delta > filter->config.max_step || delta < -filter->config.max_step)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
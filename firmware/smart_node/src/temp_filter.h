@@ -0,0 +1,53 @@
+/**
+ * @file temp_filter.h
+ *
+ * @date 19 ott 2026
+ * @author Leonardo Ricupero
+ */
+
+#ifndef TEMP_FILTER_H_
+#define TEMP_FILTER_H_
+
+#include "micro.h"
+#include "temp_sensor.h"
+
+#define TEMP_FILTER_MEDIAN_SIZE     3
+#define TEMP_FILTER_HISTORY_SIZE    8 // must be a power of 2
+#define TEMP_FILTER_HISTORY_MASK    (TEMP_FILTER_HISTORY_SIZE - 1)
+
+// DS18B20 scratchpad content at power-on reset, before the first conversion
+#define TEMP_FILTER_POWER_ON_VALUE  REAL_TO_FIXED_TEMPERATURE(85.0f)
+
+typedef enum {
+    TEMP_FILTER_OK = 0,
+    TEMP_FILTER_RATE_LIMITED,
+    TEMP_FILTER_REJECTED,
+} TEMP_FILTER_RESULT_T;
+
+typedef struct {
+    int16_t min;        // Q12.4, lowest plausible reading
+    int16_t max;        // Q12.4, highest plausible reading
+    int16_t max_step;   // Q12.4, largest change accepted between two samples
+    uint8_t ema_shift;  // EMA weight of the new sample is 1 / 2^ema_shift
+} TEMP_FILTER_CONFIG_T;
+
+typedef struct {
+    TEMP_FILTER_CONFIG_T config;
+    int32_t ema_accumulator;  // Q12.4 scaled by 2^ema_shift
+    int16_t median_window[TEMP_FILTER_MEDIAN_SIZE];
+    int16_t last_limited;     // last output of the rate limiter
+    int16_t output;           // last output of the whole chain
+    int16_t history[TEMP_FILTER_HISTORY_SIZE];
+    uint8_t median_idx;
+    uint8_t history_idx;
+    uint8_t samples;          // accepted samples, saturated at 255
+} TEMP_FILTER_T;
+
+void TempFilter__Initialize(TEMP_FILTER_T *filter, const TEMP_FILTER_CONFIG_T *config);
+TEMP_FILTER_RESULT_T TempFilter__Process(TEMP_FILTER_T *filter, int16_t raw);
+int16_t TempFilter__GetHistory(const TEMP_FILTER_T *filter, uint8_t age);
+
+#define TempFilter__GetOutput(filter) ((filter)->output)
+#define TempFilter__IsValid(filter) ((filter)->samples != 0)
+
+#endif /* TEMP_FILTER_H_ */
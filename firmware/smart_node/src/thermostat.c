@@ -1,141 +1,548 @@
 /**
  * @file thermostat.c
  *
+ * @brief Thermostat, one zone per relay
+ *
+ * @details Each zone has its own parameters, temperature source and
+ *          control state. The board sensor is read once for all the zones
+ *          using it, the other zones are fed by a remote node.
+ *
  * @date 02 gen 2018
  * @author Leonardo Ricupero
  */
 
 #include "micro.h"
+#include "timer.h"
 #include "temp_sensor.h"
 #include "relays.h"
 #include "parameters.h"
+#include "temp_filter.h"
+#include "pi_controller.h"
+#include "logger.h"
+#include "schedule.h"
+#include "optimal_start.h"
+#include "relay_tuning.h"
+#include "trace.h"
+#include "probe.h"
+#include "fsm.h"
+#include "event.h"
 #include "thermostat.h"
 
-#define THERMOSTAT_SAMPLE_RATE_100MS 50 // 5 seconds
-#define THERMOSTAT_TIMEOUT_100MS 10 // 1 seconds
+#define THERMOSTAT_SAMPLE_RATE_MS 5000
+#define THERMOSTAT_TIMEOUT_MS 1000
+#define THERMOSTAT_MAX_TEMPERATURE_AGE_100MS 3000 // 5 minutes
+#define THERMOSTAT_NO_TEMPERATURE (int16_t)0xFFFF
 
-#define THERMOSTAT_LOAD_ON()  {Relays__Set(RELAY_0); Thermostat_Status.load_active = 1;}
-#define THERMOSTAT_LOAD_OFF() {Relays__Reset(RELAY_0); Thermostat_Status.load_active = 0;}
+// PI control
+#define THERMOSTAT_PI_KD            0 // derivative disabled
+#define THERMOSTAT_100MS_PER_MIN    600
 
 typedef enum {
     STATE_IDLE,
     STATE_WAIT_FOR_TEMPERATURE,
     STATE_ERROR_FOUND,
+    STATE_NUMBER,
 } TEMP_READING_STATE_T;
 
+typedef enum {
+    EVENT_TICK = 0,     // 100ms
+} TEMP_READING_EVENT_T;
+
 typedef union {
     struct {
         uint8_t temperature_ready :1;
-        uint8_t load_active :1;
+        uint8_t load_active :1;   // last command sent to the relay
+        uint8_t load_request :1;  // what the control wants
+        uint8_t degraded :1;      // running on the last good temperature
+        uint8_t failsafe :1;      // last good temperature too old, load forced off
+        uint8_t remote_ready :1;  // remote reading waiting for the 100ms task
     };
     uint8_t all;
 } THERMOSTAT_STATUS_T;
 
-typedef enum {
-    MODE_WINTER,
-    MODE_SUMMER,
-} THERMOSTAT_MODE_T;
+typedef struct {
+    RELAY_T relay;
+    THERMOSTAT_STATUS_T status;
+    int16_t temperature;        // Q12.4 format
+    int16_t remote_temperature; // Q12.4 format
+    int16_t setpoint;           // Q12.4 format
+    uint16_t temperature_age_100ms;
+    TEMP_FILTER_T filter;
+    uint8_t control;
+    PI_CONTROLLER_T controller;
+    uint16_t cycle_counter_100ms;
+    uint16_t on_time_100ms;
+    uint16_t switch_age_100ms;  // since the last relay command, saturated
+} THERMOSTAT_ZONE_T;
+
 
+static TIMER_T Sample_Timer;
+static TIMER_T Timeout_Timer;
+static uint8_t Parameters_Generation;
+static uint8_t Samples;         // board sensor samples, wraps
+static EVENT_RECORD_T Sensor_Result;  // from the main loop, see OnSensorResult
+static BOOL_T Sensor_Result_Ready;
+static THERMOSTAT_ZONE_T Zones[THERMOSTAT_ZONES_NUMBER];
 
-static uint8_t Sample_Counter;
-static uint8_t Timeout_Counter;
-static TEMP_READING_STATE_T Temperature_Reading_State;
-static THERMOSTAT_STATUS_T Thermostat_Status;
-static THERMOSTAT_MODE_T Thermostat_Mode;
-static int16_t Last_Temperature; // Q12.4 format
+static const TEMP_FILTER_CONFIG_T Temperature_Filter_Config = {
+    .min = THERMOSTAT_FILTER_MIN,
+    .max = THERMOSTAT_FILTER_MAX,
+    .max_step = THERMOSTAT_FILTER_MAX_STEP,
+    .ema_shift = THERMOSTAT_FILTER_EMA_SHIFT,
+};
 
-static inline void TemperatureReadingStateMachine(void);
+static BOOL_T IsSampleDue(void);
+static BOOL_T IsTemperatureReady(void);
+static BOOL_T IsErrorFound(void);
+static BOOL_T IsTimeoutExpired(void);
+static void OnSensorResult(const EVENT_RECORD_T *event);
+static void StartSample(void);
+static void TakeSample(void);
+static void MarkDegraded(void);
+static void ZoneTask(THERMOSTAT_ZONE_T *zone, const config_thermostat_s *config, BOOL_T changed);
+static void ProcessSample(THERMOSTAT_ZONE_T *zone, int16_t raw);
+static inline void HysteresisControl(THERMOSTAT_ZONE_T *zone, const config_thermostat_s *config);
+static inline void TimeProportioningOutput(THERMOSTAT_ZONE_T *zone, const config_thermostat_s *config);
+static void ConfigureController(THERMOSTAT_ZONE_T *zone, const config_thermostat_s *config);
+static void DriveRelays(void);
+static void LogSample(const THERMOSTAT_ZONE_T *zone, uint8_t error);
+
+static const FSM_TRANSITION_T Idle_Rows[] PROGMEM = {
+    {EVENT_TICK, IsSampleDue, StartSample, STATE_WAIT_FOR_TEMPERATURE},
+};
+static const FSM_TRANSITION_T Wait_For_Temperature_Rows[] PROGMEM = {
+    {EVENT_TICK, IsTemperatureReady, TakeSample, STATE_IDLE},
+    {EVENT_TICK, IsErrorFound, NULL, STATE_ERROR_FOUND},
+    {EVENT_TICK, IsTimeoutExpired, NULL, STATE_ERROR_FOUND},
+};
+static const FSM_TRANSITION_T Error_Found_Rows[] PROGMEM = {
+    {EVENT_TICK, NULL, MarkDegraded, STATE_IDLE},
+};
+
+static const FSM_STATE_T Temperature_Reading_States[STATE_NUMBER] PROGMEM = {
+    [STATE_IDLE] = FSM_STATE(Idle_Rows),
+    [STATE_WAIT_FOR_TEMPERATURE] = FSM_STATE(Wait_For_Temperature_Rows),
+    [STATE_ERROR_FOUND] = FSM_STATE(Error_Found_Rows),
+};
+
+static FSM_T Temperature_Reading_Fsm;
+static uint32_t State_Time_Us[STATE_NUMBER];
 
 void Thermostat__Initialize(void)
 {
-    Sample_Counter = 0;
-    Temperature_Reading_State = STATE_IDLE;
-    Thermostat_Status.all = 0;
-    Thermostat_Mode = MODE_WINTER;
+    const PARAM_T *param = Parameters__Get();
+    THERMOSTAT_ZONE_T *zone;
+    uint8_t i;
+
+    // Armed from the 100ms task, they are over before it runs
+    Timer__Init(&Sample_Timer, NULL, NULL);
+    Timer__Init(&Timeout_Timer, NULL, NULL);
+    Timer__Arm(&Sample_Timer, THERMOSTAT_SAMPLE_RATE_MS, 0);
+    Samples = 0;
+    Sensor_Result_Ready = FALSE;
+    Event__Subscribe(EVENT_TEMPERATURE_READY, OnSensorResult);
+    Event__Subscribe(EVENT_TEMPERATURE_ERROR, OnSensorResult);
+    Fsm__Initialize(FSM_THERMOSTAT, &Temperature_Reading_Fsm, Temperature_Reading_States,
+                    STATE_NUMBER, STATE_IDLE, FSM_NO_TRACE, State_Time_Us);
+    Parameters_Generation = Parameters__GetGeneration();
+
+    for (i = 0; i < THERMOSTAT_ZONES_NUMBER; i++)
+    {
+        zone = &Zones[i];
+        zone->relay = (RELAY_T)i; // zone n drives relay n
+        zone->status.all = 0;
+        zone->temperature = THERMOSTAT_NO_TEMPERATURE;
+        zone->temperature_age_100ms = THERMOSTAT_MAX_TEMPERATURE_AGE_100MS;
+        zone->setpoint = param->thermostat[i].tempSet;
+        zone->switch_age_100ms = UINT16_MAX;
+        zone->control = param->thermostat[i].control;
+        PiController__Reset(&zone->controller);
+        ConfigureController(zone, &param->thermostat[i]);
+        zone->cycle_counter_100ms = 0;
+        zone->on_time_100ms = 0;
+        TempFilter__Initialize(&zone->filter, &Temperature_Filter_Config);
+    }
 
-    Last_Temperature = 0xFFFF;
     TempSensor__Configure();
 }
 
 
 void Thermostat__100msTask(void)
 {
-    TemperatureReadingStateMachine();
+    const PARAM_T *param;
+    BOOL_T changed = FALSE;
+    uint8_t i;
 
-    if (Thermostat_Status.temperature_ready)
+    param = Parameters__Get();
+    if (Parameters_Generation != Parameters__GetGeneration())
     {
-        Thermostat_Status.temperature_ready = 0;
+        Parameters_Generation = Parameters__GetGeneration();
+        changed = TRUE;
+    }
 
-        if (Last_Temperature <= THERMOSTAT_TEMPERATURE_SET - THERMOSTAT_TEMPERATURE_HISTERESYS)
+    Fsm__Dispatch(&Temperature_Reading_Fsm, EVENT_TICK);
+
+    for (i = 0; i < THERMOSTAT_ZONES_NUMBER; i++)
+    {
+        ZoneTask(&Zones[i], &param->thermostat[i], changed);
+    }
+
+    DriveRelays();
+}
+
+/**
+ * @brief   Last filtered temperature of a zone, Q12.4
+ *
+ * @return  FALSE if the source is failing and the value is stale
+ */
+BOOL_T Thermostat__GetTemperature(uint8_t zone, int16_t *temperature)
+{
+    const THERMOSTAT_ZONE_T *z = &Zones[zone];
+
+    *temperature = z->temperature;
+    return (z->temperature != THERMOSTAT_NO_TEMPERATURE &&
+            z->status.degraded == 0 &&
+            z->status.failsafe == 0) ? TRUE : FALSE;
+}
+
+/**
+ * @brief   Temperature read by a remote node, Q12.4
+ *
+ * @details Used by the zones with SOURCE_REMOTE, it goes through the same
+ *          filter as the local sensor at the next 100ms task
+ */
+void Thermostat__SetRemoteTemperature(uint8_t zone, int16_t temperature)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        Zones[zone].remote_temperature = temperature;
+        Zones[zone].status.remote_ready = 1;
+    }
+}
+
+static void ZoneTask(THERMOSTAT_ZONE_T *zone, const config_thermostat_s *config, BOOL_T changed)
+{
+    int16_t setpoint;
+
+    if (zone->status.remote_ready)
+    {
+        zone->status.remote_ready = 0;
+        if (config->source == SOURCE_REMOTE)
         {
-            if (Thermostat_Status.load_active == 0)
-            {
-                THERMOSTAT_LOAD_ON();
-            }
+            ProcessSample(zone, zone->remote_temperature);
         }
-        else if (Last_Temperature >= THERMOSTAT_TEMPERATURE_SET)
+    }
+
+    if (zone->switch_age_100ms < UINT16_MAX)
+    {
+        zone->switch_age_100ms++;
+    }
+
+    if (zone->temperature_age_100ms < THERMOSTAT_MAX_TEMPERATURE_AGE_100MS)
+    {
+        zone->temperature_age_100ms++;
+    }
+    else if (zone->status.failsafe == 0)
+    {
+        // No trustworthy temperature for too long: safe state is load off
+        zone->status.failsafe = 1;
+        zone->status.load_request = 0;
+        PiController__Reset(&zone->controller);
+        // A fault only if the zone lost a temperature it had: every zone
+        // starts here, before its first reading
+        if (zone->temperature != THERMOSTAT_NO_TEMPERATURE)
+        {
+            Trace__Fault(TRACE_SOURCE_THERMOSTAT, (uint8_t)(zone - Zones));
+        }
+    }
+
+    if (changed)
+    {
+        ConfigureController(zone, config);
+        if (zone->control != config->control)
+        {
+            zone->control = config->control;
+            PiController__Reset(&zone->controller);
+            zone->cycle_counter_100ms = 0;
+        }
+    }
+
+    // The schedule is shared by the zones following it
+    setpoint = (config->scheduled && Schedule__IsActive()) ?
+               OptimalStart__GetSetpoint() : config->tempSet;
+    if (zone->setpoint != setpoint)
+    {
+        zone->setpoint = setpoint;
+        changed = TRUE;
+    }
+
+    // Apply the changes now, without waiting for the next sample
+    if (changed && zone->status.failsafe == 0 && zone->temperature != THERMOSTAT_NO_TEMPERATURE)
+    {
+        zone->status.temperature_ready = 1;
+    }
+
+    if (config->mode == SUMMER)
+    {
+        // No heating in summer
+        zone->status.temperature_ready = 0;
+        zone->status.load_request = 0;
+    }
+    else
+    {
+        if (zone->status.temperature_ready)
         {
-            if (Thermostat_Status.load_active == 1)
+            zone->status.temperature_ready = 0;
+
+            if (config->control == CONTROL_PI)
+            {
+                PiController__Update(&zone->controller, zone->setpoint, zone->temperature);
+            }
+            else
             {
-                THERMOSTAT_LOAD_OFF();
+                HysteresisControl(zone, config);
             }
+            Probe__Mark(PROBE_DECISION, (uint8_t)(zone - Zones) | (changed ? PROBE_DECISION_CHANGE : 0));
+        }
+
+        if (config->control == CONTROL_PI && zone->status.failsafe == 0)
+        {
+            TimeProportioningOutput(zone, config);
         }
     }
 }
 
-static inline void TemperatureReadingStateMachine(void)
+static void ProcessSample(THERMOSTAT_ZONE_T *zone, int16_t raw)
 {
-    TEMP_READING_STATE_T next_state;
+    if (TempFilter__Process(&zone->filter, raw) != TEMP_FILTER_REJECTED)
+    {
+        zone->temperature = TempFilter__GetOutput(&zone->filter);
+        zone->temperature_age_100ms = 0;
+        zone->status.temperature_ready = 1;
+        zone->status.degraded = 0;
+        zone->status.failsafe = 0;
+    }
+}
+
+/**
+ * @brief   On below SET - HISTERESYS, off above SET
+ */
+static inline void HysteresisControl(THERMOSTAT_ZONE_T *zone, const config_thermostat_s *config)
+{
+    if (zone->temperature <= zone->setpoint - (int16_t)config->hist)
+    {
+        zone->status.load_request = 1;
+    }
+    else if (zone->temperature >= zone->setpoint)
+    {
+        zone->status.load_request = 0;
+    }
+}
 
-    next_state = Temperature_Reading_State;
+/**
+ * @brief   Turn the PI duty cycle into on and off times
+ *
+ * @details The load is on at the beginning of each window, for a time
+ *          proportional to the duty cycle computed at the window start.
+ *          On or off times shorter than minOnOff are merged into the rest
+ *          of the window, and the relay never switches twice within
+ *          minOnOff, so the bistable relay is not worn out.
+ */
+static inline void TimeProportioningOutput(THERMOSTAT_ZONE_T *zone, const config_thermostat_s *config)
+{
+    uint16_t window = (uint16_t)config->cycle * THERMOSTAT_100MS_PER_MIN;
+    uint16_t min_on_off = (uint16_t)config->minOnOff * 10;
 
-    if (Sample_Counter < THERMOSTAT_SAMPLE_RATE_100MS)
+    if (zone->cycle_counter_100ms >= window)
     {
-        Sample_Counter++;
+        zone->cycle_counter_100ms = 0;
     }
 
-    switch (Temperature_Reading_State)
+    if (zone->cycle_counter_100ms == 0)
     {
-        case STATE_IDLE:
+        zone->on_time_100ms = (uint16_t)(((uint32_t)window * PiController__GetOutput(&zone->controller)) /
+                                         PI_CONTROLLER_OUTPUT_MAX);
+        if (zone->on_time_100ms < min_on_off)
         {
-            if (Sample_Counter == THERMOSTAT_SAMPLE_RATE_100MS)
-            {
-                Sample_Counter = 0;
-                TempSensor__StartAcquisition();
-                Timeout_Counter = THERMOSTAT_TIMEOUT_100MS;
-                next_state = STATE_WAIT_FOR_TEMPERATURE;
-            }
-            break;
+            zone->on_time_100ms = 0;
         }
-        case STATE_WAIT_FOR_TEMPERATURE:
+        else if (window - zone->on_time_100ms < min_on_off)
         {
-            if (TempSensor__IsTemperatureReady())
+            zone->on_time_100ms = window;
+        }
+    }
+
+    if (zone->switch_age_100ms >= min_on_off)
+    {
+        zone->status.load_request = (zone->cycle_counter_100ms < zone->on_time_100ms) ? 1 : 0;
+    }
+    zone->cycle_counter_100ms++;
+}
+
+static void ConfigureController(THERMOSTAT_ZONE_T *zone, const config_thermostat_s *config)
+{
+    PI_CONTROLLER_CONFIG_T controller_config;
+
+    controller_config.kp = config->kp;
+    controller_config.ki = config->ki;
+    controller_config.kd = THERMOSTAT_PI_KD;
+    PiController__Configure(&zone->controller, &controller_config);
+}
+
+/**
+ * @brief   Send the relay commands requested by the zones
+ *
+ * @details A relay under self-test is left alone, the command is sent once
+ *          the test is over
+ */
+static void DriveRelays(void)
+{
+    THERMOSTAT_ZONE_T *zone;
+    uint8_t i;
+
+    for (i = 0; i < THERMOSTAT_ZONES_NUMBER; i++)
+    {
+        zone = &Zones[i];
+        if (zone->status.load_request != zone->status.load_active &&
+            RelayTuning__IsRunning(zone->relay) == FALSE)
+        {
+            if (zone->status.load_request)
             {
-                Last_Temperature = TempSensor__GetTemperature();
-                Thermostat_Status.temperature_ready = 1;
-                next_state = STATE_IDLE;
+                Relays__Set(zone->relay);
             }
             else
             {
-                Timeout_Counter--;
-                if (Timeout_Counter == 0)
-                {
-                    next_state = STATE_ERROR_FOUND;
-                }
+                Relays__Reset(zone->relay);
             }
-            break;
+            zone->status.load_active = zone->status.load_request;
+            zone->switch_age_100ms = 0;
         }
-        case STATE_ERROR_FOUND:
+    }
+}
+
+static BOOL_T IsSampleDue(void)
+{
+    return Timer__IsArmed(&Sample_Timer) ? FALSE : TRUE;
+}
+
+static BOOL_T IsTemperatureReady(void)
+{
+    return (Sensor_Result_Ready && Sensor_Result.type == EVENT_TEMPERATURE_READY) ? TRUE : FALSE;
+}
+
+static BOOL_T IsErrorFound(void)
+{
+    return (Sensor_Result_Ready && Sensor_Result.type == EVENT_TEMPERATURE_ERROR) ? TRUE : FALSE;
+}
+
+static BOOL_T IsTimeoutExpired(void)
+{
+    return Timer__IsArmed(&Timeout_Timer) ? FALSE : TRUE;
+}
+
+/**
+ * @brief   Result of the board sensor, from the bus
+ *
+ * @details In the main loop, it waits there for the next 100ms task
+ */
+static void OnSensorResult(const EVENT_RECORD_T *event)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        Sensor_Result = *event;
+        Sensor_Result_Ready = TRUE;
+    }
+}
+
+static void StartSample(void)
+{
+    Sensor_Result_Ready = FALSE;
+    Timer__Arm(&Sample_Timer, THERMOSTAT_SAMPLE_RATE_MS, 0);
+    TempSensor__StartAcquisition();
+    Timer__Arm(&Timeout_Timer, THERMOSTAT_TIMEOUT_MS, 0);
+}
+
+/**
+ * @brief   Feed the new reading to the zones using the board sensor
+ */
+static void TakeSample(void)
+{
+    const PARAM_T *param = Parameters__Get();
+    const THERMOSTAT_ZONE_T *logged = NULL;
+    int16_t raw;
+    uint8_t i;
+
+    raw = Sensor_Result.value;
+    for (i = 0; i < THERMOSTAT_ZONES_NUMBER; i++)
+    {
+        if (param->thermostat[i].source == SOURCE_LOCAL)
         {
-            // todo better error handling
-            next_state = STATE_IDLE;
-            break;
+            ProcessSample(&Zones[i], raw);
+            if (logged == NULL)
+            {
+                logged = &Zones[i];
+            }
         }
-        default:
+    }
+    if (logged != NULL)
+    {
+        LogSample(logged, TEMP_SENSOR_ERROR_NONE);
+        Samples++;
+        // Seen by the main loop once the zones ran their control
+        Event__Publish(EVENT_BUS_100MS, EVENT_SAMPLE_TAKEN, Samples, 0);
+    }
+}
+
+/**
+ * @brief   Keep regulating on the last good value until it gets too old,
+ *          the driver takes care of backing off the probing
+ */
+static void MarkDegraded(void)
+{
+    const PARAM_T *param = Parameters__Get();
+    const THERMOSTAT_ZONE_T *logged = NULL;
+    uint8_t i;
+
+    for (i = 0; i < THERMOSTAT_ZONES_NUMBER; i++)
+    {
+        if (param->thermostat[i].source == SOURCE_LOCAL)
         {
-            break;
+            Zones[i].status.degraded = 1;
+            if (logged == NULL)
+            {
+                logged = &Zones[i];
+            }
         }
     }
+    if (logged != NULL)
+    {
+        LogSample(logged, TempSensor__GetErrorCounters()->last_error);
+    }
+}
+
+/**
+ * @brief   Log a sample of the board sensor, with the first zone using it
+ */
+static void LogSample(const THERMOSTAT_ZONE_T *zone, uint8_t error)
+{
+    uint8_t status = 0;
+
+    if (Relays__IsSet(RELAY_0))
+    {
+        status |= LOGGER_STATUS_RELAY_0;
+    }
+    if (Relays__IsSet(RELAY_1))
+    {
+        status |= LOGGER_STATUS_RELAY_1;
+    }
+    if (zone->status.degraded)
+    {
+        status |= LOGGER_STATUS_DEGRADED;
+    }
+    if (zone->status.failsafe)
+    {
+        status |= LOGGER_STATUS_FAILSAFE;
+    }
 
-    Temperature_Reading_State = next_state;
+    Logger__Append(zone->temperature, status, error);
 }
@@ -8,8 +8,21 @@
 #ifndef THERMOSTAT_H_
 #define THERMOSTAT_H_
 
+#include "micro.h"
+#include "temp_sensor.h"
+
+#define THERMOSTAT_ZONES_NUMBER 2 // one per relay
+
+// Temperature conditioning, also used by the network simulator
+#define THERMOSTAT_FILTER_MIN       REAL_TO_FIXED_TEMPERATURE(-20.0f)
+#define THERMOSTAT_FILTER_MAX       REAL_TO_FIXED_TEMPERATURE(60.0f)
+#define THERMOSTAT_FILTER_MAX_STEP  REAL_TO_FIXED_TEMPERATURE(1.0f) // per sample
+#define THERMOSTAT_FILTER_EMA_SHIFT 2 // ~4 samples time constant
+
 void Thermostat__Initialize(void);
 void Thermostat__100msTask(void);
+BOOL_T Thermostat__GetTemperature(uint8_t zone, int16_t *temperature);
+void Thermostat__SetRemoteTemperature(uint8_t zone, int16_t temperature);
 
 
 #endif /* THERMOSTAT_H_ */
@@ -6,20 +6,23 @@
  */
 
 #include "micro.h"
+#include "timer.h"
 #include "ui.h"
 
-#define UI_BLINK_RATE_500MS 5 // 500ms
+#define UI_BLINK_PERIOD_MS 500
 
-static uint8_t Countdown_Timer;
+static TIMER_T Blink_Timer;
 static uint8_t Blinks_Remaining;
 
+static void OnBlinkTimer(void *context);
+
 void Ui__Initialize(void)
 {
 	DDRB |= (1 << DDB0);
 	Ui__LedOff();
 
 	Blinks_Remaining = 0;
-	Countdown_Timer = 0;
+	Timer__Init(&Blink_Timer, OnBlinkTimer, NULL);
 }
 
 void Ui__LedBlink500ms(uint8_t times)
@@ -27,24 +30,21 @@ void Ui__LedBlink500ms(uint8_t times)
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
     {
         Blinks_Remaining = (times << 1) + 1;
-        Countdown_Timer = UI_BLINK_RATE_500MS;
         Ui__LedOn();
+        Timer__Arm(&Blink_Timer, UI_BLINK_PERIOD_MS, UI_BLINK_PERIOD_MS);
     }
 }
 
-void Ui__100msTask(void)
+/**
+ * @details From the timer ISR
+ */
+static void OnBlinkTimer(void *context)
 {
-    if (Blinks_Remaining != 0)
+    (void)context;
+    Ui__LedToggle();
+    Blinks_Remaining--;
+    if (Blinks_Remaining == 0)
     {
-        if (Countdown_Timer == 0)
-        {
-            Ui__LedToggle();
-            Countdown_Timer = UI_BLINK_RATE_500MS;
-            Blinks_Remaining--;
-        }
-        else
-        {
-            Countdown_Timer--;
-        }
+        Timer__Disarm(&Blink_Timer);
     }
 }
@@ -17,10 +17,9 @@
 #define Ui__LedOn() {LED_PORT |= (1 << LED_PIN);}
 #define Ui__LedOff() {LED_PORT &= ~(1 << LED_PIN);}
 
-#define Ui__LedToggle() {PINB = (1 << PINB0);}
+#define Ui__LedToggle() {Micro__Write(PINB, (1 << PINB0));}
 
 void Ui__Initialize(void);
 void Ui__LedBlink500ms(uint8_t times);
-void Ui__100msTask(void);
 
 #endif /* SRC_UI_H_ */
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+Compare two benchmark reports of bench/simbench, e.g. before and after a
+commit, and print the cycle counts that changed.
+
+The exit status is 1 when a count grew by more than the threshold, in percent
+of the base value, so the comparison can gate a build.
+
+    bench_compare.py base.json new.json
+    bench_compare.py --threshold 2 base.json new.json
+
+@date 19 ott 2026
+@author Leonardo Ricupero
+"""
+
+import argparse
+import json
+import sys
+
+# Worse when larger: everything but the calls
+STATS = ['min', 'mean', 'max']
+ISR_STATS = STATS + ['latency_max', 'latency_mean']
+
+
+def metrics(report):
+    """Flatten a report to {name: value}."""
+    flat = {}
+    for name, stats in report.get('benchmarks', {}).items():
+        for key in STATS:
+            flat['benchmarks.%s.%s' % (name, key)] = stats[key]
+    for name, stats in report.get('isr', {}).items():
+        for key in ISR_STATS:
+            flat['isr.%s.%s' % (name, key)] = stats[key]
+    off = report.get('interrupts_off', {})
+    for name, stats in off.get('sites', {}).items():
+        flat['interrupts_off.%s.max' % name] = stats['max']
+    if 'max' in off:
+        flat['interrupts_off.max'] = off['max']
+        flat['interrupts_off.total'] = off['total']
+    return flat
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('base', help='report of the reference build')
+    parser.add_argument('new', help='report of the build under test')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='allowed growth in percent (default 5)')
+    parser.add_argument('--all', action='store_true',
+                        help='print the unchanged counts too')
+    args = parser.parse_args()
+
+    with open(args.base) as f:
+        base = metrics(json.load(f))
+    with open(args.new) as f:
+        new = metrics(json.load(f))
+
+    regressions = 0
+    width = max([len(name) for name in base.keys() | new.keys()] + [6])
+    print('%-*s %12s %12s %8s' % (width, 'metric', 'base', 'new', 'change'))
+    for name in sorted(base.keys() | new.keys()):
+        if name not in base or name not in new:
+            print('%-*s %12s %12s %8s' % (width, name, base.get(name, '-'),
+                                          new.get(name, '-'), 'n/a'))
+            continue
+        old, value = base[name], new[name]
+        if old == value and not args.all:
+            continue
+        change = (value - old) * 100.0 / old if old else (0.0 if value == 0 else float('inf'))
+        mark = ''
+        if change > args.threshold:
+            mark = ' !'
+            regressions += 1
+        print('%-*s %12g %12g %+7.1f%%%s' % (width, name, old, value, change, mark))
+
+    if regressions:
+        print('%d counts grew by more than %g%%' % (regressions, args.threshold),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
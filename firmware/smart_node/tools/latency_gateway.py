@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""
+Reference gateway for the end-to-end latency benchmark of bench/simlatency,
+on the USART of a node.
+
+It turns on the report frames, stores each report in SQLite, and every few
+seconds sends a new setpoint, far above then far below the room, so that
+each request moves the relay. The stages of the gateway go in the events
+file of simlatency, on the same clock:
+
+    parsed      a report frame passed the CRC
+    stored      the report is committed in the database
+    command     a request was written to the USART
+
+    latency_gateway.py --events events.log /dev/pts/3
+
+@date 19 ott 2026
+@author Leonardo Ricupero
+"""
+
+import argparse
+import os
+import select
+import signal
+import sqlite3
+import sys
+import time
+import tty
+
+REQUEST_TAG = ord('C')
+RESPONSE_TAG = ord('R')
+REPORT_TAG = ord('S')
+TRACE_TAG = ord('T')
+TRACE_RECORD = 4
+
+OP_SET = 0x02
+OP_REPORT = 0x0E
+PARAM_ID_TEMP_SET_Z0 = 1
+REPORT_SIZE = 4
+
+
+def crc8(data):
+    """CRC-8 CCITT, as _crc8_ccitt_update from 0."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def frame(tag, payload):
+    return bytes([tag, len(payload)]) + payload + bytes([crc8(bytes([len(payload)]) + payload)])
+
+
+class Parser:
+    """Frames of the node, a byte at a time, as in simlatency."""
+
+    def __init__(self):
+        self.tag = None
+        self.left = None
+        self.body = b''
+
+    def feed(self, byte):
+        """Return (tag, body) when the byte completes a frame."""
+        if self.tag is None:
+            if byte in (RESPONSE_TAG, REPORT_TAG, TRACE_TAG):
+                self.tag = byte
+            return None
+        if self.left is None:
+            self.left = byte * TRACE_RECORD if self.tag == TRACE_TAG else byte + 1
+            self.body = bytes([byte])
+        else:
+            self.body += bytes([byte])
+            self.left -= 1
+        if self.left != 0:
+            return None
+        result = (self.tag, self.body)
+        self.tag = None
+        self.left = None
+        return result
+
+
+class Gateway:
+    def __init__(self, port, events, database):
+        self.port = port
+        self.events = events
+        self.database = database
+        self.sequence = 0
+        self.parser = Parser()
+        self.stored = 0
+        self.bad = 0
+
+    def emit(self, stage, sequence):
+        self.events.write('%d %s %d\n' % (time.monotonic_ns() // 1000, stage, sequence))
+        self.events.flush()
+
+    def request(self, payload):
+        """Send the operations with the next sequence number."""
+        self.sequence = (self.sequence + 1) & 0xFF
+        data = frame(REQUEST_TAG, bytes([self.sequence]) + payload)
+        self.emit('command', self.sequence)
+        os.write(self.port, data)
+
+    def set_setpoint(self, celsius):
+        value = int(celsius * 16) & 0xFFFF
+        self.request(bytes([OP_SET, PARAM_ID_TEMP_SET_Z0, value >> 8, value & 0xFF]))
+
+    def receive(self, data):
+        for byte in data:
+            result = self.parser.feed(byte)
+            if result is None or result[0] != REPORT_TAG:
+                continue
+            body = result[1]
+            if len(body) != REPORT_SIZE + 2 or crc8(body[:-1]) != body[-1]:
+                self.bad += 1
+                continue
+            sequence = body[1]
+            self.emit('parsed', sequence)
+            temperature = int.from_bytes(body[2:4], 'big', signed=True) / 16.0
+            self.database.execute(
+                'INSERT INTO readings (sequence, temperature, flags, received_us) '
+                'VALUES (?, ?, ?, ?)',
+                (sequence, temperature, body[4], time.monotonic_ns() // 1000))
+            self.database.commit()
+            self.emit('stored', sequence)
+            self.stored += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('port', help='pty of the node')
+    parser.add_argument('--events', required=True, help='events file of simlatency')
+    parser.add_argument('--database', default='latency.sqlite',
+                        help='SQLite file of the readings (default latency.sqlite)')
+    parser.add_argument('--period', type=float, default=10.0,
+                        help='seconds between two setpoints (default 10)')
+    parser.add_argument('--high', type=float, default=30.0,
+                        help='setpoint above the room, Celsius (default 30)')
+    parser.add_argument('--low', type=float, default=10.0,
+                        help='setpoint below the room, Celsius (default 10)')
+    args = parser.parse_args()
+
+    port = os.open(args.port, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(port)
+    database = sqlite3.connect(args.database)
+    database.execute('CREATE TABLE IF NOT EXISTS readings '
+                     '(sequence INTEGER, temperature REAL, flags INTEGER, received_us INTEGER)')
+    stopping = []
+    signal.signal(signal.SIGTERM, lambda number, frame: stopping.append(number))
+
+    with open(args.events, 'a') as events:
+        gateway = Gateway(port, events, database)
+        gateway.request(bytes([OP_REPORT, 1]))
+        high = True
+        next_command = time.monotonic() + args.period
+        while not stopping:
+            timeout = max(0.0, next_command - time.monotonic())
+            try:
+                readable, _, _ = select.select([port], [], [], timeout)
+            except InterruptedError:
+                continue
+            if readable:
+                try:
+                    gateway.receive(os.read(port, 256))
+                except OSError:
+                    break
+            if time.monotonic() >= next_command:
+                gateway.set_setpoint(args.high if high else args.low)
+                high = not high
+                next_command += args.period
+
+    database.close()
+    print('latency_gateway: %d readings stored, %d bad frames' % (gateway.stored, gateway.bad),
+          file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Latency histograms of an events file of bench/simlatency, per stage of the
+readings and of the commands, and end to end.
+
+A reading starts at the end of the conversion and a command when the gateway
+writes it. The sequence numbers wrap, so a stage belongs to the last reading
+or command started with the same number.
+
+    latency_report.py events.log
+    latency_report.py --json latency.json events.log
+
+@date 19 ott 2026
+@author Leonardo Ricupero
+"""
+
+import argparse
+import json
+import sys
+
+PATHS = {
+    'reading': ['convert', 'ready', 'decision', 'queued', 'wire', 'parsed', 'stored'],
+    'command': ['command', 'command_wire', 'command_parsed', 'command_decision', 'pulse'],
+}
+
+BAR_WIDTH = 40
+
+
+def load(path):
+    """Events sorted by time, the order of the file on a tie."""
+    events = []
+    with open(path) as f:
+        for number, line in enumerate(f):
+            fields = line.split()
+            if len(fields) == 3:
+                events.append((int(fields[0]), number, fields[1], int(fields[2])))
+    events.sort()
+    return events
+
+
+def occurrences(events):
+    """{path: [{stage: us}]}, one dictionary per reading or command."""
+    stage_path = {stage: path for path, stages in PATHS.items() for stage in stages}
+    found = {path: [] for path in PATHS}
+    last = {}
+    for us, _, stage, sequence in events:
+        path = stage_path.get(stage)
+        if path is None:
+            continue
+        key = (path, sequence)
+        if stage == PATHS[path][0]:
+            last[key] = {}
+            found[path].append(last[key])
+        if key in last and stage not in last[key]:
+            last[key][stage] = us
+    return found
+
+
+def percentile(values, fraction):
+    return values[min(len(values) - 1, int(fraction * len(values)))]
+
+
+def summary(values):
+    values = sorted(values)
+    return {
+        'count': len(values),
+        'min': values[0],
+        'p50': percentile(values, 0.5),
+        'p90': percentile(values, 0.9),
+        'p99': percentile(values, 0.99),
+        'max': values[-1],
+    }
+
+
+def histogram(values):
+    """Counts in power of two buckets of microseconds."""
+    buckets = {}
+    for value in values:
+        bucket = max(1, value).bit_length()
+        buckets[bucket] = buckets.get(bucket, 0) + 1
+    return [(1 << (bucket - 1), buckets.get(bucket, 0))
+            for bucket in range(min(buckets), max(buckets) + 1)]
+
+
+def intervals(found):
+    """{name: [us]}, between each stage and the next one, and end to end."""
+    result = {}
+    for path, stages in PATHS.items():
+        pairs = list(zip(stages, stages[1:])) + [(stages[0], stages[-1])]
+        for first, second in pairs:
+            name = '%s.%s-%s' % (path, first, second)
+            result[name] = [o[second] - o[first] for o in found[path]
+                            if first in o and second in o and o[second] >= o[first]]
+    return result
+
+
+def print_histogram(name, values, out):
+    stats = summary(values)
+    print('%s: %d, p50 %d us, p90 %d us, p99 %d us, max %d us' %
+          (name, stats['count'], stats['p50'], stats['p90'], stats['p99'], stats['max']), file=out)
+    buckets = histogram(values)
+    peak = max(count for _, count in buckets)
+    for low, count in buckets:
+        print('  %10d us %7d %s' % (low, count, '#' * ((count * BAR_WIDTH + peak - 1) // peak)),
+              file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('events', help='events file of simlatency')
+    parser.add_argument('--json', help='write the statistics and histograms here too')
+    args = parser.parse_args()
+
+    found = occurrences(load(args.events))
+    report = {}
+    for name, values in intervals(found).items():
+        if not values:
+            print('%s: no sample' % name)
+            continue
+        print_histogram(name, values, sys.stdout)
+        report[name] = summary(values)
+        report[name]['histogram'] = histogram(values)
+
+    # The stage that weighs most on each path, by median
+    for path, stages in PATHS.items():
+        names = ['%s.%s-%s' % (path, a, b) for a, b in zip(stages, stages[1:])]
+        names = [name for name in names if name in report]
+        if names:
+            worst = max(names, key=lambda name: report[name]['p50'])
+            print('%s: dominated by %s' % (path, worst.split('.', 1)[1]))
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(report, f, indent=2)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+Static RAM usage of each module, from the linker map of the firmware.
+
+Link with -Wl,-Map=smart_node.map (add -fdata-sections to see each
+variable), then:
+
+    ram_report.py smart_node.map
+    ram_report.py --symbols smart_node.map    (one line per variable)
+
+The free RAM left for the stack is what the target reports as boot_free
+with COMMAND_OP_MEMORY; the lowest_free it reports, compared with this
+table, tells how much a buffer can grow.
+
+@date 19 ott 2026
+@author Leonardo Ricupero
+"""
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+RAM_SIZE = 2048
+SRAM_BASE = 0x800100    # data address space as seen by the linker
+SECTIONS = ('.data', '.bss', '.noinit')
+
+# " .bss.Pages  0x00800160  0x80 obj/logger.o", the name alone on its line
+# when too long, followed by the rest on the next one
+INPUT_SECTION = re.compile(
+    r'^ (?P<section>\.(?:data|bss|noinit)(?:\.(?P<symbol>\S+))?)'
+    r'\s+0x(?P<address>[0-9a-fA-F]+)\s+0x(?P<size>[0-9a-fA-F]+)\s+(?P<file>\S+)')
+COMMON = re.compile(
+    r'^ (?P<section>COMMON)\s+0x(?P<address>[0-9a-fA-F]+)'
+    r'\s+0x(?P<size>[0-9a-fA-F]+)\s+(?P<file>\S+)')
+
+
+def module(path):
+    """Object or library member to module name"""
+    member = re.search(r'\((.+)\)$', path)
+    name = os.path.basename(member.group(1) if member else path)
+    return os.path.splitext(name)[0]
+
+
+def parse(lines):
+    """Yield (module, section, symbol, size) of each RAM input section"""
+    joined = []
+    for line in lines:
+        line = line.rstrip('\n')
+        if joined and re.match(r'^\s+0x', line) and re.match(r'^ \.\S+$|^ COMMON$', joined[-1]):
+            joined[-1] += line
+        else:
+            joined.append(line)
+
+    for line in joined:
+        match = INPUT_SECTION.match(line) or COMMON.match(line)
+        if not match:
+            continue
+        address, size = int(match.group('address'), 16), int(match.group('size'), 16)
+        if size == 0 or address < SRAM_BASE:
+            continue
+        section = match.group('section')
+        kind = '.bss' if section == 'COMMON' else next(s for s in SECTIONS if section.startswith(s))
+        symbol = match.groupdict().get('symbol') or ''
+        yield module(match.group('file')), kind, symbol, size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('map', help='linker map file')
+    parser.add_argument('--symbols', action='store_true', help='list each variable')
+    args = parser.parse_args()
+
+    with open(args.map) as map_file:
+        entries = list(parse(map_file))
+    if not entries:
+        sys.exit('no RAM section found, is it an avr-gcc map file?')
+
+    usage = collections.defaultdict(lambda: collections.Counter())
+    for name, kind, _, size in entries:
+        usage[name][kind] += size
+
+    print('%-20s %7s %7s %7s %7s' % (('module',) + SECTIONS + ('total',)))
+    totals = collections.Counter()
+    for name in sorted(usage, key=lambda n: -sum(usage[n].values())):
+        row = usage[name]
+        totals.update(row)
+        print('%-20s %7d %7d %7d %7d' % ((name,) + tuple(row[s] for s in SECTIONS)
+                                         + (sum(row.values()),)))
+        if args.symbols:
+            for entry in sorted((e for e in entries if e[0] == name), key=lambda e: -e[3]):
+                print('    %-16s %-24s %5d' % (entry[1], entry[2] or '-', entry[3]))
+
+    used = sum(totals.values())
+    print('%-20s %7d %7d %7d %7d' % (('total',) + tuple(totals[s] for s in SECTIONS) + (used,)))
+    print('free for the stack: %d of %d bytes' % (RAM_SIZE - used, RAM_SIZE))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Decode the event trace dumped by the smart node and print a timeline.
+
+The input is the raw byte stream captured from the USART (a file, or stdin),
+which may hold command responses and log dumps too: only the trace frames,
+TRACE_DUMP_TAG then the number of records then the records, are decoded.
+Keep the names below in step with drivers/trace.h.
+
+    trace_decode.py capture.bin
+    trace_decode.py --port /dev/ttyUSB0    (needs pyserial)
+
+@date 19 ott 2026
+@author Leonardo Ricupero
+"""
+
+import argparse
+import struct
+import sys
+
+TRACE_DUMP_TAG = ord('T')
+RECORD_SIZE = 4
+US_PER_COUNT = 4
+COUNTS_WRAP = 1 << 16
+WRAP_US = COUNTS_WRAP * US_PER_COUNT
+GAP_UNIT_US = 100000
+
+SOURCES = [
+    'TRACE', 'ONEWIRE', 'TEMP_SENSOR', 'RELAYS', 'EXT_EEPROM', 'RADIO',
+    'USART', 'THERMOSTAT', 'COMMAND', 'CRITICAL',
+    'MEMORY', 'EVENT',
+]
+EVENTS = [
+    'STATE', 'ISR', 'PUT', 'GET', 'BEGIN', 'END', 'ERROR', 'FAULT', 'BOOT',
+    'GAP',
+]
+EVENT_BOOT = EVENTS.index('BOOT')
+EVENT_GAP = EVENTS.index('GAP')
+
+RESET_FLAGS = [(0x01, 'power-on'), (0x02, 'external'), (0x04, 'brown-out'),
+               (0x08, 'watchdog')]
+
+
+def name(table, index):
+    return table[index] if index < len(table) else str(index)
+
+
+def frames(data):
+    """Yield the records of each trace frame found in the stream"""
+    i = 0
+    while i + 2 <= len(data):
+        if data[i] == TRACE_DUMP_TAG:
+            count = data[i + 1]
+            end = i + 2 + count * RECORD_SIZE
+            if end <= len(data):
+                yield [struct.unpack_from('>HBB', data, i + 2 + n * RECORD_SIZE)
+                       for n in range(count)]
+                i = end
+                continue
+        i += 1
+
+
+def describe(source, event, arg):
+    if source == 0 and event == EVENT_BOOT:
+        flags = [text for bit, text in RESET_FLAGS if arg & bit]
+        return 'reset: ' + (', '.join(flags) if flags else 'none')
+    if source == 0 and event == EVENT_GAP:
+        return 'silence of %s%.1f s' % ('at least ' if arg == 0xFF else '',
+                                          arg * GAP_UNIT_US / 1e6)
+    return '%-11s %-5s %3d  0x%02X' % (name(SOURCES, source),
+                                       name(EVENTS, event), arg, arg)
+
+
+def timeline(records):
+    """
+    Rebuild the time of each record. The 16-bit timestamps are unwrapped
+    assuming less than one wrap between records, unless a gap record says
+    otherwise; a boot record restarts the clock.
+    """
+    now_us = 0
+    last = None
+    lines = []
+    for time, code, arg in records:
+        source, event = code >> 4, code & 0x0F
+        if source == 0 and event == EVENT_BOOT:
+            now_us = 0
+            lines.append('-' * 60)
+        elif last is not None:
+            delta_us = ((time - last) % COUNTS_WRAP) * US_PER_COUNT
+            if source == 0 and event == EVENT_GAP:
+                # The gap is known to the unit, the timestamp gives the
+                # rest: add the whole wraps that bring it in that unit
+                wraps = (arg * GAP_UNIT_US + GAP_UNIT_US // 2 - delta_us) / WRAP_US
+                delta_us += max(0, round(wraps)) * WRAP_US
+            now_us += delta_us
+        last = time
+        lines.append('%12.3f ms  %s' % (now_us / 1000.0,
+                                        describe(source, event, arg)))
+    return lines
+
+
+def read_port(port, baudrate, seconds):
+    import serial
+    with serial.Serial(port, baudrate, timeout=seconds) as line:
+        return line.read(1 + 255 * RECORD_SIZE + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('capture', nargs='?', help='raw capture, stdin if omitted')
+    parser.add_argument('--port', help='read a dump from a serial port instead')
+    parser.add_argument('--baudrate', type=int, default=9600)
+    parser.add_argument('--timeout', type=float, default=5.0)
+    args = parser.parse_args()
+
+    if args.port:
+        data = read_port(args.port, args.baudrate, args.timeout)
+    elif args.capture:
+        with open(args.capture, 'rb') as capture:
+            data = capture.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    found = False
+    for records in frames(data):
+        found = True
+        print('trace, %d records' % len(records))
+        print('\n'.join(timeline(records)))
+    if not found:
+        sys.exit('no trace dump found')
+
+
+if __name__ == '__main__':
+    main()